@@ -35,6 +35,7 @@ int kmersearch_force_simd_capability = -1;  /* -1 means auto-detect */
 /* Global variables for k-mer search configuration */
 int kmersearch_occur_bitlen = 8;  /* Default 8 bits for occurrence count */
 int kmersearch_kmer_size = 16;  /* Default k-mer size */
+int kmersearch_syncmer_size = 8;  /* Default s-mer length for open syncmer sampling */
 double kmersearch_max_appearance_rate = 0.5;  /* Default max appearance rate */
 int kmersearch_max_appearance_nrow = 0;  /* Default max appearance nrow (0 = undefined) */
 int kmersearch_min_score = 1;  /* Default minimum score for GIN search */
@@ -46,6 +47,11 @@ int kmersearch_query_kmer_cache_max_entries = 50000;  /* Default max query-kmer
 int kmersearch_actual_min_score_cache_max_entries = 50000;  /* Default max actual min score cache entries */
 int kmersearch_highfreq_kmer_cache_load_batch_size = 10000;  /* Default batch size for loading high-frequency k-mers */
 int kmersearch_highfreq_analysis_hashtable_size = 1000000;  /* Default hash table size for high-frequency k-mer analysis */
+int kmersearch_highfreq_analysis_mode = KMERSEARCH_ANALYSIS_EXACT;  /* Default to exact counting */
+int kmersearch_highfreq_analysis_summary_size = 100000;  /* Default counters per heavy-hitter summary */
+double kmersearch_highfreq_analysis_sample_confidence = 0.95;  /* Default confidence of sampled analysis */
+int kmersearch_shared_query_kmer_cache_size = 0;  /* Shared query-kmer cache size in kB (0 = disabled) */
+int kmersearch_shared_highfreq_kmer_cache_size = 0;  /* Shared high-frequency k-mer cache size in kB (0 = disabled) */
 
 /* Global cache managers */
 ActualMinScoreCacheManager *actual_min_score_cache_manager = NULL;
@@ -56,6 +62,14 @@ QueryKmerCacheManager *query_kmer_cache_manager = NULL;
 
 void _PG_init(void);
 
+/* Values of kmersearch.highfreq_analysis_mode */
+static const struct config_enum_entry kmersearch_highfreq_analysis_mode_options[] = {
+    {"exact", KMERSEARCH_ANALYSIS_EXACT, false},
+    {"approximate", KMERSEARCH_ANALYSIS_APPROXIMATE, false},
+    {"approximate_verified", KMERSEARCH_ANALYSIS_APPROXIMATE_VERIFIED, false},
+    {NULL, 0, false}
+};
+
 /* DNA2 encoding table */
 const uint8 kmersearch_dna2_encode_table[256] = {
     ['A'] = 0, ['a'] = 0,
@@ -133,6 +147,13 @@ PG_FUNCTION_INFO_V1(kmersearch_dna4_match);
 
 PG_FUNCTION_INFO_V1(kmersearch_matchscore_dna2);
 PG_FUNCTION_INFO_V1(kmersearch_matchscore_dna4);
+PG_FUNCTION_INFO_V1(kmersearch_dna2_match_canonical);
+PG_FUNCTION_INFO_V1(kmersearch_dna4_match_canonical);
+PG_FUNCTION_INFO_V1(kmersearch_matchscore_canonical_dna2);
+PG_FUNCTION_INFO_V1(kmersearch_matchscore_canonical_dna4);
+PG_FUNCTION_INFO_V1(kmersearch_dna2_distance);
+PG_FUNCTION_INFO_V1(kmersearch_dna4_distance);
+PG_FUNCTION_INFO_V1(kmersearch_search_batch);
 static simd_capability_t detect_cpu_capabilities(void);
 
 
@@ -197,6 +218,8 @@ kmersearch_kmer_size_assign_hook(int newval, void *extra)
     /* Clear actual min score cache */
     if (actual_min_score_cache_manager)
         kmersearch_free_actual_min_score_cache_manager(&actual_min_score_cache_manager);
+    /* Compiled queries resolve actual_min_score without the cache manager */
+    kmersearch_invalidate_compiled_query_scores();
     
     /* Clear high-frequency k-mer cache with conditional warning */
     clear_highfreq_cache_with_warning();
@@ -211,6 +234,8 @@ kmersearch_max_appearance_rate_assign_hook(double newval, void *extra)
     /* Clear actual min score cache */
     if (actual_min_score_cache_manager)
         kmersearch_free_actual_min_score_cache_manager(&actual_min_score_cache_manager);
+    /* Compiled queries resolve actual_min_score without the cache manager */
+    kmersearch_invalidate_compiled_query_scores();
     
     /* Clear high-frequency k-mer cache with conditional warning */
     clear_highfreq_cache_with_warning();
@@ -225,6 +250,8 @@ kmersearch_max_appearance_nrow_assign_hook(int newval, void *extra)
     /* Clear actual min score cache */
     if (actual_min_score_cache_manager)
         kmersearch_free_actual_min_score_cache_manager(&actual_min_score_cache_manager);
+    /* Compiled queries resolve actual_min_score without the cache manager */
+    kmersearch_invalidate_compiled_query_scores();
     
     /* Clear high-frequency k-mer cache with conditional warning */
     clear_highfreq_cache_with_warning();
@@ -239,6 +266,8 @@ kmersearch_min_score_assign_hook(int newval, void *extra)
     /* Clear actual min score cache */
     if (actual_min_score_cache_manager)
         kmersearch_free_actual_min_score_cache_manager(&actual_min_score_cache_manager);
+    /* Compiled queries resolve actual_min_score without the cache manager */
+    kmersearch_invalidate_compiled_query_scores();
 }
 
 /* Min shared k-mer rate change affects actual min score cache */
@@ -250,6 +279,8 @@ kmersearch_min_shared_kmer_rate_assign_hook(double newval, void *extra)
     /* Clear actual min score cache */
     if (actual_min_score_cache_manager)
         kmersearch_free_actual_min_score_cache_manager(&actual_min_score_cache_manager);
+    /* Compiled queries resolve actual_min_score without the cache manager */
+    kmersearch_invalidate_compiled_query_scores();
 }
 
 static bool
@@ -450,6 +481,19 @@ _PG_init(void)
                            kmersearch_kmer_size_assign_hook,
                            NULL);
     
+    DefineCustomIntVariable("kmersearch.syncmer_size",
+                           "S-mer length used by the syncmer-sampling GIN operator classes",
+                           "A k-mer is indexed when its smallest s-mer lies at the middle offset; must be smaller than kmersearch.kmer_size",
+                           &kmersearch_syncmer_size,
+                           8,
+                           1,
+                           31,
+                           PGC_USERSET,
+                           0,
+                           NULL,
+                           NULL,
+                           NULL);
+    
     DefineCustomRealVariable("kmersearch.min_shared_kmer_rate",
                             "Minimum shared k-mer rate for =% operator matching",
                             "Minimum ratio of shared k-mers between query and target sequence (0.0-1.0)",
@@ -550,10 +594,100 @@ _PG_init(void)
                            NULL,
                            NULL,
                            NULL);
+
+    DefineCustomEnumVariable("kmersearch.highfreq_analysis_mode",
+                            "Counting method of high-frequency k-mer analysis",
+                            "exact counts every k-mer through temporary files; approximate keeps a fixed-size heavy-hitter summary per worker; approximate_verified also counts the candidates exactly in a second scan.",
+                            &kmersearch_highfreq_analysis_mode,
+                            KMERSEARCH_ANALYSIS_EXACT,
+                            kmersearch_highfreq_analysis_mode_options,
+                            PGC_USERSET,
+                            0,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    DefineCustomIntVariable("kmersearch.highfreq_analysis_summary_size",
+                           "Counters per heavy-hitter summary in approximate analysis",
+                           "Each worker and the merged summary keep this many k-mer counters. Counts are overestimated by at most the number of k-mers scanned divided by this value.",
+                           &kmersearch_highfreq_analysis_summary_size,
+                           100000,
+                           1000,
+                           10000000,
+                           PGC_USERSET,
+                           0,
+                           NULL,
+                           NULL,
+                           NULL);
+
+    DefineCustomRealVariable("kmersearch.highfreq_analysis_sample_confidence",
+                            "Confidence level of sampled high-frequency k-mer analysis",
+                            "A sampled k-mer is reported as high-frequency when the lower binomial confidence bound of its appearance rate at this level exceeds the threshold.",
+                            &kmersearch_highfreq_analysis_sample_confidence,
+                            0.95,
+                            0.5,
+                            0.9999,
+                            PGC_USERSET,
+                            0,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    DefineCustomIntVariable("kmersearch.shared_query_kmer_cache_size",
+                           "Size of the shared query-kmer cache",
+                           "Compiled query k-mers are shared between backends up to this size. 0 disables the shared cache.",
+                           &kmersearch_shared_query_kmer_cache_size,
+                           0,
+                           0,
+                           MAX_KILOBYTES,
+                           PGC_SIGHUP,
+                           GUC_UNIT_KB,
+                           NULL,
+                           NULL,
+                           NULL);
+    
+    DefineCustomIntVariable("kmersearch.shared_highfreq_kmer_cache_size",
+                           "Size of the shared high-frequency k-mer cache",
+                           "High-frequency k-mers published with kmersearch_shared_highfreq_kmer_cache_load() are kept in shared memory of this size and reloaded at server start. Twice this size is reserved so that a reload never overwrites the set in use. 0 disables the shared cache.",
+                           &kmersearch_shared_highfreq_kmer_cache_size,
+                           0,
+                           0,
+                           MAX_KILOBYTES,
+                           PGC_POSTMASTER,
+                           GUC_UNIT_KB,
+                           NULL,
+                           NULL,
+                           NULL);
+    
+    /* Leader cache state copied into parallel workers (set internally) */
+    DefineCustomStringVariable("kmersearch.highfreq_cache_source",
+                              "High-frequency k-mer cache loaded by the leader backend",
+                              NULL,
+                              &kmersearch_highfreq_cache_source,
+                              "",
+                              PGC_SUSET,
+                              GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE | GUC_DISALLOW_IN_FILE | GUC_NO_RESET_ALL,
+                              NULL,
+                              NULL,
+                              NULL);
+
+    DefineCustomStringVariable("kmersearch.parallel_highfreq_cache_handle",
+                              "DSM handle of the parallel high-frequency k-mer cache",
+                              NULL,
+                              &kmersearch_parallel_highfreq_cache_handle,
+                              "",
+                              PGC_SUSET,
+                              GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE | GUC_DISALLOW_IN_FILE | GUC_NO_RESET_ALL,
+                              NULL,
+                              NULL,
+                              NULL);
     
     /* Initialize high-frequency k-mer cache */
     kmersearch_highfreq_kmer_cache_init();
 
+    /* Reserve shared memory for the shared query-kmer and high-frequency k-mer caches */
+    kmersearch_shmem_init();
+
     /* Initialize planner hook for index settings validation */
     kmersearch_planner_init();
 
@@ -831,13 +965,13 @@ kmersearch_expand_dna4_to_uintkey(VarBit *dna4_seq, int start_pos, int k,
  * Extract k-mers from DNA2 sequence directly as Datum array
  */
 Datum *
-kmersearch_extract_datum_from_dna2(VarBit *dna_seq, int *nkeys, size_t key_size)
+kmersearch_extract_datum_from_dna2(VarBit *dna_seq, int *nkeys, size_t key_size, bool canonical)
 {
     void *uintkey = NULL;
     Datum *keys = NULL;
     
     /* Extract uintkey array */
-    kmersearch_extract_uintkey_from_dna2(dna_seq, &uintkey, nkeys);
+    kmersearch_extract_uintkey_from_dna2(dna_seq, &uintkey, nkeys, canonical);
     
     if (uintkey == NULL || *nkeys == 0)
         return NULL;
@@ -855,13 +989,13 @@ kmersearch_extract_datum_from_dna2(VarBit *dna_seq, int *nkeys, size_t key_size)
  * Extract k-mers from DNA4 sequence directly as Datum array
  */
 Datum *
-kmersearch_extract_datum_from_dna4(VarBit *dna_seq, int *nkeys, size_t key_size)
+kmersearch_extract_datum_from_dna4(VarBit *dna_seq, int *nkeys, size_t key_size, bool canonical)
 {
     void *uintkey = NULL;
     Datum *keys = NULL;
     
     /* Extract uintkey array */
-    kmersearch_extract_uintkey_from_dna4(dna_seq, &uintkey, nkeys);
+    kmersearch_extract_uintkey_from_dna4(dna_seq, &uintkey, nkeys, canonical);
     
     if (uintkey == NULL || *nkeys == 0)
         return NULL;
@@ -884,41 +1018,18 @@ kmersearch_extract_datum_from_dna4(VarBit *dna_seq, int *nkeys, size_t key_size)
 Datum
 kmersearch_dna2_match(PG_FUNCTION_ARGS)
 {
-    VarBit *sequence = PG_GETARG_VARBIT_P(0);
-    text *pattern = PG_GETARG_TEXT_P(1);
-    char *pattern_string = text_to_cstring(pattern);
-    void *query_uintkey = NULL;
-    void *seq_uintkey = NULL;
-    int query_nkeys = 0;
-    int seq_nkeys = 0;
-    int shared_count = 0;
-    int actual_min_score;
+    Datum sequence = PG_GETARG_DATUM(0);   /* detoasted slice by slice */
+    text *pattern = PG_GETARG_TEXT_PP(1);
+    QueryKmerCacheEntry *query;
     bool match = false;
     
-    /* Extract uintkeys from query using cache */
-    query_uintkey = kmersearch_get_cached_query_uintkey(pattern_string, kmersearch_kmer_size, &query_nkeys);
+    /* Compiled query (keys, probe set and actual min score) from cache */
+    query = kmersearch_get_compiled_query(fcinfo->flinfo, pattern, false);
     
-    if (query_uintkey != NULL && query_nkeys > 0) {
-        /* Extract uintkeys from DNA2 sequence */
-        kmersearch_extract_uintkey_from_dna2(sequence, &seq_uintkey, &seq_nkeys);
-        
-        if (seq_uintkey != NULL && seq_nkeys > 0) {
-            /* Count shared k-mers using optimized function */
-            shared_count = kmersearch_count_matching_uintkey(seq_uintkey, seq_nkeys, 
-                                                            query_uintkey, query_nkeys, kmersearch_kmer_size);
-            pfree(seq_uintkey);
-        }
-        
-        /* Get cached actual min score */
-        actual_min_score = kmersearch_get_cached_actual_min_score_uintkey(query_uintkey, query_nkeys, kmersearch_kmer_size);
-        
-        /* Evaluate match condition */
-        match = (shared_count >= actual_min_score);
-        
-        /* Do not free query_uintkey - managed by cache */
-    }
+    /* Extract and count in one pass, stopping once the outcome is decided */
+    if (query != NULL)
+        match = kmersearch_evaluate_match_dna2(sequence, query);
     
-    pfree(pattern_string);
     PG_RETURN_BOOL(match);
 }
 
@@ -928,41 +1039,18 @@ kmersearch_dna2_match(PG_FUNCTION_ARGS)
 Datum
 kmersearch_dna4_match(PG_FUNCTION_ARGS)
 {
-    VarBit *sequence = PG_GETARG_VARBIT_P(0);
-    text *pattern = PG_GETARG_TEXT_P(1);
-    char *pattern_string = text_to_cstring(pattern);
-    void *query_uintkey = NULL;
-    void *seq_uintkey = NULL;
-    int query_nkeys = 0;
-    int seq_nkeys = 0;
-    int shared_count = 0;
-    int actual_min_score;
+    Datum sequence = PG_GETARG_DATUM(0);   /* detoasted slice by slice */
+    text *pattern = PG_GETARG_TEXT_PP(1);
+    QueryKmerCacheEntry *query;
     bool match = false;
     
-    /* Extract uintkeys from query using cache */
-    query_uintkey = kmersearch_get_cached_query_uintkey(pattern_string, kmersearch_kmer_size, &query_nkeys);
+    /* Compiled query (keys, probe set and actual min score) from cache */
+    query = kmersearch_get_compiled_query(fcinfo->flinfo, pattern, false);
     
-    if (query_uintkey != NULL && query_nkeys > 0) {
-        /* Extract uintkeys from DNA4 sequence (with degenerate expansion) */
-        kmersearch_extract_uintkey_from_dna4(sequence, &seq_uintkey, &seq_nkeys);
-        
-        if (seq_uintkey != NULL && seq_nkeys > 0) {
-            /* Count shared k-mers using optimized function */
-            shared_count = kmersearch_count_matching_uintkey(seq_uintkey, seq_nkeys, 
-                                                            query_uintkey, query_nkeys, kmersearch_kmer_size);
-            pfree(seq_uintkey);
-        }
-        
-        /* Get cached actual min score */
-        actual_min_score = kmersearch_get_cached_actual_min_score_uintkey(query_uintkey, query_nkeys, kmersearch_kmer_size);
-        
-        /* Evaluate match condition */
-        match = (shared_count >= actual_min_score);
-        
-        /* Do not free query_uintkey - managed by cache */
-    }
+    /* Extract and count in one pass, stopping once the outcome is decided */
+    if (query != NULL)
+        match = kmersearch_evaluate_match_dna4(sequence, query);
     
-    pfree(pattern_string);
     PG_RETURN_BOOL(match);
 }
 
@@ -975,76 +1063,505 @@ kmersearch_dna4_match(PG_FUNCTION_ARGS)
 Datum
 kmersearch_matchscore_dna2(PG_FUNCTION_ARGS)
 {
-    VarBit *sequence = PG_GETARG_VARBIT_P(0);  /* DNA2 is stored as VarBit */
-    text *query_text = PG_GETARG_TEXT_P(1);
-    char *query_string;
-    void *query_uintkey = NULL;
-    void *seq_uintkey = NULL;
-    int query_nkeys = 0;
-    int seq_nkeys = 0;
+    Datum sequence = PG_GETARG_DATUM(0);   /* detoasted slice by slice */
+    text *query_text = PG_GETARG_TEXT_PP(1);
+    QueryKmerCacheEntry *query;
     int shared_count = 0;
     
-    query_string = text_to_cstring(query_text);
+    /* Compiled query from cache */
+    query = kmersearch_get_compiled_query(fcinfo->flinfo, query_text, false);
     
-    /* Extract uintkeys from DNA2 sequence */
-    kmersearch_extract_uintkey_from_dna2(sequence, &seq_uintkey, &seq_nkeys);
+    /* Stream sequence keys into the compiled query probe */
+    if (query != NULL)
+        shared_count = kmersearch_count_shared_dna2(sequence, query);
     
-    /* Extract uintkeys from query using cache */
-    query_uintkey = kmersearch_get_cached_query_uintkey(query_string, kmersearch_kmer_size, &query_nkeys);
+    /* Return corrected score (shared k-mer count) */
+    PG_RETURN_INT32(shared_count);
+}
+
+Datum
+kmersearch_matchscore_dna4(PG_FUNCTION_ARGS)
+{
+    Datum sequence = PG_GETARG_DATUM(0);   /* detoasted slice by slice */
+    text *query_text = PG_GETARG_TEXT_PP(1);
+    QueryKmerCacheEntry *query;
+    int shared_count = 0;
     
-    /* Count shared k-mers using optimized function */
-    if (seq_uintkey && query_uintkey && seq_nkeys > 0 && query_nkeys > 0) {
-        shared_count = kmersearch_count_matching_uintkey(seq_uintkey, seq_nkeys,
-                                                        query_uintkey, query_nkeys, kmersearch_kmer_size);
-    }
+    /* Compiled query from cache */
+    query = kmersearch_get_compiled_query(fcinfo->flinfo, query_text, false);
     
-    /* Cleanup */
-    if (seq_uintkey) {
-        pfree(seq_uintkey);
-    }
-    /* Do not free query_uintkey - managed by cache */
-    pfree(query_string);
+    /* Stream sequence keys into the compiled query probe */
+    if (query != NULL)
+        shared_count = kmersearch_count_shared_dna4(sequence, query);
     
     /* Return corrected score (shared k-mer count) */
     PG_RETURN_INT32(shared_count);
 }
 
+/*
+ * Canonical =%% operators: strand-independent k-mer search
+ *
+ * Both the sequence and the query are reduced to min(k-mer, reverse
+ * complement), so a read matches on either strand with one evaluation.
+ */
 Datum
-kmersearch_matchscore_dna4(PG_FUNCTION_ARGS)
+kmersearch_dna2_match_canonical(PG_FUNCTION_ARGS)
+{
+    Datum sequence = PG_GETARG_DATUM(0);   /* detoasted slice by slice */
+    text *pattern = PG_GETARG_TEXT_PP(1);
+    QueryKmerCacheEntry *query;
+    bool match = false;
+    
+    query = kmersearch_get_compiled_query(fcinfo->flinfo, pattern, true);
+    
+    if (query != NULL)
+        match = kmersearch_evaluate_match_dna2(sequence, query);
+    
+    PG_RETURN_BOOL(match);
+}
+
+Datum
+kmersearch_dna4_match_canonical(PG_FUNCTION_ARGS)
+{
+    Datum sequence = PG_GETARG_DATUM(0);   /* detoasted slice by slice */
+    text *pattern = PG_GETARG_TEXT_PP(1);
+    QueryKmerCacheEntry *query;
+    bool match = false;
+    
+    query = kmersearch_get_compiled_query(fcinfo->flinfo, pattern, true);
+    
+    if (query != NULL)
+        match = kmersearch_evaluate_match_dna4(sequence, query);
+    
+    PG_RETURN_BOOL(match);
+}
+
+/*
+ * Canonical match score functions (shared canonical k-mer count)
+ */
+Datum
+kmersearch_matchscore_canonical_dna2(PG_FUNCTION_ARGS)
 {
-    VarBit *sequence = PG_GETARG_VARBIT_P(0);  /* DNA4 is stored as VarBit */
-    text *query_text = PG_GETARG_TEXT_P(1);
-    char *query_string = text_to_cstring(query_text);
-    void *query_uintkey = NULL;
-    void *seq_uintkey = NULL;
-    int query_nkeys = 0;
-    int seq_nkeys = 0;
+    Datum sequence = PG_GETARG_DATUM(0);   /* detoasted slice by slice */
+    text *query_text = PG_GETARG_TEXT_PP(1);
+    QueryKmerCacheEntry *query;
     int shared_count = 0;
-    int k_size = kmersearch_kmer_size;
     
-    /* Extract uintkeys from DNA4 sequence (with degenerate expansion) */
-    kmersearch_extract_uintkey_from_dna4(sequence, &seq_uintkey, &seq_nkeys);
+    query = kmersearch_get_compiled_query(fcinfo->flinfo, query_text, true);
     
-    /* Extract uintkeys from query using cache */
-    query_uintkey = kmersearch_get_cached_query_uintkey(query_string, k_size, &query_nkeys);
+    if (query != NULL)
+        shared_count = kmersearch_count_shared_dna2(sequence, query);
     
-    /* Count shared k-mers using optimized function */
-    if (seq_uintkey && query_uintkey && seq_nkeys > 0 && query_nkeys > 0) {
-        shared_count = kmersearch_count_matching_uintkey(seq_uintkey, seq_nkeys,
-                                                        query_uintkey, query_nkeys, kmersearch_kmer_size);
-    }
+    PG_RETURN_INT32(shared_count);
+}
+
+Datum
+kmersearch_matchscore_canonical_dna4(PG_FUNCTION_ARGS)
+{
+    Datum sequence = PG_GETARG_DATUM(0);   /* detoasted slice by slice */
+    text *query_text = PG_GETARG_TEXT_PP(1);
+    QueryKmerCacheEntry *query;
+    int shared_count = 0;
     
-    /* Cleanup */
-    if (seq_uintkey) {
-        pfree(seq_uintkey);
-    }
-    /* Do not free query_uintkey - managed by cache */
-    pfree(query_string);
+    query = kmersearch_get_compiled_query(fcinfo->flinfo, query_text, true);
+    
+    if (query != NULL)
+        shared_count = kmersearch_count_shared_dna4(sequence, query);
     
-    /* Return corrected score (shared k-mer count) */
     PG_RETURN_INT32(shared_count);
 }
 
+/*
+ * <-> distance operators: query k-mers NOT shared with the sequence
+ *
+ * For a fixed query this orders rows exactly like kmersearch_matchscore()
+ * descending, so ORDER BY dna_seq <-> 'q' LIMIT n returns the best hits.
+ */
+Datum
+kmersearch_dna2_distance(PG_FUNCTION_ARGS)
+{
+    Datum sequence = PG_GETARG_DATUM(0);   /* detoasted slice by slice */
+    text *query_text = PG_GETARG_TEXT_PP(1);
+    QueryKmerCacheEntry *query;
+    int distance = 0;
+
+    query = kmersearch_get_compiled_query(fcinfo->flinfo, query_text, false);
+
+    if (query != NULL)
+        distance = query->kmer_count - kmersearch_count_shared_dna2(sequence, query);
+
+    PG_RETURN_INT32(distance);
+}
+
+Datum
+kmersearch_dna4_distance(PG_FUNCTION_ARGS)
+{
+    Datum sequence = PG_GETARG_DATUM(0);   /* detoasted slice by slice */
+    text *query_text = PG_GETARG_TEXT_PP(1);
+    QueryKmerCacheEntry *query;
+    int distance = 0;
+
+    query = kmersearch_get_compiled_query(fcinfo->flinfo, query_text, false);
+
+    if (query != NULL)
+        distance = query->kmer_count - kmersearch_count_shared_dna4(sequence, query);
+
+    PG_RETURN_INT32(distance);
+}
+
+/*
+ * Check that a column exists and holds DNA2 or DNA4; returns true for DNA4
+ */
+static bool
+kmersearch_sequence_column_is_dna4(Oid table_oid, const char *column_name)
+{
+    AttrNumber column_attnum;
+    Oid column_type_oid;
+
+    column_attnum = get_attnum(table_oid, column_name);
+    if (column_attnum == InvalidAttrNumber)
+        ereport(ERROR,
+                (errcode(ERRCODE_UNDEFINED_COLUMN),
+                 errmsg("column \"%s\" does not exist", column_name)));
+
+    column_type_oid = get_atttype(table_oid, column_attnum);
+    if (column_type_oid != TypenameGetTypid("dna2") &&
+        column_type_oid != TypenameGetTypid("dna4"))
+        ereport(ERROR,
+                (errcode(ERRCODE_DATATYPE_MISMATCH),
+                 errmsg("column \"%s\" must be DNA2 or DNA4 type", column_name)));
+    return column_type_oid == TypenameGetTypid("dna4");
+}
+
+/*
+ * Multi-query batch search
+ *
+ * kmersearch_search_batch() merges the keys of all queries into one
+ * dictionary that maps each distinct uintkey to the queries using it.
+ * Candidate rows come from one =% ANY bitmap scan of the column's GIN index
+ * (one index probe per query, OR'ed into one bitmap); every candidate is
+ * then extracted once, crediting all queries at the same time instead of
+ * rechecking =% per query.
+ */
+static int
+kmersearch_batch_posting_cmp(const void *a, const void *b)
+{
+    const KmerBatchPosting *x = (const KmerBatchPosting *) a;
+    const KmerBatchPosting *y = (const KmerBatchPosting *) b;
+
+    if (x->key != y->key)
+        return (x->key > y->key) ? 1 : -1;
+    return (x->query > y->query) - (x->query < y->query);
+}
+
+/*
+ * Build the combined key dictionary from a text[] of queries
+ * NULL queries and queries without k-mers never match.
+ */
+static void
+kmersearch_batch_dictionary_build(KmerBatchDictionary *dict, Datum *queries, bool *query_nulls, int nqueries)
+{
+    int total_bits = kmersearch_kmer_size * 2 + kmersearch_occur_bitlen;
+    KmerBatchPosting *pairs = NULL;
+    Size npairs = 0;
+    Size capacity = 0;
+    int table_size = 16;
+    int log2_size = 4;
+    int nkeys = 0;
+    int npostings = 0;
+
+    dict->nqueries = nqueries;
+    dict->min_score = (int *) palloc(sizeof(int) * Max(nqueries, 1));
+
+    for (int q = 0; q < nqueries; q++)
+    {
+        char *query_string;
+        void *uintkey = NULL;
+        int query_nkeys = 0;
+
+        dict->min_score[q] = INT_MAX;
+        if (query_nulls[q])
+            continue;
+
+        query_string = TextDatumGetCString(queries[q]);
+        kmersearch_extract_uintkey_from_text(query_string, &uintkey, &query_nkeys, false);
+        pfree(query_string);
+        if (uintkey == NULL || query_nkeys == 0)
+            continue;
+
+        dict->min_score[q] = kmersearch_get_cached_actual_min_score_uintkey(uintkey, query_nkeys,
+                                                                             kmersearch_kmer_size);
+
+        if (npairs + query_nkeys > capacity)
+        {
+            capacity = Max(capacity * 2, npairs + query_nkeys);
+            if (pairs == NULL)
+                pairs = (KmerBatchPosting *) palloc_extended(sizeof(KmerBatchPosting) * capacity,
+                                                             MCXT_ALLOC_HUGE);
+            else
+                pairs = (KmerBatchPosting *) repalloc_huge(pairs, sizeof(KmerBatchPosting) * capacity);
+        }
+
+        for (int i = 0; i < query_nkeys; i++)
+        {
+            if (total_bits <= 16)
+                pairs[npairs].key = ((uint16 *) uintkey)[i];
+            else if (total_bits <= 32)
+                pairs[npairs].key = ((uint32 *) uintkey)[i];
+            else
+                pairs[npairs].key = ((uint64 *) uintkey)[i];
+            pairs[npairs].query = q;
+            npairs++;
+        }
+        pfree(uintkey);
+    }
+
+    if (npairs > 0)
+        qsort(pairs, npairs, sizeof(KmerBatchPosting), kmersearch_batch_posting_cmp);
+
+    /* Compress into distinct keys with their query lists */
+    for (Size i = 0; i < npairs; i++)
+        if (i == 0 || pairs[i].key != pairs[i - 1].key)
+            nkeys++;
+
+    dict->nkeys = nkeys;
+    dict->keys = (uint64 *) palloc(sizeof(uint64) * Max(nkeys, 1));
+    dict->posting_start = (int *) palloc(sizeof(int) * (nkeys + 1));
+    dict->posting = (int *) palloc_extended(sizeof(int) * Max(npairs, 1), MCXT_ALLOC_HUGE);
+
+    nkeys = 0;
+    for (Size i = 0; i < npairs; i++)
+    {
+        if (i == 0 || pairs[i].key != pairs[i - 1].key)
+        {
+            dict->keys[nkeys] = pairs[i].key;
+            dict->posting_start[nkeys] = npostings;
+            nkeys++;
+        }
+        else if (pairs[i].query == pairs[i - 1].query)
+            continue;
+        dict->posting[npostings++] = pairs[i].query;
+    }
+    dict->posting_start[nkeys] = npostings;
+
+    if (pairs != NULL)
+        pfree(pairs);
+
+    /* Probe table of key indexes with load factor <= 0.5 */
+    while (table_size < nkeys * 2)
+    {
+        table_size <<= 1;
+        log2_size++;
+    }
+    dict->probe_table = (int *) palloc(sizeof(int) * table_size);
+    memset(dict->probe_table, 0xFF, sizeof(int) * table_size);
+    dict->probe_shift = 64 - log2_size;
+    dict->probe_mask = (uint64) (table_size - 1);
+
+    for (int i = 0; i < nkeys; i++)
+    {
+        uint64 slot = KMERSEARCH_PROBE_HASH(dict->keys[i], dict->probe_shift);
+
+        while (dict->probe_table[slot] >= 0)
+            slot = (slot + 1) & dict->probe_mask;
+        dict->probe_table[slot] = i;
+    }
+
+    dict->counts = (int *) palloc0(sizeof(int) * Max(nqueries, 1));
+    dict->touched = (int *) palloc(sizeof(int) * Max(nqueries, 1));
+    dict->ntouched = 0;
+}
+
+/*
+ * Credit one sequence key to every query that contains it
+ */
+static bool
+kmersearch_batch_consumer(uint64 uintkey, void *arg)
+{
+    KmerBatchDictionary *dict = (KmerBatchDictionary *) arg;
+    uint64 slot = KMERSEARCH_PROBE_HASH(uintkey, dict->probe_shift);
+    int idx;
+
+    while ((idx = dict->probe_table[slot]) >= 0)
+    {
+        if (dict->keys[idx] == uintkey)
+        {
+            for (int p = dict->posting_start[idx]; p < dict->posting_start[idx + 1]; p++)
+            {
+                int q = dict->posting[p];
+
+                if (dict->counts[q]++ == 0)
+                    dict->touched[dict->ntouched++] = q;
+            }
+            break;
+        }
+        slot = (slot + 1) & dict->probe_mask;
+    }
+    return true;
+}
+
+/*
+ * Whether a valid, non-partial GIN index answers =% on the column
+ */
+static bool
+kmersearch_column_has_gin_index(Oid table_oid, const char *column_name)
+{
+    AttrNumber column_attnum = get_attnum(table_oid, column_name);
+    Oid column_type_oid = get_atttype(table_oid, column_attnum);
+    Relation rel;
+    List *index_oids;
+    ListCell *lc;
+    bool found = false;
+
+    rel = table_open(table_oid, AccessShareLock);
+    index_oids = RelationGetIndexList(rel);
+
+    foreach(lc, index_oids)
+    {
+        Relation index_rel = index_open(lfirst_oid(lc), AccessShareLock);
+
+        found = (index_rel->rd_rel->relam == GIN_AM_OID &&
+                 index_rel->rd_index->indisvalid &&
+                 index_rel->rd_index->indkey.values[0] == column_attnum &&
+                 heap_attisnull(index_rel->rd_indextuple, Anum_pg_index_indpred, NULL) &&
+                 OidIsValid(get_opfamily_member(index_rel->rd_opfamily[0], column_type_oid,
+                                                TEXTOID, 1)));
+        index_close(index_rel, AccessShareLock);
+        if (found)
+            break;
+    }
+
+    list_free(index_oids);
+    table_close(rel, AccessShareLock);
+
+    return found;
+}
+
+Datum
+kmersearch_search_batch(PG_FUNCTION_ARGS)
+{
+    Oid table_oid = PG_GETARG_OID(0);
+    char *column_name = text_to_cstring(PG_GETARG_TEXT_PP(1));
+    ArrayType *query_array = PG_GETARG_ARRAYTYPE_P(2);
+    ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+    bool is_dna4;
+    Datum *queries;
+    bool *query_nulls;
+    int nqueries;
+    int lower_bound;
+    KmerBatchDictionary dict = {0};
+    MemoryContext row_context;
+    MemoryContext old_context;
+    StringInfoData sql;
+    Oid argtypes[1] = {TEXTARRAYOID};
+    Datum args[1];
+    Portal portal;
+
+    if (ARR_NDIM(query_array) > 1)
+        ereport(ERROR,
+                (errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+                 errmsg("queries must be a one-dimensional array")));
+
+    is_dna4 = kmersearch_sequence_column_is_dna4(table_oid, column_name);
+
+    InitMaterializedSRF(fcinfo, 0);
+
+    deconstruct_array_builtin(query_array, TEXTOID, &queries, &query_nulls, &nqueries);
+    if (nqueries == 0)
+        return (Datum) 0;
+    lower_bound = ARR_LBOUND(query_array)[0];
+
+    kmersearch_batch_dictionary_build(&dict, queries, query_nulls, nqueries);
+    if (dict.nkeys == 0)
+        return (Datum) 0;
+
+    row_context = AllocSetContextCreate(CurrentMemoryContext,
+                                        "kmersearch_search_batch row",
+                                        ALLOCSET_DEFAULT_SIZES);
+
+    initStringInfo(&sql);
+    appendStringInfo(&sql, "SELECT ctid, %s FROM %s",
+                     quote_identifier(column_name),
+                     quote_qualified_identifier(get_namespace_name(get_rel_namespace(table_oid)),
+                                                get_rel_name(table_oid)));
+
+    /*
+     * With a GIN index only rows some query can match are read, and exact
+     * index matches skip the =% recheck.  Without one, a single pass beats
+     * evaluating =% per query on every row.
+     */
+    if (kmersearch_column_has_gin_index(table_oid, column_name))
+        appendStringInfo(&sql, " WHERE %s OPERATOR(%s.=%%) ANY ($1)",
+                         quote_identifier(column_name),
+                         quote_identifier(get_namespace_name(get_func_namespace(fcinfo->flinfo->fn_oid))));
+    args[0] = PointerGetDatum(query_array);
+
+    if (SPI_connect() != SPI_OK_CONNECT)
+        ereport(ERROR, (errmsg("kmersearch_search_batch: SPI_connect failed")));
+
+    portal = SPI_cursor_open_with_args(NULL, sql.data, 1, argtypes, args, NULL, true, 0);
+
+    for (;;)
+    {
+        SPI_cursor_fetch(portal, true, KMERSEARCH_SCAN_FETCH_SIZE);
+        if (SPI_processed == 0)
+            break;
+
+        for (uint64 i = 0; i < SPI_processed; i++)
+        {
+            HeapTuple tuple = SPI_tuptable->vals[i];
+            TupleDesc tupdesc = SPI_tuptable->tupdesc;
+            ItemPointerData tid;
+            Datum value;
+            bool isnull;
+
+            CHECK_FOR_INTERRUPTS();
+
+            value = SPI_getbinval(tuple, tupdesc, 2, &isnull);
+            if (isnull)
+                continue;
+            tid = *DatumGetItemPointer(SPI_getbinval(tuple, tupdesc, 1, &isnull));
+
+            /* One extraction per row credits every query */
+            old_context = MemoryContextSwitchTo(row_context);
+            dict.ntouched = 0;
+            if (is_dna4)
+                kmersearch_stream_uintkey_from_dna4(value, false, kmersearch_batch_consumer, &dict);
+            else
+                kmersearch_stream_uintkey_from_dna2(value, false, kmersearch_batch_consumer, &dict);
+            MemoryContextSwitchTo(old_context);
+            MemoryContextReset(row_context);
+
+            for (int t = 0; t < dict.ntouched; t++)
+            {
+                int q = dict.touched[t];
+
+                if (dict.counts[q] >= dict.min_score[q])
+                {
+                    Datum values[3];
+                    bool nulls[3] = {false, false, false};
+
+                    values[0] = Int32GetDatum(q + lower_bound);
+                    values[1] = ItemPointerGetDatum(&tid);
+                    values[2] = Int32GetDatum(dict.counts[q]);
+                    tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+                }
+                dict.counts[q] = 0;
+            }
+        }
+
+        SPI_freetuptable(SPI_tuptable);
+    }
+
+    SPI_cursor_close(portal);
+    SPI_finish();
+
+    MemoryContextDelete(row_context);
+    pfree(sql.data);
+
+    return (Datum) 0;
+}
+
 /*
  * Length functions for DNA2 and DNA4 types
  */
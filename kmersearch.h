@@ -33,14 +33,19 @@
 #include "access/heapam.h"
 #include "access/tableam.h"
 #include "utils/snapmgr.h"
+#include "utils/resowner.h"
 #include "utils/rel.h"
 #include "utils/hsearch.h"
 #include "access/relation.h"
 #include "utils/syscache.h"
 #include "access/tupdesc.h"
 #include "catalog/pg_class.h"
+#include "catalog/pg_am.h"
 #include "commands/tablecmds.h"
 #include "common/hashfn.h"
+#include "port/pg_bswap.h"
+#include "port/pg_bitutils.h"
+#include "access/detoast.h"
 #include "access/htup_details.h"
 #include "funcapi.h"
 #include "utils/lsyscache.h"
@@ -55,11 +60,15 @@
 #include "access/gin_private.h"
 #include "nodes/pg_list.h"
 #include "access/parallel.h"
+#include "access/xact.h"
 #include "storage/dsm.h"
 #include "storage/lmgr.h"
 #include "utils/dsa.h"
 #include "lib/dshash.h"
 #include "storage/ipc.h"
+#include "storage/shmem.h"
+#include "storage/fd.h"
+#include "port/pg_crc32c.h"
 #include "postmaster/bgworker.h"
 #include "utils/backend_status.h"
 #include <ctype.h>
@@ -85,6 +94,7 @@
  */
 #define LWTRANCHE_KMERSEARCH_CACHE    (LWTRANCHE_FIRST_USER_DEFINED + 100)
 #define LWTRANCHE_KMERSEARCH_ANALYSIS (LWTRANCHE_FIRST_USER_DEFINED + 101)
+#define LWTRANCHE_KMERSEARCH_QUERY_CACHE (LWTRANCHE_FIRST_USER_DEFINED + 102)
 
 /*
  * SIMD capability detection
@@ -116,6 +126,15 @@ typedef enum {
 #define SIMD_COMPARE_SVE_THRESHOLD     128     /* 128 bits: Use SVE */
 #define SIMD_COMPARE_SVE2_THRESHOLD    128     /* 128 bits: Use SVE2 */
 
+/*
+ * SIMD k-mer extraction thresholds (sequence length in bases)
+ */
+#define SIMD_EXTRACT_AVX2_THRESHOLD    512     /* 512 bases: Use AVX2 for extraction */
+#define SIMD_EXTRACT_AVX512_THRESHOLD  1024    /* 1024 bases: Use AVX512 for extraction */
+
+/* Bytes of sequence data fetched per slice by the streaming extractor */
+#define KMERSEARCH_STREAM_SLICE_BYTES  (1024 * 1024)
+
 /*
  * SIMD encoding thresholds (input character length)
  * Initially set to same values as SIMD_EXTRACT thresholds
@@ -136,6 +155,37 @@ typedef enum {
 #define SIMD_DECODE_SVE_THRESHOLD      512     /* 512 bits: Use SVE for decoding */
 #define SIMD_DECODE_SVE2_THRESHOLD     512     /* 512 bits: Use SVE2 for decoding */
 
+/*
+ * SIMD sorted-intersection thresholds (keys in the smaller array)
+ */
+#define SIMD_INTERSECT_AVX2_THRESHOLD    16    /* 16 keys: Use AVX2 for intersection */
+#define SIMD_INTERSECT_AVX512_THRESHOLD  32    /* 32 keys: Use AVX512 for intersection */
+
+/* Size ratio above which galloping intersection is used instead of merging */
+#define KMERSEARCH_INTERSECT_GALLOP_RATIO 32
+
+/* Occurrence table sizing: initial minimum and largest table kept between calls */
+#define KMERSEARCH_OCCURRENCE_TABLE_MIN_SLOTS     1024
+#define KMERSEARCH_OCCURRENCE_TABLE_RETAIN_SLOTS  (1 << 20)
+
+/* Presence bitmap over the whole 16-bit uintkey universe (65536 bits = 8KB) */
+#define KMERSEARCH_UINTKEY16_BITMAP_WORDS 1024
+
+/* Compiled query probe set: empty-slot marker and multiplicative hash */
+#define KMERSEARCH_PROBE_EMPTY_KEY       PG_UINT64_MAX
+#define KMERSEARCH_PROBE_HASH(key, shift) (((uint64) (key) * UINT64CONST(0x9E3779B97F4A7C15)) >> (shift))
+
+/* Rows fetched per cursor batch by kmersearch_search_batch() */
+#define KMERSEARCH_SCAN_FETCH_SIZE 1000
+
+/*
+ * High-frequency k-mer filter: a 4^k-bit bitmap is used up to this k-mer size.
+ * Above KMERSEARCH_HIGHFREQ_BITMAP_DENSE_K the bitmap (8MB or 32MB) is only
+ * built when it is no larger than the sorted k-mer array.
+ */
+#define KMERSEARCH_HIGHFREQ_BITMAP_MAX_K   14
+#define KMERSEARCH_HIGHFREQ_BITMAP_DENSE_K 12
+
 
 /*
  * Actual min score cache entry
@@ -160,25 +210,26 @@ typedef struct ActualMinScoreCacheManager
 } ActualMinScoreCacheManager;
 
 /*
- * K-mer occurrence tracking - optimized for different k-mer sizes
+ * K-mer occurrence tracking - generation-stamped open-addressing table
  */
-typedef struct KmerOccurrence16
+typedef struct KmerOccurrenceSlot
 {
-    uint16      kmer_value;         /* K-mer value for k <= 8 */
-    int         count;              /* Occurrence count */
-} KmerOccurrence16;
+    uint64      kmer_value;         /* K-mer value (without occurrence bits) */
+    uint32      generation;         /* Table generation this slot belongs to (0 = never used) */
+    int32       count;              /* Occurrence count */
+} KmerOccurrenceSlot;
 
-typedef struct KmerOccurrence32
+typedef struct KmerOccurrenceTable
 {
-    uint32      kmer_value;         /* K-mer value for k <= 16 */
-    int         count;              /* Occurrence count */
-} KmerOccurrence32;
-
-typedef struct KmerOccurrence64
-{
-    uint64      kmer_value;         /* K-mer value for k <= 32 */
-    int         count;              /* Occurrence count */
-} KmerOccurrence64;
+    KmerOccurrenceSlot *slots;      /* Slot array (power-of-two size) */
+    uint32      capacity;           /* Number of slots */
+    uint32      mask;               /* capacity - 1 */
+    int         shift;              /* 64 - log2(capacity) */
+    uint32      generation;         /* Current sequence generation */
+    int         nused;              /* Slots used in the current generation */
+    MemoryContext context;          /* Memory context holding the slots */
+    int         canonical_k;        /* K-mer size to fold onto canonical form (0 = forward strand) */
+} KmerOccurrenceTable;
 
 /*
  * K-mer analysis result
@@ -219,6 +270,8 @@ typedef struct PartitionBlockInfo
     Oid         partition_oid;            /* Partition OID */
     BlockNumber start_block;              /* Starting global block number */
     BlockNumber end_block;                /* Ending global block number */
+    BlockNumber local_start_block;        /* Local block number of start_block */
+    OffsetNumber local_start_offset;      /* First line pointer read in local_start_block */
 } PartitionBlockInfo;
 
 /* Partition to block mapping result */
@@ -231,6 +284,25 @@ typedef struct PartitionBlockMapping
 /* Maximum number of parallel workers */
 #define MAX_PARALLEL_WORKERS 256
 
+/* High-frequency analysis modes (kmersearch.highfreq_analysis_mode) */
+typedef enum KmerAnalysisMode
+{
+    KMERSEARCH_ANALYSIS_EXACT,                 /* Count every k-mer (file hash tables) */
+    KMERSEARCH_ANALYSIS_APPROXIMATE,           /* Heavy-hitter summaries only */
+    KMERSEARCH_ANALYSIS_APPROXIMATE_VERIFIED   /* Summaries, then exact counts of candidates */
+} KmerAnalysisMode;
+
+/*
+ * Heavy-hitter summary entry
+ * count is an upper bound of the appearance count, or the exact count of a
+ * candidate after verification.
+ */
+typedef struct KmerHeavyHitterEntry
+{
+    uint64      uintkey;
+    uint64      count;
+} KmerHeavyHitterEntry;
+
 typedef struct KmerAnalysisSharedState
 {
     LWLockPadded mutex;                   /* Exclusive control mutex */
@@ -242,6 +314,8 @@ typedef struct KmerAnalysisSharedState
     bool        all_processed;            /* All rows processed flag */
     BlockNumber next_block;               /* Next block number to process */
     BlockNumber total_blocks;             /* Total number of blocks in table */
+    BlockNumber first_block;              /* First block of the scan */
+    OffsetNumber first_offset;            /* First line pointer read in first_block */
     bool        worker_error_occurred;    /* Parallel worker error flag */
     char        error_message[256];       /* Error message buffer */
     uint64      total_rows;               /* Total rows in the table for progress reporting */
@@ -261,12 +335,81 @@ typedef struct KmerAnalysisSharedState
     /* Progress tracking for reproducible output */
     pg_atomic_uint64 total_rows_processed; /* Total rows processed by all workers */
     pg_atomic_uint64 total_batches_committed; /* Total batches committed by all workers */
+    pg_atomic_uint64 visible_rows_scanned; /* Visible rows in scanned blocks, NULLs included */
+    
+    /* Approximate analysis (shared summary is KMERSEARCH_KEY_SUMMARY) */
+    int         analysis_mode;            /* KmerAnalysisMode */
+    bool        verify_phase;             /* Workers count the candidates exactly */
+    LWLockPadded summary_lock;            /* Protects the shared summary */
+    int         summary_capacity;         /* Entries per Space-Saving summary */
+    int         summary_count;            /* Entries in use, sorted by uintkey */
+    uint64      summary_absent_bound;     /* Upper bound for k-mers not in the summary */
+    int         summaries_merged;         /* Worker summaries merged so far */
+    
+    /* Sampled analysis (sorted sample is KMERSEARCH_KEY_SAMPLED_BLOCKS) */
+    BlockNumber num_sampled_blocks;       /* Blocks in the sample, 0 = scan all blocks */
 } KmerAnalysisSharedState;
 
+/*
+ * Persisted k-mer counts for incremental high-frequency analysis
+ * Each analyzed (table, column, k-mer size, occurrence bit length) keeps a
+ * state file in KMERSEARCH_COUNTS_DIR that names a file hash table holding
+ * the appearance counts of every k-mer and records how many blocks of each
+ * relation those counts cover.  The state file is replaced when the
+ * analyzing transaction commits.
+ */
+#define KMERSEARCH_COUNTS_DIR       "pg_kmersearch_counts"
+#define KMERSEARCH_COUNTS_MAGIC     0x4B4D4343
+#define KMERSEARCH_COUNTS_VERSION   2
+
+/*
+ * Rows of one relation covered by the persisted counts
+ * The last block may still receive rows; they get line pointers above
+ * tail_offset, so the next analysis resumes in that block.
+ */
+typedef struct KmerAnalysisCountsRelation
+{
+    Oid         relid;                    /* Table or partition OID */
+    Oid         relfilenode;              /* Detects TRUNCATE, VACUUM FULL, CLUSTER */
+    BlockNumber scanned_blocks;           /* Blocks [0, scanned_blocks) are counted */
+    OffsetNumber tail_offset;             /* Line pointers counted in the last block */
+} KmerAnalysisCountsRelation;
+
+/*
+ * Header of a counts state file
+ * Followed by num_relations KmerAnalysisCountsRelation entries and a
+ * CRC-32C of header and entries.
+ */
+typedef struct KmerAnalysisCountsHeader
+{
+    uint32      magic;
+    uint32      version;
+    Oid         table_oid;
+    AttrNumber  column_attnum;
+    int         kmer_size;
+    int         occur_bitlen;
+    uint64      total_rows;               /* Rows the counts were taken from */
+    int         num_relations;
+    char        counts_file[MAXPGPATH];   /* File hash table with the counts */
+} KmerAnalysisCountsHeader;
+
+/* Counts state change applied when the analyzing transaction commits */
+typedef struct KmerAnalysisCountsPending
+{
+    char        prefix[MAXPGPATH];        /* Files of the affected states */
+    bool        replace;                  /* Install tmp_state_path (else remove all) */
+    bool        ready;                    /* tmp_state_path has been written */
+    char        state_path[MAXPGPATH];    /* State file to replace */
+    char        tmp_state_path[MAXPGPATH]; /* Replacement state file */
+    char        counts_file[MAXPGPATH];   /* Counts file named by the replacement */
+} KmerAnalysisCountsPending;
+
 /* Shared memory keys for parallel processing */
 #define KMERSEARCH_KEY_SHARED_STATE  1
 #define KMERSEARCH_KEY_HANDLES       2  /* Combined DSM and hash handles */
 #define KMERSEARCH_KEY_PARTITION_BLOCKS 3  /* Partition block info array */
+#define KMERSEARCH_KEY_SUMMARY       4  /* Shared heavy-hitter summary */
+#define KMERSEARCH_KEY_SAMPLED_BLOCKS 5  /* Sampled global block numbers */
 
 /*
  * File-based hash table context structures for temporary k-mer storage
@@ -362,6 +505,36 @@ typedef struct FileHashWorkerContext
     Size        memory_limit_per_worker; /* Memory limit for this worker */
 } FileHashWorkerContext;
 
+/* Space-Saving counter of a worker-local heavy-hitter summary */
+typedef struct KmerSpaceSavingEntry
+{
+    uint64      uintkey;                /* Hash key */
+    uint64      count;                  /* Upper bound of the appearance count */
+    int         heap_index;             /* Position in the min-heap */
+} KmerSpaceSavingEntry;
+
+/* Worker-local Space-Saving summary with a fixed number of counters */
+typedef struct KmerSpaceSavingSummary
+{
+    HTAB        *hash;                  /* uintkey -> counter */
+    KmerSpaceSavingEntry **heap;        /* Counters as a min-heap on count */
+    int         nentries;               /* Counters in use */
+    int         capacity;               /* Maximum number of counters */
+} KmerSpaceSavingSummary;
+
+/* Approximate analysis worker context */
+typedef struct KmerApproxWorkerContext
+{
+    int         total_bits;             /* Total bits for k-mer + occurrence */
+    Oid         dna2_oid;               /* Cached OID for dna2 type */
+    Oid         column_type_oid;        /* Column data type OID */
+    BufferAccessStrategy strategy;      /* Buffer access strategy for ring buffer */
+    MemoryContext row_context;          /* Reset after every row */
+    KmerSpaceSavingSummary local;       /* Counting phase summary */
+    KmerHeavyHitterEntry *summary;      /* Shared summary (DSM) */
+    uint64      *candidate_counts;      /* Verification phase counts per candidate */
+} KmerApproxWorkerContext;
+
 /*
  * Query-kmer cache entry
  */
@@ -370,8 +543,22 @@ typedef struct QueryKmerCacheEntry
     uint64      hash_key;                  /* Hash key for this entry */
     char        *query_string_copy;        /* Copy of query string */
     int         kmer_size;                 /* K-mer size for this query */
+    bool        canonical;                 /* Keys are strand-independent (canonical) k-mers */
     void        *extracted_uintkey;        /* Cached extracted uintkeys (uint16/uint32/uint64 array) */
     int         kmer_count;                /* Number of extracted k-mers */
+    int         occur_bitlen;              /* Occurrence bit length used for extraction */
+    size_t      elem_size;                 /* Size of one uintkey (2, 4 or 8 bytes) */
+    void        *sorted_uintkey;           /* Extracted uintkeys in ascending order */
+    uint64      *presence_bitmap;          /* Presence bitmap of uintkeys (16-bit keys only) */
+    uint64      *probe_table;              /* Open-addressing probe set of uintkeys */
+    int         probe_shift;               /* 64 - log2(probe table size) */
+    uint64      probe_mask;                /* Probe table size - 1 */
+    bool        probe_has_empty_key;       /* Query contains the empty-slot marker value */
+    int         highfreq_count;            /* High-frequency keys among the uintkeys (-1 = not counted) */
+    uint64      highfreq_state;            /* High-frequency k-mer state highfreq_count was taken in */
+    int         filtered_kmer_count;       /* Number of keys left after high-frequency filtering */
+    int         actual_min_score;          /* Resolved actual min score */
+    uint64      score_generation;          /* Score generation actual_min_score was resolved in */
     struct QueryKmerCacheEntry *next;   /* For LRU chain */
     struct QueryKmerCacheEntry *prev;   /* For LRU chain */
 } QueryKmerCacheEntry;
@@ -391,6 +578,132 @@ typedef struct QueryKmerCacheManager
     QueryKmerCacheEntry *lru_tail;      /* LRU chain tail (least recent) */
 } QueryKmerCacheManager;
 
+/*
+ * Key of the shared query-kmer cache: 128-bit fingerprint of the query text,
+ * k-mer size, occurrence bit length, strand mode and high-frequency k-mer state
+ */
+typedef struct SharedQueryKmerCacheKey
+{
+    uint64      hi;
+    uint64      lo;
+} SharedQueryKmerCacheKey;
+
+/*
+ * Shared query-kmer cache entry (dshash entry in the shared DSA area)
+ */
+typedef struct SharedQueryKmerCacheEntry
+{
+    SharedQueryKmerCacheKey key;           /* Query fingerprint (hash key) */
+    dsa_pointer uintkeys;                  /* Extracted uintkey array */
+    int         kmer_count;                /* Number of extracted k-mers */
+    int         elem_size;                 /* Size of one uintkey (2, 4 or 8 bytes) */
+    int         highfreq_count;            /* High-frequency keys among the uintkeys */
+    Size        bytes;                     /* Bytes charged against the cache size */
+    bool        referenced;                /* Clock reference bit */
+} SharedQueryKmerCacheEntry;
+
+/*
+ * Shared query-kmer cache control block (main shared memory)
+ */
+typedef struct SharedQueryKmerCacheControl
+{
+    LWLock      *lock;                     /* Serializes creation of the DSA area */
+    dsa_handle  area_handle;               /* DSA area holding the entries */
+    dshash_table_handle hash_handle;       /* dshash table of entries */
+    pg_atomic_uint64 used_bytes;           /* Bytes held by all entries */
+    pg_atomic_uint64 entries;              /* Number of entries */
+    pg_atomic_uint64 hits;                 /* Lookup hits */
+    pg_atomic_uint64 misses;               /* Lookup misses */
+    pg_atomic_uint64 evictions;            /* Entries evicted to stay within the size */
+} SharedQueryKmerCacheControl;
+
+/*
+ * Per-call-site state for compiled query lookup (stored in fn_extra)
+ */
+typedef struct CompiledQueryFnState
+{
+    text        *query_text;               /* Copy of the last query text */
+    int         kmer_size;                 /* K-mer size the entry was resolved for */
+    int         occur_bitlen;              /* Occurrence bit length the entry was resolved for */
+    bool        canonical;                 /* Entry holds canonical k-mers */
+    uint64      cache_generation;          /* Query-kmer cache generation at resolve time */
+    QueryKmerCacheEntry *entry;            /* Resolved compiled query (NULL if no k-mers) */
+} CompiledQueryFnState;
+
+/*
+ * Early-exit =% evaluation state (extraction fused with counting)
+ */
+typedef struct KmerMatchEvaluation
+{
+    QueryKmerCacheEntry *query;            /* Compiled query probed for each sequence key */
+    int         min_score;                 /* Shared keys required for a match */
+    int         max_keys_per_window;       /* Upper bound of keys one window can emit */
+    int         shared_count;              /* Shared keys seen so far */
+    bool        decided;                   /* Outcome is final */
+    bool        match;                     /* Outcome (valid once decided) */
+} KmerMatchEvaluation;
+
+/*
+ * (uintkey, query index) pair collected while building the batch dictionary
+ */
+typedef struct KmerBatchPosting
+{
+    uint64      key;                       /* Query uintkey */
+    int         query;                     /* Index of the query using it */
+} KmerBatchPosting;
+
+/*
+ * Combined key dictionary of kmersearch_search_batch()
+ * Each distinct uintkey maps to the list of queries containing it, so one
+ * extraction per row credits every query at once.
+ */
+typedef struct KmerBatchDictionary
+{
+    int         nqueries;                  /* Number of queries */
+    int        *min_score;                 /* Per-query actual min score */
+    int         nkeys;                     /* Number of distinct uintkeys */
+    uint64     *keys;                      /* Distinct uintkeys in ascending order */
+    int        *posting_start;             /* keys[i] is used by posting[posting_start[i] .. posting_start[i+1]-1] */
+    int        *posting;                   /* Query indexes per key */
+    int        *probe_table;               /* Open-addressing index into keys, -1 if empty */
+    int         probe_shift;               /* 64 - log2(probe table size) */
+    uint64      probe_mask;                /* Probe table size - 1 */
+    int        *counts;                    /* Per-query shared count of the current row */
+    int        *touched;                   /* Queries with a non-zero count in the current row */
+    int         ntouched;                  /* Number of touched queries */
+} KmerBatchDictionary;
+
+/*
+ * Per-scan GIN state built by extract_query and shared by every
+ * extra_data slot, so consistent needs no per-item cache lookup
+ */
+typedef struct KmerGinScanState
+{
+    int         nkeys;                     /* Query keys after high-frequency filtering */
+    int         actual_min_score;          /* Shared keys required for a match */
+    bool        recheck;                   /* Keys are sampled; matches need a heap recheck */
+} KmerGinScanState;
+
+/*
+ * Destination of extracted uintkeys: a result array, an early-exit
+ * evaluation or a consumer callback (returning false stops the extraction)
+ */
+typedef bool (*KmerUintkeyConsumer) (uint64 uintkey, void *arg);
+
+typedef struct KmerUintkeySink
+{
+    void        *result;                   /* Result array (NULL unless materializing) */
+    int         result_count;              /* Keys stored in result */
+    int         result_capacity;           /* Allocated length of result */
+    size_t      elem_size;                 /* Size of one uintkey (2, 4 or 8 bytes) */
+    KmerMatchEvaluation *eval;             /* Early-exit evaluation, or NULL */
+    KmerUintkeyConsumer consumer;          /* Consumer callback, or NULL */
+    void        *consumer_arg;             /* Argument passed to the consumer */
+    int         total_windows;             /* K-mer windows in the whole sequence */
+    bool        canonical;                 /* Emit strand-independent (canonical) k-mers */
+    bool        finished;                  /* No more keys wanted */
+} KmerUintkeySink;
+
 /*
  * K-mer data union for different k-values
  */
@@ -426,9 +739,40 @@ typedef struct HighfreqKmerCache
     HTAB       *highfreq_hash;           /* Hash table for fast lookup */
     uint64     *highfreq_kmers;          /* Array of high-frequency k-mers as uintkey */
     int         highfreq_count;          /* Number of high-frequency k-mers */
+    uint64     *kmer_bitmap;             /* 4^k-bit membership bitmap (NULL if not built) */
+    uint64     *kmer_eytzinger;          /* Eytzinger-ordered k-mers, 1-based (NULL if bitmap) */
+    char        column_name[NAMEDATALEN]; /* Column name, for refreshing the cache */
+    uint64      generation;              /* Analysis generation the cache was loaded at */
     bool        is_valid;                /* Cache validity flag */
 } HighfreqKmerCache;
 
+/*
+ * Where high-frequency k-mer membership is answered from
+ */
+typedef enum KmerHighfreqFilterKind
+{
+    KMERSEARCH_HIGHFREQ_FILTER_NONE,       /* No high-frequency k-mer set */
+    KMERSEARCH_HIGHFREQ_FILTER_BITMAP,     /* Global cache, 4^k-bit bitmap */
+    KMERSEARCH_HIGHFREQ_FILTER_EYTZINGER,  /* Global cache, Eytzinger-ordered k-mers */
+    KMERSEARCH_HIGHFREQ_FILTER_PARALLEL    /* Parallel cache (dshash) */
+} KmerHighfreqFilterKind;
+
+/*
+ * High-frequency k-mer filter resolved once per index build row or query
+ * (kmersearch_highfreq_filter_resolve), so that testing a key skips the
+ * cache priority chain of kmersearch_is_uintkey_highfreq
+ */
+typedef struct KmerHighfreqFilter
+{
+    KmerHighfreqFilterKind kind;
+    int         k_size;                  /* K-mer size keys were extracted with */
+    int         occur_bitlen;            /* Occurrence bits stripped before lookup */
+    const uint64 *bitmap;                /* BITMAP: 4^k-bit membership bitmap */
+    uint64      bitmap_bits;             /* BITMAP: 4^k */
+    const uint64 *eytzinger;             /* EYTZINGER: 1-based Eytzinger array */
+    int         nkmers;                  /* EYTZINGER: number of k-mers */
+} KmerHighfreqFilter;
+
 /*
  * Parallel high-frequency k-mer cache entries for different k-mer sizes
  */
@@ -469,8 +813,104 @@ typedef struct ParallelHighfreqKmerCache
     bool                is_initialized;  /* initialization flag */
     dsm_handle          dsm_handle;      /* DSM segment handle */
     HighfreqCacheKey    cache_key;       /* cache key for validation */
+    uint64              generation;      /* analysis generation the cache was loaded at */
 } ParallelHighfreqKmerCache;
 
+/*
+ * Global high-frequency k-mer cache exported to parallel workers
+ * The leader copies its compact filter into a DSM segment that stays mapped
+ * while the cache is loaded; workers map it instead of reloading the k-mer
+ * set.  The filter data follows the MAXALIGN'ed header.
+ */
+#define KMERSEARCH_HIGHFREQ_EXPORT_MAGIC    0x4B4D4858
+
+typedef struct HighfreqKmerCacheExport
+{
+    uint32      magic;
+    int         leader_pid;                /* Backend that exported the cache */
+    uint64      serial;                    /* Export number within that backend */
+    HighfreqCacheKey cache_key;            /* Cache key for validation */
+    uint64      generation;                /* Analysis generation of the k-mer set */
+    int         highfreq_count;            /* Number of high-frequency k-mers */
+    Size        bitmap_bytes;              /* Bitmap size (0 if Eytzinger-ordered) */
+    Size        data_bytes;                /* Bytes of filter data */
+} HighfreqKmerCacheExport;
+
+/*
+ * Analysis generation counters
+ * kmersearch_perform_highfreq_analysis() and kmersearch_undo_highfreq_analysis()
+ * bump the counter of their (database, table, column, k-mer size, occurrence
+ * bit length) when they commit; a cache loaded at an older generation is
+ * stale.  Keys hash onto a fixed number of slots, so an unrelated analysis
+ * may occasionally cause a spurious refresh but never a missed one.  Slot
+ * (table, column, 0, 0) stands for every k-mer size of the column.
+ */
+#define KMERSEARCH_HIGHFREQ_GENERATION_SLOTS 1024
+
+typedef struct HighfreqGenerationTable
+{
+    pg_atomic_uint64 total;                /* Bumped by every analysis */
+    pg_atomic_uint64 slots[KMERSEARCH_HIGHFREQ_GENERATION_SLOTS];
+} HighfreqGenerationTable;
+
+/*
+ * Analysis generation bump applied when the analyzing transaction commits
+ */
+typedef struct HighfreqGenerationBump
+{
+    Oid         table_oid;
+    uint32      column_name_hash;
+    int         kmer_size;                 /* 0 for every k-mer size */
+    int         occur_bitlen;              /* 0 for every k-mer size */
+} HighfreqGenerationBump;
+
+/*
+ * Shared high-frequency k-mer cache preloaded at server start
+ * (main shared memory, requires shared_preload_libraries).  The compact
+ * filter (4^k-bit bitmap or Eytzinger-ordered k-mers) follows the control
+ * block and is persisted in KMERSEARCH_SHARED_HIGHFREQ_FILE.  Two buffers
+ * are kept: a load fills the inactive one and then flips active, so the
+ * set that backends may still be reading is never overwritten in place.
+ */
+#define KMERSEARCH_SHARED_HIGHFREQ_FILE     "pg_kmersearch_highfreq.cache"
+#define KMERSEARCH_SHARED_HIGHFREQ_MAGIC    0x4B4D4846
+#define KMERSEARCH_SHARED_HIGHFREQ_VERSION  1
+
+typedef struct SharedHighfreqKmerCacheBuffer
+{
+    Oid         database_oid;              /* Database the k-mer set belongs to */
+    HighfreqCacheKey cache_key;            /* Cache key for validation */
+    int         highfreq_count;            /* Number of high-frequency k-mers */
+    Size        bitmap_bytes;              /* Bitmap size (0 if Eytzinger-ordered) */
+    Size        data_bytes;                /* Bytes of filter data in use */
+} SharedHighfreqKmerCacheBuffer;
+
+typedef struct SharedHighfreqKmerCacheControl
+{
+    LWLock     *lock;                      /* Serializes loads and frees */
+    pg_atomic_uint64 generation;           /* Bumped whenever the k-mer set changes */
+    bool        is_valid;                  /* A k-mer set is published */
+    pg_atomic_uint32 active;               /* Buffer holding the published set */
+    SharedHighfreqKmerCacheBuffer buffers[2];
+    Size        capacity;                  /* Bytes of filter data per buffer */
+    HighfreqGenerationTable generations;   /* Analysis generations of all backends */
+} SharedHighfreqKmerCacheControl;
+
+/*
+ * Header of KMERSEARCH_SHARED_HIGHFREQ_FILE
+ * Followed by data_bytes of filter data and a CRC-32C of header and data.
+ */
+typedef struct SharedHighfreqKmerCacheFileHeader
+{
+    uint32      magic;
+    uint32      version;
+    Oid         database_oid;
+    HighfreqCacheKey cache_key;
+    int         highfreq_count;
+    Size        bitmap_bytes;
+    Size        data_bytes;
+} SharedHighfreqKmerCacheFileHeader;
+
 /* DNA type definitions */
 typedef struct
 {
@@ -492,6 +932,7 @@ extern simd_capability_t simd_capability;
 /* Global configuration variables */
 extern int kmersearch_occur_bitlen;
 extern int kmersearch_kmer_size;
+extern int kmersearch_syncmer_size;
 extern double kmersearch_max_appearance_rate;
 extern int kmersearch_max_appearance_nrow;
 extern int kmersearch_min_score;
@@ -503,6 +944,11 @@ extern int kmersearch_query_kmer_cache_max_entries;
 extern int kmersearch_actual_min_score_cache_max_entries;
 extern int kmersearch_highfreq_kmer_cache_load_batch_size;
 extern int kmersearch_highfreq_analysis_hashtable_size;
+extern int kmersearch_highfreq_analysis_mode;
+extern int kmersearch_highfreq_analysis_summary_size;
+extern double kmersearch_highfreq_analysis_sample_confidence;
+extern int kmersearch_shared_query_kmer_cache_size;
+extern int kmersearch_shared_highfreq_kmer_cache_size;
 
 /* Global cache managers */
 extern ActualMinScoreCacheManager *actual_min_score_cache_manager;
@@ -525,6 +971,10 @@ extern dsa_area *parallel_cache_dsa;
 extern dshash_table *parallel_cache_hash;
 extern bool parallel_cache_exit_callback_registered;
 
+/* Leader cache state published to parallel workers (hidden GUCs) */
+extern char *kmersearch_highfreq_cache_source;
+extern char *kmersearch_parallel_highfreq_cache_handle;
+
 /* DNA encoding/decoding tables */
 extern const uint8 kmersearch_dna2_encode_table[256];
 extern const char kmersearch_dna2_decode_table[4];
@@ -632,6 +1082,31 @@ Datum kmersearch_extract_query_int8(PG_FUNCTION_ARGS);
 Datum kmersearch_consistent_int2(PG_FUNCTION_ARGS);
 Datum kmersearch_consistent_int4(PG_FUNCTION_ARGS);
 Datum kmersearch_consistent_int8(PG_FUNCTION_ARGS);
+Datum kmersearch_triconsistent_int2(PG_FUNCTION_ARGS);
+Datum kmersearch_triconsistent_int4(PG_FUNCTION_ARGS);
+Datum kmersearch_triconsistent_int8(PG_FUNCTION_ARGS);
+
+/* Syncmer-sampling GIN operator class functions */
+Datum kmersearch_extract_value_syncmer_dna2_int2(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_value_syncmer_dna2_int4(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_value_syncmer_dna2_int8(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_value_syncmer_dna4_int2(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_value_syncmer_dna4_int4(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_value_syncmer_dna4_int8(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_query_syncmer_int2(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_query_syncmer_int4(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_query_syncmer_int8(PG_FUNCTION_ARGS);
+
+/* Canonical (strand-independent) GIN operator class functions */
+Datum kmersearch_extract_value_canonical_dna2_int2(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_value_canonical_dna2_int4(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_value_canonical_dna2_int8(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_value_canonical_dna4_int2(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_value_canonical_dna4_int4(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_value_canonical_dna4_int8(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_query_canonical_int2(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_query_canonical_int4(PG_FUNCTION_ARGS);
+Datum kmersearch_extract_query_canonical_int8(PG_FUNCTION_ARGS);
 
 /* Search operator functions */
 Datum kmersearch_dna2_match(PG_FUNCTION_ARGS);
@@ -640,6 +1115,15 @@ Datum kmersearch_dna4_match(PG_FUNCTION_ARGS);
 /* Scoring functions */
 Datum kmersearch_matchscore_dna2(PG_FUNCTION_ARGS);
 Datum kmersearch_matchscore_dna4(PG_FUNCTION_ARGS);
+Datum kmersearch_dna2_match_canonical(PG_FUNCTION_ARGS);
+Datum kmersearch_dna4_match_canonical(PG_FUNCTION_ARGS);
+Datum kmersearch_matchscore_canonical_dna2(PG_FUNCTION_ARGS);
+Datum kmersearch_matchscore_canonical_dna4(PG_FUNCTION_ARGS);
+
+/* Top-K similarity ordering */
+Datum kmersearch_dna2_distance(PG_FUNCTION_ARGS);
+Datum kmersearch_dna4_distance(PG_FUNCTION_ARGS);
+Datum kmersearch_search_batch(PG_FUNCTION_ARGS);
 
 /* Cache management functions */
 Datum kmersearch_actual_min_score_cache_stats(PG_FUNCTION_ARGS);
@@ -661,6 +1145,13 @@ bool kmersearch_validate_guc_against_metadata(Oid table_oid, const char *column_
 bool kmersearch_is_global_highfreq_cache_loaded(void);
 bool kmersearch_lookup_uintkey_in_global_cache(uint64 uintkey, const char *table_name, const char *column_name);
 bool kmersearch_lookup_uintkey_in_parallel_cache(uint64 uintkey, const char *table_name, const char *column_name);
+void kmersearch_highfreq_filter_resolve(KmerHighfreqFilter *filter, int k_size);
+void kmersearch_table_highfreq_filter_resolve(KmerHighfreqFilter *filter, int k_size);
+void kmersearch_reset_table_highfreq_filter(void);
+bool kmersearch_shared_highfreq_filter_resolve(KmerHighfreqFilter *filter, int k_size);
+void kmersearch_highfreq_cache_check_generation(void);
+bool kmersearch_is_parallel_highfreq_cache_stale(void);
+void kmersearch_highfreq_generation_bump_at_commit(Oid table_oid, const char *column_name, int k_size);
 void kmersearch_highfreq_kmer_cache_init(void);
 bool kmersearch_highfreq_kmer_cache_load_internal(Oid table_oid, const char *column_name, int k_value);
 void kmersearch_highfreq_kmer_cache_free_internal(void);
@@ -672,6 +1163,10 @@ bool kmersearch_parallel_highfreq_kmer_cache_load_internal(Oid table_oid, const
 void kmersearch_parallel_highfreq_kmer_cache_free_internal(void);
 void kmersearch_parallel_cache_cleanup_on_exit(int code, Datum arg);
 bool kmersearch_parallel_cache_lookup(uint64 kmer_hash);
+bool kmersearch_parallel_cache_attach(dsm_handle handle);
+void kmersearch_publish_global_highfreq_cache(void);
+void kmersearch_publish_parallel_cache_handle(dsm_handle handle);
+void kmersearch_highfreq_cache_sync_worker(void);
 
 /* High-frequency k-mer filtering functions */
 
@@ -682,6 +1177,10 @@ Datum kmersearch_highfreq_kmer_cache_free(PG_FUNCTION_ARGS);
 /* Parallel cache functions */
 Datum kmersearch_parallel_highfreq_kmer_cache_load(PG_FUNCTION_ARGS);
 Datum kmersearch_parallel_highfreq_kmer_cache_free(PG_FUNCTION_ARGS);
+
+/* Shared (preloaded) cache functions */
+Datum kmersearch_shared_highfreq_kmer_cache_load(PG_FUNCTION_ARGS);
+Datum kmersearch_shared_highfreq_kmer_cache_free(PG_FUNCTION_ARGS);
 /* kmersearch_is_highfreq_kmer_parallel now static in kmersearch_gin.c */
 
 /* Analysis functions */
@@ -691,13 +1190,14 @@ Datum kmersearch_delete_tempfiles(PG_FUNCTION_ARGS);
 
 /* K-mer utility functions */
 int kmersearch_count_degenerate_combinations(const char *kmer, int k);
+bool kmersearch_kmer_is_open_syncmer(uint64 kmer, int k, int s);
 void kmersearch_set_bit_at(bits8 *data, int bit_pos, int value);
 bool kmersearch_will_exceed_degenerate_limit_dna4_bits(VarBit *seq, int start_pos, int k);
-/* K-mer occurrence tracking functions */
-int kmersearch_find_or_add_kmer_occurrence16(KmerOccurrence16 *occurrences, int *count, uint16 kmer_value, int max_count);
-int kmersearch_find_or_add_kmer_occurrence32(KmerOccurrence32 *occurrences, int *count, uint32 kmer_value, int max_count);
-int kmersearch_find_or_add_kmer_occurrence64(KmerOccurrence64 *occurrences, int *count, uint64 kmer_value, int max_count);
 int kmersearch_count_matching_uintkey(void *seq_keys, int seq_nkeys, void *query_keys, int query_nkeys, int k_size);
+int kmersearch_count_matching_sorted_uintkey(const void *a, int na, const void *b, int nb, size_t elem_size);
+void kmersearch_sort_uintkey(void *keys, int nkeys, size_t elem_size);
+int kmersearch_count_matching_compiled_query(QueryKmerCacheEntry *query, void *seq_keys, int seq_nkeys);
+void kmersearch_build_uintkey16_bitmap(const uint16 *keys, int nkeys, uint64 *bitmap);
 uint8 kmersearch_get_bit_at(bits8 *data, int bit_pos);
 bool kmersearch_will_exceed_degenerate_limit(const char *seq, int len);
 
@@ -718,7 +1218,11 @@ bool evaluate_optimized_match_condition(VarBit **query_keys, int nkeys, int shar
 /* Cache management functions (implemented in kmersearch_cache.c) */
 
 /* Query-kmer cache functions (implemented in kmersearch_cache.c) */
-void *kmersearch_get_cached_query_uintkey(const char *query_string, int k_size, int *nkeys);
+void *kmersearch_get_cached_query_uintkey(const char *query_string, int k_size, bool canonical, int *nkeys);
+QueryKmerCacheEntry *kmersearch_get_cached_query_entry(const char *query_string, int k_size, bool canonical);
+QueryKmerCacheEntry *kmersearch_get_compiled_query(FmgrInfo *flinfo, text *query_text, bool canonical);
+void kmersearch_invalidate_compiled_query_scores(void);
+void kmersearch_shmem_init(void);
 
 /* Actual min score cache functions (implemented in kmersearch_cache.c) */  
 int kmersearch_get_cached_actual_min_score_uintkey(void *uintkey, int nkeys, int k_size);
@@ -727,7 +1231,7 @@ int kmersearch_get_cached_actual_min_score_datum_int4(Datum *queryKeys, int nkey
 int kmersearch_get_cached_actual_min_score_datum_int8(Datum *queryKeys, int nkeys);
 
 /* High-frequency k-mer filtering functions (implemented in kmersearch_gin.c) */
-void *kmersearch_filter_uintkey_and_set_actual_min_score(void *uintkey, int *nkeys, const char *query_string, int k_size);
+void *kmersearch_filter_uintkey_and_set_actual_min_score(void *uintkey, int *nkeys, const char *query_string, int k_size, int *actual_min_score);
 bool kmersearch_is_uintkey_highfreq(uint64 uintkey, int k_size);
 
 /* Cache functions (implemented in kmersearch_cache.c) */
@@ -750,7 +1254,8 @@ Datum kmersearch_undo_highfreq_analysis(PG_FUNCTION_ARGS);
 
 /* Internal frequency analysis functions (implemented in kmersearch_freq.c) */
 DropAnalysisResult kmersearch_undo_highfreq_analysis_internal(Oid table_oid, const char *column_name, int k_size);
-KmerAnalysisResult kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_name, int k_size, int parallel_workers);
+KmerAnalysisResult kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_name, int k_size, int parallel_workers, bool incremental,
+                                                                  double sample_fraction, int64 sample_rows);
 void kmersearch_validate_analysis_parameters(Oid table_oid, const char *column_name, int k_size);
 
 /* Partition detection and handling functions (implemented in kmersearch_freq.c) */
@@ -769,16 +1274,24 @@ void kmersearch_extract_dna4_kmer_expansions_direct_bits(VarBit *seq, int start_
 void kmersearch_expand_dna4_to_uintkey(VarBit *dna4_seq, int start_pos, int k, void **output, int *expansion_count, size_t elem_size);
 
 /* Uint key extraction functions with occurrence counting */
-void kmersearch_extract_uintkey_from_dna2(VarBit *seq, void **output, int *nkeys);
-void kmersearch_extract_uintkey_from_dna4(VarBit *seq, void **output, int *nkeys);
-void kmersearch_extract_uintkey_from_text(const char *text, void **output, int *nkeys);
+void kmersearch_extract_uintkey_from_dna2(VarBit *seq, void **output, int *nkeys, bool canonical);
+void kmersearch_extract_uintkey_from_dna4(VarBit *seq, void **output, int *nkeys, bool canonical);
+void kmersearch_extract_uintkey_from_text(const char *text, void **output, int *nkeys, bool canonical);
+
+/* Streaming extraction (slice detoasting) and fused evaluation functions */
+void kmersearch_stream_uintkey_from_dna2(Datum seq_datum, bool canonical, KmerUintkeyConsumer consumer, void *arg);
+void kmersearch_stream_uintkey_from_dna4(Datum seq_datum, bool canonical, KmerUintkeyConsumer consumer, void *arg);
+bool kmersearch_evaluate_match_dna2(Datum seq_datum, QueryKmerCacheEntry *query);
+bool kmersearch_evaluate_match_dna4(Datum seq_datum, QueryKmerCacheEntry *query);
+int kmersearch_count_shared_dna2(Datum seq_datum, QueryKmerCacheEntry *query);
+int kmersearch_count_shared_dna4(Datum seq_datum, QueryKmerCacheEntry *query);
 
 /* Datum array creation from uintkey array */
 Datum *kmersearch_create_datum_array_from_uintkey(void *uintkey_array, int nkeys, size_t key_size);
 
 /* Zero-copy extraction functions - directly create Datum arrays */
-Datum *kmersearch_extract_datum_from_dna2(VarBit *dna_seq, int *nkeys, size_t key_size);
-Datum *kmersearch_extract_datum_from_dna4(VarBit *dna_seq, int *nkeys, size_t key_size);
+Datum *kmersearch_extract_datum_from_dna2(VarBit *dna_seq, int *nkeys, size_t key_size, bool canonical);
+Datum *kmersearch_extract_datum_from_dna4(VarBit *dna_seq, int *nkeys, size_t key_size, bool canonical);
 
 /* Utility functions */
 void kmersearch_spi_connect_or_error(void);
@@ -829,4 +1342,35 @@ bool kmersearch_fht64_iterate(FileHashTableIterator64 *iter, uint64 *uintkey, ui
 extern Datum kmersearch_partition_table(PG_FUNCTION_ARGS);
 extern Datum kmersearch_unpartition_table(PG_FUNCTION_ARGS);
 
+/*
+ * Test whether a uintkey is high-frequency under a resolved filter
+ */
+static inline bool
+kmersearch_highfreq_filter_contains(const KmerHighfreqFilter *filter, uint64 uintkey)
+{
+    uint64 kmer_only = uintkey >> filter->occur_bitlen;
+
+    switch (filter->kind)
+    {
+        case KMERSEARCH_HIGHFREQ_FILTER_NONE:
+            return false;
+        case KMERSEARCH_HIGHFREQ_FILTER_BITMAP:
+            return kmer_only < filter->bitmap_bits &&
+                ((filter->bitmap[kmer_only >> 6] >> (kmer_only & 63)) & 1);
+        case KMERSEARCH_HIGHFREQ_FILTER_EYTZINGER:
+            {
+                /* Branchless descent, then undo the trailing right turns */
+                uint64 i = 1;
+
+                while (i <= (uint64) filter->nkmers)
+                    i = 2 * i + (filter->eytzinger[i] < kmer_only);
+                i >>= pg_rightmost_one_pos64(~i) + 1;
+                return i != 0 && filter->eytzinger[i] == kmer_only;
+            }
+        case KMERSEARCH_HIGHFREQ_FILTER_PARALLEL:
+            return kmersearch_lookup_uintkey_in_parallel_cache(kmer_only, NULL, NULL);
+    }
+    return false;
+}
+
 #endif   /* KMERSEARCH_H */
\ No newline at end of file
@@ -11,6 +11,7 @@
 
 PG_FUNCTION_INFO_V1(kmersearch_query_kmer_cache_stats);
 PG_FUNCTION_INFO_V1(kmersearch_query_kmer_cache_free);
+PG_FUNCTION_INFO_V1(kmersearch_shared_query_kmer_cache_stats);
 PG_FUNCTION_INFO_V1(kmersearch_actual_min_score_cache_stats);
 PG_FUNCTION_INFO_V1(kmersearch_actual_min_score_cache_free);
 PG_FUNCTION_INFO_V1(kmersearch_highfreq_kmer_cache_load);
@@ -19,6 +20,8 @@ PG_FUNCTION_INFO_V1(kmersearch_highfreq_kmer_cache_free_all);
 PG_FUNCTION_INFO_V1(kmersearch_parallel_highfreq_kmer_cache_load);
 PG_FUNCTION_INFO_V1(kmersearch_parallel_highfreq_kmer_cache_free);
 PG_FUNCTION_INFO_V1(kmersearch_parallel_highfreq_kmer_cache_free_all);
+PG_FUNCTION_INFO_V1(kmersearch_shared_highfreq_kmer_cache_load);
+PG_FUNCTION_INFO_V1(kmersearch_shared_highfreq_kmer_cache_free);
 
 HighfreqKmerCache global_highfreq_cache = {0};
 
@@ -29,13 +32,35 @@ dsm_segment *parallel_cache_segment = NULL;
 dsa_area *parallel_cache_dsa = NULL;
 dshash_table *parallel_cache_hash = NULL;
 
+/*
+ * Leader cache state published to parallel workers through hidden GUCs
+ * (GUC values are copied into every parallel worker at startup)
+ */
+char *kmersearch_highfreq_cache_source = NULL;
+char *kmersearch_parallel_highfreq_cache_handle = NULL;
+static bool worker_highfreq_cache_synced = false;
+
+/* Global cache filter mapped by parallel workers (and its export counter) */
+static dsm_segment *highfreq_export_segment = NULL;
+static uint64 highfreq_export_serial = 0;
+
+/*
+ * Transaction nest level that last published each cache (0 once committed)
+ * The hidden GUCs revert when that level aborts, so the cache is dropped too.
+ */
+static int global_cache_publish_level = 0;
+static int parallel_cache_publish_level = 0;
+
 static uint32 kmersearch_uint16_identity_hash(const void *key, size_t keysize, void *arg);
 static uint32 kmersearch_uint32_identity_hash(const void *key, size_t keysize, void *arg);
 
 static void init_query_kmer_cache_manager(QueryKmerCacheManager **manager);
-static uint64 generate_query_kmer_cache_key(const char *query_string, int k_size);
-static QueryKmerCacheEntry *lookup_query_kmer_cache_entry(QueryKmerCacheManager *manager, const char *query_string, int k_size);
-static void store_query_kmer_cache_entry(QueryKmerCacheManager *manager, uint64 hash_key, const char *query_string, int k_size, void *uintkeys, int kmer_count);
+static uint64 generate_query_kmer_cache_key(const char *query_string, int k_size, bool canonical);
+static QueryKmerCacheEntry *lookup_query_kmer_cache_entry(QueryKmerCacheManager *manager, const char *query_string, int k_size, bool canonical);
+static QueryKmerCacheEntry *store_query_kmer_cache_entry(QueryKmerCacheManager *manager, uint64 hash_key, const char *query_string, int k_size, bool canonical, void *uintkeys, int kmer_count);
+static void compile_query_kmer_cache_entry(QueryKmerCacheEntry *entry);
+static void resolve_compiled_query_score(QueryKmerCacheEntry *entry);
+static void free_query_kmer_cache_entry_data(QueryKmerCacheEntry *entry);
 static void lru_touch_query_kmer_cache(QueryKmerCacheManager *manager, QueryKmerCacheEntry *entry);
 static void lru_evict_oldest_query_kmer_cache(QueryKmerCacheManager *manager);
 void kmersearch_free_query_kmer_cache_manager(QueryKmerCacheManager **manager);
@@ -43,12 +68,88 @@ void kmersearch_free_query_kmer_cache_manager(QueryKmerCacheManager **manager);
 static void create_actual_min_score_cache_manager(ActualMinScoreCacheManager **manager);
 void kmersearch_free_actual_min_score_cache_manager(ActualMinScoreCacheManager **manager);
 static int calculate_actual_min_score_from_uintkey(void *uintkey, int nkeys, int k_size);
+static int count_highfreq_uintkey(void *uintkey, int nkeys, int k_size);
+static int actual_min_score_from_highfreq_count(int nkeys, int highfreq_count, bool filtering_enabled);
+static uint64 kmersearch_highfreq_state_hash(void);
+
+static void kmersearch_shmem_request(void);
+static void kmersearch_shmem_startup(void);
+static bool kmersearch_shared_query_kmer_cache_attach(void);
+static SharedQueryKmerCacheKey generate_shared_query_kmer_cache_key(const char *query_string, int k_size, bool canonical, uint64 highfreq_state);
+static void *lookup_shared_query_kmer_cache(const SharedQueryKmerCacheKey *key, int *nkeys, int *highfreq_count);
+static void store_shared_query_kmer_cache(const SharedQueryKmerCacheKey *key, void *uintkeys, int nkeys, int elem_size, int highfreq_count);
+static void evict_shared_query_kmer_cache(Size target_bytes);
+
+static int kmersearch_eytzinger_fill(const uint64 *sorted, uint64 *eytzinger, int n, int pos, int node);
+static void kmersearch_build_kmer_filter(const uint64 *sorted, int nkmers, int k_value,
+                                         uint64 **bitmap_out, uint64 **eytzinger_out);
+static void kmersearch_build_highfreq_kmer_filter(int k_value);
+static void kmersearch_load_table_highfreq_filter(int k_size);
+static void kmersearch_highfreq_xact_callback(XactEvent event, void *arg);
+static void kmersearch_highfreq_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+                                                 SubTransactionId parentSubid, void *arg);
+static void kmersearch_register_highfreq_xact_callback(void);
+static void kmersearch_discard_reverted_caches(int nest_level);
+static dsm_handle kmersearch_highfreq_cache_export(void);
+static void kmersearch_highfreq_cache_export_release(void);
+static bool kmersearch_highfreq_cache_import(dsm_handle handle, int leader_pid, uint64 serial);
+
+static HighfreqGenerationTable *kmersearch_highfreq_generation_table(void);
+static int kmersearch_highfreq_generation_slot(Oid table_oid, uint32 column_name_hash,
+                                               int kmer_size, int occur_bitlen);
+static uint64 kmersearch_highfreq_generation(Oid table_oid, uint32 column_name_hash,
+                                             int kmer_size, int occur_bitlen);
+static void kmersearch_apply_generation_bumps(void);
+static void kmersearch_refresh_global_highfreq_cache(void);
+
+static Size kmersearch_shared_highfreq_shmem_size(void);
+static uint64 *kmersearch_shared_highfreq_data(uint32 buffer);
+static SharedHighfreqKmerCacheBuffer *kmersearch_shared_highfreq_active(void);
+static void kmersearch_shared_highfreq_write_file(void);
+static void kmersearch_shared_highfreq_read_file(void);
 
 void kmersearch_highfreq_kmer_cache_init(void);
 bool kmersearch_highfreq_kmer_cache_load_internal(Oid table_oid, const char *column_name, int k_value);
 void kmersearch_highfreq_kmer_cache_free_internal(void);
 bool kmersearch_highfreq_kmer_cache_is_valid(Oid table_oid, const char *column_name, int k_value);
 
+/*
+ * Generation counters for compiled queries.
+ * query_kmer_cache_generation changes whenever a cache entry may be freed or
+ * reused, invalidating entry pointers kept in fn_extra.
+ * compiled_query_score_generation changes whenever the settings or the
+ * high-frequency k-mer set behind actual_min_score change.
+ */
+static uint64 query_kmer_cache_generation = 1;
+static uint64 compiled_query_score_generation = 1;
+
+/*
+ * Shared query-kmer cache (requires shared_preload_libraries)
+ * The control block lives in main shared memory; entries live in a DSA area
+ * created by the first backend that uses the cache.
+ */
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+static SharedQueryKmerCacheControl *shared_query_cache_ctl = NULL;
+
+/*
+ * Shared high-frequency k-mer cache (requires shared_preload_libraries)
+ * Control block and filter data live in main shared memory.
+ */
+static SharedHighfreqKmerCacheControl *shared_highfreq_ctl = NULL;
+
+/*
+ * Analysis generations (see HighfreqGenerationTable)
+ * pending_generation_bumps lives in TopTransactionContext.
+ */
+static HighfreqGenerationTable *highfreq_generations = NULL;
+static List *pending_generation_bumps = NIL;
+static bool highfreq_generation_checked = false;
+static bool parallel_highfreq_cache_stale = false;
+static bool highfreq_xact_callback_registered = false;
+static dsa_area *shared_query_cache_dsa = NULL;
+static dshash_table *shared_query_cache_hash = NULL;
+
 /*
  * Initialize query-kmer cache manager
  */
@@ -93,7 +194,7 @@ init_query_kmer_cache_manager(QueryKmerCacheManager **manager)
  * Generate cache key for query-kmer
  */
 static uint64
-generate_query_kmer_cache_key(const char *query_string, int k_size)
+generate_query_kmer_cache_key(const char *query_string, int k_size, bool canonical)
 {
     uint64 query_hash, k_hash;
     
@@ -103,6 +204,13 @@ generate_query_kmer_cache_key(const char *query_string, int k_size)
     /* Hash k_size with different seed */
     k_hash = hash_any_extended((unsigned char*)&k_size, sizeof(k_size), 1);
     
+    /* Keys extracted with a different occurrence bit length are not interchangeable */
+    k_hash ^= hash_any_extended((unsigned char*)&kmersearch_occur_bitlen, sizeof(kmersearch_occur_bitlen), 2);
+    
+    /* Canonical and forward-strand keys of the same query differ */
+    if (canonical)
+        k_hash = ~k_hash;
+    
     /* Combine hashes */
     return query_hash ^ (k_hash << 1);
 }
@@ -160,27 +268,27 @@ lru_evict_oldest_query_kmer_cache(QueryKmerCacheManager *manager)
     manager->lru_tail = tail->prev;
     
     /* Free allocated memory */
-    if (tail->query_string_copy)
-        pfree(tail->query_string_copy);
-    if (tail->extracted_uintkey)
-        pfree(tail->extracted_uintkey);
+    free_query_kmer_cache_entry_data(tail);
     
     manager->current_entries--;
+    query_kmer_cache_generation++;
 }
 
 /*
  * Look up query-kmer cache entry
  */
 static QueryKmerCacheEntry *
-lookup_query_kmer_cache_entry(QueryKmerCacheManager *manager, const char *query_string, int k_size)
+lookup_query_kmer_cache_entry(QueryKmerCacheManager *manager, const char *query_string, int k_size, bool canonical)
 {
-    uint64 hash_key = generate_query_kmer_cache_key(query_string, k_size);
+    uint64 hash_key = generate_query_kmer_cache_key(query_string, k_size, canonical);
     QueryKmerCacheEntry *entry;
     bool found;
     
     entry = (QueryKmerCacheEntry *) hash_search(manager->hash_table, &hash_key, HASH_FIND, &found);
     
-    if (found && entry && strcmp(entry->query_string_copy, query_string) == 0 && entry->kmer_size == k_size)
+    if (found && entry && strcmp(entry->query_string_copy, query_string) == 0 &&
+        entry->kmer_size == k_size && entry->occur_bitlen == kmersearch_occur_bitlen &&
+        entry->canonical == canonical)
     {
         /* Cache hit - move to head of LRU */
         lru_touch_query_kmer_cache(manager, entry);
@@ -192,11 +300,126 @@ lookup_query_kmer_cache_entry(QueryKmerCacheManager *manager, const char *query_
 }
 
 /*
- * Store entry in query-kmer cache
+ * Free the arrays owned by a query-kmer cache entry
+ */
+static void
+free_query_kmer_cache_entry_data(QueryKmerCacheEntry *entry)
+{
+    if (entry->query_string_copy)
+        pfree(entry->query_string_copy);
+    if (entry->extracted_uintkey)
+        pfree(entry->extracted_uintkey);
+    if (entry->sorted_uintkey)
+        pfree(entry->sorted_uintkey);
+    if (entry->probe_table)
+        pfree(entry->probe_table);
+    if (entry->presence_bitmap)
+        pfree(entry->presence_bitmap);
+    entry->presence_bitmap = NULL;
+    entry->query_string_copy = NULL;
+    entry->extracted_uintkey = NULL;
+    entry->sorted_uintkey = NULL;
+    entry->probe_table = NULL;
+}
+
+/*
+ * Build the sorted key array and the probe set (or presence bitmap) of a
+ * query-kmer cache entry
+ * Must be called in the query-kmer cache memory context.
  */
 static void
+compile_query_kmer_cache_entry(QueryKmerCacheEntry *entry)
+{
+    int table_size = 16;
+    int log2_size = 4;
+    int i;
+
+    /* Sorted copy for the intersection engine */
+    entry->sorted_uintkey = palloc(entry->kmer_count * entry->elem_size);
+    memcpy(entry->sorted_uintkey, entry->extracted_uintkey, entry->kmer_count * entry->elem_size);
+    kmersearch_sort_uintkey(entry->sorted_uintkey, entry->kmer_count, entry->elem_size);
+
+    entry->score_generation = 0;
+
+    /* 16-bit key space: an 8KB presence bitmap replaces the probe set */
+    if (entry->elem_size == sizeof(uint16))
+    {
+        entry->presence_bitmap = (uint64 *) palloc(KMERSEARCH_UINTKEY16_BITMAP_WORDS * sizeof(uint64));
+        kmersearch_build_uintkey16_bitmap((const uint16 *) entry->extracted_uintkey,
+                                          entry->kmer_count, entry->presence_bitmap);
+        entry->probe_table = NULL;
+        return;
+    }
+    entry->presence_bitmap = NULL;
+
+    /* Probe set with load factor <= 0.5 */
+    while (table_size < entry->kmer_count * 2)
+    {
+        table_size <<= 1;
+        log2_size++;
+    }
+    entry->probe_table = (uint64 *) palloc(table_size * sizeof(uint64));
+    memset(entry->probe_table, 0xFF, table_size * sizeof(uint64));
+    entry->probe_shift = 64 - log2_size;
+    entry->probe_mask = (uint64) (table_size - 1);
+    entry->probe_has_empty_key = false;
+
+    for (i = 0; i < entry->kmer_count; i++)
+    {
+        uint64 key;
+        uint64 slot;
+
+        if (entry->elem_size == sizeof(uint16))
+            key = ((uint16 *) entry->extracted_uintkey)[i];
+        else if (entry->elem_size == sizeof(uint32))
+            key = ((uint32 *) entry->extracted_uintkey)[i];
+        else
+            key = ((uint64 *) entry->extracted_uintkey)[i];
+
+        if (key == KMERSEARCH_PROBE_EMPTY_KEY)
+        {
+            entry->probe_has_empty_key = true;
+            continue;
+        }
+
+        slot = KMERSEARCH_PROBE_HASH(key, entry->probe_shift);
+        while (entry->probe_table[slot] != KMERSEARCH_PROBE_EMPTY_KEY &&
+               entry->probe_table[slot] != key)
+            slot = (slot + 1) & entry->probe_mask;
+        entry->probe_table[slot] = key;
+    }
+}
+
+/*
+ * Resolve filtered key count and actual_min_score of a compiled query
+ */
+static void
+resolve_compiled_query_score(QueryKmerCacheEntry *entry)
+{
+    uint64 highfreq_state = kmersearch_highfreq_state_hash();
+
+    /* A count taken under the same high-frequency k-mer set is still valid */
+    if (entry->highfreq_count < 0 || entry->highfreq_state != highfreq_state)
+    {
+        entry->highfreq_count = (highfreq_state != 0) ?
+            count_highfreq_uintkey(entry->extracted_uintkey, entry->kmer_count, entry->kmer_size) : 0;
+        entry->highfreq_state = highfreq_state;
+    }
+
+    entry->actual_min_score = actual_min_score_from_highfreq_count(entry->kmer_count,
+                                                                   entry->highfreq_count,
+                                                                   highfreq_state != 0);
+    entry->filtered_kmer_count = entry->kmer_count - entry->highfreq_count;
+    entry->score_generation = compiled_query_score_generation;
+}
+
+/*
+ * Store entry in query-kmer cache
+ */
+static QueryKmerCacheEntry *
 store_query_kmer_cache_entry(QueryKmerCacheManager *manager, uint64 hash_key, 
-                               const char *query_string, int k_size, void *uintkeys, int kmer_count)
+                               const char *query_string, int k_size, bool canonical,
+                               void *uintkeys, int kmer_count)
 {
     QueryKmerCacheEntry *entry;
     MemoryContext old_context;
@@ -212,27 +435,41 @@ store_query_kmer_cache_entry(QueryKmerCacheManager *manager, uint64 hash_key,
     
     old_context = MemoryContextSwitchTo(manager->query_kmer_cache_context);
     
-    /* Create new entry */
+    /* Create new entry, or reuse the slot of a colliding entry */
     entry = (QueryKmerCacheEntry *) hash_search(manager->hash_table, &hash_key, HASH_ENTER, &found);
+    if (found)
+    {
+        free_query_kmer_cache_entry_data(entry);
+        lru_touch_query_kmer_cache(manager, entry);
+        query_kmer_cache_generation++;
+    }
+    
+    entry->hash_key = hash_key;
+    entry->query_string_copy = pstrdup(query_string);
+    entry->kmer_size = k_size;
+    entry->canonical = canonical;
+    entry->kmer_count = kmer_count;
+    entry->occur_bitlen = kmersearch_occur_bitlen;
+    entry->highfreq_count = -1;
+    entry->highfreq_state = 0;
+    
+    /* Determine size of uintkey array based on total_bits */
+    if (total_bits <= 16)
+        entry->elem_size = sizeof(uint16);
+    else if (total_bits <= 32)
+        entry->elem_size = sizeof(uint32);
+    else
+        entry->elem_size = sizeof(uint64);
+    uintkey_size = kmer_count * entry->elem_size;
+    
+    /* Copy uintkey array */
+    entry->extracted_uintkey = palloc(uintkey_size);
+    memcpy(entry->extracted_uintkey, uintkeys, uintkey_size);
+    
+    compile_query_kmer_cache_entry(entry);
+    
     if (!found)
     {
-        entry->hash_key = hash_key;
-        entry->query_string_copy = pstrdup(query_string);
-        entry->kmer_size = k_size;
-        entry->kmer_count = kmer_count;
-        
-        /* Determine size of uintkey array based on total_bits */
-        if (total_bits <= 16)
-            uintkey_size = kmer_count * sizeof(uint16);
-        else if (total_bits <= 32)
-            uintkey_size = kmer_count * sizeof(uint32);
-        else
-            uintkey_size = kmer_count * sizeof(uint64);
-        
-        /* Copy uintkey array */
-        entry->extracted_uintkey = palloc(uintkey_size);
-        memcpy(entry->extracted_uintkey, uintkeys, uintkey_size);
-        
         /* Add to LRU chain */
         entry->prev = NULL;
         entry->next = manager->lru_head;
@@ -246,21 +483,25 @@ store_query_kmer_cache_entry(QueryKmerCacheManager *manager, uint64 hash_key,
     }
     
     MemoryContextSwitchTo(old_context);
+    
+    return entry;
 }
 
 /*
- * Get cached query uintkeys or extract and cache them
+ * Get compiled query-kmer cache entry, extracting and compiling on miss
+ * Returns NULL if the query yields no k-mers.
  */
-void *
-kmersearch_get_cached_query_uintkey(const char *query_string, int k_size, int *nkeys)
+QueryKmerCacheEntry *
+kmersearch_get_cached_query_entry(const char *query_string, int k_size, bool canonical)
 {
     QueryKmerCacheEntry *cache_entry;
     void *extracted_uintkeys = NULL;
+    int nkeys = 0;
+    int highfreq_count = -1;
+    uint64 highfreq_state = 0;
     uint64 hash_key;
     MemoryContext old_context;
     
-    *nkeys = 0;
-    
     /* Initialize query-kmer cache manager if not already done */
     if (query_kmer_cache_manager == NULL)
     {
@@ -270,36 +511,150 @@ kmersearch_get_cached_query_uintkey(const char *query_string, int k_size, int *n
     }
     
     /* Try to find in cache first */
-    cache_entry = lookup_query_kmer_cache_entry(query_kmer_cache_manager, query_string, k_size);
-    if (cache_entry != NULL)
+    cache_entry = lookup_query_kmer_cache_entry(query_kmer_cache_manager, query_string, k_size, canonical);
+    if (cache_entry == NULL)
+    {
+        /* Cache miss - extract uintkeys and store in cache */
+        query_kmer_cache_manager->misses++;
+        
+        if (kmersearch_shared_query_kmer_cache_attach())
+        {
+            SharedQueryKmerCacheKey shared_key;
+            
+            /* Another backend may already have extracted this query */
+            highfreq_state = kmersearch_highfreq_state_hash();
+            shared_key = generate_shared_query_kmer_cache_key(query_string, k_size, canonical, highfreq_state);
+            extracted_uintkeys = lookup_shared_query_kmer_cache(&shared_key, &nkeys, &highfreq_count);
+            if (extracted_uintkeys == NULL)
+            {
+                kmersearch_extract_uintkey_from_text(query_string, &extracted_uintkeys, &nkeys, canonical);
+                if (extracted_uintkeys != NULL && nkeys > 0)
+                {
+                    int total_bits = k_size * 2 + kmersearch_occur_bitlen;
+                    int elem_size;
+                    
+                    if (total_bits <= 16)
+                        elem_size = sizeof(uint16);
+                    else if (total_bits <= 32)
+                        elem_size = sizeof(uint32);
+                    else
+                        elem_size = sizeof(uint64);
+                    
+                    highfreq_count = (highfreq_state != 0) ?
+                        count_highfreq_uintkey(extracted_uintkeys, nkeys, k_size) : 0;
+                    store_shared_query_kmer_cache(&shared_key, extracted_uintkeys, nkeys,
+                                                  elem_size, highfreq_count);
+                }
+            }
+        }
+        else
+            kmersearch_extract_uintkey_from_text(query_string, &extracted_uintkeys, &nkeys, canonical);
+        
+        if (extracted_uintkeys != NULL && nkeys > 0)
+        {
+            hash_key = generate_query_kmer_cache_key(query_string, k_size, canonical);
+            cache_entry = store_query_kmer_cache_entry(query_kmer_cache_manager, hash_key, 
+                                                       query_string, k_size, canonical,
+                                                       extracted_uintkeys, nkeys);
+            
+            /* Reuse the high-frequency count taken with the shared entry */
+            if (highfreq_count >= 0)
+            {
+                cache_entry->highfreq_count = highfreq_count;
+                cache_entry->highfreq_state = highfreq_state;
+            }
+        }
+        
+        /* Cache has its own copy */
+        if (extracted_uintkeys != NULL)
+            pfree(extracted_uintkeys);
+    }
+    
+    return cache_entry;
+}
+
+/*
+ * Get cached query uintkeys or extract and cache them
+ */
+void *
+kmersearch_get_cached_query_uintkey(const char *query_string, int k_size, bool canonical, int *nkeys)
+{
+    QueryKmerCacheEntry *cache_entry;
+    
+    cache_entry = kmersearch_get_cached_query_entry(query_string, k_size, canonical);
+    if (cache_entry == NULL)
     {
-        /* Cache hit - return pointer to cached uintkeys directly */
-        *nkeys = cache_entry->kmer_count;
-        return cache_entry->extracted_uintkey;
+        *nkeys = 0;
+        return NULL;
     }
     
-    /* Cache miss - extract uintkeys and store in cache */
-    query_kmer_cache_manager->misses++;
-    kmersearch_extract_uintkey_from_text(query_string, &extracted_uintkeys, nkeys);
+    /* Return pointer to cached uintkeys directly */
+    *nkeys = cache_entry->kmer_count;
+    return cache_entry->extracted_uintkey;
+}
+
+/*
+ * Get compiled query for a query text argument of a SQL-callable function
+ *
+ * The query text and the resolved cache entry are remembered in fn_extra, so
+ * rows evaluated against the same query text skip text_to_cstring and the
+ * cache lookup entirely.  The returned entry has an up-to-date
+ * actual_min_score.  Returns NULL if the query yields no k-mers.
+ */
+QueryKmerCacheEntry *
+kmersearch_get_compiled_query(FmgrInfo *flinfo, text *query_text, bool canonical)
+{
+    CompiledQueryFnState *state = (CompiledQueryFnState *) flinfo->fn_extra;
+    QueryKmerCacheEntry *entry;
     
-    if (extracted_uintkeys != NULL && *nkeys > 0)
+    if (state != NULL &&
+        state->cache_generation == query_kmer_cache_generation &&
+        state->kmer_size == kmersearch_kmer_size &&
+        state->occur_bitlen == kmersearch_occur_bitlen &&
+        state->canonical == canonical &&
+        VARSIZE_ANY_EXHDR(state->query_text) == VARSIZE_ANY_EXHDR(query_text) &&
+        memcmp(VARDATA_ANY(state->query_text), VARDATA_ANY(query_text),
+               VARSIZE_ANY_EXHDR(query_text)) == 0)
     {
-        /* Store in cache */
-        hash_key = generate_query_kmer_cache_key(query_string, k_size);
-        store_query_kmer_cache_entry(query_kmer_cache_manager, hash_key, 
-                                       query_string, k_size, extracted_uintkeys, *nkeys);
+        entry = state->entry;
+    }
+    else
+    {
+        char *query_string = text_to_cstring(query_text);
         
-        /* Find the cache entry we just stored and return its uintkeys */
-        cache_entry = lookup_query_kmer_cache_entry(query_kmer_cache_manager, query_string, k_size);
-        if (cache_entry != NULL) {
-            /* Free the original extracted uintkeys (cache has its own copy) */
-            pfree(extracted_uintkeys);
-            
-            return cache_entry->extracted_uintkey;
+        entry = kmersearch_get_cached_query_entry(query_string, kmersearch_kmer_size, canonical);
+        pfree(query_string);
+        
+        if (state == NULL)
+        {
+            state = (CompiledQueryFnState *) MemoryContextAllocZero(flinfo->fn_mcxt,
+                                                                    sizeof(CompiledQueryFnState));
+            flinfo->fn_extra = state;
         }
+        if (state->query_text)
+            pfree(state->query_text);
+        state->query_text = (text *) MemoryContextAlloc(flinfo->fn_mcxt, VARSIZE_ANY(query_text));
+        memcpy(state->query_text, query_text, VARSIZE_ANY(query_text));
+        state->kmer_size = kmersearch_kmer_size;
+        state->occur_bitlen = kmersearch_occur_bitlen;
+        state->canonical = canonical;
+        state->cache_generation = query_kmer_cache_generation;
+        state->entry = entry;
     }
     
-    return extracted_uintkeys;
+    if (entry != NULL && entry->score_generation != compiled_query_score_generation)
+        resolve_compiled_query_score(entry);
+    
+    return entry;
+}
+
+/*
+ * Invalidate actual_min_score resolved in compiled queries
+ */
+void
+kmersearch_invalidate_compiled_query_scores(void)
+{
+    compiled_query_score_generation++;
 }
 
 /*
@@ -318,147 +673,515 @@ kmersearch_free_query_kmer_cache_manager(QueryKmerCacheManager **manager)
         pfree(*manager);
         *manager = NULL;
     }
+    query_kmer_cache_generation++;
 }
 
 /*
- * Create actual min score cache manager
+ * Fingerprint of the high-frequency k-mer set query keys are filtered
+ * against (0 when filtering is disabled)
  */
-static void
-create_actual_min_score_cache_manager(ActualMinScoreCacheManager **manager)
+static uint64
+kmersearch_highfreq_state_hash(void)
 {
-    HASHCTL hash_ctl;
+    uint64 state;
     
-    /* Allocate manager in current context (caller should have set appropriate context) */
-    *manager = (ActualMinScoreCacheManager *) palloc0(sizeof(ActualMinScoreCacheManager));
+    if (!kmersearch_is_highfreq_filtering_enabled())
+        return 0;
     
-    /* Create actual min score cache context under current context */
-    (*manager)->cache_context = AllocSetContextCreate(CurrentMemoryContext,
-                                                   "ActualMinScoreCache",
-                                                   ALLOCSET_DEFAULT_SIZES);
+    /* Refresh stale caches before fingerprinting them */
+    kmersearch_highfreq_cache_check_generation();
     
-    /* Initialize parameters */
-    (*manager)->hits = 0;
-    (*manager)->misses = 0;
-    (*manager)->max_entries = kmersearch_actual_min_score_cache_max_entries;
-    (*manager)->current_entries = 0;
+    state = hash_any_extended((unsigned char *) &global_highfreq_cache.current_cache_key,
+                              sizeof(HighfreqCacheKey), 0);
     
-    /* Create hash table */
-    MemSet(&hash_ctl, 0, sizeof(hash_ctl));
-    hash_ctl.keysize = sizeof(uint64);  /* Hash value as key */
-    hash_ctl.entrysize = sizeof(ActualMinScoreCacheEntry);
-    hash_ctl.hcxt = (*manager)->cache_context;
+    /* Forced parallel cache lookups answer from the parallel cache's k-mer set */
+    if (kmersearch_force_use_parallel_highfreq_kmer_cache && parallel_highfreq_cache != NULL)
+        state ^= hash_any_extended((unsigned char *) &parallel_highfreq_cache->cache_key,
+                                   sizeof(HighfreqCacheKey), 1);
     
-    (*manager)->cache_hash = hash_create("ActualMinScoreCache", 256, &hash_ctl,
-                                     HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+    /* The shared cache may be republished by another backend at any time */
+    if (shared_highfreq_ctl != NULL)
+    {
+        uint64 generation = pg_atomic_read_u64(&shared_highfreq_ctl->generation);
+        
+        state ^= hash_any_extended((unsigned char *) &generation, sizeof(uint64), 2);
+    }
+    
+    /*
+     * Same cache key, different k-mer set: the analysis generation the
+     * caches were loaded at, and any analysis since (table filter)
+     */
+    {
+        uint64 generations[3];
+        
+        generations[0] = global_highfreq_cache.generation;
+        generations[1] = (parallel_highfreq_cache != NULL) ? parallel_highfreq_cache->generation : 0;
+        generations[2] = pg_atomic_read_u64(&kmersearch_highfreq_generation_table()->total);
+        state ^= hash_any_extended((unsigned char *) generations, sizeof(generations), 3);
+    }
+    
+    return (state != 0) ? state : 1;
 }
 
 /*
- * Free actual min score cache manager
+ * Install shared memory hooks of the shared query-kmer and high-frequency
+ * k-mer caches
+ * Only possible while shared_preload_libraries is being processed.
  */
 void
-kmersearch_free_actual_min_score_cache_manager(ActualMinScoreCacheManager **manager)
+kmersearch_shmem_init(void)
 {
-    if (*manager)
-    {
-        /* Delete the actual min score cache context, which will free all allocated memory */
-        if ((*manager)->cache_context)
-            MemoryContextDelete((*manager)->cache_context);
-        *manager = NULL;
-    }
+    if (!process_shared_preload_libraries_in_progress)
+        return;
+    
+    prev_shmem_request_hook = shmem_request_hook;
+    shmem_request_hook = kmersearch_shmem_request;
+    prev_shmem_startup_hook = shmem_startup_hook;
+    shmem_startup_hook = kmersearch_shmem_startup;
 }
 
 /*
- * Calculate actual min score from uintkey array
- * Helper function for cache miss case
+ * Request shared memory for the shared caches
  */
-static int
-calculate_actual_min_score_from_uintkey(void *uintkey, int nkeys, int k_size)
+static void
+kmersearch_shmem_request(void)
 {
-    int base_min_score;
-    int highfreq_count = 0;
-    int actual_min_score;
-    int relative_min = 0;
-    int query_total_kmers = nkeys;
-    int total_bits;
+    if (prev_shmem_request_hook)
+        prev_shmem_request_hook();
     
-    total_bits = k_size * 2 + kmersearch_occur_bitlen;
+    RequestAddinShmemSpace(MAXALIGN(sizeof(SharedQueryKmerCacheControl)));
+    RequestNamedLWLockTranche("pg_kmersearch_query_cache", 1);
     
-    /* Calculate base minimum score (maximum of absolute and relative) */
-    if (query_total_kmers > 0)
-    {
-        relative_min = (int)ceil(kmersearch_min_shared_kmer_rate * query_total_kmers);
-    }
+    RequestAddinShmemSpace(kmersearch_shared_highfreq_shmem_size());
+    RequestNamedLWLockTranche("pg_kmersearch_highfreq_cache", 1);
+}
+
+/*
+ * Initialize the shared cache control blocks
+ * The postmaster also reloads the persisted high-frequency k-mer set here.
+ */
+static void
+kmersearch_shmem_startup(void)
+{
+    bool found;
+    int i;
     
-    base_min_score = (kmersearch_min_score > relative_min) ? kmersearch_min_score : relative_min;
+    if (prev_shmem_startup_hook)
+        prev_shmem_startup_hook();
     
-    /* If high-frequency k-mer filtering is enabled, subtract high-frequency k-mer count */
-    if (kmersearch_is_highfreq_filtering_enabled())
+    LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+    
+    shared_query_cache_ctl = ShmemInitStruct("pg_kmersearch shared query-kmer cache",
+                                             sizeof(SharedQueryKmerCacheControl),
+                                             &found);
+    if (!found)
     {
-        /* Count high-frequency k-mers */
-        if (total_bits <= 16)
-        {
-            uint16 *keys = (uint16 *)uintkey;
-            for (int i = 0; i < nkeys; i++)
-            {
-                if (kmersearch_is_uintkey_highfreq((uint64)keys[i], k_size))
-                    highfreq_count++;
-            }
-        }
-        else if (total_bits <= 32)
-        {
-            uint32 *keys = (uint32 *)uintkey;
-            for (int i = 0; i < nkeys; i++)
-            {
-                if (kmersearch_is_uintkey_highfreq((uint64)keys[i], k_size))
-                    highfreq_count++;
-            }
-        }
-        else
-        {
-            uint64 *keys = (uint64 *)uintkey;
-            for (int i = 0; i < nkeys; i++)
-            {
-                if (kmersearch_is_uintkey_highfreq(keys[i], k_size))
-                    highfreq_count++;
-            }
-        }
-        
-        actual_min_score = base_min_score - highfreq_count;
-        
-        /* Ensure minimum value of 1 */
-        if (actual_min_score < 1)
-        {
-            actual_min_score = 1;
-        }
+        shared_query_cache_ctl->lock = &(GetNamedLWLockTranche("pg_kmersearch_query_cache"))->lock;
+        shared_query_cache_ctl->area_handle = DSA_HANDLE_INVALID;
+        shared_query_cache_ctl->hash_handle = DSHASH_HANDLE_INVALID;
+        pg_atomic_init_u64(&shared_query_cache_ctl->used_bytes, 0);
+        pg_atomic_init_u64(&shared_query_cache_ctl->entries, 0);
+        pg_atomic_init_u64(&shared_query_cache_ctl->hits, 0);
+        pg_atomic_init_u64(&shared_query_cache_ctl->misses, 0);
+        pg_atomic_init_u64(&shared_query_cache_ctl->evictions, 0);
     }
-    else
+    
+    shared_highfreq_ctl = ShmemInitStruct("pg_kmersearch shared high-frequency k-mer cache",
+                                          kmersearch_shared_highfreq_shmem_size(),
+                                          &found);
+    if (!found)
     {
-        actual_min_score = base_min_score;
+        shared_highfreq_ctl->lock = &(GetNamedLWLockTranche("pg_kmersearch_highfreq_cache"))->lock;
+        pg_atomic_init_u64(&shared_highfreq_ctl->generation, 1);
+        shared_highfreq_ctl->is_valid = false;
+        pg_atomic_init_u32(&shared_highfreq_ctl->active, 0);
+        memset(shared_highfreq_ctl->buffers, 0, sizeof(shared_highfreq_ctl->buffers));
+        shared_highfreq_ctl->capacity = (Size) kmersearch_shared_highfreq_kmer_cache_size * 1024;
+        pg_atomic_init_u64(&shared_highfreq_ctl->generations.total, 0);
+        for (i = 0; i < KMERSEARCH_HIGHFREQ_GENERATION_SLOTS; i++)
+            pg_atomic_init_u64(&shared_highfreq_ctl->generations.slots[i], 0);
+        
+        if (shared_highfreq_ctl->capacity > 0)
+            kmersearch_shared_highfreq_read_file();
     }
+    highfreq_generations = &shared_highfreq_ctl->generations;
     
-    return actual_min_score;
+    LWLockRelease(AddinShmemInitLock);
 }
 
 /*
- * Get cached actual_min_score from uintkey array
- * For use with new uintkey-based extraction
+ * Attach to the shared query-kmer cache, creating its DSA area on first use
+ * Returns false if the shared cache is disabled or was not preloaded.
  */
-int
-kmersearch_get_cached_actual_min_score_uintkey(void *uintkey, int nkeys, int k_size)
+static bool
+kmersearch_shared_query_kmer_cache_attach(void)
 {
-    ActualMinScoreCacheEntry *cache_entry;
-    uint64 query_hash = 0;
-    MemoryContext old_context;
-    int total_bits;
+    dshash_parameters params;
+    MemoryContext oldcontext;
     
-    total_bits = k_size * 2 + kmersearch_occur_bitlen;
+    if (shared_query_cache_ctl == NULL || kmersearch_shared_query_kmer_cache_size <= 0)
+        return false;
     
-    /* Initialize cache manager if needed */
-    if (actual_min_score_cache_manager == NULL)
+    if (shared_query_cache_hash != NULL)
+        return true;
+    
+    memset(&params, 0, sizeof(params));
+    params.key_size = sizeof(SharedQueryKmerCacheKey);
+    params.entry_size = sizeof(SharedQueryKmerCacheEntry);
+    params.compare_function = dshash_memcmp;
+    params.hash_function = dshash_memhash;
+#if PG_VERSION_NUM >= 170000
+    params.copy_function = dshash_memcpy;
+#endif
+    params.tranche_id = LWTRANCHE_KMERSEARCH_QUERY_CACHE;
+    
+    LWLockRegisterTranche(LWTRANCHE_KMERSEARCH_QUERY_CACHE, "pg_kmersearch_query_cache_dsa");
+    
+    /* Use TopMemoryContext for persistent dshash objects */
+    oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+    
+    LWLockAcquire(shared_query_cache_ctl->lock, LW_EXCLUSIVE);
+    
+    if (shared_query_cache_ctl->area_handle == DSA_HANDLE_INVALID)
     {
-        old_context = MemoryContextSwitchTo(TopMemoryContext);
-        create_actual_min_score_cache_manager(&actual_min_score_cache_manager);
-        MemoryContextSwitchTo(old_context);
+        /* First user creates the area and keeps it for the life of the cluster */
+        shared_query_cache_dsa = dsa_create(LWTRANCHE_KMERSEARCH_QUERY_CACHE);
+        dsa_pin(shared_query_cache_dsa);
+        dsa_pin_mapping(shared_query_cache_dsa);
+        shared_query_cache_hash = dshash_create(shared_query_cache_dsa, &params, NULL);
+        
+        shared_query_cache_ctl->area_handle = dsa_get_handle(shared_query_cache_dsa);
+        shared_query_cache_ctl->hash_handle = dshash_get_hash_table_handle(shared_query_cache_hash);
+    }
+    else
+    {
+        shared_query_cache_dsa = dsa_attach(shared_query_cache_ctl->area_handle);
+        dsa_pin_mapping(shared_query_cache_dsa);
+        shared_query_cache_hash = dshash_attach(shared_query_cache_dsa, &params,
+                                                shared_query_cache_ctl->hash_handle, NULL);
+    }
+    
+    LWLockRelease(shared_query_cache_ctl->lock);
+    MemoryContextSwitchTo(oldcontext);
+    
+    return true;
+}
+
+/*
+ * Generate shared query-kmer cache key
+ * The query text itself is not kept in shared memory, so the key is a
+ * 128-bit fingerprint built from two independently seeded hashes.
+ */
+static SharedQueryKmerCacheKey
+generate_shared_query_kmer_cache_key(const char *query_string, int k_size, bool canonical,
+                                     uint64 highfreq_state)
+{
+    SharedQueryKmerCacheKey key;
+    int32 settings[3];
+    uint64 settings_hash;
+    size_t len = strlen(query_string);
+    
+    settings[0] = k_size;
+    settings[1] = kmersearch_occur_bitlen;
+    settings[2] = canonical ? 1 : 0;
+    settings_hash = hash_any_extended((unsigned char *) settings, sizeof(settings), highfreq_state);
+    
+    key.hi = hash_any_extended((unsigned char *) query_string, len, settings_hash);
+    key.lo = hash_any_extended((unsigned char *) query_string, len,
+                               settings_hash ^ UINT64CONST(0x9E3779B97F4A7C15)) ^ (uint64) len;
+    
+    return key;
+}
+
+/*
+ * Lookup query in shared query-kmer cache
+ * Returns a palloc'd copy of the uintkey array, or NULL on miss.
+ */
+static void *
+lookup_shared_query_kmer_cache(const SharedQueryKmerCacheKey *key, int *nkeys, int *highfreq_count)
+{
+    SharedQueryKmerCacheEntry *entry;
+    void *uintkeys;
+    Size size;
+    
+    entry = (SharedQueryKmerCacheEntry *) dshash_find(shared_query_cache_hash, key, false);
+    if (entry == NULL)
+    {
+        pg_atomic_fetch_add_u64(&shared_query_cache_ctl->misses, 1);
+        return NULL;
+    }
+    
+    size = (Size) entry->kmer_count * entry->elem_size;
+    uintkeys = palloc(size);
+    memcpy(uintkeys, dsa_get_address(shared_query_cache_dsa, entry->uintkeys), size);
+    *nkeys = entry->kmer_count;
+    *highfreq_count = entry->highfreq_count;
+    
+    /* Setting the reference bit under a shared lock is a benign race */
+    entry->referenced = true;
+    
+    dshash_release_lock(shared_query_cache_hash, entry);
+    pg_atomic_fetch_add_u64(&shared_query_cache_ctl->hits, 1);
+    
+    return uintkeys;
+}
+
+/*
+ * Publish extracted query uintkeys in shared query-kmer cache
+ * Queries that do not fit are simply not shared.
+ */
+static void
+store_shared_query_kmer_cache(const SharedQueryKmerCacheKey *key, void *uintkeys, int nkeys,
+                              int elem_size, int highfreq_count)
+{
+    SharedQueryKmerCacheEntry *entry;
+    Size data_size = (Size) nkeys * elem_size;
+    Size bytes = data_size + sizeof(SharedQueryKmerCacheEntry);
+    Size limit = (Size) kmersearch_shared_query_kmer_cache_size * 1024;
+    dsa_pointer data;
+    bool found;
+    
+    if (bytes > limit)
+        return;
+    
+    if (pg_atomic_read_u64(&shared_query_cache_ctl->used_bytes) + bytes > limit)
+        evict_shared_query_kmer_cache(limit - bytes);
+    
+    data = dsa_allocate_extended(shared_query_cache_dsa, data_size, DSA_ALLOC_NO_OOM);
+    if (!DsaPointerIsValid(data))
+        return;
+    memcpy(dsa_get_address(shared_query_cache_dsa, data), uintkeys, data_size);
+    
+    entry = (SharedQueryKmerCacheEntry *) dshash_find_or_insert(shared_query_cache_hash, key, &found);
+    if (found)
+    {
+        /* Another backend published the same query first */
+        dshash_release_lock(shared_query_cache_hash, entry);
+        dsa_free(shared_query_cache_dsa, data);
+        return;
+    }
+    
+    entry->uintkeys = data;
+    entry->kmer_count = nkeys;
+    entry->elem_size = elem_size;
+    entry->highfreq_count = highfreq_count;
+    entry->bytes = bytes;
+    entry->referenced = true;
+    dshash_release_lock(shared_query_cache_hash, entry);
+    
+    pg_atomic_fetch_add_u64(&shared_query_cache_ctl->used_bytes, bytes);
+    pg_atomic_fetch_add_u64(&shared_query_cache_ctl->entries, 1);
+}
+
+/*
+ * Evict shared query-kmer cache entries until at most target_bytes are used
+ * Clock sweep: referenced entries get a second chance, so at most two passes
+ * over the table are needed.
+ */
+static void
+evict_shared_query_kmer_cache(Size target_bytes)
+{
+    dshash_seq_status status;
+    SharedQueryKmerCacheEntry *entry;
+    int pass;
+    
+    for (pass = 0; pass < 2; pass++)
+    {
+        if (pg_atomic_read_u64(&shared_query_cache_ctl->used_bytes) <= target_bytes)
+            return;
+        
+        dshash_seq_init(&status, shared_query_cache_hash, true);
+        while ((entry = (SharedQueryKmerCacheEntry *) dshash_seq_next(&status)) != NULL)
+        {
+            Size bytes;
+            
+            if (pg_atomic_read_u64(&shared_query_cache_ctl->used_bytes) <= target_bytes)
+                break;
+            
+            if (entry->referenced)
+            {
+                entry->referenced = false;
+                continue;
+            }
+            
+            bytes = entry->bytes;
+            dsa_free(shared_query_cache_dsa, entry->uintkeys);
+            dshash_delete_current(&status);
+            
+            pg_atomic_fetch_sub_u64(&shared_query_cache_ctl->used_bytes, bytes);
+            pg_atomic_fetch_sub_u64(&shared_query_cache_ctl->entries, 1);
+            pg_atomic_fetch_add_u64(&shared_query_cache_ctl->evictions, 1);
+        }
+        dshash_seq_term(&status);
+    }
+}
+
+/*
+ * Create actual min score cache manager
+ */
+static void
+create_actual_min_score_cache_manager(ActualMinScoreCacheManager **manager)
+{
+    HASHCTL hash_ctl;
+    
+    /* Allocate manager in current context (caller should have set appropriate context) */
+    *manager = (ActualMinScoreCacheManager *) palloc0(sizeof(ActualMinScoreCacheManager));
+    
+    /* Create actual min score cache context under current context */
+    (*manager)->cache_context = AllocSetContextCreate(CurrentMemoryContext,
+                                                   "ActualMinScoreCache",
+                                                   ALLOCSET_DEFAULT_SIZES);
+    
+    /* Initialize parameters */
+    (*manager)->hits = 0;
+    (*manager)->misses = 0;
+    (*manager)->max_entries = kmersearch_actual_min_score_cache_max_entries;
+    (*manager)->current_entries = 0;
+    
+    /* Create hash table */
+    MemSet(&hash_ctl, 0, sizeof(hash_ctl));
+    hash_ctl.keysize = sizeof(uint64);  /* Hash value as key */
+    hash_ctl.entrysize = sizeof(ActualMinScoreCacheEntry);
+    hash_ctl.hcxt = (*manager)->cache_context;
+    
+    (*manager)->cache_hash = hash_create("ActualMinScoreCache", 256, &hash_ctl,
+                                     HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+}
+
+/*
+ * Free actual min score cache manager
+ */
+void
+kmersearch_free_actual_min_score_cache_manager(ActualMinScoreCacheManager **manager)
+{
+    if (*manager)
+    {
+        /* Delete the actual min score cache context, which will free all allocated memory */
+        if ((*manager)->cache_context)
+            MemoryContextDelete((*manager)->cache_context);
+        *manager = NULL;
+    }
+    
+    /* Settings behind actual_min_score changed */
+    kmersearch_invalidate_compiled_query_scores();
+}
+
+/*
+ * Count high-frequency k-mers in uintkey array
+ */
+static int
+count_highfreq_uintkey(void *uintkey, int nkeys, int k_size)
+{
+    int highfreq_count = 0;
+    int total_bits;
+    KmerHighfreqFilter filter;
+    
+    total_bits = k_size * 2 + kmersearch_occur_bitlen;
+    kmersearch_highfreq_filter_resolve(&filter, k_size);
+    
+    if (total_bits <= 16)
+    {
+        uint16 *keys = (uint16 *)uintkey;
+        for (int i = 0; i < nkeys; i++)
+        {
+            if (kmersearch_highfreq_filter_contains(&filter, (uint64)keys[i]))
+                highfreq_count++;
+        }
+    }
+    else if (total_bits <= 32)
+    {
+        uint32 *keys = (uint32 *)uintkey;
+        for (int i = 0; i < nkeys; i++)
+        {
+            if (kmersearch_highfreq_filter_contains(&filter, (uint64)keys[i]))
+                highfreq_count++;
+        }
+    }
+    else
+    {
+        uint64 *keys = (uint64 *)uintkey;
+        for (int i = 0; i < nkeys; i++)
+        {
+            if (kmersearch_highfreq_filter_contains(&filter, keys[i]))
+                highfreq_count++;
+        }
+    }
+    
+    return highfreq_count;
+}
+
+/*
+ * Calculate actual min score from query k-mer count and high-frequency k-mer count
+ */
+static int
+actual_min_score_from_highfreq_count(int nkeys, int highfreq_count, bool filtering_enabled)
+{
+    int base_min_score;
+    int actual_min_score;
+    int relative_min = 0;
+    
+    /* Calculate base minimum score (maximum of absolute and relative) */
+    if (nkeys > 0)
+    {
+        relative_min = (int)ceil(kmersearch_min_shared_kmer_rate * nkeys);
+    }
+    
+    base_min_score = (kmersearch_min_score > relative_min) ? kmersearch_min_score : relative_min;
+    
+    /* If high-frequency k-mer filtering is enabled, subtract high-frequency k-mer count */
+    if (!filtering_enabled)
+        return base_min_score;
+    
+    actual_min_score = base_min_score - highfreq_count;
+    
+    /* Ensure minimum value of 1 */
+    if (actual_min_score < 1)
+    {
+        actual_min_score = 1;
+    }
+    
+    return actual_min_score;
+}
+
+/*
+ * Calculate actual min score from uintkey array
+ * Helper function for cache miss case
+ */
+static int
+calculate_actual_min_score_from_uintkey(void *uintkey, int nkeys, int k_size)
+{
+    bool filtering_enabled = kmersearch_is_highfreq_filtering_enabled();
+    int highfreq_count = 0;
+    
+    if (filtering_enabled)
+        highfreq_count = count_highfreq_uintkey(uintkey, nkeys, k_size);
+    
+    return actual_min_score_from_highfreq_count(nkeys, highfreq_count, filtering_enabled);
+}
+
+/*
+ * Get cached actual_min_score from uintkey array
+ * For use with new uintkey-based extraction
+ */
+int
+kmersearch_get_cached_actual_min_score_uintkey(void *uintkey, int nkeys, int k_size)
+{
+    ActualMinScoreCacheEntry *cache_entry;
+    uint64 query_hash = 0;
+    MemoryContext old_context;
+    int total_bits;
+    
+    total_bits = k_size * 2 + kmersearch_occur_bitlen;
+    
+    /* A refresh of stale high-frequency k-mer caches drops this cache */
+    kmersearch_highfreq_cache_check_generation();
+    
+    /* Initialize cache manager if needed */
+    if (actual_min_score_cache_manager == NULL)
+    {
+        old_context = MemoryContextSwitchTo(TopMemoryContext);
+        create_actual_min_score_cache_manager(&actual_min_score_cache_manager);
+        MemoryContextSwitchTo(old_context);
     }
     
     /* Calculate hash based on total_bits to determine uintkey type */
@@ -598,188 +1321,1091 @@ kmersearch_get_cached_actual_min_score_datum_int4(Datum *queryKeys, int nkeys)
 }
 
 /*
- * Get cached actual_min_score from int8 Datum array
+ * Get cached actual_min_score from int8 Datum array
+ */
+int
+kmersearch_get_cached_actual_min_score_datum_int8(Datum *queryKeys, int nkeys)
+{
+    ActualMinScoreCacheEntry *cache_entry;
+    uint64 query_hash = 0;
+    
+    /* Initialize cache manager if needed */
+    if (actual_min_score_cache_manager == NULL)
+    {
+        MemoryContext old_context = MemoryContextSwitchTo(TopMemoryContext);
+        create_actual_min_score_cache_manager(&actual_min_score_cache_manager);
+        MemoryContextSwitchTo(old_context);
+    }
+    
+    /* Calculate hash from uint64 values - must match extract_query */
+    for (int i = 0; i < nkeys; i++)
+    {
+        uint64 key = (uint64)DatumGetInt64(queryKeys[i]);
+        query_hash = query_hash * 31 + key;
+    }
+    
+    /* Look up in cache */
+    cache_entry = (ActualMinScoreCacheEntry *) hash_search(actual_min_score_cache_manager->cache_hash,
+                                                          &query_hash, HASH_FIND, NULL);
+    
+    if (cache_entry == NULL)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+                 errmsg("GIN index settings mismatch: the index being used does not match current GUC settings"),
+                 errdetail("Current settings: kmersearch.kmer_size=%d, kmersearch.occur_bitlen=%d. "
+                           "Ensure a GIN index exists with these settings, or adjust the GUC variables to match an existing index.",
+                           kmersearch_kmer_size, kmersearch_occur_bitlen),
+                 errhint("Check available indexes with: SELECT index_oid::regclass, kmer_size, occur_bitlen FROM kmersearch_index_info")));
+    }
+
+    actual_min_score_cache_manager->hits++;
+    return cache_entry->actual_min_score;
+}
+
+/*
+ * Query-kmer cache statistics function
+ */
+Datum
+kmersearch_query_kmer_cache_stats(PG_FUNCTION_ARGS)
+{
+    TupleDesc tupdesc;
+    Datum values[4];
+    bool nulls[4] = {false};
+    HeapTuple tuple;
+    
+    /* Build tuple descriptor */
+    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("function returning record called in context that cannot accept a set")));
+    
+    /* Query-kmer cache statistics */
+    if (query_kmer_cache_manager)
+    {
+        values[0] = Int64GetDatum(query_kmer_cache_manager->hits);
+        values[1] = Int64GetDatum(query_kmer_cache_manager->misses);
+        values[2] = Int32GetDatum(query_kmer_cache_manager->current_entries);
+        values[3] = Int32GetDatum(query_kmer_cache_manager->max_entries);
+    }
+    else
+    {
+        /* Cache manager not initialized */
+        values[0] = Int64GetDatum(0);  /* hits */
+        values[1] = Int64GetDatum(0);  /* misses */
+        values[2] = Int32GetDatum(0);  /* current_entries */
+        values[3] = Int32GetDatum(0);  /* max_entries */
+    }
+    
+    tuple = heap_form_tuple(tupdesc, values, nulls);
+    PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+}
+
+/*
+ * Query-kmer cache free function
+ */
+Datum
+kmersearch_query_kmer_cache_free(PG_FUNCTION_ARGS)
+{
+    int freed_entries = 0;
+    
+    /* Count entries before freeing */
+    if (query_kmer_cache_manager)
+        freed_entries += query_kmer_cache_manager->current_entries;
+    
+    /* Free query-kmer cache manager (uses TopMemoryContext - needs manual cleanup) */
+    /* DNA2/DNA4 cache managers are now local and automatically freed with QueryContext */
+    kmersearch_free_query_kmer_cache_manager(&query_kmer_cache_manager);
+    
+    PG_RETURN_INT32(freed_entries);
+}
+
+/*
+ * Shared query-kmer cache statistics function
+ */
+Datum
+kmersearch_shared_query_kmer_cache_stats(PG_FUNCTION_ARGS)
+{
+    TupleDesc tupdesc;
+    Datum values[6];
+    bool nulls[6] = {false};
+    HeapTuple tuple;
+    
+    /* Build tuple descriptor */
+    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("function returning record called in context that cannot accept a set")));
+    
+    /* Counters are cluster-wide; all zero when the library was not preloaded */
+    if (shared_query_cache_ctl)
+    {
+        values[0] = Int64GetDatum((int64) pg_atomic_read_u64(&shared_query_cache_ctl->hits));
+        values[1] = Int64GetDatum((int64) pg_atomic_read_u64(&shared_query_cache_ctl->misses));
+        values[2] = Int64GetDatum((int64) pg_atomic_read_u64(&shared_query_cache_ctl->evictions));
+        values[3] = Int64GetDatum((int64) pg_atomic_read_u64(&shared_query_cache_ctl->entries));
+        values[4] = Int64GetDatum((int64) pg_atomic_read_u64(&shared_query_cache_ctl->used_bytes));
+    }
+    else
+    {
+        values[0] = Int64GetDatum(0);  /* hits */
+        values[1] = Int64GetDatum(0);  /* misses */
+        values[2] = Int64GetDatum(0);  /* evictions */
+        values[3] = Int64GetDatum(0);  /* current_entries */
+        values[4] = Int64GetDatum(0);  /* used_bytes */
+    }
+    values[5] = Int64GetDatum((int64) kmersearch_shared_query_kmer_cache_size * 1024);
+    
+    tuple = heap_form_tuple(tupdesc, values, nulls);
+    PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+}
+
+/*
+ * Actual min score cache statistics function
+ */
+Datum
+kmersearch_actual_min_score_cache_stats(PG_FUNCTION_ARGS)
+{
+    TupleDesc tupdesc;
+    Datum values[4];
+    bool nulls[4] = {false};
+    HeapTuple tuple;
+    
+    /* Build tuple descriptor */
+    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("function returning record called in context that cannot accept a set")));
+    
+    /* Actual min score cache statistics */
+    if (actual_min_score_cache_manager)
+    {
+        values[0] = Int64GetDatum(actual_min_score_cache_manager->hits);
+        values[1] = Int64GetDatum(actual_min_score_cache_manager->misses);
+        values[2] = Int32GetDatum(actual_min_score_cache_manager->current_entries);
+        values[3] = Int32GetDatum(actual_min_score_cache_manager->max_entries);
+    }
+    else
+    {
+        /* Cache manager not initialized */
+        values[0] = Int64GetDatum(0);  /* hits */
+        values[1] = Int64GetDatum(0);  /* misses */
+        values[2] = Int32GetDatum(0);  /* current_entries */
+        values[3] = Int32GetDatum(0);  /* max_entries */
+    }
+    
+    tuple = heap_form_tuple(tupdesc, values, nulls);
+    PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+}
+
+/*
+ * Free actual min score cache
+ */
+Datum
+kmersearch_actual_min_score_cache_free(PG_FUNCTION_ARGS)
+{
+    int freed_entries = 0;
+    
+    /* Count entries before freeing */
+    if (actual_min_score_cache_manager)
+        freed_entries = actual_min_score_cache_manager->current_entries;
+    
+    /* Free actual min score cache manager (uses TopMemoryContext - needs manual cleanup) */
+    kmersearch_free_actual_min_score_cache_manager(&actual_min_score_cache_manager);
+    
+    PG_RETURN_INT32(freed_entries);
+}
+
+/*
+ * High-frequency k-mer cache management functions implementation
+ */
+void
+kmersearch_highfreq_kmer_cache_init(void)
+{
+    MemoryContext old_context;
+    
+    /* Switch to TopMemoryContext */
+    old_context = MemoryContextSwitchTo(TopMemoryContext);
+    
+    /* Initialize cache structure */
+    memset(&global_highfreq_cache, 0, sizeof(HighfreqKmerCache));
+    global_highfreq_cache.is_valid = false;
+    memset(&global_highfreq_cache.current_cache_key, 0, sizeof(HighfreqCacheKey));
+    global_highfreq_cache.current_cache_key.table_oid = InvalidOid;
+    
+    /* Create dedicated memory context for high-frequency k-mer cache */
+    global_highfreq_cache.cache_context = AllocSetContextCreate(TopMemoryContext,
+                                                                "HighfreqKmerCache",
+                                                                ALLOCSET_DEFAULT_SIZES);
+    
+    global_highfreq_cache.highfreq_hash = NULL;
+    global_highfreq_cache.highfreq_kmers = NULL;
+    global_highfreq_cache.highfreq_count = 0;
+    global_highfreq_cache.kmer_bitmap = NULL;
+    global_highfreq_cache.kmer_eytzinger = NULL;
+    
+    MemoryContextSwitchTo(old_context);
+}
+
+/*
+ * Fill an Eytzinger (breadth-first) ordered array from a sorted array
+ * eytzinger is 1-based; returns the next unused position of sorted.
+ */
+static int
+kmersearch_eytzinger_fill(const uint64 *sorted, uint64 *eytzinger, int n, int pos, int node)
+{
+    if (node <= n)
+    {
+        pos = kmersearch_eytzinger_fill(sorted, eytzinger, n, pos, 2 * node);
+        eytzinger[node] = sorted[pos++];
+        pos = kmersearch_eytzinger_fill(sorted, eytzinger, n, pos, 2 * node + 1);
+    }
+    return pos;
+}
+
+/*
+ * Build a compact membership filter from sorted, distinct k-mers
+ * A 4^k-bit bitmap for small k, otherwise the k-mers in Eytzinger order.
+ * Allocates in the current memory context; both outputs are NULL if empty.
+ */
+static void
+kmersearch_build_kmer_filter(const uint64 *sorted, int nkmers, int k_value,
+                             uint64 **bitmap_out, uint64 **eytzinger_out)
+{
+    uint64 *eytzinger;
+    
+    *bitmap_out = NULL;
+    *eytzinger_out = NULL;
+    
+    if (nkmers == 0)
+        return;
+    
+    if (k_value <= KMERSEARCH_HIGHFREQ_BITMAP_MAX_K)
+    {
+        uint64 nbits = UINT64CONST(1) << (2 * k_value);
+        Size bitmap_bytes = (Size) (nbits / 8);
+        
+        if (k_value <= KMERSEARCH_HIGHFREQ_BITMAP_DENSE_K ||
+            bitmap_bytes <= (Size) nkmers * sizeof(uint64))
+        {
+            uint64 *bitmap = (uint64 *) palloc0(bitmap_bytes);
+            int i;
+            
+            for (i = 0; i < nkmers; i++)
+            {
+                uint64 kmer = sorted[i];
+                
+                /* Lookups strip the occurrence bits, so larger values never match */
+                if (kmer < nbits)
+                    bitmap[kmer >> 6] |= UINT64CONST(1) << (kmer & 63);
+            }
+            *bitmap_out = bitmap;
+            return;
+        }
+    }
+    
+    eytzinger = (uint64 *) palloc((nkmers + 1) * sizeof(uint64));
+    eytzinger[0] = 0;
+    kmersearch_eytzinger_fill(sorted, eytzinger, nkmers, 0, 1);
+    *eytzinger_out = eytzinger;
+}
+
+/*
+ * Build the compact membership filter of the global high-frequency k-mer cache
+ * Must be called in the cache memory context once the hash table is filled.
+ */
+static void
+kmersearch_build_highfreq_kmer_filter(int k_value)
+{
+    HASH_SEQ_STATUS status;
+    HighfreqKmerHashEntry *entry;
+    uint64 *sorted;
+    int nkmers = 0;
+    
+    sorted = (uint64 *) palloc(Max(global_highfreq_cache.highfreq_count, 1) * sizeof(uint64));
+    hash_seq_init(&status, global_highfreq_cache.highfreq_hash);
+    while ((entry = (HighfreqKmerHashEntry *) hash_seq_search(&status)) != NULL)
+        sorted[nkmers++] = entry->hash_value;
+    kmersearch_sort_uintkey(sorted, nkmers, sizeof(uint64));
+    
+    kmersearch_build_kmer_filter(sorted, nkmers, k_value,
+                                 &global_highfreq_cache.kmer_bitmap,
+                                 &global_highfreq_cache.kmer_eytzinger);
+    pfree(sorted);
+}
+
+/*
+ * Transient high-frequency k-mer filter read from the kmersearch_highfreq_kmer
+ * table when no cache is loaded.  It is loaded on first use and kept until
+ * the end of the transaction, so index builds and scans never run a query
+ * per k-mer.
+ */
+static MemoryContext table_highfreq_filter_context = NULL;
+static int table_highfreq_filter_kmer_size = 0;
+static int table_highfreq_filter_occur_bitlen = 0;
+static uint64 *table_highfreq_filter_bitmap = NULL;
+static uint64 *table_highfreq_filter_eytzinger = NULL;
+static int table_highfreq_filter_nkmers = 0;
+
+/*
+ * Discard the transient table filter (its k-mer set may have changed)
+ */
+void
+kmersearch_reset_table_highfreq_filter(void)
+{
+    if (table_highfreq_filter_context != NULL)
+        MemoryContextDelete(table_highfreq_filter_context);
+    
+    table_highfreq_filter_context = NULL;
+    table_highfreq_filter_bitmap = NULL;
+    table_highfreq_filter_eytzinger = NULL;
+    table_highfreq_filter_nkmers = 0;
+}
+
+/*
+ * End-of-transaction work of the high-frequency k-mer caches
+ * Publishes committed analysis generations, drops the transient table
+ * filter and re-arms the generation check.
+ */
+static void
+kmersearch_highfreq_xact_callback(XactEvent event, void *arg)
+{
+    switch (event)
+    {
+        case XACT_EVENT_PRE_PREPARE:
+            /* The rows only become visible at COMMIT PREPARED, which no callback sees */
+            if (pending_generation_bumps != NIL)
+                ereport(ERROR,
+                        (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                         errmsg("cannot PREPARE a transaction that has changed high-frequency k-mer analyses")));
+            break;
+        case XACT_EVENT_COMMIT:
+            kmersearch_apply_generation_bumps();
+            /* fall through */
+        case XACT_EVENT_PREPARE:
+        case XACT_EVENT_PARALLEL_COMMIT:
+        case XACT_EVENT_ABORT:
+        case XACT_EVENT_PARALLEL_ABORT:
+            if (event == XACT_EVENT_ABORT)
+                kmersearch_discard_reverted_caches(1);
+            global_cache_publish_level = 0;
+            parallel_cache_publish_level = 0;
+            pending_generation_bumps = NIL;
+            highfreq_generation_checked = false;
+            parallel_highfreq_cache_stale = false;
+            kmersearch_reset_table_highfreq_filter();
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * Hand cache publications of a committed subtransaction to its parent and
+ * drop the caches whose publication an aborted one reverted
+ */
+static void
+kmersearch_highfreq_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+                                     SubTransactionId parentSubid, void *arg)
+{
+    int nest_level = GetCurrentTransactionNestLevel();
+    
+    switch (event)
+    {
+        case SUBXACT_EVENT_COMMIT_SUB:
+            if (global_cache_publish_level >= nest_level)
+                global_cache_publish_level = nest_level - 1;
+            if (parallel_cache_publish_level >= nest_level)
+                parallel_cache_publish_level = nest_level - 1;
+            break;
+        case SUBXACT_EVENT_ABORT_SUB:
+            kmersearch_discard_reverted_caches(nest_level);
+            break;
+        default:
+            break;
+    }
+}
+
+static void
+kmersearch_register_highfreq_xact_callback(void)
+{
+    if (!highfreq_xact_callback_registered)
+    {
+        RegisterXactCallback(kmersearch_highfreq_xact_callback, NULL);
+        RegisterSubXactCallback(kmersearch_highfreq_subxact_callback, NULL);
+        highfreq_xact_callback_registered = true;
+    }
+}
+
+/*
+ * Drop the leader caches published at or below an aborting nest level
+ * Their hidden GUCs have reverted, so workers would no longer find them;
+ * without the cache the leader agrees with its workers again.
+ */
+static void
+kmersearch_discard_reverted_caches(int nest_level)
+{
+    if (global_cache_publish_level >= nest_level)
+    {
+        kmersearch_highfreq_kmer_cache_free_internal();
+        global_cache_publish_level = 0;
+    }
+    
+    if (parallel_cache_publish_level >= nest_level)
+    {
+        kmersearch_parallel_highfreq_kmer_cache_free_internal();
+        parallel_cache_publish_level = 0;
+    }
+}
+
+/*
+ * Load every high-frequency k-mer of this k-mer size and occurrence bit
+ * length with one query, matching what per-key table lookups used to test
+ */
+static void
+kmersearch_load_table_highfreq_filter(int k_size)
+{
+    MemoryContext old_context;
+    uint64 *kmers = NULL;
+    int nkmers = 0;
+    
+    kmersearch_reset_table_highfreq_filter();
+    kmersearch_register_highfreq_xact_callback();
+    
+    table_highfreq_filter_context = AllocSetContextCreate(TopTransactionContext,
+                                                          "KmersearchTableHighfreqFilter",
+                                                          ALLOCSET_DEFAULT_SIZES);
+    table_highfreq_filter_kmer_size = k_size;
+    table_highfreq_filter_occur_bitlen = kmersearch_occur_bitlen;
+    
+    if (SPI_connect() == SPI_OK_CONNECT)
+    {
+        StringInfoData query;
+        
+        initStringInfo(&query);
+        appendStringInfo(&query,
+            "SELECT DISTINCT uintkey FROM kmersearch_highfreq_kmer "
+            "WHERE kmer_size = %d AND occur_bitlen = %d",
+            k_size, kmersearch_occur_bitlen);
+        
+        if (SPI_execute(query.data, true, 0) == SPI_OK_SELECT && SPI_processed > 0)
+        {
+            uint64 i;
+            
+            kmers = (uint64 *) MemoryContextAlloc(table_highfreq_filter_context,
+                                                  SPI_processed * sizeof(uint64));
+            for (i = 0; i < SPI_processed; i++)
+            {
+                bool isnull;
+                Datum kmer_datum;
+                
+                kmer_datum = SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1, &isnull);
+                if (!isnull)
+                    kmers[nkmers++] = (uint64) DatumGetInt64(kmer_datum);
+            }
+        }
+        
+        pfree(query.data);
+        SPI_finish();
+    }
+    
+    if (nkmers > 0)
+        kmersearch_sort_uintkey(kmers, nkmers, sizeof(uint64));
+    
+    old_context = MemoryContextSwitchTo(table_highfreq_filter_context);
+    kmersearch_build_kmer_filter(kmers, nkmers, k_size,
+                                 &table_highfreq_filter_bitmap,
+                                 &table_highfreq_filter_eytzinger);
+    MemoryContextSwitchTo(old_context);
+    
+    if (kmers != NULL)
+        pfree(kmers);
+    table_highfreq_filter_nkmers = nkmers;
+}
+
+/*
+ * Resolve a filter over the kmersearch_highfreq_kmer table, loading the
+ * transient table filter on first use in this transaction
+ */
+void
+kmersearch_table_highfreq_filter_resolve(KmerHighfreqFilter *filter, int k_size)
+{
+    if (table_highfreq_filter_context == NULL ||
+        table_highfreq_filter_kmer_size != k_size ||
+        table_highfreq_filter_occur_bitlen != kmersearch_occur_bitlen)
+        kmersearch_load_table_highfreq_filter(k_size);
+    
+    if (table_highfreq_filter_bitmap != NULL)
+    {
+        filter->kind = KMERSEARCH_HIGHFREQ_FILTER_BITMAP;
+        filter->bitmap = table_highfreq_filter_bitmap;
+        filter->bitmap_bits = UINT64CONST(1) << (2 * k_size);
+    }
+    else if (table_highfreq_filter_eytzinger != NULL)
+    {
+        filter->kind = KMERSEARCH_HIGHFREQ_FILTER_EYTZINGER;
+        filter->eytzinger = table_highfreq_filter_eytzinger;
+        filter->nkmers = table_highfreq_filter_nkmers;
+    }
+    else
+        filter->kind = KMERSEARCH_HIGHFREQ_FILTER_NONE;
+}
+
+/*
+ * Analysis generation counters of this backend's view
+ * Shared by all backends when preloaded, otherwise private to this backend,
+ * which then only notices its own analyses.
+ */
+static HighfreqGenerationTable *
+kmersearch_highfreq_generation_table(void)
+{
+    if (highfreq_generations == NULL)
+    {
+        int i;
+        
+        highfreq_generations = (HighfreqGenerationTable *)
+            MemoryContextAlloc(TopMemoryContext, sizeof(HighfreqGenerationTable));
+        pg_atomic_init_u64(&highfreq_generations->total, 0);
+        for (i = 0; i < KMERSEARCH_HIGHFREQ_GENERATION_SLOTS; i++)
+            pg_atomic_init_u64(&highfreq_generations->slots[i], 0);
+    }
+    return highfreq_generations;
+}
+
+/*
+ * Generation slot of a (database, table, column, k-mer size, occurrence bit length)
+ */
+static int
+kmersearch_highfreq_generation_slot(Oid table_oid, uint32 column_name_hash,
+                                    int kmer_size, int occur_bitlen)
+{
+    uint32 key[5];
+    
+    key[0] = MyDatabaseId;
+    key[1] = table_oid;
+    key[2] = column_name_hash;
+    key[3] = (uint32) kmer_size;
+    key[4] = (uint32) occur_bitlen;
+    
+    return DatumGetUInt32(hash_any((unsigned char *) key, sizeof(key))) %
+           KMERSEARCH_HIGHFREQ_GENERATION_SLOTS;
+}
+
+/*
+ * Current analysis generation of a high-frequency k-mer set
+ * Counters only grow, so the sum changes whenever either slot does.
+ */
+static uint64
+kmersearch_highfreq_generation(Oid table_oid, uint32 column_name_hash,
+                               int kmer_size, int occur_bitlen)
+{
+    HighfreqGenerationTable *table = kmersearch_highfreq_generation_table();
+    
+    return pg_atomic_read_u64(&table->slots[kmersearch_highfreq_generation_slot(table_oid, column_name_hash,
+                                                                                kmer_size, occur_bitlen)]) +
+           pg_atomic_read_u64(&table->slots[kmersearch_highfreq_generation_slot(table_oid, column_name_hash,
+                                                                                0, 0)]);
+}
+
+/*
+ * Remember that this transaction changed the high-frequency k-mers of a
+ * column (k_size 0: every k-mer size); the generation is bumped at commit
+ */
+void
+kmersearch_highfreq_generation_bump_at_commit(Oid table_oid, const char *column_name, int k_size)
+{
+    HighfreqGenerationBump *bump;
+    MemoryContext old_context;
+    
+    kmersearch_register_highfreq_xact_callback();
+    
+    old_context = MemoryContextSwitchTo(TopTransactionContext);
+    bump = (HighfreqGenerationBump *) palloc(sizeof(HighfreqGenerationBump));
+    bump->table_oid = table_oid;
+    bump->column_name_hash = DatumGetUInt32(hash_any((unsigned char *) column_name, strlen(column_name)));
+    bump->kmer_size = k_size;
+    bump->occur_bitlen = (k_size > 0) ? kmersearch_occur_bitlen : 0;
+    pending_generation_bumps = lappend(pending_generation_bumps, bump);
+    MemoryContextSwitchTo(old_context);
+}
+
+/*
+ * Publish the generation bumps of a committed analysis
+ * A shared set of the same column is withdrawn, so that it is not
+ * reloaded at the next server start either.
+ */
+static void
+kmersearch_apply_generation_bumps(void)
+{
+    HighfreqGenerationTable *table = kmersearch_highfreq_generation_table();
+    ListCell *lc;
+    
+    foreach(lc, pending_generation_bumps)
+    {
+        HighfreqGenerationBump *bump = (HighfreqGenerationBump *) lfirst(lc);
+        SharedHighfreqKmerCacheBuffer *published;
+        
+        pg_atomic_fetch_add_u64(&table->slots[kmersearch_highfreq_generation_slot(bump->table_oid,
+                                                                                  bump->column_name_hash,
+                                                                                  bump->kmer_size,
+                                                                                  bump->occur_bitlen)], 1);
+        pg_atomic_fetch_add_u64(&table->total, 1);
+        
+        if (shared_highfreq_ctl == NULL)
+            continue;
+        
+        LWLockAcquire(shared_highfreq_ctl->lock, LW_EXCLUSIVE);
+        published = kmersearch_shared_highfreq_active();
+        if (shared_highfreq_ctl->is_valid &&
+            published->database_oid == MyDatabaseId &&
+            published->cache_key.table_oid == bump->table_oid &&
+            published->cache_key.column_name_hash == bump->column_name_hash &&
+            (bump->kmer_size == 0 ||
+             (published->cache_key.kmer_size == bump->kmer_size &&
+              published->cache_key.occur_bitlen == bump->occur_bitlen)))
+        {
+            shared_highfreq_ctl->is_valid = false;
+            pg_atomic_fetch_add_u64(&shared_highfreq_ctl->generation, 1);
+            if (unlink(KMERSEARCH_SHARED_HIGHFREQ_FILE) != 0 && errno != ENOENT)
+                ereport(WARNING,
+                        (errcode_for_file_access(),
+                         errmsg("could not remove file \"%s\": %m", KMERSEARCH_SHARED_HIGHFREQ_FILE)));
+        }
+        LWLockRelease(shared_highfreq_ctl->lock);
+    }
+    
+    pending_generation_bumps = NIL;
+}
+
+/*
+ * Reload the global cache after an analysis of its column committed
+ * The reload runs in a subtransaction; if it fails (for example because the
+ * analysis was undone) the cache is dropped instead.
+ */
+static void
+kmersearch_refresh_global_highfreq_cache(void)
+{
+    Oid table_oid = global_highfreq_cache.current_cache_key.table_oid;
+    int k_value = global_highfreq_cache.current_cache_key.kmer_size;
+    char column_name[NAMEDATALEN];
+    MemoryContext old_context = CurrentMemoryContext;
+    ResourceOwner old_owner = CurrentResourceOwner;
+    bool reloaded = false;
+    
+    strlcpy(column_name, global_highfreq_cache.column_name, NAMEDATALEN);
+    
+    BeginInternalSubTransaction(NULL);
+    MemoryContextSwitchTo(old_context);
+    
+    PG_TRY();
+    {
+        reloaded = kmersearch_highfreq_kmer_cache_load_internal(table_oid, column_name, k_value);
+        ReleaseCurrentSubTransaction();
+        MemoryContextSwitchTo(old_context);
+        CurrentResourceOwner = old_owner;
+    }
+    PG_CATCH();
+    {
+        ErrorData *edata;
+        
+        MemoryContextSwitchTo(old_context);
+        edata = CopyErrorData();
+        FlushErrorState();
+        RollbackAndReleaseCurrentSubTransaction();
+        MemoryContextSwitchTo(old_context);
+        CurrentResourceOwner = old_owner;
+        
+        ereport(WARNING,
+                (errmsg("could not refresh high-frequency k-mer cache: %s", edata->message)));
+        FreeErrorData(edata);
+    }
+    PG_END_TRY();
+    
+    /* Workers map the reloaded filter, or find none if it was dropped */
+    if (!reloaded)
+        kmersearch_highfreq_kmer_cache_free_internal();
+    kmersearch_publish_global_highfreq_cache();
+    
+    /* Cached actual_min_score values were computed against the old k-mer set */
+    kmersearch_free_actual_min_score_cache_manager(&actual_min_score_cache_manager);
+}
+
+/*
+ * Validate high-frequency k-mer caches against the analysis generations
+ * Checked once per transaction, so a statement never sees two k-mer sets.
+ * A stale global cache is reloaded (not in parallel mode, where
+ * subtransactions are not allowed); a stale parallel cache is ignored
+ * until it is reloaded.
+ */
+void
+kmersearch_highfreq_cache_check_generation(void)
+{
+    if (highfreq_generation_checked)
+        return;
+    
+    kmersearch_register_highfreq_xact_callback();
+    highfreq_generation_checked = true;
+    
+    /* The parallel cache's generation means nothing to other backends' private counters */
+    parallel_highfreq_cache_stale =
+        (shared_highfreq_ctl != NULL &&
+         parallel_highfreq_cache != NULL && parallel_highfreq_cache->is_initialized &&
+         parallel_highfreq_cache->generation !=
+         kmersearch_highfreq_generation(parallel_highfreq_cache->cache_key.table_oid,
+                                        parallel_highfreq_cache->cache_key.column_name_hash,
+                                        parallel_highfreq_cache->cache_key.kmer_size,
+                                        parallel_highfreq_cache->cache_key.occur_bitlen));
+    
+    /* Parallel workers follow the leader's global cache */
+    if (IsInParallelMode() || !IsTransactionState())
+        return;
+    
+    if (global_highfreq_cache.is_valid &&
+        global_highfreq_cache.generation !=
+        kmersearch_highfreq_generation(global_highfreq_cache.current_cache_key.table_oid,
+                                       global_highfreq_cache.current_cache_key.column_name_hash,
+                                       global_highfreq_cache.current_cache_key.kmer_size,
+                                       global_highfreq_cache.current_cache_key.occur_bitlen))
+        kmersearch_refresh_global_highfreq_cache();
+}
+
+/*
+ * Whether the parallel cache predates a committed analysis of its column
+ */
+bool
+kmersearch_is_parallel_highfreq_cache_stale(void)
+{
+    return parallel_highfreq_cache_stale;
+}
+
+/*
+ * Shared memory needed by the shared high-frequency k-mer cache
+ * (control block and two filter buffers)
+ */
+static Size
+kmersearch_shared_highfreq_shmem_size(void)
+{
+    return add_size(MAXALIGN(sizeof(SharedHighfreqKmerCacheControl)),
+                    mul_size((Size) kmersearch_shared_highfreq_kmer_cache_size * 1024, 2));
+}
+
+/*
+ * Filter data of one buffer of the shared high-frequency k-mer cache
+ */
+static uint64 *
+kmersearch_shared_highfreq_data(uint32 buffer)
+{
+    return (uint64 *) ((char *) shared_highfreq_ctl +
+                       MAXALIGN(sizeof(SharedHighfreqKmerCacheControl)) +
+                       buffer * shared_highfreq_ctl->capacity);
+}
+
+/*
+ * Descriptor of the buffer holding the published k-mer set
+ */
+static SharedHighfreqKmerCacheBuffer *
+kmersearch_shared_highfreq_active(void)
+{
+    return &shared_highfreq_ctl->buffers[pg_atomic_read_u32(&shared_highfreq_ctl->active)];
+}
+
+/*
+ * Resolve the filter from the shared high-frequency k-mer cache
+ * Returns false if no k-mer set of this database, k-mer size and occurrence
+ * bit length is published.  The filter points into the active buffer; a
+ * reload writes the other one, so it stays intact while the caller, which
+ * resolves once per row or query, is using it.
  */
-int
-kmersearch_get_cached_actual_min_score_datum_int8(Datum *queryKeys, int nkeys)
+bool
+kmersearch_shared_highfreq_filter_resolve(KmerHighfreqFilter *filter, int k_size)
 {
-    ActualMinScoreCacheEntry *cache_entry;
-    uint64 query_hash = 0;
+    uint32 buffer;
+    SharedHighfreqKmerCacheBuffer *published;
     
-    /* Initialize cache manager if needed */
-    if (actual_min_score_cache_manager == NULL)
-    {
-        MemoryContext old_context = MemoryContextSwitchTo(TopMemoryContext);
-        create_actual_min_score_cache_manager(&actual_min_score_cache_manager);
-        MemoryContextSwitchTo(old_context);
-    }
+    if (shared_highfreq_ctl == NULL || !shared_highfreq_ctl->is_valid)
+        return false;
     
-    /* Calculate hash from uint64 values - must match extract_query */
-    for (int i = 0; i < nkeys; i++)
-    {
-        uint64 key = (uint64)DatumGetInt64(queryKeys[i]);
-        query_hash = query_hash * 31 + key;
-    }
+    /* Read the published buffer only after seeing is_valid */
+    pg_read_barrier();
+    buffer = pg_atomic_read_u32(&shared_highfreq_ctl->active);
+    pg_read_barrier();
+    published = &shared_highfreq_ctl->buffers[buffer];
     
-    /* Look up in cache */
-    cache_entry = (ActualMinScoreCacheEntry *) hash_search(actual_min_score_cache_manager->cache_hash,
-                                                          &query_hash, HASH_FIND, NULL);
+    if (published->database_oid != MyDatabaseId ||
+        published->cache_key.kmer_size != k_size ||
+        published->cache_key.occur_bitlen != kmersearch_occur_bitlen)
+        return false;
     
-    if (cache_entry == NULL)
+    if (published->highfreq_count == 0)
+        filter->kind = KMERSEARCH_HIGHFREQ_FILTER_NONE;
+    else if (published->bitmap_bytes > 0)
     {
-        ereport(ERROR,
-                (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
-                 errmsg("GIN index settings mismatch: the index being used does not match current GUC settings"),
-                 errdetail("Current settings: kmersearch.kmer_size=%d, kmersearch.occur_bitlen=%d. "
-                           "Ensure a GIN index exists with these settings, or adjust the GUC variables to match an existing index.",
-                           kmersearch_kmer_size, kmersearch_occur_bitlen),
-                 errhint("Check available indexes with: SELECT index_oid::regclass, kmer_size, occur_bitlen FROM kmersearch_index_info")));
+        filter->kind = KMERSEARCH_HIGHFREQ_FILTER_BITMAP;
+        filter->bitmap = kmersearch_shared_highfreq_data(buffer);
+        filter->bitmap_bits = UINT64CONST(1) << (2 * k_size);
     }
-
-    actual_min_score_cache_manager->hits++;
-    return cache_entry->actual_min_score;
+    else
+    {
+        filter->kind = KMERSEARCH_HIGHFREQ_FILTER_EYTZINGER;
+        filter->eytzinger = kmersearch_shared_highfreq_data(buffer);
+        filter->nkmers = published->highfreq_count;
+    }
+    return true;
 }
 
 /*
- * Query-kmer cache statistics function
+ * Persist the shared high-frequency k-mer cache for the next server start
+ * Caller must hold the cache lock exclusively.
  */
-Datum
-kmersearch_query_kmer_cache_stats(PG_FUNCTION_ARGS)
+static void
+kmersearch_shared_highfreq_write_file(void)
 {
-    TupleDesc tupdesc;
-    Datum values[4];
-    bool nulls[4] = {false};
-    HeapTuple tuple;
-    
-    /* Build tuple descriptor */
-    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+    const char *tmpfile = KMERSEARCH_SHARED_HIGHFREQ_FILE ".tmp";
+    SharedHighfreqKmerCacheFileHeader header;
+    uint64 *data = kmersearch_shared_highfreq_data(pg_atomic_read_u32(&shared_highfreq_ctl->active));
+    SharedHighfreqKmerCacheBuffer *published = kmersearch_shared_highfreq_active();
+    pg_crc32c crc;
+    FILE *file;
+    
+    memset(&header, 0, sizeof(header));
+    header.magic = KMERSEARCH_SHARED_HIGHFREQ_MAGIC;
+    header.version = KMERSEARCH_SHARED_HIGHFREQ_VERSION;
+    header.database_oid = published->database_oid;
+    header.cache_key = published->cache_key;
+    header.highfreq_count = published->highfreq_count;
+    header.bitmap_bytes = published->bitmap_bytes;
+    header.data_bytes = published->data_bytes;
+    
+    INIT_CRC32C(crc);
+    COMP_CRC32C(crc, &header, sizeof(header));
+    COMP_CRC32C(crc, data, header.data_bytes);
+    FIN_CRC32C(crc);
+    
+    file = AllocateFile(tmpfile, PG_BINARY_W);
+    if (file == NULL)
         ereport(ERROR,
-                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-                 errmsg("function returning record called in context that cannot accept a set")));
+                (errcode_for_file_access(),
+                 errmsg("could not create file \"%s\": %m", tmpfile)));
     
-    /* Query-kmer cache statistics */
-    if (query_kmer_cache_manager)
+    if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+        (header.data_bytes > 0 && fwrite(data, header.data_bytes, 1, file) != 1) ||
+        fwrite(&crc, sizeof(crc), 1, file) != 1)
     {
-        values[0] = Int64GetDatum(query_kmer_cache_manager->hits);
-        values[1] = Int64GetDatum(query_kmer_cache_manager->misses);
-        values[2] = Int32GetDatum(query_kmer_cache_manager->current_entries);
-        values[3] = Int32GetDatum(query_kmer_cache_manager->max_entries);
+        int save_errno = errno;
+        
+        FreeFile(file);
+        unlink(tmpfile);
+        errno = save_errno;
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not write file \"%s\": %m", tmpfile)));
     }
-    else
+    
+    if (FreeFile(file) != 0)
     {
-        /* Cache manager not initialized */
-        values[0] = Int64GetDatum(0);  /* hits */
-        values[1] = Int64GetDatum(0);  /* misses */
-        values[2] = Int32GetDatum(0);  /* current_entries */
-        values[3] = Int32GetDatum(0);  /* max_entries */
+        int save_errno = errno;
+        
+        unlink(tmpfile);
+        errno = save_errno;
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not close file \"%s\": %m", tmpfile)));
     }
     
-    tuple = heap_form_tuple(tupdesc, values, nulls);
-    PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+    (void) durable_rename(tmpfile, KMERSEARCH_SHARED_HIGHFREQ_FILE, ERROR);
 }
 
 /*
- * Query-kmer cache free function
+ * Reload the persisted high-frequency k-mer set into shared memory
+ * Called by the postmaster at startup; an unusable file is only logged.
  */
-Datum
-kmersearch_query_kmer_cache_free(PG_FUNCTION_ARGS)
+static void
+kmersearch_shared_highfreq_read_file(void)
 {
-    int freed_entries = 0;
+    SharedHighfreqKmerCacheFileHeader header;
+    uint64 *data = kmersearch_shared_highfreq_data(0);
+    pg_crc32c crc;
+    pg_crc32c file_crc;
+    FILE *file;
+    
+    file = AllocateFile(KMERSEARCH_SHARED_HIGHFREQ_FILE, PG_BINARY_R);
+    if (file == NULL)
+    {
+        if (errno != ENOENT)
+            ereport(LOG,
+                    (errcode_for_file_access(),
+                     errmsg("could not open file \"%s\": %m",
+                            KMERSEARCH_SHARED_HIGHFREQ_FILE)));
+        return;
+    }
     
-    /* Count entries before freeing */
-    if (query_kmer_cache_manager)
-        freed_entries += query_kmer_cache_manager->current_entries;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        header.magic != KMERSEARCH_SHARED_HIGHFREQ_MAGIC ||
+        header.version != KMERSEARCH_SHARED_HIGHFREQ_VERSION)
+        goto invalid;
     
-    /* Free query-kmer cache manager (uses TopMemoryContext - needs manual cleanup) */
-    /* DNA2/DNA4 cache managers are now local and automatically freed with QueryContext */
-    kmersearch_free_query_kmer_cache_manager(&query_kmer_cache_manager);
+    if (header.data_bytes > shared_highfreq_ctl->capacity)
+    {
+        ereport(LOG,
+                (errmsg("shared high-frequency k-mer cache needs %zu bytes but only %zu bytes are available, not loading \"%s\"",
+                        header.data_bytes, shared_highfreq_ctl->capacity,
+                        KMERSEARCH_SHARED_HIGHFREQ_FILE),
+                 errhint("Increase kmersearch.shared_highfreq_kmer_cache_size.")));
+        FreeFile(file);
+        return;
+    }
     
-    PG_RETURN_INT32(freed_entries);
+    if ((header.data_bytes > 0 && fread(data, header.data_bytes, 1, file) != 1) ||
+        fread(&file_crc, sizeof(file_crc), 1, file) != 1)
+        goto invalid;
+    
+    INIT_CRC32C(crc);
+    COMP_CRC32C(crc, &header, sizeof(header));
+    COMP_CRC32C(crc, data, header.data_bytes);
+    FIN_CRC32C(crc);
+    if (!EQ_CRC32C(crc, file_crc))
+        goto invalid;
+    
+    FreeFile(file);
+    
+    shared_highfreq_ctl->buffers[0].database_oid = header.database_oid;
+    shared_highfreq_ctl->buffers[0].cache_key = header.cache_key;
+    shared_highfreq_ctl->buffers[0].highfreq_count = header.highfreq_count;
+    shared_highfreq_ctl->buffers[0].bitmap_bytes = header.bitmap_bytes;
+    shared_highfreq_ctl->buffers[0].data_bytes = header.data_bytes;
+    shared_highfreq_ctl->is_valid = true;
+    return;
+    
+invalid:
+    ereport(LOG,
+            (errmsg("ignoring invalid shared high-frequency k-mer cache file \"%s\"",
+                    KMERSEARCH_SHARED_HIGHFREQ_FILE)));
+    FreeFile(file);
 }
 
 /*
- * Actual min score cache statistics function
+ * SQL-accessible shared high-frequency cache load function
+ * Loads the k-mer set through the backend-local global cache, then publishes
+ * its compact filter to all backends and persists it for server restarts.
  */
 Datum
-kmersearch_actual_min_score_cache_stats(PG_FUNCTION_ARGS)
+kmersearch_shared_highfreq_kmer_cache_load(PG_FUNCTION_ARGS)
 {
-    TupleDesc tupdesc;
-    Datum values[4];
-    bool nulls[4] = {false};
-    HeapTuple tuple;
+    text *table_name_text = PG_GETARG_TEXT_P(0);
+    text *column_name_text = PG_GETARG_TEXT_P(1);
     
-    /* Build tuple descriptor */
-    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+    char *table_name = text_to_cstring(table_name_text);
+    char *column_name = text_to_cstring(column_name_text);
+    Oid table_oid;
+    const uint64 *data;
+    Size bitmap_bytes = 0;
+    Size data_bytes = 0;
+    uint32 buffer;
+    
+    if (!superuser())
         ereport(ERROR,
-                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-                 errmsg("function returning record called in context that cannot accept a set")));
+                (errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+                 errmsg("must be superuser to load the shared high-frequency k-mer cache")));
     
-    /* Actual min score cache statistics */
-    if (actual_min_score_cache_manager)
+    if (shared_highfreq_ctl == NULL || shared_highfreq_ctl->capacity == 0)
+        ereport(ERROR,
+                (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+                 errmsg("shared high-frequency k-mer cache is not available"),
+                 errhint("Add pg_kmersearch to shared_preload_libraries and set kmersearch.shared_highfreq_kmer_cache_size.")));
+    
+    /* Get table OID from table name */
+    table_oid = RelnameGetRelid(table_name);
+    if (!OidIsValid(table_oid))
     {
-        values[0] = Int64GetDatum(actual_min_score_cache_manager->hits);
-        values[1] = Int64GetDatum(actual_min_score_cache_manager->misses);
-        values[2] = Int32GetDatum(actual_min_score_cache_manager->current_entries);
-        values[3] = Int32GetDatum(actual_min_score_cache_manager->max_entries);
+        ereport(ERROR,
+                (errcode(ERRCODE_UNDEFINED_TABLE),
+                 errmsg("relation \"%s\" does not exist", table_name)));
+    }
+    
+    if (!kmersearch_highfreq_kmer_cache_load_internal(table_oid, column_name, kmersearch_kmer_size))
+        PG_RETURN_BOOL(false);
+    kmersearch_publish_global_highfreq_cache();
+    
+    if (global_highfreq_cache.kmer_bitmap != NULL)
+    {
+        data = global_highfreq_cache.kmer_bitmap;
+        bitmap_bytes = (Size) ((UINT64CONST(1) << (2 * kmersearch_kmer_size)) / 8);
+        data_bytes = bitmap_bytes;
     }
     else
     {
-        /* Cache manager not initialized */
-        values[0] = Int64GetDatum(0);  /* hits */
-        values[1] = Int64GetDatum(0);  /* misses */
-        values[2] = Int32GetDatum(0);  /* current_entries */
-        values[3] = Int32GetDatum(0);  /* max_entries */
+        data = global_highfreq_cache.kmer_eytzinger;
+        if (data != NULL)
+            data_bytes = (global_highfreq_cache.highfreq_count + 1) * sizeof(uint64);
     }
     
-    tuple = heap_form_tuple(tupdesc, values, nulls);
-    PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+    if (data_bytes > shared_highfreq_ctl->capacity)
+        ereport(ERROR,
+                (errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+                 errmsg("shared high-frequency k-mer cache needs %zu bytes but only %zu bytes are available",
+                        data_bytes, shared_highfreq_ctl->capacity),
+                 errhint("Increase kmersearch.shared_highfreq_kmer_cache_size.")));
+    
+    LWLockAcquire(shared_highfreq_ctl->lock, LW_EXCLUSIVE);
+    
+    /* Fill the inactive buffer; readers of the published set are not disturbed */
+    buffer = 1 - pg_atomic_read_u32(&shared_highfreq_ctl->active);
+    if (data_bytes > 0)
+        memcpy(kmersearch_shared_highfreq_data(buffer), data, data_bytes);
+    shared_highfreq_ctl->buffers[buffer].database_oid = MyDatabaseId;
+    shared_highfreq_ctl->buffers[buffer].cache_key = global_highfreq_cache.current_cache_key;
+    shared_highfreq_ctl->buffers[buffer].highfreq_count = global_highfreq_cache.highfreq_count;
+    shared_highfreq_ctl->buffers[buffer].bitmap_bytes = bitmap_bytes;
+    shared_highfreq_ctl->buffers[buffer].data_bytes = data_bytes;
+    
+    /* Flip only once the buffer is complete, and publish only after the flip */
+    pg_write_barrier();
+    pg_atomic_write_u32(&shared_highfreq_ctl->active, buffer);
+    pg_write_barrier();
+    shared_highfreq_ctl->is_valid = true;
+    pg_atomic_fetch_add_u64(&shared_highfreq_ctl->generation, 1);
+    
+    kmersearch_shared_highfreq_write_file();
+    
+    LWLockRelease(shared_highfreq_ctl->lock);
+    
+    PG_RETURN_BOOL(true);
 }
 
 /*
- * Free actual min score cache
+ * SQL-accessible shared high-frequency cache free function
+ * Returns the number of k-mers withdrawn.
  */
 Datum
-kmersearch_actual_min_score_cache_free(PG_FUNCTION_ARGS)
+kmersearch_shared_highfreq_kmer_cache_free(PG_FUNCTION_ARGS)
 {
     int freed_entries = 0;
     
-    /* Count entries before freeing */
-    if (actual_min_score_cache_manager)
-        freed_entries = actual_min_score_cache_manager->current_entries;
+    if (!superuser())
+        ereport(ERROR,
+                (errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+                 errmsg("must be superuser to free the shared high-frequency k-mer cache")));
     
-    /* Free actual min score cache manager (uses TopMemoryContext - needs manual cleanup) */
-    kmersearch_free_actual_min_score_cache_manager(&actual_min_score_cache_manager);
+    if (shared_highfreq_ctl == NULL)
+        PG_RETURN_INT32(0);
     
-    PG_RETURN_INT32(freed_entries);
-}
-
-/*
- * High-frequency k-mer cache management functions implementation
- */
-void
-kmersearch_highfreq_kmer_cache_init(void)
-{
-    MemoryContext old_context;
+    LWLockAcquire(shared_highfreq_ctl->lock, LW_EXCLUSIVE);
     
-    /* Switch to TopMemoryContext */
-    old_context = MemoryContextSwitchTo(TopMemoryContext);
+    if (shared_highfreq_ctl->is_valid)
+        freed_entries = kmersearch_shared_highfreq_active()->highfreq_count;
+    shared_highfreq_ctl->is_valid = false;
+    pg_atomic_fetch_add_u64(&shared_highfreq_ctl->generation, 1);
     
-    /* Initialize cache structure */
-    memset(&global_highfreq_cache, 0, sizeof(HighfreqKmerCache));
-    global_highfreq_cache.is_valid = false;
-    memset(&global_highfreq_cache.current_cache_key, 0, sizeof(HighfreqCacheKey));
-    global_highfreq_cache.current_cache_key.table_oid = InvalidOid;
+    if (unlink(KMERSEARCH_SHARED_HIGHFREQ_FILE) != 0 && errno != ENOENT)
+        ereport(WARNING,
+                (errcode_for_file_access(),
+                 errmsg("could not remove file \"%s\": %m", KMERSEARCH_SHARED_HIGHFREQ_FILE)));
     
-    /* Create dedicated memory context for high-frequency k-mer cache */
-    global_highfreq_cache.cache_context = AllocSetContextCreate(TopMemoryContext,
-                                                                "HighfreqKmerCache",
-                                                                ALLOCSET_DEFAULT_SIZES);
+    LWLockRelease(shared_highfreq_ctl->lock);
     
-    global_highfreq_cache.highfreq_hash = NULL;
-    global_highfreq_cache.highfreq_kmers = NULL;
-    global_highfreq_cache.highfreq_count = 0;
+    kmersearch_invalidate_compiled_query_scores();
     
-    MemoryContextSwitchTo(old_context);
+    PG_RETURN_INT32(freed_entries);
 }
 
 bool
@@ -795,6 +2421,7 @@ kmersearch_highfreq_kmer_cache_load_internal(Oid table_oid, const char *column_n
     int batch_num;
     int offset;
     int total_bits;
+    uint64 generation;
     
     if (!column_name || k_value <= 0) {
         return false;
@@ -810,6 +2437,11 @@ kmersearch_highfreq_kmer_cache_load_internal(Oid table_oid, const char *column_n
         return false;
     }
     
+    /* Taken before reading, so an analysis committed meanwhile makes the cache stale */
+    generation = kmersearch_highfreq_generation(table_oid,
+                                                hash_any((unsigned char*)column_name, strlen(column_name)),
+                                                k_value, kmersearch_occur_bitlen);
+    
     /* Clear existing cache if valid */
     if (global_highfreq_cache.is_valid) {
         kmersearch_highfreq_kmer_cache_free_internal();
@@ -914,6 +2546,8 @@ kmersearch_highfreq_kmer_cache_load_internal(Oid table_oid, const char *column_n
     global_highfreq_cache.current_cache_key.occur_bitlen = kmersearch_occur_bitlen;
     global_highfreq_cache.current_cache_key.max_appearance_rate = kmersearch_max_appearance_rate;
     global_highfreq_cache.current_cache_key.max_appearance_nrow = kmersearch_max_appearance_nrow;
+    strlcpy(global_highfreq_cache.column_name, column_name, NAMEDATALEN);
+    global_highfreq_cache.generation = generation;
     
     /* Initialize hash table in cache context */
     MemSet(&hash_ctl, 0, sizeof(hash_ctl));
@@ -1066,7 +2700,7 @@ kmersearch_highfreq_kmer_cache_load_internal(Oid table_oid, const char *column_n
                                                          &found);
             
             if (entry && !found) {
-                entry->kmer_key = NULL;  /* No longer storing VarBit */
+                /* kmer_key holds the hash key itself, so it must not be cleared */
                 entry->hash_value = uintkey;
                 total_inserted++;
             } else if (found) {
@@ -1096,9 +2730,13 @@ kmersearch_highfreq_kmer_cache_load_internal(Oid table_oid, const char *column_n
     global_highfreq_cache.highfreq_kmers = NULL;  /* We don't store the array anymore */
     global_highfreq_cache.highfreq_count = total_inserted;
     
+    /* Resolve the compact membership filter once, in the cache context */
+    kmersearch_build_highfreq_kmer_filter(k_value);
+    
     
     if (global_highfreq_cache.highfreq_hash) {
         global_highfreq_cache.is_valid = true;
+        kmersearch_invalidate_compiled_query_scores();
     } else {
         /* Hash table creation failed, clean up by deleting the context */
         MemoryContextSwitchTo(old_context);
@@ -1116,6 +2754,9 @@ kmersearch_highfreq_kmer_cache_load_internal(Oid table_oid, const char *column_n
 void
 kmersearch_highfreq_kmer_cache_free_internal(void)
 {
+    /* Workers mapping the filter keep it until they detach */
+    kmersearch_highfreq_cache_export_release();
+    
     if (!global_highfreq_cache.is_valid) {
         return;
     }
@@ -1133,6 +2774,13 @@ kmersearch_highfreq_kmer_cache_free_internal(void)
     global_highfreq_cache.highfreq_count = 0;
     global_highfreq_cache.highfreq_hash = NULL;
     global_highfreq_cache.highfreq_kmers = NULL;
+    global_highfreq_cache.kmer_bitmap = NULL;
+    global_highfreq_cache.kmer_eytzinger = NULL;
+    global_highfreq_cache.column_name[0] = '\0';
+    global_highfreq_cache.generation = 0;
+    
+    /* High-frequency k-mer set behind actual_min_score is gone */
+    kmersearch_invalidate_compiled_query_scores();
 }
 
 bool
@@ -1247,6 +2895,7 @@ kmersearch_highfreq_kmer_cache_load(PG_FUNCTION_ARGS)
     }
     
     success = kmersearch_highfreq_kmer_cache_load_internal(table_oid, column_name, kmersearch_kmer_size);
+    kmersearch_publish_global_highfreq_cache();
     
     PG_RETURN_BOOL(success);
 }
@@ -1288,6 +2937,7 @@ kmersearch_highfreq_kmer_cache_free(PG_FUNCTION_ARGS)
     
     /* Free the cache */
     kmersearch_highfreq_kmer_cache_free_internal();
+    kmersearch_publish_global_highfreq_cache();
     
     PG_RETURN_INT32(freed_entries);
 }
@@ -1306,6 +2956,7 @@ kmersearch_highfreq_kmer_cache_free_all(PG_FUNCTION_ARGS)
     
     /* Free the cache */
     kmersearch_highfreq_kmer_cache_free_internal();
+    kmersearch_publish_global_highfreq_cache();
     
     PG_RETURN_INT32(freed_entries);
 }
@@ -1464,6 +3115,7 @@ kmersearch_parallel_highfreq_kmer_cache_load(PG_FUNCTION_ARGS)
     /* Register cleanup function for process exit */
     if (result) {
         on_proc_exit(kmersearch_parallel_cache_cleanup_on_exit, 0);
+        kmersearch_publish_parallel_cache_handle(parallel_highfreq_cache->dsm_handle);
     }
     
     pfree(column_name);
@@ -1510,7 +3162,7 @@ kmersearch_parallel_highfreq_kmer_cache_free(PG_FUNCTION_ARGS)
     
     /* Free parallel cache */
     kmersearch_parallel_highfreq_kmer_cache_free_internal();
-    
+    kmersearch_publish_parallel_cache_handle(DSM_HANDLE_INVALID);
     
     PG_RETURN_INT32(freed_entries);
 }
@@ -1530,6 +3182,7 @@ kmersearch_parallel_highfreq_kmer_cache_free_all(PG_FUNCTION_ARGS)
     
     /* Free parallel cache */
     kmersearch_parallel_highfreq_kmer_cache_free_internal();
+    kmersearch_publish_parallel_cache_handle(DSM_HANDLE_INVALID);
     
     PG_RETURN_INT32(freed_entries);
 }
@@ -1693,6 +3346,7 @@ kmersearch_parallel_highfreq_kmer_cache_load_internal(Oid table_oid, const char
     int offset = 0;
     int total_bits;
     VarBit **count_kmers;
+    uint64 generation;
     
     if (!column_name || k_value <= 0)
         return false;
@@ -1716,13 +3370,26 @@ kmersearch_parallel_highfreq_kmer_cache_load_internal(Oid table_oid, const char
             fabs(parallel_highfreq_cache->cache_key.max_appearance_rate - kmersearch_max_appearance_rate) < 0.0001 &&
             parallel_highfreq_cache->cache_key.max_appearance_nrow == kmersearch_max_appearance_nrow) {
             /* All parameters match (table, column, and GUC variables) - return true */
-            return true;
+            if (shared_highfreq_ctl == NULL ||
+                parallel_highfreq_cache->generation ==
+                kmersearch_highfreq_generation(table_oid, parallel_highfreq_cache->cache_key.column_name_hash,
+                                               k_value, kmersearch_occur_bitlen))
+                return true;
+            
+            /* Loaded before a committed analysis of the column - rebuild it */
+            kmersearch_parallel_highfreq_kmer_cache_free_internal();
+            parallel_highfreq_cache_stale = false;
         } else {
             /* Cache exists but GUC variables don't match - keep cache and return false */
             return false;
         }
     }
     
+    /* Taken before reading, so an analysis committed meanwhile makes the cache stale */
+    generation = kmersearch_highfreq_generation(table_oid,
+                                                hash_any((unsigned char*)column_name, strlen(column_name)),
+                                                k_value, kmersearch_occur_bitlen);
+    
     /* Count total k-mers first for DSM segment size calculation */
     {
         StringInfoData count_query;
@@ -1839,6 +3506,7 @@ kmersearch_parallel_highfreq_kmer_cache_load_internal(Oid table_oid, const char
     parallel_highfreq_cache->cache_key.occur_bitlen = kmersearch_occur_bitlen;
     parallel_highfreq_cache->cache_key.max_appearance_rate = kmersearch_max_appearance_rate;
     parallel_highfreq_cache->cache_key.max_appearance_nrow = kmersearch_max_appearance_nrow;
+    parallel_highfreq_cache->generation = generation;
     
     /* num_entries will be set after batch processing */
     parallel_highfreq_cache->segment_size = segment_size;
@@ -2134,6 +3802,7 @@ kmersearch_parallel_highfreq_kmer_cache_free_internal(void)
     
     /* Use the unified cleanup function for proper resource destruction */
     kmersearch_parallel_cache_cleanup_internal();
+    kmersearch_invalidate_compiled_query_scores();
 }
 
 /*
@@ -2188,7 +3857,7 @@ kmersearch_parallel_cache_lookup(uint64 kmer_hash)
 /*
  * Attach to existing parallel cache from worker process
  */
-static bool
+bool
 kmersearch_parallel_cache_attach(dsm_handle handle)
 {
     dshash_parameters params;
@@ -2208,10 +3877,14 @@ kmersearch_parallel_cache_attach(dsm_handle handle)
         return false;
     }
     
+    /* Keep the mapping for the life of the worker, not the current query */
+    dsm_pin_mapping(parallel_cache_segment);
+    
     /* Get parallel cache structure from DSM */
     parallel_highfreq_cache = (ParallelHighfreqKmerCache *) dsm_segment_address(parallel_cache_segment);
     
     if (!parallel_highfreq_cache->is_initialized) {
+        parallel_highfreq_cache = NULL;
         MemoryContextSwitchTo(oldcontext);
         return false;
     }
@@ -2267,6 +3940,205 @@ kmersearch_parallel_cache_attach(dsm_handle handle)
 }
 
 
+/*
+ * Publish the leader's high-frequency cache state to parallel workers
+ *
+ * Parallel workers inherit GUC values but not backend-local caches, so the
+ * leader records what it has loaded in hidden GUCs and each worker mirrors
+ * it on first use.  GUC changes revert when their transaction aborts, so
+ * the publishing nest level is remembered and the cache is dropped along
+ * with them (kmersearch_discard_reverted_caches).
+ */
+static void
+kmersearch_set_hidden_guc(const char *name, const char *value, int *publish_level)
+{
+    kmersearch_register_highfreq_xact_callback();
+    *publish_level = Max(*publish_level, GetCurrentTransactionNestLevel());
+    SetConfigOption(name, value, PGC_SUSET, PGC_S_SESSION);
+}
+
+/*
+ * Copy the global cache's compact filter into a new DSM segment
+ * The mapping is kept until the cache is freed; the segment goes away once
+ * the last worker mapping it detaches.
+ */
+static dsm_handle
+kmersearch_highfreq_cache_export(void)
+{
+    HighfreqKmerCacheExport *exported;
+    const uint64 *data = NULL;
+    Size bitmap_bytes = 0;
+    Size data_bytes = 0;
+    
+    if (global_highfreq_cache.kmer_bitmap != NULL)
+    {
+        data = global_highfreq_cache.kmer_bitmap;
+        bitmap_bytes = (Size) ((UINT64CONST(1) << (2 * global_highfreq_cache.current_cache_key.kmer_size)) / 8);
+        data_bytes = bitmap_bytes;
+    }
+    else if (global_highfreq_cache.kmer_eytzinger != NULL)
+    {
+        data = global_highfreq_cache.kmer_eytzinger;
+        data_bytes = (global_highfreq_cache.highfreq_count + 1) * sizeof(uint64);
+    }
+    
+    highfreq_export_segment = dsm_create(MAXALIGN(sizeof(HighfreqKmerCacheExport)) + data_bytes, 0);
+    dsm_pin_mapping(highfreq_export_segment);
+    
+    exported = (HighfreqKmerCacheExport *) dsm_segment_address(highfreq_export_segment);
+    exported->magic = KMERSEARCH_HIGHFREQ_EXPORT_MAGIC;
+    exported->leader_pid = MyProcPid;
+    exported->serial = ++highfreq_export_serial;
+    exported->cache_key = global_highfreq_cache.current_cache_key;
+    exported->generation = global_highfreq_cache.generation;
+    exported->highfreq_count = global_highfreq_cache.highfreq_count;
+    exported->bitmap_bytes = bitmap_bytes;
+    exported->data_bytes = data_bytes;
+    if (data_bytes > 0)
+        memcpy((char *) exported + MAXALIGN(sizeof(HighfreqKmerCacheExport)), data, data_bytes);
+    
+    return dsm_segment_handle(highfreq_export_segment);
+}
+
+static void
+kmersearch_highfreq_cache_export_release(void)
+{
+    if (highfreq_export_segment != NULL)
+        dsm_detach(highfreq_export_segment);
+    highfreq_export_segment = NULL;
+}
+
+/*
+ * Map the leader's exported filter as this worker's global cache
+ * A handle that no longer exists or now belongs to another export is
+ * ignored, as is a cache built for other k-mer settings.
+ */
+static bool
+kmersearch_highfreq_cache_import(dsm_handle handle, int leader_pid, uint64 serial)
+{
+    dsm_segment *segment;
+    HighfreqKmerCacheExport *exported;
+    uint64 *data;
+    
+    segment = dsm_attach(handle);
+    if (segment == NULL)
+        return false;
+    
+    exported = (HighfreqKmerCacheExport *) dsm_segment_address(segment);
+    if (dsm_segment_map_length(segment) < MAXALIGN(sizeof(HighfreqKmerCacheExport)) ||
+        exported->magic != KMERSEARCH_HIGHFREQ_EXPORT_MAGIC ||
+        exported->leader_pid != leader_pid ||
+        exported->serial != serial ||
+        exported->cache_key.kmer_size != kmersearch_kmer_size ||
+        exported->cache_key.occur_bitlen != kmersearch_occur_bitlen ||
+        fabs(exported->cache_key.max_appearance_rate - kmersearch_max_appearance_rate) >= 0.0001 ||
+        exported->cache_key.max_appearance_nrow != kmersearch_max_appearance_nrow)
+    {
+        dsm_detach(segment);
+        return false;
+    }
+    
+    /* Keep the mapping for the life of the worker, not the current query */
+    dsm_pin_mapping(segment);
+    highfreq_export_segment = segment;
+    data = (uint64 *) ((char *) exported + MAXALIGN(sizeof(HighfreqKmerCacheExport)));
+    
+    global_highfreq_cache.current_cache_key = exported->cache_key;
+    global_highfreq_cache.generation = exported->generation;
+    global_highfreq_cache.highfreq_count = exported->highfreq_count;
+    global_highfreq_cache.highfreq_hash = NULL;
+    global_highfreq_cache.kmer_bitmap = (exported->bitmap_bytes > 0) ? data : NULL;
+    global_highfreq_cache.kmer_eytzinger = (exported->bitmap_bytes == 0 && exported->data_bytes > 0) ? data : NULL;
+    global_highfreq_cache.is_valid = true;
+    kmersearch_invalidate_compiled_query_scores();
+    
+    return true;
+}
+
+/*
+ * Publish the global cache (or its absence) to parallel workers
+ * The compact filter is exported, so workers never reload the k-mer set.
+ */
+void
+kmersearch_publish_global_highfreq_cache(void)
+{
+    char value[64] = "";
+    
+    if (IsParallelWorker() || IsInParallelMode())
+        return;
+    
+    kmersearch_highfreq_cache_export_release();
+    if (global_highfreq_cache.is_valid)
+    {
+        /* An abort from here on must drop the cache even before the GUC is set */
+        kmersearch_register_highfreq_xact_callback();
+        global_cache_publish_level = Max(global_cache_publish_level, GetCurrentTransactionNestLevel());
+        
+        snprintf(value, sizeof(value), "%u %d " UINT64_FORMAT,
+                 (unsigned int) kmersearch_highfreq_cache_export(),
+                 MyProcPid, highfreq_export_serial);
+    }
+    kmersearch_set_hidden_guc("kmersearch.highfreq_cache_source", value,
+                              &global_cache_publish_level);
+}
+
+void
+kmersearch_publish_parallel_cache_handle(dsm_handle handle)
+{
+    char value[16] = "";
+    
+    if (IsParallelWorker() || IsInParallelMode())
+        return;
+    
+    if (handle != DSM_HANDLE_INVALID)
+        snprintf(value, sizeof(value), "%u", (unsigned int) handle);
+    kmersearch_set_hidden_guc("kmersearch.parallel_highfreq_cache_handle", value,
+                              &parallel_cache_publish_level);
+}
+
+/*
+ * Mirror the leader's high-frequency caches in a parallel worker
+ *
+ * The parallel (DSM) cache and the exported global cache filter are both
+ * attached directly.  Without this, workers would skip high-frequency
+ * exclusion and disagree with the leader on =% results.
+ */
+void
+kmersearch_highfreq_cache_sync_worker(void)
+{
+    if (worker_highfreq_cache_synced || !IsParallelWorker())
+        return;
+    worker_highfreq_cache_synced = true;
+    
+    if (kmersearch_parallel_highfreq_cache_handle != NULL &&
+        kmersearch_parallel_highfreq_cache_handle[0] != '\0' &&
+        parallel_highfreq_cache == NULL)
+    {
+        dsm_handle handle = (dsm_handle) strtoul(kmersearch_parallel_highfreq_cache_handle, NULL, 10);
+        
+        if (!kmersearch_parallel_cache_attach(handle))
+            ereport(DEBUG1,
+                    (errmsg("parallel worker could not attach to high-frequency k-mer cache %u",
+                            (unsigned int) handle)));
+    }
+    
+    if (kmersearch_highfreq_cache_source != NULL &&
+        kmersearch_highfreq_cache_source[0] != '\0' &&
+        !global_highfreq_cache.is_valid)
+    {
+        unsigned int handle;
+        int leader_pid;
+        uint64 serial;
+        
+        if (sscanf(kmersearch_highfreq_cache_source, "%u %d " UINT64_FORMAT,
+                   &handle, &leader_pid, &serial) != 3 ||
+            !kmersearch_highfreq_cache_import((dsm_handle) handle, leader_pid, serial))
+            ereport(DEBUG1,
+                    (errmsg("parallel worker could not map high-frequency k-mer cache %s",
+                            kmersearch_highfreq_cache_source)));
+    }
+}
+
 /*
  * Cleanup function for parallel cache on process exit
  */
@@ -2287,6 +4159,8 @@ kmersearch_parallel_cache_cleanup_on_exit(int code, Datum arg)
 bool
 kmersearch_is_parallel_highfreq_cache_loaded(void)
 {
+    kmersearch_highfreq_cache_sync_worker();
+    
     return (parallel_highfreq_cache != NULL && 
             parallel_highfreq_cache->is_initialized &&
             parallel_highfreq_cache->num_entries > 0);
@@ -2300,7 +4174,7 @@ kmersearch_lookup_uintkey_in_global_cache(uint64 uintkey, const char *table_name
 {
     bool found;
     
-    if (!global_highfreq_cache.is_valid || global_highfreq_cache.highfreq_count == 0)
+    if (!global_highfreq_cache.is_valid || global_highfreq_cache.highfreq_hash == NULL)
         return false;
     
     hash_search(global_highfreq_cache.highfreq_hash, &uintkey, HASH_FIND, &found);
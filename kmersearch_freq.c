@@ -20,6 +20,8 @@
 #include "storage/bufmgr.h"
 #include "access/genam.h"
 #include "utils/lsyscache.h"
+#include "utils/sampling.h"
+#include "common/pg_prng.h"
 
 /* PostgreSQL function info declarations for frequency functions */
 PG_FUNCTION_INFO_V1(kmersearch_perform_highfreq_analysis);
@@ -32,6 +34,7 @@ static void kmersearch_register_worker_temp_file(KmerAnalysisSharedState *shared
 static void kmersearch_flush_batch_to_fht(FileHashWorkerContext *ctx);
 static void kmersearch_process_block_with_batch(BlockNumber block,
                                                Oid table_oid,
+                                               OffsetNumber first_offset,
                                                KmerAnalysisSharedState *shared_state,
                                                FileHashWorkerContext *ctx);
 
@@ -42,6 +45,57 @@ static void kmersearch_aggregate_temp_files_parallel(char file_paths[][MAXPGPATH
                                                     const char *temp_dir_path,
                                                     int total_bits);
 
+/* Persisted k-mer counts for incremental analysis */
+static List *pending_counts_updates = NIL;
+static bool counts_xact_callback_registered = false;
+
+static void kmersearch_counts_key(char *buf, Oid table_oid, AttrNumber column_attnum,
+                                  int k_size, int occur_bitlen);
+static OffsetNumber kmersearch_tail_block_max_offset(Relation rel, BlockNumber nblocks);
+static bool kmersearch_read_counts_state(const char *state_path, Oid table_oid,
+                                         AttrNumber column_attnum, int k_size,
+                                         const KmerAnalysisCountsRelation *current,
+                                         int num_current,
+                                         KmerAnalysisCountsHeader *header,
+                                         KmerAnalysisCountsRelation **relations);
+static void kmersearch_write_counts_state(const char *path,
+                                          const KmerAnalysisCountsHeader *header,
+                                          const KmerAnalysisCountsRelation *relations);
+static void kmersearch_merge_counts_file(const char *source_path, const char *target_path,
+                                         int total_bits);
+static void kmersearch_remove_counts_files(const char *prefix, const char *keep_state,
+                                           const char *keep_counts);
+static KmerAnalysisCountsPending *kmersearch_counts_at_commit(const char *prefix, bool replace);
+static void kmersearch_counts_xact_callback(XactEvent event, void *arg);
+
+/* Block dispatch and approximate (heavy-hitter) analysis */
+static bool kmersearch_next_analysis_block(KmerAnalysisSharedState *shared_state,
+                                           const BlockNumber *sampled_blocks,
+                                           BlockNumber *block, Oid *relid);
+static OffsetNumber kmersearch_first_analysis_offset(const KmerAnalysisSharedState *shared_state,
+                                                     BlockNumber block, Oid relid);
+static uint64 kmersearch_appearance_threshold(int64 total_rows);
+static uint64 kmersearch_sampled_threshold(uint64 sampled_rows, double threshold_rate);
+static double kmersearch_wilson_lower_bound(uint64 count, uint64 nrows, double z);
+static void kmersearch_insert_highfreq_kmer(Oid table_oid, const char *column_name, int k_size,
+                                            uint64 uintkey, uint64 appearance_nrow,
+                                            const char *detection_reason);
+static void kmersearch_analysis_worker_approximate(shm_toc *toc,
+                                                   KmerAnalysisSharedState *shared_state,
+                                                   FileHashWorkerContext *fctx);
+static void kmersearch_process_block_approximate(BlockNumber block, Oid relid,
+                                                 KmerAnalysisSharedState *shared_state,
+                                                 KmerApproxWorkerContext *ctx);
+static void kmersearch_space_saving_add(KmerSpaceSavingSummary *summary, uint64 uintkey);
+static void kmersearch_space_saving_merge(KmerSpaceSavingSummary *summary,
+                                          KmerAnalysisSharedState *shared_state,
+                                          KmerHeavyHitterEntry *shared_summary);
+static KmerHeavyHitterEntry *kmersearch_resolve_heavy_hitters(ParallelContext *pcxt,
+                                                              KmerAnalysisSharedState *shared_state,
+                                                              KmerHeavyHitterEntry *summary,
+                                                              uint64 threshold_rows,
+                                                              int *nresults);
+
 /*
  * Create worker temporary table for k-mer uintkeys
  */
@@ -208,6 +262,9 @@ kmersearch_perform_highfreq_analysis(PG_FUNCTION_ARGS)
 {
     text *table_name_or_oid_text = PG_GETARG_TEXT_P(0);
     text *column_name_or_attnum_text = PG_GETARG_TEXT_P(1);
+    bool incremental = PG_GETARG_BOOL(2);
+    double sample_fraction = PG_GETARG_FLOAT8(3);
+    int64 sample_rows = PG_GETARG_INT64(4);
     KmerAnalysisResult result = {0};  /* Initialize all fields to zero */
     Oid table_oid;
     char *column_name;
@@ -294,10 +351,42 @@ kmersearch_perform_highfreq_analysis(PG_FUNCTION_ARGS)
     /* Comprehensive parameter validation */
     kmersearch_validate_analysis_parameters(table_oid, column_name, kmersearch_kmer_size);
     
+    /* Incremental analysis extends exact counts */
+    if (incremental && kmersearch_highfreq_analysis_mode != KMERSEARCH_ANALYSIS_EXACT)
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("incremental high-frequency k-mer analysis requires kmersearch.highfreq_analysis_mode = exact")));
+    
+    /* Sampling takes either a block fraction or a row target */
+    if (!(sample_fraction > 0.0 && sample_fraction <= 1.0))
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("sample_fraction must be greater than 0 and at most 1")));
+    if (sample_rows < 0)
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("sample_rows must not be negative")));
+    if (sample_fraction < 1.0 && sample_rows > 0)
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("sample_fraction and sample_rows cannot be specified together")));
+    if (incremental && (sample_fraction < 1.0 || sample_rows > 0))
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("incremental high-frequency k-mer analysis cannot be sampled")));
+    
     /* Log analysis start */
     
     /* Perform parallel analysis */
-    result = kmersearch_perform_highfreq_analysis_parallel(table_oid, column_name, kmersearch_kmer_size, parallel_workers);
+    result = kmersearch_perform_highfreq_analysis_parallel(table_oid, column_name, kmersearch_kmer_size,
+                                                           parallel_workers, incremental,
+                                                           sample_fraction, sample_rows);
+    
+    /* High-frequency k-mers read earlier in this transaction are stale */
+    kmersearch_reset_table_highfreq_filter();
+    
+    /* Loaded caches become stale once this transaction commits */
+    kmersearch_highfreq_generation_bump_at_commit(table_oid, column_name, kmersearch_kmer_size);
     
     /* Create result tuple */
     {
@@ -369,6 +458,25 @@ kmersearch_undo_highfreq_analysis(PG_FUNCTION_ARGS)
     /* Perform drop operation (delete all k-mer sizes for this table/column) */
     result = kmersearch_undo_highfreq_analysis_internal(table_oid, column_name, 0);
     
+    /* High-frequency k-mers read earlier in this transaction are stale */
+    kmersearch_reset_table_highfreq_filter();
+    
+    /* Loaded caches become stale once this transaction commits */
+    kmersearch_highfreq_generation_bump_at_commit(table_oid, column_name, 0);
+    
+    /* Persisted k-mer counts of incremental analyses go at commit too */
+    {
+        AttrNumber column_attnum = get_attnum(table_oid, column_name);
+        
+        if (column_attnum != InvalidAttrNumber)
+        {
+            char counts_key[MAXPGPATH];
+            
+            kmersearch_counts_key(counts_key, table_oid, column_attnum, 0, 0);
+            kmersearch_counts_at_commit(counts_key, false);
+        }
+    }
+    
     /* Create result tuple */
     {
         TupleDesc tupdesc;
@@ -403,12 +511,15 @@ kmersearch_undo_highfreq_analysis(PG_FUNCTION_ARGS)
 bool
 kmersearch_is_highfreq_filtering_enabled(void)
 {
+    /* Parallel workers mirror the leader's caches on first use */
+    kmersearch_highfreq_cache_sync_worker();
+    
     /* Check if global cache is valid and contains high-frequency k-mers */
     if (!global_highfreq_cache.is_valid)
         return false;
     
-    /* Check if cache contains any high-frequency k-mers */
-    if (global_highfreq_cache.highfreq_hash == NULL)
+    /* Check if cache contains any high-frequency k-mers (workers map no hash table) */
+    if (global_highfreq_cache.highfreq_count == 0)
         return false;
     
     return true;
@@ -498,11 +609,359 @@ kmersearch_undo_highfreq_analysis_internal(Oid table_oid, const char *column_nam
     return result;
 }
 
+/*
+ * Persisted k-mer counts for incremental analysis
+ */
+
+/*
+ * Build the file name prefix shared by every file of a counts state
+ * A k_size of 0 matches all k-mer sizes of the column.
+ */
+static void
+kmersearch_counts_key(char *buf, Oid table_oid, AttrNumber column_attnum,
+                      int k_size, int occur_bitlen)
+{
+    if (k_size > 0)
+        snprintf(buf, MAXPGPATH, "%u_%u_%d_%d_%d.", MyDatabaseId, table_oid,
+                 (int) column_attnum, k_size, occur_bitlen);
+    else
+        snprintf(buf, MAXPGPATH, "%u_%u_%d_", MyDatabaseId, table_oid,
+                 (int) column_attnum);
+}
+
+/*
+ * Highest line pointer in the last block of a relation (0 if it has none)
+ * Rows added to that block later get higher line pointers.
+ */
+static OffsetNumber
+kmersearch_tail_block_max_offset(Relation rel, BlockNumber nblocks)
+{
+    Buffer buffer;
+    OffsetNumber maxoff;
+    
+    if (nblocks == 0)
+        return InvalidOffsetNumber;
+    
+    buffer = ReadBuffer(rel, nblocks - 1);
+    LockBuffer(buffer, BUFFER_LOCK_SHARE);
+    maxoff = PageGetMaxOffsetNumber(BufferGetPage(buffer));
+    UnlockReleaseBuffer(buffer);
+    
+    return maxoff;
+}
+
+/*
+ * Read the counts state left by the previous incremental analysis
+ * Returns false, after telling the user why, when the counts cannot be
+ * extended to the current relations and the whole table must be scanned.
+ */
+static bool
+kmersearch_read_counts_state(const char *state_path, Oid table_oid,
+                             AttrNumber column_attnum, int k_size,
+                             const KmerAnalysisCountsRelation *current,
+                             int num_current,
+                             KmerAnalysisCountsHeader *header,
+                             KmerAnalysisCountsRelation **relations)
+{
+    KmerAnalysisCountsRelation *prev = NULL;
+    char *table_name = get_rel_name(table_oid);
+    Size relations_bytes = 0;
+    pg_crc32c crc;
+    pg_crc32c file_crc;
+    struct stat st;
+    FILE *file;
+    
+    *relations = NULL;
+    
+    file = AllocateFile(state_path, PG_BINARY_R);
+    if (file == NULL)
+    {
+        if (errno != ENOENT)
+            ereport(ERROR,
+                    (errcode_for_file_access(),
+                     errmsg("could not open file \"%s\": %m", state_path)));
+        ereport(INFO,
+                (errmsg("No previous k-mer counts for column %s in table %s, scanning all blocks",
+                        get_attname(table_oid, column_attnum, false), table_name)));
+        return false;
+    }
+    
+    if (fread(header, sizeof(*header), 1, file) != 1 ||
+        header->magic != KMERSEARCH_COUNTS_MAGIC ||
+        header->version != KMERSEARCH_COUNTS_VERSION ||
+        header->table_oid != table_oid ||
+        header->column_attnum != column_attnum ||
+        header->kmer_size != k_size ||
+        header->occur_bitlen != kmersearch_occur_bitlen ||
+        header->num_relations <= 0 ||
+        header->num_relations > (int) (MaxAllocSize / sizeof(KmerAnalysisCountsRelation)))
+        goto invalid;
+    
+    relations_bytes = sizeof(KmerAnalysisCountsRelation) * header->num_relations;
+    prev = palloc(relations_bytes);
+    if (fread(prev, relations_bytes, 1, file) != 1 ||
+        fread(&file_crc, sizeof(file_crc), 1, file) != 1)
+        goto invalid;
+    
+    INIT_CRC32C(crc);
+    COMP_CRC32C(crc, header, sizeof(*header));
+    COMP_CRC32C(crc, prev, relations_bytes);
+    FIN_CRC32C(crc);
+    if (!EQ_CRC32C(crc, file_crc))
+        goto invalid;
+    
+    FreeFile(file);
+    
+    if (stat(header->counts_file, &st) != 0)
+    {
+        ereport(INFO,
+                (errmsg("K-mer counts file \"%s\" is missing, scanning all blocks",
+                        header->counts_file)));
+        pfree(prev);
+        return false;
+    }
+    
+    /* Counts cannot be taken back, so every counted block must still exist */
+    for (int i = 0; i < header->num_relations; i++)
+    {
+        bool usable = false;
+        
+        for (int j = 0; j < num_current; j++)
+        {
+            if (current[j].relid == prev[i].relid)
+            {
+                usable = (current[j].relfilenode == prev[i].relfilenode &&
+                          current[j].scanned_blocks >= prev[i].scanned_blocks);
+                break;
+            }
+        }
+        
+        if (!usable)
+        {
+            ereport(INFO,
+                    (errmsg("Table %s was rewritten, truncated or lost partitions since its k-mers were counted, scanning all blocks",
+                            table_name)));
+            pfree(prev);
+            return false;
+        }
+    }
+    
+    *relations = prev;
+    return true;
+    
+invalid:
+    FreeFile(file);
+    if (prev)
+        pfree(prev);
+    ereport(INFO,
+            (errmsg("Ignoring invalid k-mer counts state file \"%s\", scanning all blocks",
+                    state_path)));
+    return false;
+}
+
+/*
+ * Write a counts state file; it is installed at commit
+ */
+static void
+kmersearch_write_counts_state(const char *path,
+                              const KmerAnalysisCountsHeader *header,
+                              const KmerAnalysisCountsRelation *relations)
+{
+    Size relations_bytes = sizeof(KmerAnalysisCountsRelation) * header->num_relations;
+    pg_crc32c crc;
+    FILE *file;
+    
+    INIT_CRC32C(crc);
+    COMP_CRC32C(crc, header, sizeof(*header));
+    COMP_CRC32C(crc, relations, relations_bytes);
+    FIN_CRC32C(crc);
+    
+    file = AllocateFile(path, PG_BINARY_W);
+    if (file == NULL)
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not create file \"%s\": %m", path)));
+    
+    if (fwrite(header, sizeof(*header), 1, file) != 1 ||
+        fwrite(relations, relations_bytes, 1, file) != 1 ||
+        fwrite(&crc, sizeof(crc), 1, file) != 1)
+    {
+        int save_errno = errno;
+        
+        FreeFile(file);
+        unlink(path);
+        errno = save_errno;
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not write file \"%s\": %m", path)));
+    }
+    
+    if (FreeFile(file) != 0)
+    {
+        int save_errno = errno;
+        
+        unlink(path);
+        errno = save_errno;
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not close file \"%s\": %m", path)));
+    }
+}
+
+/*
+ * Add the counts of one file hash table to another
+ */
+static void
+kmersearch_merge_counts_file(const char *source_path, const char *target_path,
+                             int total_bits)
+{
+    if (total_bits <= 16)
+        kmersearch_fht16_merge(source_path, target_path);
+    else if (total_bits <= 32)
+        kmersearch_fht32_merge(source_path, target_path);
+    else
+        kmersearch_fht64_merge(source_path, target_path);
+}
+
+/*
+ * Remove counts files whose names start with prefix, except the kept ones
+ */
+static void
+kmersearch_remove_counts_files(const char *prefix, const char *keep_state,
+                               const char *keep_counts)
+{
+    size_t prefix_len = strlen(prefix);
+    struct dirent *de;
+    DIR *dir;
+    
+    dir = AllocateDir(KMERSEARCH_COUNTS_DIR);
+    if (dir == NULL)
+    {
+        if (errno != ENOENT)
+            ereport(WARNING,
+                    (errcode_for_file_access(),
+                     errmsg("could not open directory \"%s\": %m", KMERSEARCH_COUNTS_DIR)));
+        return;
+    }
+    
+    while ((de = ReadDir(dir, KMERSEARCH_COUNTS_DIR)) != NULL)
+    {
+        char path[MAXPGPATH];
+        
+        if (strncmp(de->d_name, prefix, prefix_len) != 0)
+            continue;
+        
+        snprintf(path, MAXPGPATH, "%s/%s", KMERSEARCH_COUNTS_DIR, de->d_name);
+        if ((keep_state && strcmp(path, keep_state) == 0) ||
+            (keep_counts && strcmp(path, keep_counts) == 0))
+            continue;
+        
+        if (unlink(path) != 0 && errno != ENOENT)
+            ereport(WARNING,
+                    (errcode_for_file_access(),
+                     errmsg("could not remove file \"%s\": %m", path)));
+    }
+    
+    FreeDir(dir);
+}
+
+/*
+ * Queue a counts state change for the end of the current transaction
+ */
+static KmerAnalysisCountsPending *
+kmersearch_counts_at_commit(const char *prefix, bool replace)
+{
+    KmerAnalysisCountsPending *pending;
+    MemoryContext old_context;
+    
+    if (!counts_xact_callback_registered)
+    {
+        RegisterXactCallback(kmersearch_counts_xact_callback, NULL);
+        counts_xact_callback_registered = true;
+    }
+    
+    old_context = MemoryContextSwitchTo(TopTransactionContext);
+    pending = palloc0(sizeof(KmerAnalysisCountsPending));
+    strlcpy(pending->prefix, prefix, MAXPGPATH);
+    pending->replace = replace;
+    pending_counts_updates = lappend(pending_counts_updates, pending);
+    MemoryContextSwitchTo(old_context);
+    
+    return pending;
+}
+
+/*
+ * Install or remove counts states when the analyzing transaction commits
+ * This runs before the commit record is written, so a failure aborts the
+ * transaction.  Files written by an aborted analysis are removed.
+ */
+static void
+kmersearch_counts_xact_callback(XactEvent event, void *arg)
+{
+    KmerAnalysisCountsPending *pending;
+    ListCell *lc;
+    
+    switch (event)
+    {
+        case XACT_EVENT_PRE_COMMIT:
+            while (pending_counts_updates != NIL)
+            {
+                pending = (KmerAnalysisCountsPending *) linitial(pending_counts_updates);
+                pending_counts_updates = list_delete_first(pending_counts_updates);
+                
+                if (!pending->replace)
+                    kmersearch_remove_counts_files(pending->prefix, NULL, NULL);
+                else if (pending->ready)
+                {
+                    fsync_fname(pending->counts_file, false);
+                    (void) durable_rename(pending->tmp_state_path, pending->state_path, ERROR);
+                    kmersearch_remove_counts_files(pending->prefix, pending->state_path,
+                                                   pending->counts_file);
+                }
+                else
+                {
+                    /* The analysis failed inside a subtransaction */
+                    unlink(pending->tmp_state_path);
+                    unlink(pending->counts_file);
+                }
+            }
+            break;
+        case XACT_EVENT_PRE_PREPARE:
+            foreach(lc, pending_counts_updates)
+            {
+                pending = (KmerAnalysisCountsPending *) lfirst(lc);
+                if (pending->replace)
+                    ereport(ERROR,
+                            (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                             errmsg("cannot PREPARE a transaction that has run an incremental high-frequency k-mer analysis")));
+            }
+            /* Counts of undone analyses are still correct and are kept */
+            pending_counts_updates = NIL;
+            break;
+        case XACT_EVENT_ABORT:
+        case XACT_EVENT_PARALLEL_ABORT:
+            foreach(lc, pending_counts_updates)
+            {
+                pending = (KmerAnalysisCountsPending *) lfirst(lc);
+                if (pending->replace)
+                {
+                    unlink(pending->tmp_state_path);
+                    unlink(pending->counts_file);
+                }
+            }
+            pending_counts_updates = NIL;
+            break;
+        default:
+            break;
+    }
+}
+
 /*
  * Parallel table analysis implementation
  */
 KmerAnalysisResult
-kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_name, int k_size, int requested_workers)
+kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_name, int k_size, int requested_workers,
+                                              bool incremental, double sample_fraction, int64 sample_rows)
 {
     KmerAnalysisResult result = {0};  /* Initialize all fields to zero */
     ParallelContext *pcxt = NULL;
@@ -512,7 +971,6 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
     bool table_locked = false;
     int64 total_rows;
     uint64 threshold_rows;
-    uint64 rate_based_threshold;
     char temp_dir_to_delete[MAXPGPATH] = {0};  /* Initialize to empty string */
     KmerSearchTableType table_type;
     List *partition_oids = NIL;
@@ -521,6 +979,23 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
     BlockNumber total_blocks_all_partitions = 0;
     PartitionBlockInfo *partition_blocks = NULL;
     int num_partitions = 0;
+    KmerAnalysisCountsRelation *scan_relations = NULL;
+    int num_scan_relations = 0;
+    KmerAnalysisCountsHeader prev_counts;
+    KmerAnalysisCountsRelation *prev_relations = NULL;
+    bool use_prev_counts = false;
+    KmerHeavyHitterEntry *summary = NULL;
+    BlockNumber start_block = 0;
+    OffsetNumber start_offset = FirstOffsetNumber;
+    bool snapshot_pushed = false;
+    AttrNumber counts_attnum = InvalidAttrNumber;
+    char counts_key[MAXPGPATH];
+    char state_path[MAXPGPATH];
+    double estimated_rows = 0;
+    bool estimated_rows_known = true;
+    BlockNumber num_sampled_blocks = 0;
+    double row_scale = 1.0;
+    const char *detection_reason;
     
     
     PG_TRY();
@@ -538,6 +1013,21 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
         
         total_rows = 0; /* Initialize */
         
+        /*
+         * Keep the table unchanged until the new counts state is committed.
+         * Rows committed before the lock must be seen, which needs a
+         * snapshot taken after it.
+         */
+        if (incremental)
+        {
+            if (IsolationUsesXactSnapshot())
+                ereport(ERROR,
+                        (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                         errmsg("incremental high-frequency k-mer analysis requires READ COMMITTED isolation")));
+            LockRelationOid(table_oid, ExclusiveLock);
+            table_locked = true;
+        }
+        
         /* Check table type */
         table_type = kmersearch_get_table_type(table_oid);
         
@@ -554,28 +1044,35 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
             
             /* Allocate partition block info array */
             partition_blocks = palloc(sizeof(PartitionBlockInfo) * num_partitions);
+            scan_relations = palloc(sizeof(KmerAnalysisCountsRelation) * num_partitions);
             
-            /* Calculate total blocks from all partitions */
-            partition_idx = 0;
+            /* Record the current size of every partition */
             foreach(lc, partition_oids)
             {
                 Oid part_oid = lfirst_oid(lc);
-                Relation part_rel = table_open(part_oid, AccessShareLock);
-                BlockNumber part_blocks = RelationGetNumberOfBlocks(part_rel);
+                Relation part_rel;
                 
-                partition_blocks[partition_idx].partition_oid = part_oid;
-                partition_blocks[partition_idx].start_block = total_blocks_all_partitions;
-                partition_blocks[partition_idx].end_block = total_blocks_all_partitions + part_blocks - 1;
+                /* Rows inserted directly into a partition bypass the parent's lock */
+                if (incremental)
+                    LockRelationOid(part_oid, ExclusiveLock);
+                part_rel = table_open(part_oid, AccessShareLock);
                 
+                scan_relations[num_scan_relations].relid = part_oid;
+                scan_relations[num_scan_relations].relfilenode = part_rel->rd_rel->relfilenode;
+                scan_relations[num_scan_relations].scanned_blocks = RelationGetNumberOfBlocks(part_rel);
+                scan_relations[num_scan_relations].tail_offset = incremental ?
+                    kmersearch_tail_block_max_offset(part_rel, scan_relations[num_scan_relations].scanned_blocks) :
+                    InvalidOffsetNumber;
+                num_scan_relations++;
                 
-                total_blocks_all_partitions += part_blocks;
-                partition_idx++;
+                if (part_rel->rd_rel->reltuples < 0)
+                    estimated_rows_known = false;
+                else
+                    estimated_rows += part_rel->rd_rel->reltuples;
                 
                 table_close(part_rel, AccessShareLock);
             }
             
-            total_blocks = total_blocks_all_partitions;
-            
             /* Validate column exists in first partition */
             {
                 Oid first_part_oid = linitial_oid(partition_oids);
@@ -607,37 +1104,161 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
                 elog(ERROR, "Column must be DNA2 or DNA4 type");
             
             total_blocks = RelationGetNumberOfBlocks(rel);
+            
+            scan_relations = palloc(sizeof(KmerAnalysisCountsRelation));
+            scan_relations[0].relid = table_oid;
+            scan_relations[0].relfilenode = rel->rd_rel->relfilenode;
+            scan_relations[0].scanned_blocks = total_blocks;
+            scan_relations[0].tail_offset = incremental ?
+                kmersearch_tail_block_max_offset(rel, total_blocks) : InvalidOffsetNumber;
+            num_scan_relations = 1;
+            
+            if (rel->rd_rel->reltuples < 0)
+                estimated_rows_known = false;
+            else
+                estimated_rows = rel->rd_rel->reltuples;
             table_close(rel, AccessShareLock);
         }
         
-        /* Get row count */
-        initStringInfo(&count_query);
+        /* Every relation is locked now; see all rows committed before */
+        if (incremental)
         {
-            char *table_name_str = get_rel_name(table_oid);
-            const char *escaped_table_name = quote_identifier(table_name_str);
-            appendStringInfo(&count_query, "SELECT COUNT(*) FROM %s", escaped_table_name);
+            PushActiveSnapshot(GetTransactionSnapshot());
+            snapshot_pushed = true;
         }
         
-        if (SPI_connect() == SPI_OK_CONNECT) {
-            ret = SPI_exec(count_query.data, 0);
-            if (ret == SPI_OK_SELECT && SPI_processed == 1) {
-                count_datum = SPI_getbinval(SPI_tuptable->vals[0], 
-                                                 SPI_tuptable->tupdesc, 1, &isnull);
-                if (!isnull) {
-                    total_rows = DatumGetInt64(count_datum);
+        /* Continue from the rows counted by the previous incremental analysis */
+        if (incremental)
+        {
+            counts_attnum = get_attnum(table_oid, column_name);
+            kmersearch_counts_key(counts_key, table_oid, counts_attnum,
+                                  k_size, kmersearch_occur_bitlen);
+            snprintf(state_path, MAXPGPATH, "%s/%sstate", KMERSEARCH_COUNTS_DIR, counts_key);
+            use_prev_counts = kmersearch_read_counts_state(state_path, table_oid, counts_attnum,
+                                                           k_size, scan_relations,
+                                                           num_scan_relations,
+                                                           &prev_counts, &prev_relations);
+        }
+        
+        if (table_type == KMERSEARCH_TABLE_PARTITIONED)
+        {
+            /* Lay the blocks left to scan out as one global block range */
+            for (int i = 0; i < num_scan_relations; i++)
+            {
+                BlockNumber first_block = 0;
+                OffsetNumber first_offset = FirstOffsetNumber;
+                BlockNumber part_blocks;
+                
+                /* Resume in the last counted block, after its counted line pointers */
+                if (use_prev_counts)
+                {
+                    for (int j = 0; j < prev_counts.num_relations; j++)
+                    {
+                        if (prev_relations[j].relid == scan_relations[i].relid &&
+                            prev_relations[j].scanned_blocks > 0)
+                        {
+                            first_block = prev_relations[j].scanned_blocks - 1;
+                            first_offset = OffsetNumberNext(prev_relations[j].tail_offset);
+                        }
+                    }
                 }
+                
+                part_blocks = scan_relations[i].scanned_blocks - first_block;
+                if (part_blocks == 0)
+                    continue;
+                
+                partition_blocks[partition_idx].partition_oid = scan_relations[i].relid;
+                partition_blocks[partition_idx].start_block = total_blocks_all_partitions;
+                partition_blocks[partition_idx].end_block = total_blocks_all_partitions + part_blocks - 1;
+                partition_blocks[partition_idx].local_start_block = first_block;
+                partition_blocks[partition_idx].local_start_offset = first_offset;
+                
+                total_blocks_all_partitions += part_blocks;
+                partition_idx++;
             }
-            SPI_finish();
+            num_partitions = partition_idx;
+            
+            total_blocks = total_blocks_all_partitions;
+        }
+        else if (use_prev_counts && prev_relations[0].scanned_blocks > 0)
+        {
+            /* Resume in the last counted block, after its counted line pointers */
+            start_block = prev_relations[0].scanned_blocks - 1;
+            start_offset = OffsetNumberNext(prev_relations[0].tail_offset);
+        }
+        
+        /* Sampled analysis reads a random subset of the blocks */
+        if (sample_fraction < 1.0 || sample_rows > 0)
+        {
+            double target_blocks;
+            
+            if (sample_rows > 0)
+            {
+                if (!estimated_rows_known || estimated_rows <= 0)
+                    ereport(ERROR,
+                            (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+                             errmsg("row count of table \"%s\" is not known", get_rel_name(table_oid)),
+                             errhint("Run ANALYZE on the table or pass sample_fraction instead of sample_rows.")));
+                sample_fraction = Min((double) sample_rows / estimated_rows, 1.0);
+            }
+            
+            /* A sample covering every block is a full scan */
+            target_blocks = ceil(sample_fraction * total_blocks);
+            if (target_blocks < total_blocks)
+                num_sampled_blocks = (BlockNumber) Min(Max(target_blocks, 1.0), (double) INT_MAX);
+        }
+        
+        if (use_prev_counts)
+        {
+            uint64 counted_blocks = 0;
+            BlockNumber new_blocks = total_blocks - start_block;
+            
+            /* Only estimated for progress reporting; the scan yields the exact count */
+            for (int i = 0; i < prev_counts.num_relations; i++)
+                counted_blocks += prev_relations[i].scanned_blocks;
+            if (counted_blocks > 0)
+                total_rows = (int64) ((double) prev_counts.total_rows * new_blocks / counted_blocks);
+        }
+        else if (num_sampled_blocks > 0)
+        {
+            /* Only estimated for progress reporting; COUNT(*) would read every block */
+            if (estimated_rows_known)
+                total_rows = (int64) (estimated_rows * num_sampled_blocks / total_blocks);
+        }
+        else
+        {
+            /* Get row count */
+            initStringInfo(&count_query);
+            {
+                char *table_name_str = get_rel_name(table_oid);
+                const char *escaped_table_name = quote_identifier(table_name_str);
+                appendStringInfo(&count_query, "SELECT COUNT(*) FROM %s", escaped_table_name);
+            }
+        
+            if (SPI_connect() == SPI_OK_CONNECT) {
+                ret = SPI_exec(count_query.data, 0);
+                if (ret == SPI_OK_SELECT && SPI_processed == 1) {
+                    count_datum = SPI_getbinval(SPI_tuptable->vals[0], 
+                                                     SPI_tuptable->tupdesc, 1, &isnull);
+                    if (!isnull) {
+                        total_rows = DatumGetInt64(count_datum);
+                    }
+                }
+                SPI_finish();
+            }
+            pfree(count_query.data);
         }
-        pfree(count_query.data);
         
         result.total_rows = total_rows;
         result.max_appearance_rate_used = kmersearch_max_appearance_rate;
         result.max_appearance_nrow_used = kmersearch_max_appearance_nrow;
         
         /* Table lock acquisition */
-        LockRelationOid(table_oid, ExclusiveLock);
-        table_locked = true;
+        if (!table_locked)
+        {
+            LockRelationOid(table_oid, ExclusiveLock);
+            table_locked = true;
+        }
         
         
         /* Enter parallel mode */
@@ -651,13 +1272,26 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
         if (table_type == KMERSEARCH_TABLE_PARTITIONED)
         {
             /* Additional space for partition block info array */
-            shm_toc_estimate_chunk(&pcxt->estimator, MAXALIGN(sizeof(PartitionBlockInfo) * num_partitions));
+            shm_toc_estimate_chunk(&pcxt->estimator, MAXALIGN(sizeof(PartitionBlockInfo) * Max(num_partitions, 1)));
             shm_toc_estimate_keys(&pcxt->estimator, 2); /* SHARED_STATE, PARTITION_BLOCKS */
         }
         else
         {
             shm_toc_estimate_keys(&pcxt->estimator, 1); /* SHARED_STATE */
         }
+        if (kmersearch_highfreq_analysis_mode != KMERSEARCH_ANALYSIS_EXACT)
+        {
+            /* Shared heavy-hitter summary */
+            shm_toc_estimate_chunk(&pcxt->estimator,
+                                   MAXALIGN(sizeof(KmerHeavyHitterEntry) * kmersearch_highfreq_analysis_summary_size));
+            shm_toc_estimate_keys(&pcxt->estimator, 1); /* SUMMARY */
+        }
+        if (num_sampled_blocks > 0)
+        {
+            /* Sampled global block numbers */
+            shm_toc_estimate_chunk(&pcxt->estimator, MAXALIGN(sizeof(BlockNumber) * num_sampled_blocks));
+            shm_toc_estimate_keys(&pcxt->estimator, 1); /* SAMPLED_BLOCKS */
+        }
         elog(DEBUG1, "  - sizeof(KmerAnalysisSharedState) = %zu, MAXALIGN = %zu", 
              sizeof(KmerAnalysisSharedState), MAXALIGN(sizeof(KmerAnalysisSharedState)));
         
@@ -694,12 +1328,15 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
         strlcpy(shared_state->column_name, column_name, NAMEDATALEN);
         
         shared_state->all_processed = false;
-        shared_state->next_block = 0;
+        shared_state->next_block = start_block;
         shared_state->total_blocks = total_blocks;
+        shared_state->first_block = start_block;
+        shared_state->first_offset = start_offset;
         
         /* Initialize progress tracking atomics */
         pg_atomic_init_u64(&shared_state->total_rows_processed, 0);
         pg_atomic_init_u64(&shared_state->total_batches_committed, 0);
+        pg_atomic_init_u64(&shared_state->visible_rows_scanned, 0);
         
         /* Initialize temporary directory path for SQLite3 files */
         {
@@ -737,6 +1374,35 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
         shared_state->worker_error_occurred = false;
         shared_state->total_rows = total_rows;
         
+        /* Set up the shared heavy-hitter summary of approximate analysis */
+        shared_state->analysis_mode = kmersearch_highfreq_analysis_mode;
+        shared_state->verify_phase = false;
+        LWLockInitialize(&shared_state->summary_lock.lock, LWTRANCHE_KMERSEARCH_ANALYSIS);
+        if (shared_state->analysis_mode != KMERSEARCH_ANALYSIS_EXACT)
+        {
+            shared_state->summary_capacity = kmersearch_highfreq_analysis_summary_size;
+            summary = (KmerHeavyHitterEntry *) shm_toc_allocate(toc,
+                sizeof(KmerHeavyHitterEntry) * shared_state->summary_capacity);
+            shm_toc_insert(toc, KMERSEARCH_KEY_SUMMARY, summary);
+        }
+        
+        /* Draw the block sample over the global block range, in block order */
+        shared_state->num_sampled_blocks = num_sampled_blocks;
+        if (num_sampled_blocks > 0)
+        {
+            BlockNumber *sampled_blocks;
+            BlockSamplerData bs;
+            BlockNumber nsampled = 0;
+            
+            sampled_blocks = (BlockNumber *) shm_toc_allocate(toc, sizeof(BlockNumber) * num_sampled_blocks);
+            BlockSampler_Init(&bs, total_blocks, (int) num_sampled_blocks,
+                              pg_prng_uint32(&pg_global_prng_state));
+            while (BlockSampler_HasMore(&bs))
+                sampled_blocks[nsampled++] = BlockSampler_Next(&bs);
+            Assert(nsampled == num_sampled_blocks);
+            shm_toc_insert(toc, KMERSEARCH_KEY_SAMPLED_BLOCKS, sampled_blocks);
+        }
+        
         /* Set partition-specific fields */
         shared_state->is_partitioned = (table_type == KMERSEARCH_TABLE_PARTITIONED);
         shared_state->num_partitions = num_partitions;
@@ -746,7 +1412,7 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
             /* Allocate and copy partition block info to shared memory */
             PartitionBlockInfo *shm_partition_blocks;
             shm_partition_blocks = (PartitionBlockInfo *)shm_toc_allocate(toc, 
-                sizeof(PartitionBlockInfo) * num_partitions);
+                sizeof(PartitionBlockInfo) * Max(num_partitions, 1));
             if (!shm_partition_blocks)
             {
                 elog(ERROR, "Failed to allocate memory for partition blocks in shm_toc");
@@ -761,6 +1427,7 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
         {
             shared_state->partition_blocks = NULL;
             shared_state->total_blocks_all_partitions = 0;
+            pg_atomic_init_u32(&shared_state->next_global_block, 0);  /* Sampled blocks */
         }
         
         elog(DEBUG1, "kmersearch_perform_highfreq_analysis_parallel: Initialized shared state - next_block=%u, total_blocks=%u, is_partitioned=%d",
@@ -778,12 +1445,22 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
             if (shared_state->is_partitioned) {
                 total_blocks_to_process = shared_state->total_blocks_all_partitions;
             } else {
-                total_blocks_to_process = shared_state->total_blocks;
+                total_blocks_to_process = shared_state->total_blocks - start_block;
             }
             
-            ereport(INFO, 
-                    (errmsg("Starting high-frequency k-mer analysis: %lu rows in %u blocks with %d parallel workers", 
-                            result.total_rows, total_blocks_to_process, result.parallel_workers_used)));
+            if (num_sampled_blocks > 0)
+                ereport(INFO,
+                        (errmsg("Starting sampled high-frequency k-mer analysis: %u of %u blocks with %d parallel workers",
+                                num_sampled_blocks, total_blocks_to_process, result.parallel_workers_used)));
+            else if (use_prev_counts)
+                ereport(INFO,
+                        (errmsg("Starting incremental high-frequency k-mer analysis: %u new blocks after %lu counted rows with %d parallel workers",
+                                total_blocks_to_process, (unsigned long) prev_counts.total_rows,
+                                result.parallel_workers_used)));
+            else
+                ereport(INFO, 
+                        (errmsg("Starting high-frequency k-mer analysis: %lu rows in %u blocks with %d parallel workers", 
+                                result.total_rows, total_blocks_to_process, result.parallel_workers_used)));
         }
         
         /* Wait for workers to complete */
@@ -793,11 +1470,55 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
         if (shared_state->worker_error_occurred)
             elog(ERROR, "Parallel worker error: %s", shared_state->error_message);
         
+        /* New rows extend the row count the previous counts were taken from */
+        if (use_prev_counts)
+            result.total_rows = prev_counts.total_rows +
+                pg_atomic_read_u64(&shared_state->visible_rows_scanned);
+        
         /* Announce start of parent aggregation */
         ereport(INFO,
                 (errmsg("Parallel scan completed. Starting aggregation of results.")));
 
+        /* Calculate threshold based on GUC variables */
+        threshold_rows = kmersearch_appearance_threshold(result.total_rows);
+        detection_reason = "threshold";
+
+        /*
+         * A sample stands for the whole table by its share of the blocks.
+         * Counts stay in sample rows; the threshold moves there instead.
+         */
+        if (num_sampled_blocks > 0)
+        {
+            uint64 sampled_rows = pg_atomic_read_u64(&shared_state->visible_rows_scanned);
+
+            result.total_rows = (int64) rint((double) sampled_rows * total_blocks / num_sampled_blocks);
+            threshold_rows = kmersearch_appearance_threshold(result.total_rows);
+            if (sampled_rows > 0)
+                row_scale = (double) result.total_rows / sampled_rows;
+            detection_reason = "sampled";
+
+            result.max_appearance_nrow_used = threshold_rows;
+            threshold_rows = kmersearch_sampled_threshold(sampled_rows,
+                result.total_rows > 0 ? (double) threshold_rows / result.total_rows : 1.0);
+
+            ereport(INFO,
+                    (errmsg("Sampled %lu rows in %u of %u blocks, estimated %ld rows in the table",
+                            (unsigned long)sampled_rows, num_sampled_blocks, total_blocks,
+                            result.total_rows),
+                     errdetail("K-mers in more than %lu sampled rows are high-frequency at %.2f%% confidence.",
+                               (unsigned long)threshold_rows,
+                               kmersearch_highfreq_analysis_sample_confidence * 100.0)));
+        }
+        else
+        {
+            result.max_appearance_nrow_used = threshold_rows;
+        }
+        elog(DEBUG1, "Threshold calculation: total_rows=%ld, rate=%.2f, nrow=%d, final=%lu",
+             result.total_rows, kmersearch_max_appearance_rate,
+             kmersearch_max_appearance_nrow, (unsigned long)threshold_rows);
+
         /* Aggregate results from worker file hash tables */
+        if (shared_state->analysis_mode == KMERSEARCH_ANALYSIS_EXACT)
         {
             char worker_files[MAX_PARALLEL_WORKERS][MAXPGPATH];
             char *aggregated_file_path;
@@ -835,21 +1556,54 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
             /* Use the first worker file (aggregated if multiple, original if single) */
             aggregated_file_path = worker_files[0];
 
-            /* Calculate threshold based on GUC variables */
-            rate_based_threshold = (uint64)(result.total_rows * kmersearch_max_appearance_rate);
+            /*
+             * Incremental analysis adds the previous counts and keeps the
+             * result as the counts state of the next run
+             */
+            if (incremental)
+            {
+                KmerAnalysisCountsPending *pending;
+                KmerAnalysisCountsHeader counts;
 
-            /* Determine final threshold: min of rate-based and nrow-based (excluding 0) */
-            if (kmersearch_max_appearance_nrow > 0) {
-                threshold_rows = (rate_based_threshold < (uint64)kmersearch_max_appearance_nrow) ?
-                                rate_based_threshold : (uint64)kmersearch_max_appearance_nrow;
-            } else {
-                threshold_rows = rate_based_threshold;
-            }
-            elog(DEBUG1, "Threshold calculation: total_rows=%ld, rate=%.2f, rate_based=%lu, nrow=%d, final=%lu",
-                 result.total_rows, kmersearch_max_appearance_rate, (unsigned long)rate_based_threshold,
-                 kmersearch_max_appearance_nrow, (unsigned long)threshold_rows);
+                if (MakePGDirectory(KMERSEARCH_COUNTS_DIR) < 0 && errno != EEXIST)
+                    ereport(ERROR,
+                            (errcode_for_file_access(),
+                             errmsg("could not create directory \"%s\": %m", KMERSEARCH_COUNTS_DIR)));
 
-            result.max_appearance_nrow_used = threshold_rows;
+                pending = kmersearch_counts_at_commit(counts_key, true);
+                strlcpy(pending->state_path, state_path, MAXPGPATH);
+                snprintf(pending->tmp_state_path, MAXPGPATH, "%s.tmp", state_path);
+                snprintf(pending->counts_file, MAXPGPATH, "%s/%s%ld.fht",
+                         KMERSEARCH_COUNTS_DIR, counts_key, (long) GetCurrentTimestamp());
+
+                if (total_bits <= 16)
+                    kmersearch_fht16_close(kmersearch_fht16_create(pending->counts_file));
+                else if (total_bits <= 32)
+                    kmersearch_fht32_close(kmersearch_fht32_create(pending->counts_file, 0));
+                else
+                    kmersearch_fht64_close(kmersearch_fht64_create(pending->counts_file, 0));
+
+                kmersearch_merge_counts_file(aggregated_file_path, pending->counts_file, total_bits);
+                if (use_prev_counts)
+                    kmersearch_merge_counts_file(prev_counts.counts_file, pending->counts_file, total_bits);
+
+                memset(&counts, 0, sizeof(counts));
+                counts.magic = KMERSEARCH_COUNTS_MAGIC;
+                counts.version = KMERSEARCH_COUNTS_VERSION;
+                counts.table_oid = table_oid;
+                counts.column_attnum = counts_attnum;
+                counts.kmer_size = k_size;
+                counts.occur_bitlen = kmersearch_occur_bitlen;
+                counts.total_rows = result.total_rows;
+                counts.num_relations = num_scan_relations;
+                strlcpy(counts.counts_file, pending->counts_file, MAXPGPATH);
+                kmersearch_write_counts_state(pending->tmp_state_path, &counts, scan_relations);
+                pending->ready = true;
+
+                /* Derive the high-frequency k-mers from the merged counts */
+                unlink(aggregated_file_path);
+                aggregated_file_path = pending->counts_file;
+            }
 
             /* Count and extract high-frequency k-mers from file hash table */
             {
@@ -912,6 +1666,21 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
             /* Save results to PostgreSQL */
             kmersearch_spi_connect_or_error();
 
+            /* Merged counts re-derive the whole set, so k-mers below the threshold go */
+            if (incremental)
+            {
+                StringInfoData delete_query;
+
+                initStringInfo(&delete_query);
+                appendStringInfo(&delete_query,
+                    "DELETE FROM kmersearch_highfreq_kmer "
+                    "WHERE table_oid = %u AND column_name = %s AND kmer_size = %d AND occur_bitlen = %d",
+                    table_oid, quote_literal_cstr(column_name), k_size, kmersearch_occur_bitlen);
+                if (SPI_exec(delete_query.data, 0) != SPI_OK_DELETE)
+                    elog(ERROR, "Failed to delete previous high-frequency k-mers");
+                pfree(delete_query.data);
+            }
+
             ereport(INFO,
                     (errmsg("Writing %d high-frequency k-mers to kmersearch_highfreq_kmer table...",
                             result.highfreq_kmers_count)));
@@ -932,23 +1701,9 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
                     {
                         if (appearance_nrow > threshold_rows)
                         {
-                            StringInfoData insert_query;
-                            int insert_ret;
-
-                            initStringInfo(&insert_query);
-                            appendStringInfo(&insert_query,
-                                "INSERT INTO kmersearch_highfreq_kmer "
-                                "(table_oid, column_name, kmer_size, occur_bitlen, uintkey, appearance_nrow, detection_reason) "
-                                "VALUES (%u, %s, %d, %d, %ld, %lu, 'threshold') "
-                                "ON CONFLICT (table_oid, column_name, kmer_size, occur_bitlen, uintkey) DO UPDATE SET "
-                                "appearance_nrow = EXCLUDED.appearance_nrow",
-                                table_oid, quote_literal_cstr(column_name), k_size, kmersearch_occur_bitlen,
-                                (int64)uintkey, (unsigned long)appearance_nrow);
-
-                            insert_ret = SPI_exec(insert_query.data, 0);
-                            if (insert_ret != SPI_OK_INSERT && insert_ret != SPI_OK_UPDATE)
-                                elog(WARNING, "Failed to insert high-frequency k-mer");
-                            pfree(insert_query.data);
+                            kmersearch_insert_highfreq_kmer(table_oid, column_name, k_size, uintkey,
+                                                            (uint64) rint(appearance_nrow * row_scale),
+                                                            detection_reason);
 
                             kmers_written++;
                             if (kmers_written % 1000 == 0)
@@ -970,23 +1725,9 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
                     {
                         if (appearance_nrow > threshold_rows)
                         {
-                            StringInfoData insert_query;
-                            int insert_ret;
-
-                            initStringInfo(&insert_query);
-                            appendStringInfo(&insert_query,
-                                "INSERT INTO kmersearch_highfreq_kmer "
-                                "(table_oid, column_name, kmer_size, occur_bitlen, uintkey, appearance_nrow, detection_reason) "
-                                "VALUES (%u, %s, %d, %d, %ld, %lu, 'threshold') "
-                                "ON CONFLICT (table_oid, column_name, kmer_size, occur_bitlen, uintkey) DO UPDATE SET "
-                                "appearance_nrow = EXCLUDED.appearance_nrow",
-                                table_oid, quote_literal_cstr(column_name), k_size, kmersearch_occur_bitlen,
-                                (int64)uintkey, (unsigned long)appearance_nrow);
-
-                            insert_ret = SPI_exec(insert_query.data, 0);
-                            if (insert_ret != SPI_OK_INSERT && insert_ret != SPI_OK_UPDATE)
-                                elog(WARNING, "Failed to insert high-frequency k-mer");
-                            pfree(insert_query.data);
+                            kmersearch_insert_highfreq_kmer(table_oid, column_name, k_size, uintkey,
+                                                            (uint64) rint(appearance_nrow * row_scale),
+                                                            detection_reason);
 
                             kmers_written++;
                             if (kmers_written % 1000 == 0)
@@ -1008,23 +1749,9 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
                     {
                         if (appearance_nrow > threshold_rows)
                         {
-                            StringInfoData insert_query;
-                            int insert_ret;
-
-                            initStringInfo(&insert_query);
-                            appendStringInfo(&insert_query,
-                                "INSERT INTO kmersearch_highfreq_kmer "
-                                "(table_oid, column_name, kmer_size, occur_bitlen, uintkey, appearance_nrow, detection_reason) "
-                                "VALUES (%u, %s, %d, %d, %ld, %lu, 'threshold') "
-                                "ON CONFLICT (table_oid, column_name, kmer_size, occur_bitlen, uintkey) DO UPDATE SET "
-                                "appearance_nrow = EXCLUDED.appearance_nrow",
-                                table_oid, quote_literal_cstr(column_name), k_size, kmersearch_occur_bitlen,
-                                (int64)uintkey, (unsigned long)appearance_nrow);
-
-                            insert_ret = SPI_exec(insert_query.data, 0);
-                            if (insert_ret != SPI_OK_INSERT && insert_ret != SPI_OK_UPDATE)
-                                elog(WARNING, "Failed to insert high-frequency k-mer");
-                            pfree(insert_query.data);
+                            kmersearch_insert_highfreq_kmer(table_oid, column_name, k_size, uintkey,
+                                                            (uint64) rint(appearance_nrow * row_scale),
+                                                            detection_reason);
 
                             kmers_written++;
                             if (kmers_written % 1000 == 0)
@@ -1035,14 +1762,50 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
                     kmersearch_fht64_close(fht_ctx);
                 }
 
-                /* Delete aggregated file */
-                unlink(aggregated_file_path);
+                /* Delete aggregated file (incremental counts are kept) */
+                if (!incremental)
+                    unlink(aggregated_file_path);
 
                 ereport(INFO,
                         (errmsg("Successfully wrote %d high-frequency k-mers to database.",
                                 kmers_written)));
             }
         }
+        else
+        {
+            KmerHeavyHitterEntry *heavy_hitters;
+            int nheavy_hitters;
+            bool verified = (shared_state->analysis_mode == KMERSEARCH_ANALYSIS_APPROXIMATE_VERIFIED);
+
+            if (!verified)
+                detection_reason = "approximate";
+
+            heavy_hitters = kmersearch_resolve_heavy_hitters(pcxt, shared_state, summary,
+                                                             threshold_rows, &nheavy_hitters);
+            result.highfreq_kmers_count = nheavy_hitters;
+
+            /* Clean up parallel context and exit parallel mode BEFORE any SQL operations */
+            DestroyParallelContext(pcxt);
+            pcxt = NULL;
+            ExitParallelMode();
+
+            /* Save results to PostgreSQL */
+            kmersearch_spi_connect_or_error();
+
+            ereport(INFO,
+                    (errmsg("Writing %d %s high-frequency k-mers to kmersearch_highfreq_kmer table...",
+                            nheavy_hitters, verified ? "verified" : "approximate")));
+
+            for (int i = 0; i < nheavy_hitters; i++)
+                kmersearch_insert_highfreq_kmer(table_oid, column_name, k_size, heavy_hitters[i].uintkey,
+                                                (uint64) rint(heavy_hitters[i].count * row_scale),
+                                                detection_reason);
+            pfree(heavy_hitters);
+
+            ereport(INFO,
+                    (errmsg("Successfully wrote %d high-frequency k-mers to database.",
+                            nheavy_hitters)));
+        }
         
         /* result.highfreq_kmers_count is already set above */
         
@@ -1090,13 +1853,20 @@ kmersearch_perform_highfreq_analysis_parallel(Oid table_oid, const char *column_
     PG_END_TRY();
     
     /* Normal cleanup - already done above, just unlock */
-    UnlockRelationOid(table_oid, ExclusiveLock);
+    if (snapshot_pushed)
+        PopActiveSnapshot();
+    if (!incremental)
+        UnlockRelationOid(table_oid, ExclusiveLock);
     
     /* Free partition blocks if allocated */
     if (partition_blocks)
     {
         pfree(partition_blocks);
     }
+    if (scan_relations)
+        pfree(scan_relations);
+    if (prev_relations)
+        pfree(prev_relations);
     
     /* Free partition OID list */
     if (partition_oids)
@@ -1225,7 +1995,9 @@ kmersearch_analysis_worker(dsm_segment *seg, shm_toc *toc)
 {
     KmerAnalysisSharedState *shared_state = NULL;
     FileHashWorkerContext ctx;
-    bool has_work = true;
+    BlockNumber *sampled_blocks;
+    BlockNumber block;
+    Oid relid;
     int worker_id;
     int fd;
 
@@ -1253,214 +2025,777 @@ kmersearch_analysis_worker(dsm_segment *seg, shm_toc *toc)
         }
     }
 
+    /* NULL unless a block sample is analyzed */
+    sampled_blocks = (BlockNumber *)shm_toc_lookup(toc, KMERSEARCH_KEY_SAMPLED_BLOCKS, true);
+
     ctx.total_bits = kmersearch_kmer_size * 2 + kmersearch_occur_bitlen;
 
-    ctx.dna2_oid = TypenameGetTypid("dna2");
-    ctx.dna4_oid = TypenameGetTypid("dna4");
+    ctx.dna2_oid = TypenameGetTypid("dna2");
+    ctx.dna4_oid = TypenameGetTypid("dna4");
+
+    {
+        Relation rel;
+        TupleDesc tupdesc;
+        Form_pg_attribute attr;
+        Oid column_type_oid;
+
+        rel = table_open(shared_state->table_oid, AccessShareLock);
+        tupdesc = RelationGetDescr(rel);
+        attr = TupleDescAttr(tupdesc, shared_state->column_attnum - 1);
+        column_type_oid = attr->atttypid;
+        table_close(rel, AccessShareLock);
+
+        if (column_type_oid != ctx.dna2_oid && column_type_oid != ctx.dna4_oid)
+        {
+            elog(ERROR, "Column must be DNA2 or DNA4 type");
+        }
+
+        ctx.column_type_oid = column_type_oid;
+    }
+
+    {
+        int shared_buffers_kb = NBuffers * (BLCKSZ / 1024);
+        int ring_size_kb;
+        int num_workers = Max(max_parallel_maintenance_workers, 1);
+
+        ring_size_kb = shared_buffers_kb / (num_workers * 4);
+
+        if (ring_size_kb < 256)
+            ring_size_kb = 256;
+        if (ring_size_kb > 256 * 1024)
+            ring_size_kb = 256 * 1024;
+
+        if (shared_buffers_kb < ring_size_kb * num_workers * 2)
+        {
+            elog(DEBUG2, "Worker using normal buffer access: shared_buffers=%d KB < ring_requirement=%d KB",
+                 shared_buffers_kb, ring_size_kb * num_workers * 2);
+            ctx.strategy = NULL;
+        }
+        else
+        {
+            elog(DEBUG2, "Worker using ring buffer strategy: size=%d KB, shared_buffers=%d KB",
+                 ring_size_kb, shared_buffers_kb);
+            ctx.strategy = GetAccessStrategyWithSize(BAS_BULKREAD, ring_size_kb);
+        }
+    }
+
+    /* Approximate analysis keeps fixed-size summaries instead of spill files */
+    if (shared_state->analysis_mode != KMERSEARCH_ANALYSIS_EXACT)
+    {
+        kmersearch_analysis_worker_approximate(toc, shared_state, &ctx);
+        return;
+    }
+
+    /* Create temporary file for file hash table */
+    snprintf(ctx.file_path, MAXPGPATH, "%s/pg_kmersearch_XXXXXX",
+             shared_state->temp_dir_path);
+
+    fd = mkstemp(ctx.file_path);
+    if (fd < 0)
+    {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not create temporary file \"%s\": %m", ctx.file_path)));
+    }
+    close(fd);
+    unlink(ctx.file_path);
+
+    /* Create file hash table based on total_bits */
+    if (ctx.total_bits <= 16)
+    {
+        ctx.fht_ctx = kmersearch_fht16_create(ctx.file_path);
+    }
+    else if (ctx.total_bits <= 32)
+    {
+        ctx.fht_ctx = kmersearch_fht32_create(ctx.file_path, 0);
+    }
+    else
+    {
+        ctx.fht_ctx = kmersearch_fht64_create(ctx.file_path, 0);
+    }
+
+    ctx.batch_memory_context = AllocSetContextCreate(CurrentMemoryContext,
+                                                     "KmerBatchMemoryContext",
+                                                     ALLOCSET_DEFAULT_SIZES);
+
+    ctx.memory_limit_per_worker = (Size)maintenance_work_mem * 1024L / Max(max_parallel_maintenance_workers, 1);
+    if (ctx.memory_limit_per_worker < 64 * 1024)
+        ctx.memory_limit_per_worker = 64 * 1024;
+
+    if (ctx.total_bits <= 16)
+    {
+        ctx.fht16_memory_array = (uint64 *) palloc0(65536 * sizeof(uint64));
+    }
+    else
+    {
+        ctx.fht16_memory_array = NULL;
+    }
+
+    /* Dynamic work acquisition loop */
+    while (kmersearch_next_analysis_block(shared_state, sampled_blocks, &block, &relid))
+        kmersearch_process_block_with_batch(block, relid,
+                                            kmersearch_first_analysis_offset(shared_state, block, relid),
+                                            shared_state, &ctx);
+
+    /* Flush any remaining batch data */
+    if (ctx.batch_hash && ctx.batch_count > 0)
+    {
+        uint64 total_rows;
+        uint64 batch_num;
+
+        kmersearch_flush_batch_to_fht(&ctx);
+
+        total_rows = pg_atomic_add_fetch_u64(&shared_state->total_rows_processed, ctx.batch_count);
+        batch_num = pg_atomic_add_fetch_u64(&shared_state->total_batches_committed, 1);
+
+        ereport(INFO,
+                (errmsg("Batch %lu completed: %lu / %lu rows processed of column %s in table %s (final)",
+                        (unsigned long)batch_num, (unsigned long)total_rows,
+                        (unsigned long)shared_state->total_rows,
+                        shared_state->column_name, shared_state->table_name)));
+    }
+
+    if (ctx.batch_hash)
+    {
+        hash_destroy(ctx.batch_hash);
+        ctx.batch_hash = NULL;
+    }
+
+    /* Close file hash table */
+    if (ctx.fht_ctx)
+    {
+        if (ctx.total_bits <= 16)
+        {
+            kmersearch_fht16_close((FileHashTable16Context *)ctx.fht_ctx);
+        }
+        else if (ctx.total_bits <= 32)
+        {
+            kmersearch_fht32_close((FileHashTable32Context *)ctx.fht_ctx);
+        }
+        else
+        {
+            kmersearch_fht64_close((FileHashTable64Context *)ctx.fht_ctx);
+        }
+        ctx.fht_ctx = NULL;
+    }
+
+    if (ctx.batch_memory_context)
+    {
+        MemoryContextDelete(ctx.batch_memory_context);
+        ctx.batch_memory_context = NULL;
+    }
+
+    if (ctx.strategy)
+    {
+        FreeAccessStrategy(ctx.strategy);
+        ctx.strategy = NULL;
+    }
+
+    /* Register temporary file path for parent process */
+    kmersearch_register_worker_temp_file(shared_state, ctx.file_path, worker_id);
+}
+
+/*
+ * Claim the next block to analyze
+ * Partitioned tables and block samples are dispatched through one global
+ * block counter; with a sample it indexes the sampled global blocks.
+ */
+static bool
+kmersearch_next_analysis_block(KmerAnalysisSharedState *shared_state,
+                               const BlockNumber *sampled_blocks,
+                               BlockNumber *block, Oid *relid)
+{
+    if (shared_state->is_partitioned || sampled_blocks != NULL)
+    {
+        BlockNumber global_block;
+        PartitionBlockMapping mapping;
+
+        global_block = pg_atomic_fetch_add_u32(&shared_state->next_global_block, 1);
+        if (sampled_blocks != NULL)
+        {
+            if (global_block >= shared_state->num_sampled_blocks)
+                return false;
+            global_block = sampled_blocks[global_block];
+        }
+        else if (global_block >= shared_state->total_blocks_all_partitions)
+            return false;
+
+        if (!shared_state->is_partitioned)
+        {
+            *block = global_block;
+            *relid = shared_state->table_oid;
+            return true;
+        }
+
+        mapping = kmersearch_map_global_to_partition_block(global_block, shared_state);
+        *block = mapping.local_block_number;
+        *relid = mapping.partition_oid;
+        return true;
+    }
+
+    LWLockAcquire(&shared_state->mutex.lock, LW_EXCLUSIVE);
+    if (shared_state->next_block >= shared_state->total_blocks)
+    {
+        shared_state->all_processed = true;
+        LWLockRelease(&shared_state->mutex.lock);
+        return false;
+    }
+    *block = shared_state->next_block++;
+    LWLockRelease(&shared_state->mutex.lock);
+
+    *relid = shared_state->table_oid;
+    return true;
+}
+
+/*
+ * First line pointer to analyze in a block
+ * An incremental analysis resumes inside the block it counted last, after
+ * the line pointers that are already counted.
+ */
+static OffsetNumber
+kmersearch_first_analysis_offset(const KmerAnalysisSharedState *shared_state,
+                                 BlockNumber block, Oid relid)
+{
+    if (shared_state->is_partitioned)
+    {
+        for (int i = 0; i < shared_state->num_partitions; i++)
+        {
+            const PartitionBlockInfo *info = &shared_state->partition_blocks[i];
+            
+            if (info->partition_oid == relid)
+                return (block == info->local_start_block) ? info->local_start_offset : FirstOffsetNumber;
+        }
+        return FirstOffsetNumber;
+    }
+    
+    return (block == shared_state->first_block) ? shared_state->first_offset : FirstOffsetNumber;
+}
+
+/*
+ * Appearance count above which a k-mer is high-frequency
+ * The smaller of the rate-based and the nrow-based limit (0 = no limit).
+ */
+static uint64
+kmersearch_appearance_threshold(int64 total_rows)
+{
+    uint64 rate_based_threshold = (uint64)(total_rows * kmersearch_max_appearance_rate);
+
+    if (kmersearch_max_appearance_nrow > 0 &&
+        (uint64)kmersearch_max_appearance_nrow < rate_based_threshold)
+        return (uint64)kmersearch_max_appearance_nrow;
 
-    {
-        Relation rel;
-        TupleDesc tupdesc;
-        Form_pg_attribute attr;
-        Oid column_type_oid;
+    return rate_based_threshold;
+}
 
-        rel = table_open(shared_state->table_oid, AccessShareLock);
-        tupdesc = RelationGetDescr(rel);
-        attr = TupleDescAttr(tupdesc, shared_state->column_attnum - 1);
-        column_type_oid = attr->atttypid;
-        table_close(rel, AccessShareLock);
+/*
+ * Sample count above which a k-mer is high-frequency
+ * A k-mer seen in x of n sampled rows qualifies when the lower Wilson score
+ * bound of its appearance rate at kmersearch.highfreq_analysis_sample_confidence
+ * exceeds threshold_rate.  The bound grows with x, so the smallest such x
+ * is found by bisection.  Returns sampled_rows when no count qualifies.
+ * Rows of one block are taken as independent, which they need not be.
+ */
+static uint64
+kmersearch_sampled_threshold(uint64 sampled_rows, double threshold_rate)
+{
+    double z;
+    double z_low = 0.0;
+    double z_high = 10.0;
+    uint64 low = 0;
+    uint64 high = sampled_rows;
 
-        if (column_type_oid != ctx.dna2_oid && column_type_oid != ctx.dna4_oid)
-        {
-            elog(ERROR, "Column must be DNA2 or DNA4 type");
-        }
+    if (sampled_rows == 0)
+        return 0;
 
-        ctx.column_type_oid = column_type_oid;
+    /* One-sided normal quantile of the confidence level */
+    for (int i = 0; i < 64; i++)
+    {
+        z = (z_low + z_high) / 2.0;
+        if (0.5 * erfc(-z / sqrt(2.0)) < kmersearch_highfreq_analysis_sample_confidence)
+            z_low = z;
+        else
+            z_high = z;
     }
+    z = z_high;
 
-    /* Create temporary file for file hash table */
-    snprintf(ctx.file_path, MAXPGPATH, "%s/pg_kmersearch_XXXXXX",
-             shared_state->temp_dir_path);
+    if (kmersearch_wilson_lower_bound(sampled_rows, sampled_rows, z) <= threshold_rate)
+        return sampled_rows;
 
-    fd = mkstemp(ctx.file_path);
-    if (fd < 0)
+    /* Smallest count in (low, high] whose lower bound exceeds the rate */
+    while (high - low > 1)
     {
-        ereport(ERROR,
-                (errcode_for_file_access(),
-                 errmsg("could not create temporary file \"%s\": %m", ctx.file_path)));
-    }
-    close(fd);
-    unlink(ctx.file_path);
+        uint64 mid = low + (high - low) / 2;
 
-    /* Create file hash table based on total_bits */
-    if (ctx.total_bits <= 16)
-    {
-        ctx.fht_ctx = kmersearch_fht16_create(ctx.file_path);
+        if (kmersearch_wilson_lower_bound(mid, sampled_rows, z) > threshold_rate)
+            high = mid;
+        else
+            low = mid;
     }
-    else if (ctx.total_bits <= 32)
+
+    /* Counts above the returned value are high-frequency */
+    return high - 1;
+}
+
+/*
+ * Lower Wilson score bound of a binomial proportion
+ */
+static double
+kmersearch_wilson_lower_bound(uint64 count, uint64 nrows, double z)
+{
+    double n = (double) nrows;
+    double p = (double) count / n;
+    double z2 = z * z;
+
+    return (p + z2 / (2.0 * n) - z * sqrt(p * (1.0 - p) / n + z2 / (4.0 * n * n))) /
+           (1.0 + z2 / n);
+}
+
+/*
+ * Record one high-frequency k-mer (SPI must be connected)
+ */
+static void
+kmersearch_insert_highfreq_kmer(Oid table_oid, const char *column_name, int k_size,
+                                uint64 uintkey, uint64 appearance_nrow,
+                                const char *detection_reason)
+{
+    StringInfoData insert_query;
+    int insert_ret;
+
+    initStringInfo(&insert_query);
+    appendStringInfo(&insert_query,
+        "INSERT INTO kmersearch_highfreq_kmer "
+        "(table_oid, column_name, kmer_size, occur_bitlen, uintkey, appearance_nrow, detection_reason) "
+        "VALUES (%u, %s, %d, %d, %ld, %lu, %s) "
+        "ON CONFLICT (table_oid, column_name, kmer_size, occur_bitlen, uintkey) DO UPDATE SET "
+        "appearance_nrow = EXCLUDED.appearance_nrow, detection_reason = EXCLUDED.detection_reason",
+        table_oid, quote_literal_cstr(column_name), k_size, kmersearch_occur_bitlen,
+        (int64)uintkey, (unsigned long)appearance_nrow, quote_literal_cstr(detection_reason));
+
+    insert_ret = SPI_exec(insert_query.data, 0);
+    if (insert_ret != SPI_OK_INSERT && insert_ret != SPI_OK_UPDATE)
+        elog(WARNING, "Failed to insert high-frequency k-mer");
+    pfree(insert_query.data);
+}
+
+/*
+ * Approximate analysis in a parallel worker
+ * The counting phase feeds a Space-Saving summary with a fixed number of
+ * counters and merges it into the shared summary.  The verification phase
+ * counts the shared candidates exactly.
+ */
+static void
+kmersearch_analysis_worker_approximate(shm_toc *toc,
+                                       KmerAnalysisSharedState *shared_state,
+                                       FileHashWorkerContext *fctx)
+{
+    KmerApproxWorkerContext ctx;
+    BlockNumber *sampled_blocks;
+    BlockNumber block;
+    Oid relid;
+
+    memset(&ctx, 0, sizeof(ctx));
+    sampled_blocks = (BlockNumber *) shm_toc_lookup(toc, KMERSEARCH_KEY_SAMPLED_BLOCKS, true);
+    ctx.total_bits = fctx->total_bits;
+    ctx.dna2_oid = fctx->dna2_oid;
+    ctx.column_type_oid = fctx->column_type_oid;
+    ctx.strategy = fctx->strategy;
+    ctx.summary = (KmerHeavyHitterEntry *) shm_toc_lookup(toc, KMERSEARCH_KEY_SUMMARY, false);
+    ctx.row_context = AllocSetContextCreate(CurrentMemoryContext,
+                                            "KmerApproxRowContext",
+                                            ALLOCSET_DEFAULT_SIZES);
+
+    if (shared_state->verify_phase)
     {
-        ctx.fht_ctx = kmersearch_fht32_create(ctx.file_path, 0);
+        ctx.candidate_counts = palloc0(sizeof(uint64) * Max(shared_state->summary_count, 1));
     }
     else
     {
-        ctx.fht_ctx = kmersearch_fht64_create(ctx.file_path, 0);
-    }
+        HASHCTL hashctl;
 
-    ctx.batch_memory_context = AllocSetContextCreate(CurrentMemoryContext,
-                                                     "KmerBatchMemoryContext",
-                                                     ALLOCSET_DEFAULT_SIZES);
+        memset(&hashctl, 0, sizeof(hashctl));
+        hashctl.keysize = sizeof(uint64);
+        hashctl.entrysize = sizeof(KmerSpaceSavingEntry);
+        hashctl.hcxt = CurrentMemoryContext;
 
-    ctx.memory_limit_per_worker = (Size)maintenance_work_mem * 1024L / Max(max_parallel_maintenance_workers, 1);
-    if (ctx.memory_limit_per_worker < 64 * 1024)
-        ctx.memory_limit_per_worker = 64 * 1024;
+        ctx.local.capacity = shared_state->summary_capacity;
+        ctx.local.hash = hash_create("KmerSpaceSavingHash", ctx.local.capacity,
+                                     &hashctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+        ctx.local.heap = palloc(sizeof(KmerSpaceSavingEntry *) * ctx.local.capacity);
+    }
 
-    if (ctx.total_bits <= 16)
+    while (kmersearch_next_analysis_block(shared_state, sampled_blocks, &block, &relid))
+        kmersearch_process_block_approximate(block, relid, shared_state, &ctx);
+
+    if (shared_state->verify_phase)
     {
-        ctx.fht16_memory_array = (uint64 *) palloc0(65536 * sizeof(uint64));
+        LWLockAcquire(&shared_state->summary_lock.lock, LW_EXCLUSIVE);
+        for (int i = 0; i < shared_state->summary_count; i++)
+            ctx.summary[i].count += ctx.candidate_counts[i];
+        LWLockRelease(&shared_state->summary_lock.lock);
     }
     else
     {
-        ctx.fht16_memory_array = NULL;
+        kmersearch_space_saving_merge(&ctx.local, shared_state, ctx.summary);
     }
 
+    MemoryContextDelete(ctx.row_context);
+    if (ctx.strategy)
+        FreeAccessStrategy(ctx.strategy);
+}
+
+/*
+ * Feed the k-mers of one block to the summary or the candidate counts
+ */
+static void
+kmersearch_process_block_approximate(BlockNumber block, Oid relid,
+                                     KmerAnalysisSharedState *shared_state,
+                                     KmerApproxWorkerContext *ctx)
+{
+    Relation rel;
+    TupleDesc tupdesc;
+    Buffer buffer;
+    Page page;
+    OffsetNumber maxoff;
+    uint64 visible_rows = 0;
+
+    rel = table_open(relid, AccessShareLock);
+    tupdesc = RelationGetDescr(rel);
+
+    buffer = ReadBufferExtended(rel, MAIN_FORKNUM, block, RBM_NORMAL, ctx->strategy);
+    LockBuffer(buffer, BUFFER_LOCK_SHARE);
+    page = BufferGetPage(buffer);
+    maxoff = PageGetMaxOffsetNumber(page);
+
+    for (OffsetNumber offnum = FirstOffsetNumber;
+         offnum <= maxoff;
+         offnum = OffsetNumberNext(offnum))
     {
-        int shared_buffers_kb = NBuffers * (BLCKSZ / 1024);
-        int ring_size_kb;
-        int num_workers = Max(max_parallel_maintenance_workers, 1);
+        ItemId itemid = PageGetItemId(page, offnum);
+        HeapTupleData tuple;
+        MemoryContext old_context;
+        Datum datum;
+        bool isnull;
+        void *kmer_array = NULL;
+        int kmer_count = 0;
 
-        ring_size_kb = shared_buffers_kb / (num_workers * 4);
+        if (!ItemIdIsNormal(itemid))
+            continue;
 
-        if (ring_size_kb < 256)
-            ring_size_kb = 256;
-        if (ring_size_kb > 256 * 1024)
-            ring_size_kb = 256 * 1024;
+        memset(&tuple, 0, sizeof(HeapTupleData));
+        tuple.t_data = (HeapTupleHeader) PageGetItem(page, itemid);
+        tuple.t_len = ItemIdGetLength(itemid);
+        tuple.t_tableOid = relid;
+        ItemPointerSet(&tuple.t_self, block, offnum);
 
-        if (shared_buffers_kb < ring_size_kb * num_workers * 2)
-        {
-            elog(DEBUG2, "Worker using normal buffer access: shared_buffers=%d KB < ring_requirement=%d KB",
-                 shared_buffers_kb, ring_size_kb * num_workers * 2);
-            ctx.strategy = NULL;
-        }
-        else
+        if (!HeapTupleSatisfiesVisibility(&tuple, GetActiveSnapshot(), buffer))
+            continue;
+        visible_rows++;
+
+        old_context = MemoryContextSwitchTo(ctx->row_context);
+
+        datum = heap_getattr(&tuple, shared_state->column_attnum, tupdesc, &isnull);
+        if (!isnull)
         {
-            elog(DEBUG2, "Worker using ring buffer strategy: size=%d KB, shared_buffers=%d KB",
-                 ring_size_kb, shared_buffers_kb);
-            ctx.strategy = GetAccessStrategyWithSize(BAS_BULKREAD, ring_size_kb);
-        }
-    }
+            VarBit *seq = DatumGetVarBitP(datum);
 
-    /* Dynamic work acquisition loop */
-    {
-        int blocks_processed = 0;
+            if (ctx->column_type_oid == ctx->dna2_oid)
+                kmersearch_extract_uintkey_from_dna2(seq, &kmer_array, &kmer_count, false);
+            else
+                kmersearch_extract_uintkey_from_dna4(seq, &kmer_array, &kmer_count, false);
+        }
 
-        while (has_work)
+        for (int i = 0; i < kmer_count; i++)
         {
-            BlockNumber current_block;
-            bool got_block = false;
+            uint64 uintkey;
 
-            if (shared_state->is_partitioned)
-            {
-                BlockNumber global_block;
+            if (ctx->total_bits <= 16)
+                uintkey = ((uint16 *) kmer_array)[i];
+            else if (ctx->total_bits <= 32)
+                uintkey = ((uint32 *) kmer_array)[i];
+            else
+                uintkey = ((uint64 *) kmer_array)[i];
 
-                global_block = pg_atomic_fetch_add_u32(&shared_state->next_global_block, 1);
+            if (shared_state->verify_phase)
+            {
+                /* Candidates are sorted by uintkey */
+                int lo = 0;
+                int hi = shared_state->summary_count - 1;
 
-                if (global_block < shared_state->total_blocks_all_partitions)
+                while (lo <= hi)
                 {
-                    PartitionBlockMapping mapping = kmersearch_map_global_to_partition_block(
-                        global_block, shared_state);
-
-                    kmersearch_process_block_with_batch(mapping.local_block_number,
-                                                       mapping.partition_oid,
-                                                       shared_state, &ctx);
-                    blocks_processed++;
-                    got_block = true;
+                    int mid = lo + (hi - lo) / 2;
+
+                    if (ctx->summary[mid].uintkey == uintkey)
+                    {
+                        ctx->candidate_counts[mid]++;
+                        break;
+                    }
+                    if (ctx->summary[mid].uintkey < uintkey)
+                        lo = mid + 1;
+                    else
+                        hi = mid - 1;
                 }
             }
             else
             {
-                LWLockAcquire(&shared_state->mutex.lock, LW_EXCLUSIVE);
-
-                if (shared_state->next_block < shared_state->total_blocks)
-                {
-                    current_block = shared_state->next_block;
-                    shared_state->next_block++;
-                    LWLockRelease(&shared_state->mutex.lock);
-
-                    kmersearch_process_block_with_batch(current_block,
-                                                       shared_state->table_oid,
-                                                       shared_state, &ctx);
-                    blocks_processed++;
-                    got_block = true;
-                }
-                else
-                {
-                    shared_state->all_processed = true;
-                    LWLockRelease(&shared_state->mutex.lock);
-                }
+                kmersearch_space_saving_add(&ctx->local, uintkey);
             }
+        }
+
+        MemoryContextSwitchTo(old_context);
+        MemoryContextReset(ctx->row_context);
+    }
 
-            if (!got_block)
-                has_work = false;
+    UnlockReleaseBuffer(buffer);
+    table_close(rel, AccessShareLock);
+
+    if (!shared_state->verify_phase)
+        pg_atomic_fetch_add_u64(&shared_state->visible_rows_scanned, visible_rows);
+}
+
+/*
+ * Count one k-mer in a Space-Saving summary
+ * When all counters are taken, the k-mer replaces the least counted one and
+ * inherits its count, so every count stays an upper bound.
+ */
+static void
+kmersearch_space_saving_add(KmerSpaceSavingSummary *summary, uint64 uintkey)
+{
+    KmerSpaceSavingEntry **heap = summary->heap;
+    KmerSpaceSavingEntry *entry;
+    bool found;
+    int i;
+
+    entry = (KmerSpaceSavingEntry *) hash_search(summary->hash, &uintkey, HASH_FIND, NULL);
+    if (entry == NULL && summary->nentries < summary->capacity)
+    {
+        /* Free counter: the new count of 1 is the smallest, sift up */
+        entry = (KmerSpaceSavingEntry *) hash_search(summary->hash, &uintkey, HASH_ENTER, &found);
+        entry->count = 1;
+        i = summary->nentries++;
+        while (i > 0 && heap[(i - 1) / 2]->count > entry->count)
+        {
+            heap[i] = heap[(i - 1) / 2];
+            heap[i]->heap_index = i;
+            i = (i - 1) / 2;
         }
+        heap[i] = entry;
+        entry->heap_index = i;
+        return;
     }
 
-    /* Flush any remaining batch data */
-    if (ctx.batch_hash && ctx.batch_count > 0)
+    if (entry == NULL)
     {
-        uint64 total_rows;
-        uint64 batch_num;
+        uint64 min_count = heap[0]->count;
 
-        kmersearch_flush_batch_to_fht(&ctx);
+        hash_search(summary->hash, &heap[0]->uintkey, HASH_REMOVE, NULL);
+        entry = (KmerSpaceSavingEntry *) hash_search(summary->hash, &uintkey, HASH_ENTER, &found);
+        entry->count = min_count;
+        entry->heap_index = 0;
+        heap[0] = entry;
+    }
 
-        total_rows = pg_atomic_add_fetch_u64(&shared_state->total_rows_processed, ctx.batch_count);
-        batch_num = pg_atomic_add_fetch_u64(&shared_state->total_batches_committed, 1);
+    /* The count grew, sift down */
+    entry->count++;
+    i = entry->heap_index;
+    for (;;)
+    {
+        int child = 2 * i + 1;
+
+        if (child >= summary->nentries)
+            break;
+        if (child + 1 < summary->nentries && heap[child + 1]->count < heap[child]->count)
+            child++;
+        if (heap[child]->count >= entry->count)
+            break;
+        heap[i] = heap[child];
+        heap[i]->heap_index = i;
+        i = child;
+    }
+    heap[i] = entry;
+    entry->heap_index = i;
+}
 
-        ereport(INFO,
-                (errmsg("Batch %lu completed: %lu / %lu rows processed of column %s in table %s (final)",
-                        (unsigned long)batch_num, (unsigned long)total_rows,
-                        (unsigned long)shared_state->total_rows,
-                        shared_state->column_name, shared_state->table_name)));
-    }
+static int
+kmersearch_heavy_hitter_cmp_key(const void *a, const void *b)
+{
+    uint64 ka = ((const KmerHeavyHitterEntry *) a)->uintkey;
+    uint64 kb = ((const KmerHeavyHitterEntry *) b)->uintkey;
 
-    if (ctx.batch_hash)
+    return (ka > kb) - (ka < kb);
+}
+
+static int
+kmersearch_heavy_hitter_cmp_count_desc(const void *a, const void *b)
+{
+    uint64 ca = ((const KmerHeavyHitterEntry *) a)->count;
+    uint64 cb = ((const KmerHeavyHitterEntry *) b)->count;
+
+    return (ca < cb) - (ca > cb);
+}
+
+/*
+ * Merge a worker summary into the shared summary
+ * A k-mer missing from one side is bounded by that side's absent bound.
+ * When the union exceeds the capacity, the largest dropped count becomes
+ * part of the absent bound of the result.
+ */
+static void
+kmersearch_space_saving_merge(KmerSpaceSavingSummary *summary,
+                              KmerAnalysisSharedState *shared_state,
+                              KmerHeavyHitterEntry *shared_summary)
+{
+    KmerHeavyHitterEntry *local;
+    KmerHeavyHitterEntry *merged;
+    uint64 local_absent;
+    uint64 shared_absent;
+    int nmerged = 0;
+    int li = 0;
+    int si = 0;
+
+    /* A summary with free counters has seen every k-mer it did not keep 0 times */
+    local_absent = (summary->nentries == summary->capacity) ? summary->heap[0]->count : 0;
+
+    local = palloc(sizeof(KmerHeavyHitterEntry) * Max(summary->nentries, 1));
+    for (int i = 0; i < summary->nentries; i++)
     {
-        hash_destroy(ctx.batch_hash);
-        ctx.batch_hash = NULL;
+        local[i].uintkey = summary->heap[i]->uintkey;
+        local[i].count = summary->heap[i]->count;
     }
+    qsort(local, summary->nentries, sizeof(KmerHeavyHitterEntry), kmersearch_heavy_hitter_cmp_key);
 
-    /* Close file hash table */
-    if (ctx.fht_ctx)
+    LWLockAcquire(&shared_state->summary_lock.lock, LW_EXCLUSIVE);
+
+    shared_absent = shared_state->summary_absent_bound;
+    merged = palloc(sizeof(KmerHeavyHitterEntry) *
+                    Max(summary->nentries + shared_state->summary_count, 1));
+
+    while (li < summary->nentries || si < shared_state->summary_count)
     {
-        if (ctx.total_bits <= 16)
+        if (si >= shared_state->summary_count ||
+            (li < summary->nentries && local[li].uintkey < shared_summary[si].uintkey))
         {
-            kmersearch_fht16_close((FileHashTable16Context *)ctx.fht_ctx);
+            merged[nmerged].uintkey = local[li].uintkey;
+            merged[nmerged].count = local[li].count + shared_absent;
+            li++;
         }
-        else if (ctx.total_bits <= 32)
+        else if (li >= summary->nentries || shared_summary[si].uintkey < local[li].uintkey)
         {
-            kmersearch_fht32_close((FileHashTable32Context *)ctx.fht_ctx);
+            merged[nmerged].uintkey = shared_summary[si].uintkey;
+            merged[nmerged].count = shared_summary[si].count + local_absent;
+            si++;
         }
         else
         {
-            kmersearch_fht64_close((FileHashTable64Context *)ctx.fht_ctx);
+            merged[nmerged].uintkey = local[li].uintkey;
+            merged[nmerged].count = local[li].count + shared_summary[si].count;
+            li++;
+            si++;
         }
-        ctx.fht_ctx = NULL;
+        nmerged++;
     }
 
-    if (ctx.batch_memory_context)
+    shared_absent += local_absent;
+    if (nmerged > shared_state->summary_capacity)
     {
-        MemoryContextDelete(ctx.batch_memory_context);
-        ctx.batch_memory_context = NULL;
+        qsort(merged, nmerged, sizeof(KmerHeavyHitterEntry), kmersearch_heavy_hitter_cmp_count_desc);
+        shared_absent = Max(shared_absent, merged[shared_state->summary_capacity].count);
+        nmerged = shared_state->summary_capacity;
+        qsort(merged, nmerged, sizeof(KmerHeavyHitterEntry), kmersearch_heavy_hitter_cmp_key);
     }
 
-    if (ctx.strategy)
+    memcpy(shared_summary, merged, sizeof(KmerHeavyHitterEntry) * nmerged);
+    shared_state->summary_count = nmerged;
+    shared_state->summary_absent_bound = shared_absent;
+    shared_state->summaries_merged++;
+
+    LWLockRelease(&shared_state->summary_lock.lock);
+
+    pfree(merged);
+    pfree(local);
+}
+
+/*
+ * Turn the merged summary into high-frequency k-mers
+ * Candidates are the k-mers whose upper bound exceeds the threshold.  With
+ * verification the workers scan the table once more and count only the
+ * candidates.  Returns the k-mers above the threshold in a palloc'd array.
+ */
+static KmerHeavyHitterEntry *
+kmersearch_resolve_heavy_hitters(ParallelContext *pcxt,
+                                 KmerAnalysisSharedState *shared_state,
+                                 KmerHeavyHitterEntry *summary,
+                                 uint64 threshold_rows,
+                                 int *nresults)
+{
+    KmerHeavyHitterEntry *results;
+    int ncandidates = 0;
+
+    if (shared_state->summaries_merged == 0)
+        ereport(ERROR,
+                (errmsg("No worker heavy-hitter summaries found")));
+
+    if (shared_state->summary_absent_bound > threshold_rows)
+        ereport(WARNING,
+                (errmsg("k-mers outside the heavy-hitter summary may appear in up to %lu rows, above the threshold of %lu rows",
+                        (unsigned long)shared_state->summary_absent_bound,
+                        (unsigned long)threshold_rows),
+                 errdetail("Such k-mers are not reported as high-frequency."),
+                 errhint("Increase kmersearch.highfreq_analysis_summary_size.")));
+
+    /* Keep the candidates in place; they stay sorted by uintkey */
+    for (int i = 0; i < shared_state->summary_count; i++)
     {
-        FreeAccessStrategy(ctx.strategy);
-        ctx.strategy = NULL;
+        if (summary[i].count > threshold_rows)
+            summary[ncandidates++] = summary[i];
     }
+    shared_state->summary_count = ncandidates;
 
-    /* Register temporary file path for parent process */
-    kmersearch_register_worker_temp_file(shared_state, ctx.file_path, worker_id);
-}/*
+    if (shared_state->analysis_mode == KMERSEARCH_ANALYSIS_APPROXIMATE_VERIFIED && ncandidates > 0)
+    {
+        ereport(INFO,
+                (errmsg("Verifying %d candidate high-frequency k-mers with a second scan",
+                        ncandidates)));
+
+        for (int i = 0; i < ncandidates; i++)
+            summary[i].count = 0;
+
+        shared_state->verify_phase = true;
+        shared_state->all_processed = false;
+        shared_state->next_block = 0;
+        pg_atomic_write_u32(&shared_state->next_global_block, 0);
+
+        ReinitializeParallelDSM(pcxt);
+        LaunchParallelWorkers(pcxt);
+
+        /* The leader does not scan; without workers every count would stay 0 */
+        if (pcxt->nworkers_launched == 0)
+            ereport(ERROR,
+                    (errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+                     errmsg("could not launch parallel workers to verify candidate high-frequency k-mers"),
+                     errhint("Retry when more background workers are available, or use kmersearch.highfreq_analysis_mode = approximate.")));
+
+        WaitForParallelWorkersToFinish(pcxt);
+
+        if (shared_state->worker_error_occurred)
+            elog(ERROR, "Parallel worker error: %s", shared_state->error_message);
+
+        ncandidates = 0;
+        for (int i = 0; i < shared_state->summary_count; i++)
+        {
+            if (summary[i].count > threshold_rows)
+                summary[ncandidates++] = summary[i];
+        }
+    }
+
+    results = palloc(sizeof(KmerHeavyHitterEntry) * Max(ncandidates, 1));
+    memcpy(results, summary, sizeof(KmerHeavyHitterEntry) * ncandidates);
+    *nresults = ncandidates;
+
+    return results;
+}
+
+/*
  * Map global block number to partition and local block
  */
 static PartitionBlockMapping
@@ -1476,7 +2811,8 @@ kmersearch_map_global_to_partition_block(BlockNumber global_block,
             global_block <= state->partition_blocks[i].end_block)
         {
             result.partition_oid = state->partition_blocks[i].partition_oid;
-            result.local_block_number = global_block - state->partition_blocks[i].start_block;
+            result.local_block_number = global_block - state->partition_blocks[i].start_block +
+                                        state->partition_blocks[i].local_start_block;
             return result;
         }
     }
@@ -1940,6 +3276,7 @@ kmersearch_flush_batch_to_fht(FileHashWorkerContext *ctx)
 static void
 kmersearch_process_block_with_batch(BlockNumber block,
                                    Oid table_oid,
+                                   OffsetNumber first_offset,
                                    KmerAnalysisSharedState *shared_state,
                                    FileHashWorkerContext *ctx)
 {
@@ -1949,6 +3286,7 @@ kmersearch_process_block_with_batch(BlockNumber block,
     Page page;
     OffsetNumber maxoff;
     bool batch_completed = false;
+    uint64 visible_rows = 0;
 
     /* Initialize batch hash if needed (start of new batch) */
     if (ctx->batch_hash == NULL)
@@ -2008,7 +3346,7 @@ kmersearch_process_block_with_batch(BlockNumber block,
     maxoff = PageGetMaxOffsetNumber(page);
     
     /* Process each tuple in the page */
-    for (OffsetNumber offnum = FirstOffsetNumber;
+    for (OffsetNumber offnum = first_offset;
          offnum <= maxoff;
          offnum = OffsetNumberNext(offnum))
     {
@@ -2032,6 +3370,7 @@ kmersearch_process_block_with_batch(BlockNumber block,
         /* MVCC visibility check: skip tuples not visible to current snapshot */
         if (!HeapTupleSatisfiesVisibility(&tuple, GetActiveSnapshot(), buffer))
             continue;
+        visible_rows++;
 
         /* Switch to batch memory context BEFORE getting data to ensure all allocations happen there */
         old_context = MemoryContextSwitchTo(ctx->batch_memory_context);
@@ -2050,7 +3389,7 @@ kmersearch_process_block_with_batch(BlockNumber block,
         if (ctx->column_type_oid == ctx->dna2_oid)
         {
             VarBit *seq = DatumGetVarBitP(datum);
-            kmersearch_extract_uintkey_from_dna2(seq, &kmer_array, &kmer_count);
+            kmersearch_extract_uintkey_from_dna2(seq, &kmer_array, &kmer_count, false);
             /* Free detoasted datum if it was copied */
             if ((Pointer)seq != DatumGetPointer(datum))
                 pfree(seq);
@@ -2058,7 +3397,7 @@ kmersearch_process_block_with_batch(BlockNumber block,
         else if (ctx->column_type_oid == ctx->dna4_oid)
         {
             VarBit *seq = DatumGetVarBitP(datum);
-            kmersearch_extract_uintkey_from_dna4(seq, &kmer_array, &kmer_count);
+            kmersearch_extract_uintkey_from_dna4(seq, &kmer_array, &kmer_count, false);
             /* Free detoasted datum if it was copied */
             if ((Pointer)seq != DatumGetPointer(datum))
                 pfree(seq);
@@ -2248,6 +3587,8 @@ kmersearch_process_block_with_batch(BlockNumber block,
 
     table_close(rel, AccessShareLock);
 
+    pg_atomic_fetch_add_u64(&shared_state->visible_rows_scanned, visible_rows);
+
     /* Clear main and TOAST table buffers after batch completion */
     if (batch_completed)
     {
@@ -5,6 +5,9 @@
  * - extract_value functions for DNA2 and DNA4 types
  * - extract_query function for query processing  
  * - consistent function for index consistency checking
+ * - triConsistent function for GIN fast scan
+ * - open syncmer sampling for the syncmer operator classes
+ * - canonical (strand-independent) k-mers for the canonical operator classes
  * - compare_partial function for partial key comparison
  * - Supporting utility functions for k-mer extraction and processing
  */
@@ -23,8 +26,30 @@ PG_FUNCTION_INFO_V1(kmersearch_extract_query_int8);
 PG_FUNCTION_INFO_V1(kmersearch_consistent_int2);
 PG_FUNCTION_INFO_V1(kmersearch_consistent_int4);
 PG_FUNCTION_INFO_V1(kmersearch_consistent_int8);
+PG_FUNCTION_INFO_V1(kmersearch_triconsistent_int2);
+PG_FUNCTION_INFO_V1(kmersearch_triconsistent_int4);
+PG_FUNCTION_INFO_V1(kmersearch_triconsistent_int8);
+PG_FUNCTION_INFO_V1(kmersearch_extract_value_syncmer_dna2_int2);
+PG_FUNCTION_INFO_V1(kmersearch_extract_value_syncmer_dna2_int4);
+PG_FUNCTION_INFO_V1(kmersearch_extract_value_syncmer_dna2_int8);
+PG_FUNCTION_INFO_V1(kmersearch_extract_value_syncmer_dna4_int2);
+PG_FUNCTION_INFO_V1(kmersearch_extract_value_syncmer_dna4_int4);
+PG_FUNCTION_INFO_V1(kmersearch_extract_value_syncmer_dna4_int8);
+PG_FUNCTION_INFO_V1(kmersearch_extract_query_syncmer_int2);
+PG_FUNCTION_INFO_V1(kmersearch_extract_query_syncmer_int4);
+PG_FUNCTION_INFO_V1(kmersearch_extract_query_syncmer_int8);
+PG_FUNCTION_INFO_V1(kmersearch_extract_value_canonical_dna2_int2);
+PG_FUNCTION_INFO_V1(kmersearch_extract_value_canonical_dna2_int4);
+PG_FUNCTION_INFO_V1(kmersearch_extract_value_canonical_dna2_int8);
+PG_FUNCTION_INFO_V1(kmersearch_extract_value_canonical_dna4_int2);
+PG_FUNCTION_INFO_V1(kmersearch_extract_value_canonical_dna4_int4);
+PG_FUNCTION_INFO_V1(kmersearch_extract_value_canonical_dna4_int8);
+PG_FUNCTION_INFO_V1(kmersearch_extract_query_canonical_int2);
+PG_FUNCTION_INFO_V1(kmersearch_extract_query_canonical_int4);
+PG_FUNCTION_INFO_V1(kmersearch_extract_query_canonical_int8);
 
 static void check_operator_class_compatibility(const char *opclass_type);
+static GinTernaryValue kmersearch_triconsistent_internal(GinTernaryValue *check, int32 nkeys, int actual_min_score);
 
 /*
  * Check operator class compatibility with current GUC settings
@@ -189,6 +214,7 @@ kmersearch_filter_datum_for_indexing(Datum *keys, int *nkeys, size_t key_size, i
     int filtered_count = 0;
     int i;
     bool has_highfreq = false;
+    KmerHighfreqFilter filter;
 
     if (!kmersearch_preclude_highfreq_kmer || keys == NULL || *nkeys == 0)
         return keys;
@@ -200,6 +226,8 @@ kmersearch_filter_datum_for_indexing(Datum *keys, int *nkeys, size_t key_size, i
             return keys;
     }
 
+    kmersearch_highfreq_filter_resolve(&filter, k_size);
+
     for (i = 0; i < *nkeys; i++)
     {
         uint64 uintkey_val;
@@ -211,7 +239,7 @@ kmersearch_filter_datum_for_indexing(Datum *keys, int *nkeys, size_t key_size, i
         else
             uintkey_val = (uint64)DatumGetInt64(keys[i]);
 
-        if (kmersearch_is_uintkey_highfreq(uintkey_val, k_size))
+        if (kmersearch_highfreq_filter_contains(&filter, uintkey_val))
         {
             has_highfreq = true;
             break;
@@ -234,7 +262,7 @@ kmersearch_filter_datum_for_indexing(Datum *keys, int *nkeys, size_t key_size, i
         else
             uintkey_val = (uint64)DatumGetInt64(keys[i]);
 
-        if (!kmersearch_is_uintkey_highfreq(uintkey_val, k_size))
+        if (!kmersearch_highfreq_filter_contains(&filter, uintkey_val))
             filtered_keys[filtered_count++] = keys[i];
     }
 
@@ -265,7 +293,7 @@ kmersearch_extract_value_dna2_int2(PG_FUNCTION_ARGS)
     check_operator_class_compatibility("int2");
 
     /* Extract and convert to Datum array in one step */
-    keys = kmersearch_extract_datum_from_dna2(dna, nkeys, sizeof(uint16));
+    keys = kmersearch_extract_datum_from_dna2(dna, nkeys, sizeof(uint16), false);
 
     if (keys == NULL || *nkeys == 0)
         PG_RETURN_POINTER(NULL);
@@ -289,7 +317,7 @@ kmersearch_extract_value_dna2_int4(PG_FUNCTION_ARGS)
     check_operator_class_compatibility("int4");
 
     /* Extract and convert to Datum array in one step */
-    keys = kmersearch_extract_datum_from_dna2(dna, nkeys, sizeof(uint32));
+    keys = kmersearch_extract_datum_from_dna2(dna, nkeys, sizeof(uint32), false);
 
     if (keys == NULL || *nkeys == 0)
         PG_RETURN_POINTER(NULL);
@@ -313,7 +341,7 @@ kmersearch_extract_value_dna2_int8(PG_FUNCTION_ARGS)
     check_operator_class_compatibility("int8");
 
     /* Extract and convert to Datum array in one step */
-    keys = kmersearch_extract_datum_from_dna2(dna, nkeys, sizeof(uint64));
+    keys = kmersearch_extract_datum_from_dna2(dna, nkeys, sizeof(uint64), false);
 
     if (keys == NULL || *nkeys == 0)
         PG_RETURN_POINTER(NULL);
@@ -340,7 +368,7 @@ kmersearch_extract_value_dna4_int2(PG_FUNCTION_ARGS)
     check_operator_class_compatibility("int2");
 
     /* Extract and convert to Datum array in one step */
-    keys = kmersearch_extract_datum_from_dna4(dna, nkeys, sizeof(uint16));
+    keys = kmersearch_extract_datum_from_dna4(dna, nkeys, sizeof(uint16), false);
 
     if (keys == NULL || *nkeys == 0)
         PG_RETURN_POINTER(NULL);
@@ -364,7 +392,7 @@ kmersearch_extract_value_dna4_int4(PG_FUNCTION_ARGS)
     check_operator_class_compatibility("int4");
 
     /* Extract and convert to Datum array in one step */
-    keys = kmersearch_extract_datum_from_dna4(dna, nkeys, sizeof(uint32));
+    keys = kmersearch_extract_datum_from_dna4(dna, nkeys, sizeof(uint32), false);
 
     if (keys == NULL || *nkeys == 0)
         PG_RETURN_POINTER(NULL);
@@ -388,7 +416,7 @@ kmersearch_extract_value_dna4_int8(PG_FUNCTION_ARGS)
     check_operator_class_compatibility("int8");
 
     /* Extract and convert to Datum array in one step */
-    keys = kmersearch_extract_datum_from_dna4(dna, nkeys, sizeof(uint64));
+    keys = kmersearch_extract_datum_from_dna4(dna, nkeys, sizeof(uint64), false);
 
     if (keys == NULL || *nkeys == 0)
         PG_RETURN_POINTER(NULL);
@@ -402,339 +430,765 @@ kmersearch_extract_value_dna4_int8(PG_FUNCTION_ARGS)
 }
 
 /*
- * Filter uintkey array and set actual_min_score in cache
- * This function filters out high-frequency k-mers and caches the actual_min_score
+ * Check that the syncmer s-mer length fits the current k-mer size
  */
-void *
-kmersearch_filter_uintkey_and_set_actual_min_score(void *uintkey, int *nkeys, 
-                                        const char *query_string, int k_size)
+static void
+kmersearch_check_syncmer_size(void)
 {
-    void *filtered_keys = NULL;
-    int original_nkeys = *nkeys;
-    int filtered_count = 0;
+    if (kmersearch_syncmer_size >= kmersearch_kmer_size)
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("kmersearch.syncmer_size must be smaller than kmersearch.kmer_size"),
+                 errdetail("Current syncmer_size=%d, kmer_size=%d",
+                          kmersearch_syncmer_size, kmersearch_kmer_size)));
+}
+
+/*
+ * Keep only the open syncmers of an extracted key array (in place) and
+ * drop high-frequency k-mers from the rest
+ */
+static Datum *
+kmersearch_sample_syncmer_datum(Datum *keys, int *nkeys, size_t key_size, int k_size)
+{
+    int sampled_count = 0;
     int i;
-    bool has_highfreq = false;
-    int total_bits;
-    
-    total_bits = k_size * 2 + kmersearch_occur_bitlen;
-    
-    if (!kmersearch_preclude_highfreq_kmer || uintkey == NULL || *nkeys == 0)
-    {
-        if (uintkey != NULL && *nkeys > 0)
-            kmersearch_get_cached_actual_min_score_uintkey(uintkey, *nkeys, k_size);
-        return uintkey;
-    }
-    
-    /* First pass: check if there are any high-frequency k-mers */
-    if (total_bits <= 16)
-    {
-        uint16 *keys = (uint16 *)uintkey;
-        for (i = 0; i < *nkeys; i++)
-        {
-            if (kmersearch_is_uintkey_highfreq((uint64)keys[i], k_size))
-            {
-                has_highfreq = true;
-                break;
-            }
-        }
-    }
-    else if (total_bits <= 32)
-    {
-        uint32 *keys = (uint32 *)uintkey;
-        for (i = 0; i < *nkeys; i++)
-        {
-            if (kmersearch_is_uintkey_highfreq((uint64)keys[i], k_size))
-            {
-                has_highfreq = true;
-                break;
-            }
-        }
-    }
-    else
-    {
-        uint64 *keys = (uint64 *)uintkey;
-        for (i = 0; i < *nkeys; i++)
-        {
-            if (kmersearch_is_uintkey_highfreq(keys[i], k_size))
-            {
-                has_highfreq = true;
-                break;
-            }
-        }
-    }
-    
-    /* If no high-frequency k-mers, return original array */
-    if (!has_highfreq)
-    {
-        kmersearch_get_cached_actual_min_score_uintkey(uintkey, *nkeys, k_size);
-        return uintkey;
-    }
-    
-    /* Allocate new array for filtered keys */
-    if (total_bits <= 16)
-    {
-        uint16 *original = (uint16 *)uintkey;
-        uint16 *filtered = (uint16 *)palloc(*nkeys * sizeof(uint16));
-        
-        for (i = 0; i < *nkeys; i++)
-        {
-            if (!kmersearch_is_uintkey_highfreq((uint64)original[i], k_size))
-                filtered[filtered_count++] = original[i];
-        }
-        
-        if (filtered_count > 0)
-        {
-            filtered_keys = repalloc(filtered, filtered_count * sizeof(uint16));
-        }
-        else
-        {
-            pfree(filtered);
-        }
-    }
-    else if (total_bits <= 32)
+
+    for (i = 0; i < *nkeys; i++)
     {
-        uint32 *original = (uint32 *)uintkey;
-        uint32 *filtered = (uint32 *)palloc(*nkeys * sizeof(uint32));
-        
-        for (i = 0; i < *nkeys; i++)
-        {
-            if (!kmersearch_is_uintkey_highfreq((uint64)original[i], k_size))
-                filtered[filtered_count++] = original[i];
-        }
-        
-        if (filtered_count > 0)
-        {
-            filtered_keys = repalloc(filtered, filtered_count * sizeof(uint32));
-        }
+        uint64 uintkey_val;
+
+        if (key_size == sizeof(uint16))
+            uintkey_val = (uint64)(uint16)DatumGetInt16(keys[i]);
+        else if (key_size == sizeof(uint32))
+            uintkey_val = (uint64)(uint32)DatumGetInt32(keys[i]);
         else
-        {
-            pfree(filtered);
-        }
+            uintkey_val = (uint64)DatumGetInt64(keys[i]);
+
+        if (kmersearch_kmer_is_open_syncmer(uintkey_val >> kmersearch_occur_bitlen,
+                                            k_size, kmersearch_syncmer_size))
+            keys[sampled_count++] = keys[i];
     }
-    else
+
+    *nkeys = sampled_count;
+    if (sampled_count == 0)
     {
-        uint64 *original = (uint64 *)uintkey;
-        uint64 *filtered = (uint64 *)palloc(*nkeys * sizeof(uint64));
-        
-        for (i = 0; i < *nkeys; i++)
-        {
-            if (!kmersearch_is_uintkey_highfreq(original[i], k_size))
-                filtered[filtered_count++] = original[i];
-        }
-        
-        if (filtered_count > 0)
-        {
-            filtered_keys = repalloc(filtered, filtered_count * sizeof(uint64));
-        }
-        else
-        {
-            pfree(filtered);
-        }
+        pfree(keys);
+        return NULL;
     }
-    
-    /* Cache actual_min_score - this will be retrieved in consistent function */
-    kmersearch_get_cached_actual_min_score_uintkey(filtered_keys ? filtered_keys : uintkey, 
-                                        filtered_keys ? filtered_count : *nkeys, k_size);
-    
-    *nkeys = filtered_count;
-    
-    return filtered_keys;
+
+    return kmersearch_filter_datum_for_indexing(keys, nkeys, key_size, k_size);
 }
 
 /*
- * Check if cache settings match current GUC settings
+ * Syncmer-sampling GIN extract_value functions
  */
-static bool
-kmersearch_is_global_cache_settings_valid(int k_size)
+Datum
+kmersearch_extract_value_syncmer_dna2_int2(PG_FUNCTION_ARGS)
 {
-    if (!global_highfreq_cache.is_valid)
-        return false;
+    VarBit *dna = PG_GETARG_VARBIT_P(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Datum *keys = NULL;
 
-    return (global_highfreq_cache.current_cache_key.kmer_size == k_size &&
-            global_highfreq_cache.current_cache_key.occur_bitlen == kmersearch_occur_bitlen);
-}
+    check_operator_class_compatibility("int2");
+    kmersearch_check_syncmer_size();
 
-static bool
-kmersearch_is_parallel_cache_settings_valid(int k_size)
-{
-    if (!parallel_highfreq_cache || !parallel_highfreq_cache->is_initialized)
-        return false;
+    keys = kmersearch_extract_datum_from_dna2(dna, nkeys, sizeof(uint16), false);
 
-    return (parallel_highfreq_cache->cache_key.kmer_size == k_size &&
-            parallel_highfreq_cache->cache_key.occur_bitlen == kmersearch_occur_bitlen);
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    keys = kmersearch_sample_syncmer_datum(keys, nkeys, sizeof(uint16), kmersearch_kmer_size);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    PG_RETURN_POINTER(keys);
 }
 
-/*
- * Check if a uintkey is high-frequency
- */
-bool
-kmersearch_is_uintkey_highfreq(uint64 uintkey, int k_size)
+Datum
+kmersearch_extract_value_syncmer_dna2_int4(PG_FUNCTION_ARGS)
 {
-    /* Extract just the k-mer portion (remove occurrence bits) */
-    uint64 kmer_only;
-    bool is_highfreq = false;
-    int ret;
-    int total_bits;
+    VarBit *dna = PG_GETARG_VARBIT_P(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Datum *keys = NULL;
 
-    total_bits = k_size * 2 + kmersearch_occur_bitlen;
+    check_operator_class_compatibility("int4");
+    kmersearch_check_syncmer_size();
 
-    /* For uintkey format, k-mer is in higher bits, occurrence in lower bits */
-    kmer_only = uintkey >> kmersearch_occur_bitlen;
+    keys = kmersearch_extract_datum_from_dna2(dna, nkeys, sizeof(uint32), false);
 
-    if (kmersearch_force_use_parallel_highfreq_kmer_cache)
-    {
-        /* When force_use_parallel_highfreq_kmer_cache is true, skip global cache */
-        if (kmersearch_is_parallel_highfreq_cache_loaded() &&
-            kmersearch_is_parallel_cache_settings_valid(k_size)) {
-            return kmersearch_lookup_uintkey_in_parallel_cache(kmer_only, NULL, NULL);
-        }
-    }
-    else
-    {
-        /* Priority 1: Check in global cache (highest priority) */
-        if (global_highfreq_cache.is_valid && global_highfreq_cache.highfreq_hash &&
-            kmersearch_is_global_cache_settings_valid(k_size)) {
-            return kmersearch_lookup_uintkey_in_global_cache(kmer_only, NULL, NULL);
-        }
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
 
-        /* Priority 2: Check in parallel cache */
-        if (kmersearch_is_parallel_highfreq_cache_loaded() &&
-            kmersearch_is_parallel_cache_settings_valid(k_size)) {
-            return kmersearch_lookup_uintkey_in_parallel_cache(kmer_only, NULL, NULL);
-        }
-    }
-    
-    /* Priority 3: Check kmersearch_highfreq_kmer table directly */
-    ret = SPI_connect();
-    if (ret == SPI_OK_CONNECT) {
-        StringInfoData query;
-
-        initStringInfo(&query);
-
-        /* Build query based on total_bits, filter by kmer_size and occur_bitlen */
-        if (total_bits <= 16) {
-            appendStringInfo(&query,
-                "SELECT 1 FROM kmersearch_highfreq_kmer "
-                "WHERE uintkey = %u AND kmer_size = %d AND occur_bitlen = %d "
-                "LIMIT 1",
-                (unsigned int)kmer_only, k_size, kmersearch_occur_bitlen);
-        } else if (total_bits <= 32) {
-            appendStringInfo(&query,
-                "SELECT 1 FROM kmersearch_highfreq_kmer "
-                "WHERE uintkey = %u AND kmer_size = %d AND occur_bitlen = %d "
-                "LIMIT 1",
-                (unsigned int)kmer_only, k_size, kmersearch_occur_bitlen);
-        } else {
-            appendStringInfo(&query,
-                "SELECT 1 FROM kmersearch_highfreq_kmer "
-                "WHERE uintkey = %lu AND kmer_size = %d AND occur_bitlen = %d "
-                "LIMIT 1",
-                kmer_only, k_size, kmersearch_occur_bitlen);
-        }
+    keys = kmersearch_sample_syncmer_datum(keys, nkeys, sizeof(uint32), kmersearch_kmer_size);
 
-        ret = SPI_execute(query.data, true, 1);
-        if (ret == SPI_OK_SELECT && SPI_processed > 0) {
-            is_highfreq = true;
-        }
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
 
-        pfree(query.data);
-        SPI_finish();
-    }
-    
-    return is_highfreq;
+    PG_RETURN_POINTER(keys);
 }
 
-/*
- * New uintkey-based GIN extract_query functions
- */
 Datum
-kmersearch_extract_query_int2(PG_FUNCTION_ARGS)
+kmersearch_extract_value_syncmer_dna2_int8(PG_FUNCTION_ARGS)
 {
-    Datum query = PG_GETARG_DATUM(0);
+    VarBit *dna = PG_GETARG_VARBIT_P(0);
     int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
-    StrategyNumber strategy = PG_GETARG_UINT16(2);
-    bool **pmatch = (bool **) PG_GETARG_POINTER(3);
-    Pointer **extra_data = (Pointer **) PG_GETARG_POINTER(4);
-    bool **nullFlags = (bool **) PG_GETARG_POINTER(5);
-    int32 *searchMode = (int32 *) PG_GETARG_POINTER(6);
-    
-    text *query_text = DatumGetTextP(query);
-    char *query_string = text_to_cstring(query_text);
     Datum *keys = NULL;
-    void *uintkey = NULL;
-    uint16 *uint16_keys;
-    int i;
-    
-    /* Use cached query-kmer extraction */
-    uintkey = kmersearch_get_cached_query_uintkey(query_string, kmersearch_kmer_size, nkeys);
-    
-    /* Filter high-frequency k-mers and cache actual_min_score */
-    if (uintkey != NULL && *nkeys > 0)
-    {
-        uintkey = kmersearch_filter_uintkey_and_set_actual_min_score(uintkey, nkeys, 
-                                                           query_string, kmersearch_kmer_size);
-    }
-    
-    if (uintkey == NULL || *nkeys == 0)
-    {
+
+    check_operator_class_compatibility("int8");
+    kmersearch_check_syncmer_size();
+
+    keys = kmersearch_extract_datum_from_dna2(dna, nkeys, sizeof(uint64), false);
+
+    if (keys == NULL || *nkeys == 0)
         PG_RETURN_POINTER(NULL);
-    }
-    
-    /* Convert to Datum array */
-    uint16_keys = (uint16 *)uintkey;
-    keys = (Datum *) palloc(*nkeys * sizeof(Datum));
-    for (i = 0; i < *nkeys; i++)
-    {
-        keys[i] = Int16GetDatum(uint16_keys[i]);
-    }
-    
-    *searchMode = GIN_SEARCH_MODE_DEFAULT;
+
+    keys = kmersearch_sample_syncmer_datum(keys, nkeys, sizeof(uint64), kmersearch_kmer_size);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
     PG_RETURN_POINTER(keys);
 }
 
 Datum
-kmersearch_extract_query_int4(PG_FUNCTION_ARGS)
+kmersearch_extract_value_syncmer_dna4_int2(PG_FUNCTION_ARGS)
 {
-    Datum query = PG_GETARG_DATUM(0);
+    VarBit *dna = PG_GETARG_VARBIT_P(0);
     int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
-    StrategyNumber strategy = PG_GETARG_UINT16(2);
-    bool **pmatch = (bool **) PG_GETARG_POINTER(3);
-    Pointer **extra_data = (Pointer **) PG_GETARG_POINTER(4);
-    bool **nullFlags = (bool **) PG_GETARG_POINTER(5);
-    int32 *searchMode = (int32 *) PG_GETARG_POINTER(6);
-    
-    text *query_text = DatumGetTextP(query);
-    char *query_string = text_to_cstring(query_text);
     Datum *keys = NULL;
-    void *uintkey = NULL;
-    uint32 *uint32_keys;
-    int i;
+
+    check_operator_class_compatibility("int2");
+    kmersearch_check_syncmer_size();
+
+    keys = kmersearch_extract_datum_from_dna4(dna, nkeys, sizeof(uint16), false);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    keys = kmersearch_sample_syncmer_datum(keys, nkeys, sizeof(uint16), kmersearch_kmer_size);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    PG_RETURN_POINTER(keys);
+}
+
+Datum
+kmersearch_extract_value_syncmer_dna4_int4(PG_FUNCTION_ARGS)
+{
+    VarBit *dna = PG_GETARG_VARBIT_P(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Datum *keys = NULL;
+
+    check_operator_class_compatibility("int4");
+    kmersearch_check_syncmer_size();
+
+    keys = kmersearch_extract_datum_from_dna4(dna, nkeys, sizeof(uint32), false);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    keys = kmersearch_sample_syncmer_datum(keys, nkeys, sizeof(uint32), kmersearch_kmer_size);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    PG_RETURN_POINTER(keys);
+}
+
+Datum
+kmersearch_extract_value_syncmer_dna4_int8(PG_FUNCTION_ARGS)
+{
+    VarBit *dna = PG_GETARG_VARBIT_P(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Datum *keys = NULL;
+
+    check_operator_class_compatibility("int8");
+    kmersearch_check_syncmer_size();
+
+    keys = kmersearch_extract_datum_from_dna4(dna, nkeys, sizeof(uint64), false);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    keys = kmersearch_sample_syncmer_datum(keys, nkeys, sizeof(uint64), kmersearch_kmer_size);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    PG_RETURN_POINTER(keys);
+}
+
+/*
+ * Canonical (strand-independent) GIN extract_value functions
+ */
+Datum
+kmersearch_extract_value_canonical_dna2_int2(PG_FUNCTION_ARGS)
+{
+    VarBit *dna = PG_GETARG_VARBIT_P(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Datum *keys = NULL;
+
+    /* Check operator class compatibility */
+    check_operator_class_compatibility("int2");
+
+    /* Extract min(k-mer, reverse complement) for every window */
+    keys = kmersearch_extract_datum_from_dna2(dna, nkeys, sizeof(uint16), true);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    keys = kmersearch_filter_datum_for_indexing(keys, nkeys, sizeof(uint16), kmersearch_kmer_size);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    PG_RETURN_POINTER(keys);
+}
+
+Datum
+kmersearch_extract_value_canonical_dna2_int4(PG_FUNCTION_ARGS)
+{
+    VarBit *dna = PG_GETARG_VARBIT_P(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Datum *keys = NULL;
+
+    /* Check operator class compatibility */
+    check_operator_class_compatibility("int4");
+
+    /* Extract min(k-mer, reverse complement) for every window */
+    keys = kmersearch_extract_datum_from_dna2(dna, nkeys, sizeof(uint32), true);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    keys = kmersearch_filter_datum_for_indexing(keys, nkeys, sizeof(uint32), kmersearch_kmer_size);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    PG_RETURN_POINTER(keys);
+}
+
+Datum
+kmersearch_extract_value_canonical_dna2_int8(PG_FUNCTION_ARGS)
+{
+    VarBit *dna = PG_GETARG_VARBIT_P(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Datum *keys = NULL;
+
+    /* Check operator class compatibility */
+    check_operator_class_compatibility("int8");
+
+    /* Extract min(k-mer, reverse complement) for every window */
+    keys = kmersearch_extract_datum_from_dna2(dna, nkeys, sizeof(uint64), true);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    keys = kmersearch_filter_datum_for_indexing(keys, nkeys, sizeof(uint64), kmersearch_kmer_size);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    PG_RETURN_POINTER(keys);
+}
+
+Datum
+kmersearch_extract_value_canonical_dna4_int2(PG_FUNCTION_ARGS)
+{
+    VarBit *dna = PG_GETARG_VARBIT_P(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Datum *keys = NULL;
+
+    /* Check operator class compatibility */
+    check_operator_class_compatibility("int2");
+
+    /* Extract min(k-mer, reverse complement) for every window */
+    keys = kmersearch_extract_datum_from_dna4(dna, nkeys, sizeof(uint16), true);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    keys = kmersearch_filter_datum_for_indexing(keys, nkeys, sizeof(uint16), kmersearch_kmer_size);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    PG_RETURN_POINTER(keys);
+}
+
+Datum
+kmersearch_extract_value_canonical_dna4_int4(PG_FUNCTION_ARGS)
+{
+    VarBit *dna = PG_GETARG_VARBIT_P(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Datum *keys = NULL;
+
+    /* Check operator class compatibility */
+    check_operator_class_compatibility("int4");
+
+    /* Extract min(k-mer, reverse complement) for every window */
+    keys = kmersearch_extract_datum_from_dna4(dna, nkeys, sizeof(uint32), true);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    keys = kmersearch_filter_datum_for_indexing(keys, nkeys, sizeof(uint32), kmersearch_kmer_size);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    PG_RETURN_POINTER(keys);
+}
+
+Datum
+kmersearch_extract_value_canonical_dna4_int8(PG_FUNCTION_ARGS)
+{
+    VarBit *dna = PG_GETARG_VARBIT_P(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Datum *keys = NULL;
+
+    /* Check operator class compatibility */
+    check_operator_class_compatibility("int8");
+
+    /* Extract min(k-mer, reverse complement) for every window */
+    keys = kmersearch_extract_datum_from_dna4(dna, nkeys, sizeof(uint64), true);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    keys = kmersearch_filter_datum_for_indexing(keys, nkeys, sizeof(uint64), kmersearch_kmer_size);
+
+    if (keys == NULL || *nkeys == 0)
+        PG_RETURN_POINTER(NULL);
+
+    PG_RETURN_POINTER(keys);
+}
+
+/*
+ * Filter uintkey array and set actual_min_score in cache
+ * This function filters out high-frequency k-mers and caches the actual_min_score,
+ * which is also returned through actual_min_score for the scan state
+ */
+void *
+kmersearch_filter_uintkey_and_set_actual_min_score(void *uintkey, int *nkeys, 
+                                        const char *query_string, int k_size,
+                                        int *actual_min_score)
+{
+    void *filtered_keys = NULL;
+    int original_nkeys = *nkeys;
+    int filtered_count = 0;
+    int i;
+    bool has_highfreq = false;
+    int total_bits;
+    KmerHighfreqFilter filter;
+    
+    total_bits = k_size * 2 + kmersearch_occur_bitlen;
+    *actual_min_score = 0;
+    
+    if (!kmersearch_preclude_highfreq_kmer || uintkey == NULL || *nkeys == 0)
+    {
+        if (uintkey != NULL && *nkeys > 0)
+            *actual_min_score = kmersearch_get_cached_actual_min_score_uintkey(uintkey, *nkeys, k_size);
+        return uintkey;
+    }
+    
+    kmersearch_highfreq_filter_resolve(&filter, k_size);
+    
+    /* First pass: check if there are any high-frequency k-mers */
+    if (total_bits <= 16)
+    {
+        uint16 *keys = (uint16 *)uintkey;
+        for (i = 0; i < *nkeys; i++)
+        {
+            if (kmersearch_highfreq_filter_contains(&filter, (uint64)keys[i]))
+            {
+                has_highfreq = true;
+                break;
+            }
+        }
+    }
+    else if (total_bits <= 32)
+    {
+        uint32 *keys = (uint32 *)uintkey;
+        for (i = 0; i < *nkeys; i++)
+        {
+            if (kmersearch_highfreq_filter_contains(&filter, (uint64)keys[i]))
+            {
+                has_highfreq = true;
+                break;
+            }
+        }
+    }
+    else
+    {
+        uint64 *keys = (uint64 *)uintkey;
+        for (i = 0; i < *nkeys; i++)
+        {
+            if (kmersearch_highfreq_filter_contains(&filter, keys[i]))
+            {
+                has_highfreq = true;
+                break;
+            }
+        }
+    }
+    
+    /* If no high-frequency k-mers, return original array */
+    if (!has_highfreq)
+    {
+        *actual_min_score = kmersearch_get_cached_actual_min_score_uintkey(uintkey, *nkeys, k_size);
+        return uintkey;
+    }
+    
+    /* Allocate new array for filtered keys */
+    if (total_bits <= 16)
+    {
+        uint16 *original = (uint16 *)uintkey;
+        uint16 *filtered = (uint16 *)palloc(*nkeys * sizeof(uint16));
+        
+        for (i = 0; i < *nkeys; i++)
+        {
+            if (!kmersearch_highfreq_filter_contains(&filter, (uint64)original[i]))
+                filtered[filtered_count++] = original[i];
+        }
+        
+        if (filtered_count > 0)
+        {
+            filtered_keys = repalloc(filtered, filtered_count * sizeof(uint16));
+        }
+        else
+        {
+            pfree(filtered);
+        }
+    }
+    else if (total_bits <= 32)
+    {
+        uint32 *original = (uint32 *)uintkey;
+        uint32 *filtered = (uint32 *)palloc(*nkeys * sizeof(uint32));
+        
+        for (i = 0; i < *nkeys; i++)
+        {
+            if (!kmersearch_highfreq_filter_contains(&filter, (uint64)original[i]))
+                filtered[filtered_count++] = original[i];
+        }
+        
+        if (filtered_count > 0)
+        {
+            filtered_keys = repalloc(filtered, filtered_count * sizeof(uint32));
+        }
+        else
+        {
+            pfree(filtered);
+        }
+    }
+    else
+    {
+        uint64 *original = (uint64 *)uintkey;
+        uint64 *filtered = (uint64 *)palloc(*nkeys * sizeof(uint64));
+        
+        for (i = 0; i < *nkeys; i++)
+        {
+            if (!kmersearch_highfreq_filter_contains(&filter, original[i]))
+                filtered[filtered_count++] = original[i];
+        }
+        
+        if (filtered_count > 0)
+        {
+            filtered_keys = repalloc(filtered, filtered_count * sizeof(uint64));
+        }
+        else
+        {
+            pfree(filtered);
+        }
+    }
+    
+    /* Cache actual_min_score - this will be retrieved in consistent function */
+    *actual_min_score = kmersearch_get_cached_actual_min_score_uintkey(filtered_keys ? filtered_keys : uintkey, 
+                                                          filtered_keys ? filtered_count : *nkeys, k_size);
+    
+    *nkeys = filtered_count;
+    
+    return filtered_keys;
+}
+
+/*
+ * Check if cache settings match current GUC settings
+ */
+static bool
+kmersearch_is_global_cache_settings_valid(int k_size)
+{
+    if (!global_highfreq_cache.is_valid)
+        return false;
+
+    return (global_highfreq_cache.current_cache_key.kmer_size == k_size &&
+            global_highfreq_cache.current_cache_key.occur_bitlen == kmersearch_occur_bitlen);
+}
+
+static bool
+kmersearch_is_parallel_cache_settings_valid(int k_size)
+{
+    if (!parallel_highfreq_cache || !parallel_highfreq_cache->is_initialized ||
+        kmersearch_is_parallel_highfreq_cache_stale())
+        return false;
+
+    return (parallel_highfreq_cache->cache_key.kmer_size == k_size &&
+            parallel_highfreq_cache->cache_key.occur_bitlen == kmersearch_occur_bitlen);
+}
+
+/*
+ * Resolve where high-frequency k-mer membership is answered from
+ * Resolve once per row or query and test keys with
+ * kmersearch_highfreq_filter_contains().  Without a loaded cache the
+ * kmersearch_highfreq_kmer table is read once per transaction.
+ */
+void
+kmersearch_highfreq_filter_resolve(KmerHighfreqFilter *filter, int k_size)
+{
+    memset(filter, 0, sizeof(KmerHighfreqFilter));
+    filter->k_size = k_size;
+    filter->occur_bitlen = kmersearch_occur_bitlen;
+    filter->kind = KMERSEARCH_HIGHFREQ_FILTER_NONE;
+
+    /* Parallel workers mirror the leader's caches on first use */
+    kmersearch_highfreq_cache_sync_worker();
+
+    /* Caches loaded before a committed analysis are refreshed or skipped */
+    kmersearch_highfreq_cache_check_generation();
+
+    if (kmersearch_force_use_parallel_highfreq_kmer_cache)
+    {
+        /* When force_use_parallel_highfreq_kmer_cache is true, skip global cache */
+        if (kmersearch_is_parallel_highfreq_cache_loaded() &&
+            kmersearch_is_parallel_cache_settings_valid(k_size))
+        {
+            filter->kind = KMERSEARCH_HIGHFREQ_FILTER_PARALLEL;
+            return;
+        }
+    }
+    else
+    {
+        /* Priority 1: Check in global cache (highest priority) */
+        if (global_highfreq_cache.is_valid &&
+            kmersearch_is_global_cache_settings_valid(k_size))
+        {
+            if (global_highfreq_cache.kmer_bitmap != NULL)
+            {
+                filter->kind = KMERSEARCH_HIGHFREQ_FILTER_BITMAP;
+                filter->bitmap = global_highfreq_cache.kmer_bitmap;
+                filter->bitmap_bits = UINT64CONST(1) << (2 * k_size);
+            }
+            else if (global_highfreq_cache.kmer_eytzinger != NULL)
+            {
+                filter->kind = KMERSEARCH_HIGHFREQ_FILTER_EYTZINGER;
+                filter->eytzinger = global_highfreq_cache.kmer_eytzinger;
+                filter->nkmers = global_highfreq_cache.highfreq_count;
+            }
+            return;
+        }
+
+        /* Priority 2: Check in parallel cache */
+        if (kmersearch_is_parallel_highfreq_cache_loaded() &&
+            kmersearch_is_parallel_cache_settings_valid(k_size))
+        {
+            filter->kind = KMERSEARCH_HIGHFREQ_FILTER_PARALLEL;
+            return;
+        }
+    }
+
+    /* Priority 3: Shared cache preloaded at server start */
+    if (kmersearch_shared_highfreq_filter_resolve(filter, k_size))
+        return;
+
+    /* Priority 4: Transient filter loaded from kmersearch_highfreq_kmer table */
+    kmersearch_table_highfreq_filter_resolve(filter, k_size);
+}
+
+/*
+ * Check if a uintkey is high-frequency
+ * Loops over many keys should resolve a filter once instead.
+ */
+bool
+kmersearch_is_uintkey_highfreq(uint64 uintkey, int k_size)
+{
+    KmerHighfreqFilter filter;
+
+    kmersearch_highfreq_filter_resolve(&filter, k_size);
+    return kmersearch_highfreq_filter_contains(&filter, uintkey);
+}
+
+/*
+ * Build the per-scan state handed to consistent through extra_data.
+ * GIN expects one pointer per key; every slot refers to the same state.
+ */
+static Pointer *
+kmersearch_build_scan_extra_data(int nkeys, int actual_min_score, bool recheck)
+{
+    KmerGinScanState *state;
+    Pointer *extra_data;
+    int i;
+    
+    state = (KmerGinScanState *) palloc0(sizeof(KmerGinScanState));
+    state->nkeys = nkeys;
+    state->actual_min_score = actual_min_score;
+    state->recheck = recheck;
+    
+    /* At least one slot, so a key-less ALL scan still reaches the state */
+    extra_data = (Pointer *) palloc(Max(nkeys, 1) * sizeof(Pointer));
+    for (i = 0; i < Max(nkeys, 1); i++)
+        extra_data[i] = (Pointer) state;
+    
+    return extra_data;
+}
+
+/*
+ * Sample the open syncmers of a query uintkey array into a new array
+ */
+static void *
+kmersearch_sample_syncmer_uintkey(void *uintkey, int *nkeys, int k_size)
+{
+    int total_bits = k_size * 2 + kmersearch_occur_bitlen;
+    int sampled_count = 0;
+    int i;
+    
+    if (total_bits <= 16)
+    {
+        uint16 *keys = (uint16 *) uintkey;
+        uint16 *sampled = (uint16 *) palloc(*nkeys * sizeof(uint16));
+        
+        for (i = 0; i < *nkeys; i++)
+        {
+            if (kmersearch_kmer_is_open_syncmer((uint64) keys[i] >> kmersearch_occur_bitlen,
+                                                k_size, kmersearch_syncmer_size))
+                sampled[sampled_count++] = keys[i];
+        }
+        *nkeys = sampled_count;
+        return sampled;
+    }
+    else if (total_bits <= 32)
+    {
+        uint32 *keys = (uint32 *) uintkey;
+        uint32 *sampled = (uint32 *) palloc(*nkeys * sizeof(uint32));
+        
+        for (i = 0; i < *nkeys; i++)
+        {
+            if (kmersearch_kmer_is_open_syncmer((uint64) keys[i] >> kmersearch_occur_bitlen,
+                                                k_size, kmersearch_syncmer_size))
+                sampled[sampled_count++] = keys[i];
+        }
+        *nkeys = sampled_count;
+        return sampled;
+    }
+    else
+    {
+        uint64 *keys = (uint64 *) uintkey;
+        uint64 *sampled = (uint64 *) palloc(*nkeys * sizeof(uint64));
+        
+        for (i = 0; i < *nkeys; i++)
+        {
+            if (kmersearch_kmer_is_open_syncmer(keys[i] >> kmersearch_occur_bitlen,
+                                                k_size, kmersearch_syncmer_size))
+                sampled[sampled_count++] = keys[i];
+        }
+        *nkeys = sampled_count;
+        return sampled;
+    }
+}
+
+/*
+ * Shared body of the extract_query functions.  With syncmer sampling only
+ * open syncmers are searched, actual_min_score is rescaled to the sampled
+ * key count and every candidate is rechecked against the heap tuple.
+ * With canonical set the query keys are strand-independent k-mers.
+ */
+static Datum *
+kmersearch_extract_query_internal(Datum query, int32 *nkeys, Pointer **extra_data,
+                                  int32 *searchMode, bool syncmer, bool canonical)
+{
+    text *query_text = DatumGetTextP(query);
+    char *query_string = text_to_cstring(query_text);
+    int total_bits = kmersearch_kmer_size * 2 + kmersearch_occur_bitlen;
+    Datum *keys = NULL;
+    void *uintkey = NULL;
+    int actual_min_score = 0;
+    int i;
+    
+    if (syncmer)
+        kmersearch_check_syncmer_size();
     
     /* Use cached query-kmer extraction */
-    uintkey = kmersearch_get_cached_query_uintkey(query_string, kmersearch_kmer_size, nkeys);
+    uintkey = kmersearch_get_cached_query_uintkey(query_string, kmersearch_kmer_size, canonical, nkeys);
     
     /* Filter high-frequency k-mers and cache actual_min_score */
     if (uintkey != NULL && *nkeys > 0)
     {
         uintkey = kmersearch_filter_uintkey_and_set_actual_min_score(uintkey, nkeys, 
-                                                           query_string, kmersearch_kmer_size);
+                                                           query_string, kmersearch_kmer_size,
+                                                           &actual_min_score);
     }
     
     if (uintkey == NULL || *nkeys == 0)
+        return NULL;
+    
+    if (syncmer)
     {
-        PG_RETURN_POINTER(NULL);
+        int full_nkeys = *nkeys;
+        
+        uintkey = kmersearch_sample_syncmer_uintkey(uintkey, nkeys, kmersearch_kmer_size);
+        
+        /* A query holding no syncmer cannot narrow the scan; recheck everything */
+        if (*nkeys == 0)
+        {
+            *extra_data = kmersearch_build_scan_extra_data(0, 0, true);
+            *searchMode = GIN_SEARCH_MODE_ALL;
+            return NULL;
+        }
+        
+        if (actual_min_score > 0)
+            actual_min_score = (int) ceil((double) actual_min_score * *nkeys / full_nkeys);
     }
     
     /* Convert to Datum array */
-    uint32_keys = (uint32 *)uintkey;
     keys = (Datum *) palloc(*nkeys * sizeof(Datum));
     for (i = 0; i < *nkeys; i++)
     {
-        keys[i] = Int32GetDatum(uint32_keys[i]);
+        if (total_bits <= 16)
+            keys[i] = Int16GetDatum(((uint16 *) uintkey)[i]);
+        else if (total_bits <= 32)
+            keys[i] = Int32GetDatum(((uint32 *) uintkey)[i]);
+        else
+            keys[i] = Int64GetDatum(((uint64 *) uintkey)[i]);
     }
     
+    *extra_data = kmersearch_build_scan_extra_data(*nkeys, actual_min_score, syncmer);
     *searchMode = GIN_SEARCH_MODE_DEFAULT;
-    PG_RETURN_POINTER(keys);
+    return keys;
+}
+
+/*
+ * New uintkey-based GIN extract_query functions
+ */
+Datum
+kmersearch_extract_query_int2(PG_FUNCTION_ARGS)
+{
+    Datum query = PG_GETARG_DATUM(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Pointer **extra_data = (Pointer **) PG_GETARG_POINTER(4);
+    int32 *searchMode = (int32 *) PG_GETARG_POINTER(6);
+    
+    PG_RETURN_POINTER(kmersearch_extract_query_internal(query, nkeys, extra_data, searchMode, false, false));
+}
+
+Datum
+kmersearch_extract_query_int4(PG_FUNCTION_ARGS)
+{
+    Datum query = PG_GETARG_DATUM(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Pointer **extra_data = (Pointer **) PG_GETARG_POINTER(4);
+    int32 *searchMode = (int32 *) PG_GETARG_POINTER(6);
+    
+    PG_RETURN_POINTER(kmersearch_extract_query_internal(query, nkeys, extra_data, searchMode, false, false));
 }
 
 Datum
@@ -742,44 +1196,122 @@ kmersearch_extract_query_int8(PG_FUNCTION_ARGS)
 {
     Datum query = PG_GETARG_DATUM(0);
     int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
-    StrategyNumber strategy = PG_GETARG_UINT16(2);
-    bool **pmatch = (bool **) PG_GETARG_POINTER(3);
     Pointer **extra_data = (Pointer **) PG_GETARG_POINTER(4);
-    bool **nullFlags = (bool **) PG_GETARG_POINTER(5);
     int32 *searchMode = (int32 *) PG_GETARG_POINTER(6);
     
-    text *query_text = DatumGetTextP(query);
-    char *query_string = text_to_cstring(query_text);
-    Datum *keys = NULL;
-    void *uintkey = NULL;
-    uint64 *uint64_keys;
-    int i;
+    PG_RETURN_POINTER(kmersearch_extract_query_internal(query, nkeys, extra_data, searchMode, false, false));
+}
+
+/*
+ * Syncmer-sampling GIN extract_query functions
+ */
+Datum
+kmersearch_extract_query_syncmer_int2(PG_FUNCTION_ARGS)
+{
+    Datum query = PG_GETARG_DATUM(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Pointer **extra_data = (Pointer **) PG_GETARG_POINTER(4);
+    int32 *searchMode = (int32 *) PG_GETARG_POINTER(6);
     
-    /* Use cached query-kmer extraction */
-    uintkey = kmersearch_get_cached_query_uintkey(query_string, kmersearch_kmer_size, nkeys);
+    PG_RETURN_POINTER(kmersearch_extract_query_internal(query, nkeys, extra_data, searchMode, true, false));
+}
+
+Datum
+kmersearch_extract_query_syncmer_int4(PG_FUNCTION_ARGS)
+{
+    Datum query = PG_GETARG_DATUM(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Pointer **extra_data = (Pointer **) PG_GETARG_POINTER(4);
+    int32 *searchMode = (int32 *) PG_GETARG_POINTER(6);
     
-    /* Filter high-frequency k-mers and cache actual_min_score */
-    if (uintkey != NULL && *nkeys > 0)
-    {
-        uintkey = kmersearch_filter_uintkey_and_set_actual_min_score(uintkey, nkeys, 
-                                                           query_string, kmersearch_kmer_size);
-    }
+    PG_RETURN_POINTER(kmersearch_extract_query_internal(query, nkeys, extra_data, searchMode, true, false));
+}
+
+Datum
+kmersearch_extract_query_syncmer_int8(PG_FUNCTION_ARGS)
+{
+    Datum query = PG_GETARG_DATUM(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Pointer **extra_data = (Pointer **) PG_GETARG_POINTER(4);
+    int32 *searchMode = (int32 *) PG_GETARG_POINTER(6);
     
-    if (uintkey == NULL || *nkeys == 0)
+    PG_RETURN_POINTER(kmersearch_extract_query_internal(query, nkeys, extra_data, searchMode, true, false));
+}
+
+/*
+ * Canonical (strand-independent) GIN extract_query functions
+ */
+Datum
+kmersearch_extract_query_canonical_int2(PG_FUNCTION_ARGS)
+{
+    Datum query = PG_GETARG_DATUM(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Pointer **extra_data = (Pointer **) PG_GETARG_POINTER(4);
+    int32 *searchMode = (int32 *) PG_GETARG_POINTER(6);
+    
+    PG_RETURN_POINTER(kmersearch_extract_query_internal(query, nkeys, extra_data, searchMode, false, true));
+}
+
+Datum
+kmersearch_extract_query_canonical_int4(PG_FUNCTION_ARGS)
+{
+    Datum query = PG_GETARG_DATUM(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Pointer **extra_data = (Pointer **) PG_GETARG_POINTER(4);
+    int32 *searchMode = (int32 *) PG_GETARG_POINTER(6);
+    
+    PG_RETURN_POINTER(kmersearch_extract_query_internal(query, nkeys, extra_data, searchMode, false, true));
+}
+
+Datum
+kmersearch_extract_query_canonical_int8(PG_FUNCTION_ARGS)
+{
+    Datum query = PG_GETARG_DATUM(0);
+    int32 *nkeys = (int32 *) PG_GETARG_POINTER(1);
+    Pointer **extra_data = (Pointer **) PG_GETARG_POINTER(4);
+    int32 *searchMode = (int32 *) PG_GETARG_POINTER(6);
+    
+    PG_RETURN_POINTER(kmersearch_extract_query_internal(query, nkeys, extra_data, searchMode, false, true));
+}
+
+/*
+ * Count query keys present in the current item
+ */
+static int
+kmersearch_count_checked_keys(bool *check, int32 nkeys)
+{
+    int shared_count = 0;
+    int i;
+    
+    for (i = 0; i < nkeys; i++)
     {
-        PG_RETURN_POINTER(NULL);
+        if (check[i])
+            shared_count++;
     }
     
-    /* Convert to Datum array */
-    uint64_keys = (uint64 *)uintkey;
-    keys = (Datum *) palloc(*nkeys * sizeof(Datum));
-    for (i = 0; i < *nkeys; i++)
+    return shared_count;
+}
+
+/*
+ * Decide an item against the per-scan state, stopping as soon as the
+ * shared count reaches actual_min_score
+ */
+static bool
+kmersearch_consistent_scan_state(KmerGinScanState *state, bool *check, int32 nkeys)
+{
+    int shared_count = 0;
+    int i;
+    
+    if (state->actual_min_score <= 0)
+        return true;
+    
+    for (i = 0; i < nkeys; i++)
     {
-        keys[i] = Int64GetDatum(uint64_keys[i]);
+        if (check[i] && ++shared_count >= state->actual_min_score)
+            return true;
     }
     
-    *searchMode = GIN_SEARCH_MODE_DEFAULT;
-    PG_RETURN_POINTER(keys);
+    return false;
 }
 
 /*
@@ -797,23 +1329,22 @@ kmersearch_consistent_int2(PG_FUNCTION_ARGS)
     Datum *queryKeys = (Datum *) PG_GETARG_POINTER(6);
     bool *nullFlags = (bool *) PG_GETARG_POINTER(7);
     
-    int shared_count = 0;
     int actual_min_score;
-    int i;
     
     *recheck = false;
     
-    /* Count matches */
-    for (i = 0; i < nkeys; i++)
+    if (extra_data != NULL)
     {
-        if (check[i])
-            shared_count++;
+        KmerGinScanState *state = (KmerGinScanState *) extra_data[0];
+        
+        *recheck = state->recheck;
+        PG_RETURN_BOOL(kmersearch_consistent_scan_state(state, check, nkeys));
     }
     
-    /* Get cached actual_min_score */
+    /* No scan state: fall back to the cached actual_min_score */
     actual_min_score = kmersearch_get_cached_actual_min_score_datum_int2(queryKeys, nkeys);
     
-    PG_RETURN_BOOL(shared_count >= actual_min_score);
+    PG_RETURN_BOOL(kmersearch_count_checked_keys(check, nkeys) >= actual_min_score);
 }
 
 Datum
@@ -828,23 +1359,22 @@ kmersearch_consistent_int4(PG_FUNCTION_ARGS)
     Datum *queryKeys = (Datum *) PG_GETARG_POINTER(6);
     bool *nullFlags = (bool *) PG_GETARG_POINTER(7);
     
-    int shared_count = 0;
     int actual_min_score;
-    int i;
     
     *recheck = false;
     
-    /* Count matches */
-    for (i = 0; i < nkeys; i++)
+    if (extra_data != NULL)
     {
-        if (check[i])
-            shared_count++;
+        KmerGinScanState *state = (KmerGinScanState *) extra_data[0];
+        
+        *recheck = state->recheck;
+        PG_RETURN_BOOL(kmersearch_consistent_scan_state(state, check, nkeys));
     }
     
-    /* Get cached actual_min_score */
+    /* No scan state: fall back to the cached actual_min_score */
     actual_min_score = kmersearch_get_cached_actual_min_score_datum_int4(queryKeys, nkeys);
     
-    PG_RETURN_BOOL(shared_count >= actual_min_score);
+    PG_RETURN_BOOL(kmersearch_count_checked_keys(check, nkeys) >= actual_min_score);
 }
 
 Datum
@@ -859,22 +1389,129 @@ kmersearch_consistent_int8(PG_FUNCTION_ARGS)
     Datum *queryKeys = (Datum *) PG_GETARG_POINTER(6);
     bool *nullFlags = (bool *) PG_GETARG_POINTER(7);
     
-    int shared_count = 0;
     int actual_min_score;
-    int i;
     
     *recheck = false;
     
-    /* Count matches */
-    for (i = 0; i < nkeys; i++)
+    if (extra_data != NULL)
     {
-        if (check[i])
-            shared_count++;
+        KmerGinScanState *state = (KmerGinScanState *) extra_data[0];
+        
+        *recheck = state->recheck;
+        PG_RETURN_BOOL(kmersearch_consistent_scan_state(state, check, nkeys));
     }
     
-    /* Get cached actual_min_score */
+    /* No scan state: fall back to the cached actual_min_score */
     actual_min_score = kmersearch_get_cached_actual_min_score_datum_int8(queryKeys, nkeys);
     
-    PG_RETURN_BOOL(shared_count >= actual_min_score);
+    PG_RETURN_BOOL(kmersearch_count_checked_keys(check, nkeys) >= actual_min_score);
+}
+
+/*
+ * GIN triConsistent functions
+ *
+ * TRUE entries are certain matches and MAYBE entries may or may not match.
+ * The item is rejected as soon as even all MAYBE entries together cannot
+ * lift the shared count to actual_min_score, which lets GIN skip loading
+ * posting data for the remaining keys.
+ *
+ * Query keys are passed to GIN in extraction order.  GIN's fast scan
+ * sorts a scan key's entries by posting-list size itself and asks this
+ * function which of the rarest entries are required.
+ */
+static GinTernaryValue
+kmersearch_triconsistent_internal(GinTernaryValue *check, int32 nkeys, int actual_min_score)
+{
+    int true_count = 0;
+    int maybe_count = 0;
+    int i;
+    
+    for (i = 0; i < nkeys; i++)
+    {
+        if (check[i] == GIN_TRUE)
+        {
+            if (++true_count >= actual_min_score)
+                return GIN_TRUE;
+        }
+        else if (check[i] == GIN_MAYBE)
+            maybe_count++;
+    }
+    
+    if (true_count >= actual_min_score)
+        return GIN_TRUE;
+    if (true_count + maybe_count < actual_min_score)
+        return GIN_FALSE;
+    return GIN_MAYBE;
+}
+
+Datum
+kmersearch_triconsistent_int2(PG_FUNCTION_ARGS)
+{
+    GinTernaryValue *check = (GinTernaryValue *) PG_GETARG_POINTER(0);
+    int32 nkeys = PG_GETARG_INT32(3);
+    Pointer *extra_data = (Pointer *) PG_GETARG_POINTER(4);
+    Datum *queryKeys = (Datum *) PG_GETARG_POINTER(5);
+    KmerGinScanState *state = extra_data ? (KmerGinScanState *) extra_data[0] : NULL;
+    GinTernaryValue result;
+    
+    /* Read actual_min_score from the scan state, or the cache without one */
+    if (state != NULL)
+        result = kmersearch_triconsistent_internal(check, nkeys, state->actual_min_score);
+    else
+        result = kmersearch_triconsistent_internal(check, nkeys,
+                                                   kmersearch_get_cached_actual_min_score_datum_int2(queryKeys, nkeys));
+    
+    /* Sampled keys are lossy, so a certain match still needs a recheck */
+    if (result == GIN_TRUE && state != NULL && state->recheck)
+        result = GIN_MAYBE;
+    
+    PG_RETURN_GIN_TERNARY_VALUE(result);
+}
+
+Datum
+kmersearch_triconsistent_int4(PG_FUNCTION_ARGS)
+{
+    GinTernaryValue *check = (GinTernaryValue *) PG_GETARG_POINTER(0);
+    int32 nkeys = PG_GETARG_INT32(3);
+    Pointer *extra_data = (Pointer *) PG_GETARG_POINTER(4);
+    Datum *queryKeys = (Datum *) PG_GETARG_POINTER(5);
+    KmerGinScanState *state = extra_data ? (KmerGinScanState *) extra_data[0] : NULL;
+    GinTernaryValue result;
+    
+    /* Read actual_min_score from the scan state, or the cache without one */
+    if (state != NULL)
+        result = kmersearch_triconsistent_internal(check, nkeys, state->actual_min_score);
+    else
+        result = kmersearch_triconsistent_internal(check, nkeys,
+                                                   kmersearch_get_cached_actual_min_score_datum_int4(queryKeys, nkeys));
+    
+    /* Sampled keys are lossy, so a certain match still needs a recheck */
+    if (result == GIN_TRUE && state != NULL && state->recheck)
+        result = GIN_MAYBE;
+    
+    PG_RETURN_GIN_TERNARY_VALUE(result);
 }
 
+Datum
+kmersearch_triconsistent_int8(PG_FUNCTION_ARGS)
+{
+    GinTernaryValue *check = (GinTernaryValue *) PG_GETARG_POINTER(0);
+    int32 nkeys = PG_GETARG_INT32(3);
+    Pointer *extra_data = (Pointer *) PG_GETARG_POINTER(4);
+    Datum *queryKeys = (Datum *) PG_GETARG_POINTER(5);
+    KmerGinScanState *state = extra_data ? (KmerGinScanState *) extra_data[0] : NULL;
+    GinTernaryValue result;
+    
+    /* Read actual_min_score from the scan state, or the cache without one */
+    if (state != NULL)
+        result = kmersearch_triconsistent_internal(check, nkeys, state->actual_min_score);
+    else
+        result = kmersearch_triconsistent_internal(check, nkeys,
+                                                   kmersearch_get_cached_actual_min_score_datum_int8(queryKeys, nkeys));
+    
+    /* Sampled keys are lossy, so a certain match still needs a recheck */
+    if (result == GIN_TRUE && state != NULL && state->recheck)
+        result = GIN_MAYBE;
+    
+    PG_RETURN_GIN_TERNARY_VALUE(result);
+}
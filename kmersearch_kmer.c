@@ -128,8 +128,6 @@ static const uint8 kmersearch_text_to_dna2_table[256][5] = {
     {0, 0, 0, 0, 0}, {0, 0, 0, 0, 0}
 };
 
-static int kmersearch_count_matching_uintkey_scalar(void *seq_keys, int seq_nkeys, void *query_keys, int query_nkeys, int k_size);
-
 /*
  * Simple utility function: Set a specific bit in a bit array
  */
@@ -146,6 +144,38 @@ kmersearch_set_bit_at(bits8 *data, int bit_pos, int value)
     }
 }
 
+/*
+ * Check whether a 2-bit encoded k-mer is an open syncmer: its smallest
+ * s-mer (under a mixing hash, so poly-A runs are not favoured) starts at
+ * the middle offset (k - s) / 2.  The decision depends on the k-mer alone,
+ * so a query and the indexed sequences always sample the same k-mers.
+ */
+bool
+kmersearch_kmer_is_open_syncmer(uint64 kmer, int k, int s)
+{
+    uint64 smer_mask = (s >= 32) ? ~UINT64CONST(0) : ((UINT64CONST(1) << (2 * s)) - 1);
+    uint64 min_hash = 0;
+    int min_offset = 0;
+    int offset;
+    
+    for (offset = 0; offset <= k - s; offset++)
+    {
+        uint64 h = (kmer >> (2 * (k - s - offset))) & smer_mask;
+        
+        h ^= h >> 33;
+        h *= UINT64CONST(0xFF51AFD7ED558CCD);
+        h ^= h >> 33;
+        
+        if (offset == 0 || h < min_hash)
+        {
+            min_hash = h;
+            min_offset = offset;
+        }
+    }
+    
+    return min_offset == (k - s) / 2;
+}
+
 /*
  * Simple utility function: Count degenerate combinations in a k-mer string
  */
@@ -252,144 +282,381 @@ kmersearch_will_exceed_degenerate_limit_dna4_bits(VarBit *seq, int start_pos, in
 
 
 /*
- * Find or add k-mer occurrence in sorted array for k <= 8
+ * Per-sequence k-mer occurrence table
+ *
+ * Open-addressing table reused across extraction calls.  Each slot carries
+ * the generation it was written in, so starting a new sequence only bumps
+ * the generation instead of clearing the table.
  */
-int
-kmersearch_find_or_add_kmer_occurrence16(KmerOccurrence16 *occurrences, int *count, uint16 kmer_value, int max_count)
+static KmerOccurrenceTable occurrence_table = {0};
+
+/*
+ * Allocate the occurrence table slots for at least 'capacity' slots
+ */
+static void
+kmersearch_occurrence_table_alloc(KmerOccurrenceTable *table, uint32 capacity)
 {
-    int left = 0, right = *count - 1;
-    int insert_pos = *count;
-    
-    /* Binary search for existing k-mer */
-    while (left <= right)
-    {
-        int mid = (left + right) / 2;
-        if (occurrences[mid].kmer_value == kmer_value)
-        {
-            return ++occurrences[mid].count;  /* Found, increment and return */
-        }
-        else if (occurrences[mid].kmer_value < kmer_value)
-        {
-            left = mid + 1;
-        }
-        else
-        {
-            right = mid - 1;
-            insert_pos = mid;
+    uint32 size = KMERSEARCH_OCCURRENCE_TABLE_MIN_SLOTS;
+    int log2_size = 0;
+
+    while (size < capacity)
+        size <<= 1;
+    while ((UINT64CONST(1) << log2_size) < size)
+        log2_size++;
+
+    if (table->context == NULL)
+        table->context = AllocSetContextCreate(TopMemoryContext,
+                                               "KmerOccurrenceTable",
+                                               ALLOCSET_DEFAULT_SIZES);
+
+    table->slots = (KmerOccurrenceSlot *) MemoryContextAllocHuge(table->context,
+                                                                 (Size) size * sizeof(KmerOccurrenceSlot));
+    memset(table->slots, 0, (Size) size * sizeof(KmerOccurrenceSlot));
+    table->capacity = size;
+    table->mask = size - 1;
+    table->shift = 64 - log2_size;
+    table->generation = 1;
+    table->nused = 0;
+}
+
+/*
+ * Start tracking occurrences for a new sequence
+ * expected_kmers is the number of k-mer windows and sizes the table so that
+ * it rarely needs to grow.  With canonical set, every k-mer is folded onto
+ * min(kmer, reverse complement) before it is counted.
+ */
+static KmerOccurrenceTable *
+kmersearch_occurrence_table_begin(int expected_kmers, bool canonical)
+{
+    KmerOccurrenceTable *table = &occurrence_table;
+    uint32 wanted = (uint32) Min((int64) expected_kmers * 2, (int64) KMERSEARCH_OCCURRENCE_TABLE_RETAIN_SLOTS);
+
+    table->canonical_k = canonical ? kmersearch_kmer_size : 0;
+
+    if (table->slots == NULL || table->capacity < wanted) {
+        if (table->slots != NULL)
+            pfree(table->slots);
+        /* Allocation may ERROR; never leave freed slots behind */
+        table->slots = NULL;
+        table->capacity = 0;
+        kmersearch_occurrence_table_alloc(table, wanted);
+        return table;
+    }
+
+    /* Reuse existing slots: a new generation invalidates all of them */
+    table->generation++;
+    table->nused = 0;
+    if (table->generation == 0) {
+        memset(table->slots, 0, (Size) table->capacity * sizeof(KmerOccurrenceSlot));
+        table->generation = 1;
+    }
+
+    return table;
+}
+
+/*
+ * Double the occurrence table, keeping entries of the current generation
+ */
+static void
+kmersearch_occurrence_table_grow(KmerOccurrenceTable *table)
+{
+    KmerOccurrenceSlot *old_slots = table->slots;
+    uint32 old_capacity = table->capacity;
+    uint32 generation = table->generation;
+    uint32 i;
+
+    kmersearch_occurrence_table_alloc(table, old_capacity * 2);
+
+    for (i = 0; i < old_capacity; i++) {
+        KmerOccurrenceSlot *old = &old_slots[i];
+        uint64 slot;
+
+        if (old->generation != generation)
+            continue;
+
+        slot = KMERSEARCH_PROBE_HASH(old->kmer_value, table->shift);
+        while (table->slots[slot].generation == 1)
+            slot = (slot + 1) & table->mask;
+        table->slots[slot].kmer_value = old->kmer_value;
+        table->slots[slot].count = old->count;
+        table->slots[slot].generation = 1;
+        table->nused++;
+    }
+
+    pfree(old_slots);
+}
+
+/*
+ * Increment the occurrence count of a k-mer and return the new count
+ */
+static inline int
+kmersearch_occurrence_table_increment(KmerOccurrenceTable *table, uint64 kmer_value)
+{
+    uint64 slot;
+
+    /* Keep load factor <= 0.5 */
+    if ((uint32) table->nused * 2 >= table->capacity)
+        kmersearch_occurrence_table_grow(table);
+
+    slot = KMERSEARCH_PROBE_HASH(kmer_value, table->shift);
+    for (;;) {
+        KmerOccurrenceSlot *entry = &table->slots[slot];
+
+        if (entry->generation != table->generation) {
+            entry->kmer_value = kmer_value;
+            entry->count = 1;
+            entry->generation = table->generation;
+            table->nused++;
+            return 1;
         }
+        if (entry->kmer_value == kmer_value)
+            return ++entry->count;
+        slot = (slot + 1) & table->mask;
     }
-    
-    /* Not found, insert new entry if space available */
-    if (*count >= max_count)
-        return -1;  /* Array full */
-    
-    /* Shift elements to make room */
-    if (insert_pos < *count)
-    {
-        memmove(&occurrences[insert_pos + 1], &occurrences[insert_pos],
-                (*count - insert_pos) * sizeof(KmerOccurrence16));
+}
+
+/*
+ * Finish tracking occurrences for a sequence
+ * Oversized tables left behind by very long sequences are released.
+ */
+static void
+kmersearch_occurrence_table_end(KmerOccurrenceTable *table)
+{
+    if (table->capacity > KMERSEARCH_OCCURRENCE_TABLE_RETAIN_SLOTS) {
+        pfree(table->slots);
+        table->slots = NULL;
+        table->capacity = 0;
+        table->nused = 0;
     }
-    
-    /* Insert new entry */
-    occurrences[insert_pos].kmer_value = kmer_value;
-    occurrences[insert_pos].count = 1;
-    (*count)++;
-    
-    return 1;
 }
 
 /*
- * Find or add k-mer occurrence in sorted array for k <= 16
+ * Fold a 2-bit encoded k-mer onto its strand-independent (canonical) form:
+ * the smaller of the k-mer and its reverse complement.  With A=0, C=1,
+ * G=2, T=3 the complement is a bitwise NOT; reversing the 2-bit groups
+ * takes two swap steps and a byte swap.
  */
-int
-kmersearch_find_or_add_kmer_occurrence32(KmerOccurrence32 *occurrences, int *count, uint32 kmer_value, int max_count)
+static inline uint64
+kmersearch_canonical_kmer(uint64 kmer, int k)
+{
+    uint64 rc = ~kmer;
+
+    rc = ((rc >> 2) & UINT64CONST(0x3333333333333333)) | ((rc & UINT64CONST(0x3333333333333333)) << 2);
+    rc = ((rc >> 4) & UINT64CONST(0x0F0F0F0F0F0F0F0F)) | ((rc & UINT64CONST(0x0F0F0F0F0F0F0F0F)) << 4);
+    rc = pg_bswap64(rc) >> (64 - 2 * k);
+
+    return Min(kmer, rc);
+}
+
+/*
+ * Count an occurrence of kmer_value and build its uintkey
+ * Returns false if this occurrence is not emitted (repeat with
+ * occur_bitlen = 0, or occurrence count beyond the occurrence bits).
+ */
+static inline bool
+kmersearch_occurrence_uintkey(KmerOccurrenceTable *table, uint64 kmer_value, int occur_bitlen, uint64 *uintkey)
+{
+    int current_count;
+
+    if (table->canonical_k > 0)
+        kmer_value = kmersearch_canonical_kmer(kmer_value, table->canonical_k);
+
+    current_count = kmersearch_occurrence_table_increment(table, kmer_value);
+
+    if (occur_bitlen == 0) {
+        /* For occur_bitlen=0, only output unique k-mers (first occurrence) */
+        if (current_count != 1)
+            return false;
+        *uintkey = kmer_value;
+        return true;
+    }
+
+    if (current_count > (1 << occur_bitlen))
+        return false;
+
+    /* Include occurrence count in the uintkey */
+    *uintkey = (kmer_value << occur_bitlen) | (uint64) (current_count - 1);
+    return true;
+}
+
+/*
+ * Store uintkey into a uint16/uint32/uint64 result array
+ */
+static inline void
+kmersearch_store_uintkey(void *result, int index, size_t elem_size, uint64 uintkey)
+{
+    if (elem_size == sizeof(uint16))
+        ((uint16 *)result)[index] = (uint16) uintkey;
+    else if (elem_size == sizeof(uint32))
+        ((uint32 *)result)[index] = (uint32) uintkey;
+    else
+        ((uint64 *)result)[index] = uintkey;
+}
+
+/*
+ * Check whether a single uintkey is part of a compiled query
+ */
+static inline bool
+kmersearch_compiled_query_contains(const QueryKmerCacheEntry *query, uint64 key)
+{
+    const uint64 *table;
+    uint64 slot;
+
+    if (query->presence_bitmap != NULL)
+        return (query->presence_bitmap[key >> 6] >> (key & 63)) & 1;
+
+    if (key == KMERSEARCH_PROBE_EMPTY_KEY)
+        return query->probe_has_empty_key;
+
+    table = query->probe_table;
+    slot = KMERSEARCH_PROBE_HASH(key, query->probe_shift);
+    while (table[slot] != KMERSEARCH_PROBE_EMPTY_KEY) {
+        if (table[slot] == key)
+            return true;
+        slot = (slot + 1) & query->probe_mask;
+    }
+    return false;
+}
+
+/*
+ * Early-exit =% evaluation
+ *
+ * The outcome is decided as soon as the shared count reaches min_score, or
+ * when even a match on every key the remaining windows can emit (capped by
+ * the number of query keys not matched yet) would fall short of it.
+ */
+static inline bool
+kmersearch_match_evaluation_decide(KmerMatchEvaluation *eval, int windows_left)
+{
+    int64 reachable;
+
+    if (eval->shared_count >= eval->min_score) {
+        eval->match = true;
+        eval->decided = true;
+        return true;
+    }
+
+    reachable = Min((int64) windows_left * eval->max_keys_per_window,
+                    (int64) (eval->query->kmer_count - eval->shared_count));
+    if (eval->shared_count + reachable < eval->min_score) {
+        eval->match = false;
+        eval->decided = true;
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * Settle the outcome after the last window
+ */
+static inline void
+kmersearch_match_evaluation_finish(KmerMatchEvaluation *eval)
+{
+    if (!eval->decided) {
+        eval->match = (eval->shared_count >= eval->min_score);
+        eval->decided = true;
+    }
+}
+
+/*
+ * Feed one sequence uintkey; returns true once the outcome is decided
+ */
+static inline bool
+kmersearch_match_evaluation_feed(KmerMatchEvaluation *eval, uint64 uintkey, int windows_left)
+{
+    if (kmersearch_compiled_query_contains(eval->query, uintkey))
+        eval->shared_count++;
+    return kmersearch_match_evaluation_decide(eval, windows_left);
+}
+
+/*
+ * Validate extraction parameters and return the uintkey element size
+ */
+static size_t
+kmersearch_validate_extract_params(int max_kmers)
 {
-    int left = 0, right = *count - 1;
-    int insert_pos = *count;
+    int k = kmersearch_kmer_size;
+    int occur_bitlen = kmersearch_occur_bitlen;
+    int kmer_bits = k * 2;
+    int total_bits = kmer_bits + occur_bitlen;
     
-    /* Binary search for existing k-mer */
-    while (left <= right)
-    {
-        int mid = (left + right) / 2;
-        if (occurrences[mid].kmer_value == kmer_value)
-        {
-            return ++occurrences[mid].count;  /* Found, increment and return */
-        }
-        else if (occurrences[mid].kmer_value < kmer_value)
-        {
-            left = mid + 1;
-        }
-        else
-        {
-            right = mid - 1;
-            insert_pos = mid;
-        }
+    if (k < 4 || k > 32) {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("Invalid k-mer size: %d", k),
+                 errdetail("k-mer size must be between 4 and 32")));
     }
     
-    /* Not found, insert new entry if space available */
-    if (*count >= max_count)
-        return -1;  /* Array full */
+    if (occur_bitlen < 0 || occur_bitlen > 16) {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("Invalid occurrence bit length: %d", occur_bitlen),
+                 errdetail("Occurrence bit length must be between 0 and 16")));
+    }
     
-    /* Shift elements to make room */
-    if (insert_pos < *count)
-    {
-        memmove(&occurrences[insert_pos + 1], &occurrences[insert_pos],
-                (*count - insert_pos) * sizeof(KmerOccurrence32));
+    if (total_bits > 64) {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("Total bit length exceeds 64 bits"),
+                 errdetail("k-mer bits: %d, occurrence bits: %d, total: %d", 
+                          kmer_bits, occur_bitlen, total_bits)));
     }
     
-    /* Insert new entry */
-    occurrences[insert_pos].kmer_value = kmer_value;
-    occurrences[insert_pos].count = 1;
-    (*count)++;
+    if (max_kmers <= 0) {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("Query sequence must be at least %d bases long", k)));
+    }
     
-    return 1;
+    /* Determine element size based on total bits */
+    if (total_bits <= 16)
+        return sizeof(uint16);
+    else if (total_bits <= 32)
+        return sizeof(uint32);
+    else
+        return sizeof(uint64);
 }
 
 /*
- * Find or add k-mer occurrence in sorted array for k <= 32
+ * Hand one uintkey to a sink; returns true once the sink wants no more keys
  */
-int
-kmersearch_find_or_add_kmer_occurrence64(KmerOccurrence64 *occurrences, int *count, uint64 kmer_value, int max_count)
+static inline bool
+kmersearch_sink_emit(KmerUintkeySink *sink, uint64 uintkey, int windows_left)
 {
-    int left = 0, right = *count - 1;
-    int insert_pos = *count;
-    
-    /* Binary search for existing k-mer */
-    while (left <= right)
-    {
-        int mid = (left + right) / 2;
-        if (occurrences[mid].kmer_value == kmer_value)
-        {
-            return ++occurrences[mid].count;  /* Found, increment and return */
-        }
-        else if (occurrences[mid].kmer_value < kmer_value)
-        {
-            left = mid + 1;
-        }
-        else
-        {
-            right = mid - 1;
-            insert_pos = mid;
+    if (sink->eval != NULL)
+        sink->finished = kmersearch_match_evaluation_feed(sink->eval, uintkey, windows_left);
+    else if (sink->consumer != NULL)
+        sink->finished = !sink->consumer(uintkey, sink->consumer_arg);
+    else {
+        if (sink->result_count >= sink->result_capacity) {
+            sink->result_capacity *= 2;
+            sink->result = repalloc(sink->result, sink->result_capacity * sink->elem_size);
         }
+        kmersearch_store_uintkey(sink->result, sink->result_count++, sink->elem_size, uintkey);
     }
     
-    /* Not found, insert new entry if space available */
-    if (*count >= max_count)
-        return -1;  /* Array full */
+    return sink->finished;
+}
+
+/*
+ * Return the keys collected by a result sink, trimmed to their actual size
+ */
+static void
+kmersearch_sink_finish_result(KmerUintkeySink *sink, void **output, int *nkeys)
+{
+    void *result = sink->result;
     
-    /* Shift elements to make room */
-    if (insert_pos < *count)
-    {
-        memmove(&occurrences[insert_pos + 1], &occurrences[insert_pos],
-                (*count - insert_pos) * sizeof(KmerOccurrence64));
+    /* Reallocate to actual size if needed */
+    if (sink->result_count < sink->result_capacity) {
+        void *new_result = palloc(sink->result_count * sink->elem_size);
+        memcpy(new_result, result, sink->result_count * sink->elem_size);
+        pfree(result);
+        result = new_result;
     }
     
-    /* Insert new entry */
-    occurrences[insert_pos].kmer_value = kmer_value;
-    occurrences[insert_pos].count = 1;
-    (*count)++;
-    
-    return 1;
+    *output = result;
+    *nkeys = sink->result_count;
 }
 
 
@@ -460,541 +727,1194 @@ kmersearch_will_exceed_degenerate_limit(const char *seq, int len)
 }
 
 /*
- * Extract k-mers directly from DNA2 bit sequence (with SIMD dispatch)
+ * DNA2 k-mer window kernels
+ *
+ * A kernel writes the raw k-mer values (without occurrence bits) of windows
+ * [start, start + nwindows) to out and returns how many leading windows it
+ * produced; start must be a multiple of 4.  Windows a kernel leaves out are
+ * filled in by kmersearch_dna2_kmer_at().  Window 4*b+o starts at bit 2*o of
+ * byte b, so its k-mer is the top 2k bits of the big-endian 64-bit word at
+ * byte b shifted left by 2*o, with the next byte supplying the bits shifted
+ * in for k > 28.
+ */
+typedef int (*kmersearch_dna2_kmer_kernel) (const bits8 *data, int seq_bytes, int start,
+                                            int nwindows, int k, uint64 *out);
+
+/* Number of windows generated per kernel call */
+#define KMERSEARCH_DNA2_KERNEL_CHUNK  256
+
+/*
+ * Bounds-safe k-mer value of a single DNA2 window
+ */
+static inline uint64
+kmersearch_dna2_kmer_at(const bits8 *data, int seq_bytes, int pos, int k)
+{
+    int byte_pos = pos >> 2;
+    int shift = (pos & 3) * 2;
+    uint64 word = 0;
+    uint64 extra = 0;
+    int r;
+
+    for (r = 0; r < 8 && byte_pos + r < seq_bytes; r++)
+        word |= (uint64) data[byte_pos + r] << (56 - r * 8);
+    if (byte_pos + 8 < seq_bytes)
+        extra = data[byte_pos + 8];
+
+    word = (word << shift) | (extra >> (8 - shift));
+    return word >> (64 - 2 * k);
+}
+
+#ifdef __x86_64__
+/*
+ * AVX2 kernel: one big-endian word load per byte, broadcast to four lanes
+ * and shifted by 0/2/4/6 bits with variable shifts -> 4 k-mers per byte
+ */
+__attribute__((target("avx2")))
+static int
+kmersearch_dna2_kmers_avx2(const bits8 *data, int seq_bytes, int start, int nwindows, int k, uint64 *out)
+{
+    const __m256i lshift = _mm256_set_epi64x(6, 4, 2, 0);
+    const __m256i rshift = _mm256_set_epi64x(2, 4, 6, 8);
+    const __m128i kshift = _mm_cvtsi32_si128(64 - 2 * k);
+    int i = 0;
+
+    while (i + 4 <= nwindows) {
+        int byte_pos = (start + i) >> 2;
+        uint64 word;
+        __m256i vw;
+        __m256i ve;
+
+        if (byte_pos + 9 > seq_bytes)
+            break;
+
+        memcpy(&word, data + byte_pos, sizeof(uint64));
+        word = pg_ntoh64(word);
+
+        vw = _mm256_sllv_epi64(_mm256_set1_epi64x((long long) word), lshift);
+        ve = _mm256_srlv_epi64(_mm256_set1_epi64x(data[byte_pos + 8]), rshift);
+        _mm256_storeu_si256((__m256i *)(out + i),
+                            _mm256_srl_epi64(_mm256_or_si256(vw, ve), kshift));
+        i += 4;
+    }
+
+    return i;
+}
+
+/*
+ * AVX512 VBMI kernel: a single byte permute builds the big-endian words of
+ * eight consecutive bytes (and their following bytes), giving 32 k-mers per
+ * iteration.  The four per-offset vectors are transposed into window order.
  */
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static int
+kmersearch_dna2_kmers_avx512vbmi(const bits8 *data, int seq_bytes, int start, int nwindows, int k, uint64 *out)
+{
+    /* Lane L byte m <- data[L + 7 - m] (byte-swapped word at byte L) */
+    const __m512i word_idx = _mm512_set_epi64(0x0708090A0B0C0D0ELL, 0x060708090A0B0C0DLL,
+                                              0x05060708090A0B0CLL, 0x0405060708090A0BLL,
+                                              0x030405060708090ALL, 0x0203040506070809LL,
+                                              0x0102030405060708LL, 0x0001020304050607LL);
+    /* Lane L byte 0 <- data[L + 8] */
+    const __m512i extra_idx = _mm512_set_epi64(15, 14, 13, 12, 11, 10, 9, 8);
+    const __m512i lo_pairs = _mm512_set_epi64(11, 3, 10, 2, 9, 1, 8, 0);
+    const __m512i hi_pairs = _mm512_set_epi64(15, 7, 14, 6, 13, 5, 12, 4);
+    const __m512i lo_quads = _mm512_set_epi64(11, 10, 3, 2, 9, 8, 1, 0);
+    const __m512i hi_quads = _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4);
+    const __m128i kshift = _mm_cvtsi32_si128(64 - 2 * k);
+    int i = 0;
+
+    while (i + 32 <= nwindows) {
+        int byte_pos = (start + i) >> 2;
+        __m512i raw, w, e;
+        __m512i v0, v1, v2, v3;
+        __m512i ab_lo, ab_hi, cd_lo, cd_hi;
 
+        if (byte_pos + 16 > seq_bytes)
+            break;
+
+        raw = _mm512_maskz_loadu_epi8((__mmask64) 0xFFFF, data + byte_pos);
+        w = _mm512_permutexvar_epi8(word_idx, raw);
+        e = _mm512_maskz_permutexvar_epi8((__mmask64) 0x0101010101010101ULL, extra_idx, raw);
+
+        v0 = _mm512_srl_epi64(w, kshift);
+        v1 = _mm512_srl_epi64(_mm512_or_si512(_mm512_slli_epi64(w, 2), _mm512_srli_epi64(e, 6)), kshift);
+        v2 = _mm512_srl_epi64(_mm512_or_si512(_mm512_slli_epi64(w, 4), _mm512_srli_epi64(e, 4)), kshift);
+        v3 = _mm512_srl_epi64(_mm512_or_si512(_mm512_slli_epi64(w, 6), _mm512_srli_epi64(e, 2)), kshift);
+
+        /* Transpose 4x8 so that out[4L + o] = v_o[L] */
+        ab_lo = _mm512_permutex2var_epi64(v0, lo_pairs, v1);
+        ab_hi = _mm512_permutex2var_epi64(v0, hi_pairs, v1);
+        cd_lo = _mm512_permutex2var_epi64(v2, lo_pairs, v3);
+        cd_hi = _mm512_permutex2var_epi64(v2, hi_pairs, v3);
+        _mm512_storeu_si512((void *)(out + i), _mm512_permutex2var_epi64(ab_lo, lo_quads, cd_lo));
+        _mm512_storeu_si512((void *)(out + i + 8), _mm512_permutex2var_epi64(ab_lo, hi_quads, cd_lo));
+        _mm512_storeu_si512((void *)(out + i + 16), _mm512_permutex2var_epi64(ab_hi, lo_quads, cd_hi));
+        _mm512_storeu_si512((void *)(out + i + 24), _mm512_permutex2var_epi64(ab_hi, hi_quads, cd_hi));
+        i += 32;
+    }
+
+    return i;
+}
+#endif
 
 /*
- * Extract uint keys with occurrence counting from DNA2 sequence (scalar implementation)
+ * Extract uint keys with occurrence counting from one DNA2 segment
+ *
+ * The segment holds seg_bases bases starting at a byte boundary; windows
+ * before first_window were already emitted from the previous segment.
+ * window_offset is the absolute index of the segment's first window.
+ * With kernel == NULL the k-mers are produced by a scalar rolling window;
+ * otherwise the kernel generates them a chunk at a time.
  */
 static void
-kmersearch_extract_uintkey_from_dna2_scalar(VarBit *seq, void **output, int *nkeys)
+kmersearch_dna2_extract_segment(const bits8 *data, int seg_bytes, int seg_bases, int first_window,
+                                int window_offset, kmersearch_dna2_kmer_kernel kernel,
+                                KmerOccurrenceTable *occurrences, KmerUintkeySink *sink)
 {
     int k = kmersearch_kmer_size;
     int occur_bitlen = kmersearch_occur_bitlen;
-    int seq_bits = VARBITLEN(seq);
-    int seq_len = seq_bits / 2;
-    int max_kmers = seq_len - k + 1;
+    int nwindows = seg_bases - k + 1;
     int kmer_bits = k * 2;
-    int total_bits = kmer_bits + occur_bitlen;
-    size_t elem_size;
-    void *result;
-    int result_count = 0;
-    int i;
-    void *occurrences = NULL;
-    int occurrence_count = 0;
+    int byte_pos;
+    int base_pos = 0;
+    uint64 kmer_value = 0;
+    uint64 kmer_mask;
     
-    /* Validate parameters */
-    if (k < 4 || k > 32) {
-        ereport(ERROR,
-                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                 errmsg("Invalid k-mer size: %d", k),
-                 errdetail("k-mer size must be between 4 and 32")));
-    }
+    if (nwindows <= first_window || sink->finished)
+        return;
     
-    if (occur_bitlen < 0 || occur_bitlen > 16) {
-        ereport(ERROR,
-                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                 errmsg("Invalid occurrence bit length: %d", occur_bitlen),
-                 errdetail("Occurrence bit length must be between 0 and 16")));
+    if (kernel != NULL) {
+        uint64 chunk[KMERSEARCH_DNA2_KERNEL_CHUNK];
+        int start;
+        
+        for (start = 0; start < nwindows && !sink->finished; start += KMERSEARCH_DNA2_KERNEL_CHUNK) {
+            int chunk_windows = Min(KMERSEARCH_DNA2_KERNEL_CHUNK, nwindows - start);
+            int done = kernel(data, seg_bytes, start, chunk_windows, k, chunk);
+            int c;
+            
+            /* Windows too close to the end for a full vector load */
+            for (c = done; c < chunk_windows; c++)
+                chunk[c] = kmersearch_dna2_kmer_at(data, seg_bytes, start + c, k);
+            
+            for (c = Max(0, first_window - start); c < chunk_windows; c++) {
+                uint64 uintkey;
+                
+                if (!kmersearch_occurrence_uintkey(occurrences, chunk[c], occur_bitlen, &uintkey))
+                    continue;
+                if (kmersearch_sink_emit(sink, uintkey,
+                                         sink->total_windows - (window_offset + start + c + 1)))
+                    break;
+            }
+        }
+        
+        return;
     }
     
-    if (total_bits > 64) {
-        ereport(ERROR,
-                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                 errmsg("Total bit length exceeds 64 bits"),
-                 errdetail("k-mer bits: %d, occurrence bits: %d, total: %d", 
-                          kmer_bits, occur_bitlen, total_bits)));
-    }
+    /* Extract k-mers with a rolling window over 64-bit big-endian word loads */
+    kmer_mask = (kmer_bits == 64) ? PG_UINT64_MAX : ((UINT64CONST(1) << kmer_bits) - 1);
     
-    if (max_kmers <= 0) {
-        ereport(ERROR,
-                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                 errmsg("Query sequence must be at least %d bases long", k)));
-        return;
+    for (byte_pos = 0; base_pos < seg_bases && !sink->finished; byte_pos += 8) {
+        uint64 word;
+        int word_bases;
+        int b;
+        
+        /* Load next 32 bases; the first base ends up in the top two bits */
+        if (byte_pos + 8 <= seg_bytes) {
+            memcpy(&word, data + byte_pos, sizeof(uint64));
+            word = pg_ntoh64(word);
+        } else {
+            int r;
+            word = 0;
+            for (r = 0; byte_pos + r < seg_bytes; r++)
+                word |= (uint64) data[byte_pos + r] << (56 - r * 8);
+        }
+        
+        word_bases = Min(32, seg_bases - base_pos);
+        for (b = 0; b < word_bases; b++) {
+            uint64 uintkey;
+            
+            kmer_value = ((kmer_value << 2) | (word >> 62)) & kmer_mask;
+            word <<= 2;
+            base_pos++;
+            
+            if (base_pos - k < first_window)
+                continue;
+            
+            /* Track occurrences and hand the key to the sink */
+            if (!kmersearch_occurrence_uintkey(occurrences, kmer_value, occur_bitlen, &uintkey))
+                continue;
+            if (kmersearch_sink_emit(sink, uintkey,
+                                     sink->total_windows - (window_offset + base_pos - k + 1)))
+                break;
+        }
+    }
+}
+
+/*
+ * Select the DNA2 k-mer kernel for a sequence length (NULL = scalar rolling window)
+ */
+static kmersearch_dna2_kmer_kernel
+kmersearch_select_dna2_kernel(int seq_len)
+{
+#ifdef __x86_64__
+    if (simd_capability >= SIMD_AVX512VBMI && seq_len >= SIMD_EXTRACT_AVX512_THRESHOLD)
+        return kmersearch_dna2_kmers_avx512vbmi;
+    if (simd_capability >= SIMD_AVX2 && seq_len >= SIMD_EXTRACT_AVX2_THRESHOLD)
+        return kmersearch_dna2_kmers_avx2;
+#elif defined(__aarch64__)
+    /* Future: Add NEON/SVE dispatch based on simd_capability */
+    if (simd_capability >= SIMD_NEON) {
+        /* NEON available but not yet implemented for DNA2 extraction, using scalar */
     }
+#endif
     
-    /* Determine element size based on total bits */
-    if (total_bits <= 16) {
-        elem_size = sizeof(uint16);
-    } else if (total_bits <= 32) {
-        elem_size = sizeof(uint32);
-    } else {
-        elem_size = sizeof(uint64);
+    return NULL;
+}
+
+/*
+ * Extract uint keys with occurrence counting from DNA2 sequence (dispatch function)
+ */
+void
+kmersearch_extract_uintkey_from_dna2(VarBit *seq, void **output, int *nkeys, bool canonical)
+{
+    int seq_len = VARBITLEN(seq) / 2;
+    int max_kmers = seq_len - kmersearch_kmer_size + 1;
+    KmerUintkeySink sink = {0};
+    KmerOccurrenceTable *occurrences;
+    
+    sink.elem_size = kmersearch_validate_extract_params(max_kmers);
+    sink.total_windows = max_kmers;
+    sink.result_capacity = max_kmers;
+    sink.result = palloc(max_kmers * sink.elem_size);
+    
+    occurrences = kmersearch_occurrence_table_begin(max_kmers, canonical);
+    kmersearch_dna2_extract_segment(VARBITS(seq), VARBITBYTES(seq), seq_len, 0, 0,
+                                    kmersearch_select_dna2_kernel(seq_len), occurrences, &sink);
+    
+    /* Finish occurrence tracking (table is reused by the next call) */
+    kmersearch_occurrence_table_end(occurrences);
+    
+    kmersearch_sink_finish_result(&sink, output, nkeys);
+}
+
+/*
+ * DNA4 single-pass expansion engine
+ *
+ * A pre-pass unpacks the 4-bit codes into one byte per base and tags each
+ * with its class: degenerate (MRWSYKVHDB, 2-3 expansions) or blocking
+ * (N or invalid).  The main pass then keeps a rolling DNA2 window built from
+ * the first expansion of every base, skips whole N-runs, tracks the
+ * degenerate positions inside the window so the expansion limit is checked
+ * in O(1), and enumerates the allowed windows with an odometer.
+ */
+#define KMERSEARCH_DNA4_DEGENERATE  0x10
+#define KMERSEARCH_DNA4_BLOCKING    0x20
+#define KMERSEARCH_DNA4_CODE_MASK   0x0F
+
+/* Windows with more degenerate bases than this are not expanded */
+#define KMERSEARCH_DNA4_MAX_DEGENERATE  1
+
+/* Most keys one window can emit (a single V/H/D/B base) */
+#define KMERSEARCH_DNA4_MAX_WINDOW_KEYS 3
+
+typedef void (*kmersearch_dna4_classify_fn) (const bits8 *data, int seq_len, uint8 *bases);
+
+/*
+ * Class of each 4-bit code, indexed by code
+ */
+static const uint8 kmersearch_dna4_class_table[16] = {
+    KMERSEARCH_DNA4_BLOCKING,       /* 0000 - invalid */
+    0, 0,                           /* A, C */
+    KMERSEARCH_DNA4_DEGENERATE,     /* M */
+    0,                              /* G */
+    KMERSEARCH_DNA4_DEGENERATE,     /* R */
+    KMERSEARCH_DNA4_DEGENERATE,     /* S */
+    KMERSEARCH_DNA4_DEGENERATE,     /* V */
+    0,                              /* T */
+    KMERSEARCH_DNA4_DEGENERATE,     /* W */
+    KMERSEARCH_DNA4_DEGENERATE,     /* Y */
+    KMERSEARCH_DNA4_DEGENERATE,     /* H */
+    KMERSEARCH_DNA4_DEGENERATE,     /* K */
+    KMERSEARCH_DNA4_DEGENERATE,     /* D */
+    KMERSEARCH_DNA4_DEGENERATE,     /* B */
+    KMERSEARCH_DNA4_BLOCKING        /* 1111 - N */
+};
+
+/*
+ * Pre-pass (scalar): one tagged byte per base
+ */
+static void
+kmersearch_dna4_classify_scalar(const bits8 *data, int seq_len, uint8 *bases)
+{
+    int i;
+    
+    for (i = 0; i < seq_len; i++) {
+        uint8 code = (i & 1) ? (data[i >> 1] & 0x0F) : (data[i >> 1] >> 4);
+        
+        bases[i] = code | kmersearch_dna4_class_table[code];
+    }
+}
+
+#ifdef __x86_64__
+/*
+ * Pre-pass (AVX2): 32 bases per iteration, nibble unpack plus a shuffle
+ * lookup of the class tags
+ */
+__attribute__((target("avx2")))
+static void
+kmersearch_dna4_classify_avx2(const bits8 *data, int seq_len, uint8 *bases)
+{
+    const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+    const __m128i class_lut = _mm_loadu_si128((const __m128i *) kmersearch_dna4_class_table);
+    int i = 0;
+    
+    for (; i + 32 <= seq_len; i += 32) {
+        __m128i raw = _mm_loadu_si128((const __m128i *)(data + (i >> 1)));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(raw, 4), nibble_mask);
+        __m128i lo = _mm_and_si128(raw, nibble_mask);
+        __m128i first = _mm_unpacklo_epi8(hi, lo);
+        __m128i second = _mm_unpackhi_epi8(hi, lo);
+        
+        first = _mm_or_si128(first, _mm_shuffle_epi8(class_lut, first));
+        second = _mm_or_si128(second, _mm_shuffle_epi8(class_lut, second));
+        _mm_storeu_si128((__m128i *)(bases + i), first);
+        _mm_storeu_si128((__m128i *)(bases + i + 16), second);
     }
     
-    /* Allocate result array */
-    result = palloc(max_kmers * elem_size);
+    if (i < seq_len)
+        kmersearch_dna4_classify_scalar(data + (i >> 1), seq_len - i, bases + i);
+}
+#endif
+
+/*
+ * Return the first position at or after pos that is not a blocking base,
+ * testing eight bases at a time across N-runs
+ */
+static inline int
+kmersearch_dna4_skip_blocked(const uint8 *bases, int pos, int seq_len)
+{
+    const uint64 all_blocking = UINT64CONST(0x2020202020202020);
     
-    if (elem_size == sizeof(uint16)) {
-        occurrences = palloc0(max_kmers * sizeof(KmerOccurrence16));
-    } else if (elem_size == sizeof(uint32)) {
-        occurrences = palloc0(max_kmers * sizeof(KmerOccurrence32));
-    } else {
-        occurrences = palloc0(max_kmers * sizeof(KmerOccurrence64));
+    while (pos + 8 <= seq_len) {
+        uint64 word;
+        
+        memcpy(&word, bases + pos, sizeof(uint64));
+        if ((word & all_blocking) != all_blocking)
+            break;
+        pos += 8;
     }
+    while (pos < seq_len && (bases[pos] & KMERSEARCH_DNA4_BLOCKING))
+        pos++;
     
-    /* Extract k-mers and track occurrences */
-    for (i = 0; i <= seq_len - k; i++) {
-        int j;
-        int current_count;
-        bits8 *data = VARBITS(seq);
+    return pos;
+}
+
+/*
+ * Extract uint keys with occurrence counting from one DNA4 segment
+ *
+ * The segment holds seg_bases bases starting at a byte boundary; windows
+ * before first_window were already emitted from the previous segment.
+ */
+static void
+kmersearch_dna4_extract_segment(const bits8 *data, int seg_bases, int first_window,
+                                int window_offset, kmersearch_dna4_classify_fn classify,
+                                KmerOccurrenceTable *occurrences, KmerUintkeySink *sink)
+{
+    int k = kmersearch_kmer_size;
+    int occur_bitlen = kmersearch_occur_bitlen;
+    int kmer_bits = k * 2;  /* Output is DNA2 format */
+    uint8 *bases;
+    int pos;
+    int filled = 0;
+    int degen_pos[64];          /* degenerate positions in the window (ring) */
+    int degen_head = 0;
+    int degen_count = 0;
+    uint64 kmer_value = 0;
+    uint64 kmer_mask;
+    uint64 expanded;
+    
+    if (seg_bases - k + 1 <= first_window || sink->finished)
+        return;
+    
+    /* Pre-pass: classify every base */
+    bases = (uint8 *) palloc(seg_bases + 1);
+    classify(data, seg_bases, bases);
+    
+    kmer_mask = (kmer_bits == 64) ? PG_UINT64_MAX : ((UINT64CONST(1) << kmer_bits) - 1);
+    pos = 0;
+    while (pos < seg_bases && !sink->finished) {
+        uint8 base = bases[pos];
+        int ndigits;
+        int digit_shift[KMERSEARCH_DNA4_MAX_DEGENERATE] = {0};
+        uint8 digit_code[KMERSEARCH_DNA4_MAX_DEGENERATE] = {0};
+        int digit_index[KMERSEARCH_DNA4_MAX_DEGENERATE] = {0};
+        int d;
         
-        /* Extract k-mer bits and store based on element size */
-        if (elem_size == sizeof(uint16)) {
-            uint16 kmer_value = 0;
-            uint16 final_value;
-            
-            for (j = 0; j < k; j++) {
-                int bit_pos = (i + j) * 2;
-                int byte_pos = bit_pos / 8;
-                int bit_offset = bit_pos % 8;
-                uint8 nucleotide = (data[byte_pos] >> (6 - bit_offset)) & 0x3;
-                kmer_value = (kmer_value << 2) | nucleotide;
-            }
-            
-            current_count = kmersearch_find_or_add_kmer_occurrence16(
-                (KmerOccurrence16 *)occurrences, &occurrence_count,
-                kmer_value, max_kmers);
-            if (current_count < 0) continue;
-            if (occur_bitlen > 0 && current_count > (1 << occur_bitlen)) continue;
-            
-            if (occur_bitlen == 0) {
-                /* For occur_bitlen=0, only output unique k-mers (first occurrence) */
-                if (current_count == 1) {
-                    final_value = kmer_value;
-                    ((uint16 *)result)[result_count++] = final_value;
-                }
-            } else {
-                /* Include occurrence count in the uintkey */
-                final_value = (kmer_value << occur_bitlen) | ((current_count - 1) & ((1 << occur_bitlen) - 1));
-                ((uint16 *)result)[result_count++] = final_value;
-            }
-            
-        } else if (elem_size == sizeof(uint32)) {
-            uint32 kmer_value = 0;
-            uint32 final_value;
-            
-            for (j = 0; j < k; j++) {
-                int bit_pos = (i + j) * 2;
-                int byte_pos = bit_pos / 8;
-                int bit_offset = bit_pos % 8;
-                uint8 nucleotide = (data[byte_pos] >> (6 - bit_offset)) & 0x3;
-                kmer_value = (kmer_value << 2) | nucleotide;
-            }
-            
-            current_count = kmersearch_find_or_add_kmer_occurrence32(
-                (KmerOccurrence32 *)occurrences, &occurrence_count,
-                kmer_value, max_kmers);
-            if (current_count < 0) continue;
-            if (occur_bitlen > 0 && current_count > (1 << occur_bitlen)) continue;
-            
-            if (occur_bitlen == 0) {
-                /* For occur_bitlen=0, only output unique k-mers (first occurrence) */
-                if (current_count == 1) {
-                    final_value = kmer_value;
-                    ((uint32 *)result)[result_count++] = final_value;
-                }
-            } else {
-                /* Include occurrence count in the uintkey */
-                final_value = (kmer_value << occur_bitlen) | ((current_count - 1) & ((1 << occur_bitlen) - 1));
-                ((uint32 *)result)[result_count++] = final_value;
-            }
-            
-        } else {
-            uint64 kmer_value = 0;
-            uint64 final_value;
+        /* No window may contain an N or invalid base: restart after the run */
+        if (base & KMERSEARCH_DNA4_BLOCKING) {
+            pos = kmersearch_dna4_skip_blocked(bases, pos, seg_bases);
+            filled = 0;
+            degen_head = 0;
+            degen_count = 0;
+            continue;
+        }
+        
+        /* Roll the first expansion of this base into the window */
+        kmer_value = ((kmer_value << 2) |
+                      kmersearch_dna4_to_dna2_table[base & KMERSEARCH_DNA4_CODE_MASK][1]) & kmer_mask;
+        if (base & KMERSEARCH_DNA4_DEGENERATE)
+            degen_pos[(degen_head + degen_count++) & 63] = pos;
+        pos++;
+        
+        if (++filled < k || pos - k < first_window)
+            continue;
+        
+        /* Drop degenerate bases that slid out of the window */
+        while (degen_count > 0 && degen_pos[degen_head & 63] < pos - k) {
+            degen_head++;
+            degen_count--;
+        }
+        
+        if (degen_count > KMERSEARCH_DNA4_MAX_DEGENERATE)
+            continue;
+        
+        /* Odometer over the degenerate bases of this window */
+        ndigits = degen_count;
+        for (d = 0; d < ndigits; d++) {
+            int p = degen_pos[(degen_head + d) & 63];
             
-            for (j = 0; j < k; j++) {
-                int bit_pos = (i + j) * 2;
-                int byte_pos = bit_pos / 8;
-                int bit_offset = bit_pos % 8;
-                uint8 nucleotide = (data[byte_pos] >> (6 - bit_offset)) & 0x3;
-                kmer_value = (kmer_value << 2) | nucleotide;
-            }
+            digit_shift[d] = 2 * (pos - 1 - p);
+            digit_code[d] = bases[p] & KMERSEARCH_DNA4_CODE_MASK;
+            digit_index[d] = 1;
+        }
+        
+        expanded = kmer_value;
+        for (;;) {
+            uint64 uintkey;
             
-            current_count = kmersearch_find_or_add_kmer_occurrence64(
-                (KmerOccurrence64 *)occurrences, &occurrence_count,
-                kmer_value, max_kmers);
-            if (current_count < 0) continue;
-            if (occur_bitlen > 0 && current_count > (1 << occur_bitlen)) continue;
+            /* Remaining windows include this one while its expansions are pending */
+            if (kmersearch_occurrence_uintkey(occurrences, expanded, occur_bitlen, &uintkey) &&
+                kmersearch_sink_emit(sink, uintkey,
+                                     sink->total_windows - (window_offset + pos - k)))
+                break;
             
-            if (occur_bitlen == 0) {
-                /* For occur_bitlen=0, only output unique k-mers (first occurrence) */
-                if (current_count == 1) {
-                    final_value = kmer_value;
-                    ((uint64 *)result)[result_count++] = final_value;
+            /* Advance the odometer; the first digit turns fastest */
+            for (d = 0; d < ndigits; d++) {
+                const uint8 *expansion = kmersearch_dna4_to_dna2_table[digit_code[d]];
+                
+                expanded &= ~(UINT64CONST(3) << digit_shift[d]);
+                if (++digit_index[d] <= expansion[0]) {
+                    expanded |= (uint64) expansion[digit_index[d]] << digit_shift[d];
+                    break;
                 }
-            } else {
-                /* Include occurrence count in the uintkey */
-                final_value = (kmer_value << occur_bitlen) | ((current_count - 1) & ((1 << occur_bitlen) - 1));
-                ((uint64 *)result)[result_count++] = final_value;
+                digit_index[d] = 1;
+                expanded |= (uint64) expansion[1] << digit_shift[d];
             }
+            if (d == ndigits)
+                break;
         }
     }
     
-    /* Free occurrence tracking array */
-    pfree(occurrences);
+    pfree(bases);
+}
+
+/*
+ * Select the DNA4 classification pre-pass for a sequence length
+ */
+static kmersearch_dna4_classify_fn
+kmersearch_select_dna4_classify(int seq_len)
+{
+#ifdef __x86_64__
+    if (simd_capability >= SIMD_AVX2 && seq_len >= SIMD_EXTRACT_AVX2_THRESHOLD)
+        return kmersearch_dna4_classify_avx2;
+#elif defined(__aarch64__)
+    /* Future: Add NEON/SVE dispatch based on simd_capability */
+    if (simd_capability >= SIMD_NEON) {
+        /* NEON available but not yet implemented for DNA4 extraction, using scalar */
+    }
+#endif
     
-    /* Reallocate to actual size if needed */
-    if (result_count < max_kmers) {
-        void *new_result = palloc(result_count * elem_size);
-        memcpy(new_result, result, result_count * elem_size);
-        pfree(result);
-        result = new_result;
+    return kmersearch_dna4_classify_scalar;
+}
+
+/*
+ * Extract uint keys with occurrence counting from DNA4 sequence (dispatch function)
+ */
+void
+kmersearch_extract_uintkey_from_dna4(VarBit *seq, void **output, int *nkeys, bool canonical)
+{
+    int seq_len = VARBITLEN(seq) / 4;  /* DNA4 uses 4 bits per character */
+    int max_kmers = seq_len - kmersearch_kmer_size + 1;
+    KmerUintkeySink sink = {0};
+    KmerOccurrenceTable *occurrences;
+    
+    sink.elem_size = kmersearch_validate_extract_params(max_kmers);
+    sink.total_windows = max_kmers;
+    
+    /* Allocate result array; the sink grows it if expansions outrun it */
+    sink.result_capacity = max_kmers + max_kmers / 2;
+    sink.result = palloc(sink.result_capacity * sink.elem_size);
+    
+    occurrences = kmersearch_occurrence_table_begin(max_kmers, canonical);
+    kmersearch_dna4_extract_segment(VARBITS(seq), seq_len, 0, 0,
+                                    kmersearch_select_dna4_classify(seq_len), occurrences, &sink);
+    
+    /* Finish occurrence tracking (table is reused by the next call) */
+    kmersearch_occurrence_table_end(occurrences);
+    
+    kmersearch_sink_finish_result(&sink, output, nkeys);
+}
+
+/*
+ * Streaming extraction
+ *
+ * The sequence is read through PG_DETOAST_DATUM_SLICE in slices of
+ * KMERSEARCH_STREAM_SLICE_BYTES.  Each slice starts at the byte holding the
+ * first window not yet emitted, so consecutive slices overlap by the k-1
+ * base carry-over, and keys are handed to the sink as they are produced.
+ * Only values stored out of line without compression are sliced; anything
+ * else is detoasted once, since fetching a slice of a compressed value
+ * decompresses everything before it.
+ */
+static void
+kmersearch_stream_uintkey_internal(Datum seq_datum, int bits_per_base, KmerUintkeySink *sink)
+{
+    struct varlena *attr = (struct varlena *) DatumGetPointer(seq_datum);
+    int k = kmersearch_kmer_size;
+    int bases_per_byte = 8 / bits_per_base;
+    int64 seq_len;
+    int max_kmers;
+    int emit_from;
+    bool sliced = false;
+    KmerOccurrenceTable *occurrences;
+    VarBit *seq = NULL;
+    
+    if (VARATT_IS_EXTERNAL_ONDISK(attr)) {
+        struct varatt_external toast_pointer;
+        
+        VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+        sliced = !VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer);
+    }
+    
+    if (sliced) {
+        struct varlena *header = PG_DETOAST_DATUM_SLICE(seq_datum, 0, VARBITHDRSZ);
+        int32 bit_len;
+        
+        memcpy(&bit_len, VARDATA(header), VARBITHDRSZ);
+        pfree(header);
+        seq_len = bit_len / bits_per_base;
+    } else {
+        seq = DatumGetVarBitP(seq_datum);
+        seq_len = VARBITLEN(seq) / bits_per_base;
+    }
+    
+    max_kmers = (int) (seq_len - k + 1);
+    sink->elem_size = kmersearch_validate_extract_params(max_kmers);
+    sink->total_windows = max_kmers;
+    if (sink->eval != NULL)
+        sink->finished = kmersearch_match_evaluation_decide(sink->eval, max_kmers);
+    
+    occurrences = kmersearch_occurrence_table_begin(max_kmers, sink->canonical);
+    
+    for (emit_from = 0; emit_from < max_kmers && !sink->finished; ) {
+        int64 seg_start = emit_from - emit_from % bases_per_byte;
+        int seg_bases = (int) Min(seq_len - seg_start,
+                                  (int64) KMERSEARCH_STREAM_SLICE_BYTES * bases_per_byte);
+        int seg_bytes = (seg_bases * bits_per_base + 7) / 8;
+        struct varlena *slice = NULL;
+        const bits8 *data;
+        
+        if (sliced) {
+            slice = PG_DETOAST_DATUM_SLICE(seq_datum,
+                                           VARBITHDRSZ + (int32) (seg_start / bases_per_byte),
+                                           seg_bytes);
+            seg_bytes = VARSIZE(slice) - VARHDRSZ;
+            data = (const bits8 *) VARDATA(slice);
+        } else
+            data = VARBITS(seq) + seg_start / bases_per_byte;
+        
+        if (bits_per_base == 2)
+            kmersearch_dna2_extract_segment(data, seg_bytes, seg_bases, (int) (emit_from - seg_start),
+                                            (int) seg_start, kmersearch_select_dna2_kernel(seg_bases),
+                                            occurrences, sink);
+        else
+            kmersearch_dna4_extract_segment(data, seg_bases, (int) (emit_from - seg_start),
+                                            (int) seg_start, kmersearch_select_dna4_classify(seg_bases),
+                                            occurrences, sink);
+        
+        if (slice != NULL)
+            pfree(slice);
+        
+        /* The next slice restarts k-1 bases before this one ended */
+        emit_from = (int) (seg_start + seg_bases - k + 1);
+    }
+    
+    /* Finish occurrence tracking (table is reused by the next call) */
+    kmersearch_occurrence_table_end(occurrences);
+    
+    if (seq != NULL && (Pointer) seq != DatumGetPointer(seq_datum))
+        pfree(seq);
+}
+
+/*
+ * Stream uint keys of a DNA2/DNA4 datum to a consumer callback
+ * The consumer returns false to stop the extraction; canonical folds each
+ * k-mer onto its strand-independent form.
+ */
+void
+kmersearch_stream_uintkey_from_dna2(Datum seq_datum, bool canonical, KmerUintkeyConsumer consumer, void *arg)
+{
+    KmerUintkeySink sink = {0};
+    
+    sink.canonical = canonical;
+    sink.consumer = consumer;
+    sink.consumer_arg = arg;
+    kmersearch_stream_uintkey_internal(seq_datum, 2, &sink);
+}
+
+void
+kmersearch_stream_uintkey_from_dna4(Datum seq_datum, bool canonical, KmerUintkeyConsumer consumer, void *arg)
+{
+    KmerUintkeySink sink = {0};
+    
+    sink.canonical = canonical;
+    sink.consumer = consumer;
+    sink.consumer_arg = arg;
+    kmersearch_stream_uintkey_internal(seq_datum, 4, &sink);
+}
+
+/*
+ * Early-exit =% evaluation of a DNA2/DNA4 datum against a compiled query
+ * Extraction and counting are fused, so the sequence keys are never
+ * materialized and extraction stops at the first decision point.
+ */
+bool
+kmersearch_evaluate_match_dna2(Datum seq_datum, QueryKmerCacheEntry *query)
+{
+    KmerMatchEvaluation eval = {0};
+    KmerUintkeySink sink = {0};
+    
+    eval.query = query;
+    eval.min_score = query->actual_min_score;
+    eval.max_keys_per_window = 1;
+    sink.eval = &eval;
+    sink.canonical = query->canonical;
+    
+    kmersearch_stream_uintkey_internal(seq_datum, 2, &sink);
+    kmersearch_match_evaluation_finish(&eval);
+    return eval.match;
+}
+
+bool
+kmersearch_evaluate_match_dna4(Datum seq_datum, QueryKmerCacheEntry *query)
+{
+    KmerMatchEvaluation eval = {0};
+    KmerUintkeySink sink = {0};
+    
+    eval.query = query;
+    eval.min_score = query->actual_min_score;
+    eval.max_keys_per_window = KMERSEARCH_DNA4_MAX_WINDOW_KEYS;
+    sink.eval = &eval;
+    sink.canonical = query->canonical;
+    
+    kmersearch_stream_uintkey_internal(seq_datum, 4, &sink);
+    kmersearch_match_evaluation_finish(&eval);
+    return eval.match;
+}
+
+/*
+ * Count sequence keys shared with a compiled query without materializing
+ * the sequence keys (used by the matchscore functions)
+ */
+static bool
+kmersearch_count_shared_consumer(uint64 uintkey, void *arg)
+{
+    KmerMatchEvaluation *count = (KmerMatchEvaluation *) arg;
+    
+    if (count->query->kmer_count > 0 &&
+        kmersearch_compiled_query_contains(count->query, uintkey))
+        count->shared_count++;
+    return true;
+}
+
+int
+kmersearch_count_shared_dna2(Datum seq_datum, QueryKmerCacheEntry *query)
+{
+    KmerMatchEvaluation count = {0};
+    
+    count.query = query;
+    kmersearch_stream_uintkey_from_dna2(seq_datum, query->canonical, kmersearch_count_shared_consumer, &count);
+    return count.shared_count;
+}
+
+int
+kmersearch_count_shared_dna4(Datum seq_datum, QueryKmerCacheEntry *query)
+{
+    KmerMatchEvaluation count = {0};
+    
+    count.query = query;
+    kmersearch_stream_uintkey_from_dna4(seq_datum, query->canonical, kmersearch_count_shared_consumer, &count);
+    return count.shared_count;
+}
+
+/*
+ * Sorted uintkey intersection engine
+ *
+ * Both key arrays produced by the extractors are duplicate-free (the
+ * occurrence suffix makes repeated k-mers distinct), so the number of
+ * shared keys equals the size of the intersection of the two sorted arrays.
+ */
+
+/*
+ * Comparison functions for sorting uintkey arrays
+ */
+static int
+kmersearch_uintkey16_cmp(const void *a, const void *b)
+{
+    uint16 x = *(const uint16 *)a;
+    uint16 y = *(const uint16 *)b;
+    return (x > y) - (x < y);
+}
+
+static int
+kmersearch_uintkey32_cmp(const void *a, const void *b)
+{
+    uint32 x = *(const uint32 *)a;
+    uint32 y = *(const uint32 *)b;
+    return (x > y) - (x < y);
+}
+
+static int
+kmersearch_uintkey64_cmp(const void *a, const void *b)
+{
+    uint64 x = *(const uint64 *)a;
+    uint64 y = *(const uint64 *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Sort uintkey array in place in ascending order
+ */
+void
+kmersearch_sort_uintkey(void *keys, int nkeys, size_t elem_size)
+{
+    if (nkeys < 2)
+        return;
+
+    if (elem_size == sizeof(uint16))
+        qsort(keys, nkeys, sizeof(uint16), kmersearch_uintkey16_cmp);
+    else if (elem_size == sizeof(uint32))
+        qsort(keys, nkeys, sizeof(uint32), kmersearch_uintkey32_cmp);
+    else
+        qsort(keys, nkeys, sizeof(uint64), kmersearch_uintkey64_cmp);
+}
+
+/*
+ * Scalar branchless merge intersection
+ */
+static int
+kmersearch_intersect_sorted16_scalar(const uint16 *a, int na, const uint16 *b, int nb)
+{
+    int i = 0, j = 0, count = 0;
+
+    while (i < na && j < nb) {
+        uint16 x = a[i];
+        uint16 y = b[j];
+        count += (x == y);
+        i += (x <= y);
+        j += (y <= x);
+    }
+    return count;
+}
+
+static int
+kmersearch_intersect_sorted32_scalar(const uint32 *a, int na, const uint32 *b, int nb)
+{
+    int i = 0, j = 0, count = 0;
+
+    while (i < na && j < nb) {
+        uint32 x = a[i];
+        uint32 y = b[j];
+        count += (x == y);
+        i += (x <= y);
+        j += (y <= x);
+    }
+    return count;
+}
+
+static int
+kmersearch_intersect_sorted64_scalar(const uint64 *a, int na, const uint64 *b, int nb)
+{
+    int i = 0, j = 0, count = 0;
+
+    while (i < na && j < nb) {
+        uint64 x = a[i];
+        uint64 y = b[j];
+        count += (x == y);
+        i += (x <= y);
+        j += (y <= x);
+    }
+    return count;
+}
+
+/*
+ * Galloping intersection: 'small' is probed into 'large' with exponential
+ * search followed by binary search, O(n_small * log(n_large / n_small)).
+ */
+#define KMERSEARCH_DEFINE_GALLOP_INTERSECT(bits) \
+static int \
+kmersearch_intersect_gallop##bits(const uint##bits *small, int nsmall, const uint##bits *large, int nlarge) \
+{ \
+    int i; \
+    int base = 0; \
+    int count = 0; \
+    for (i = 0; i < nsmall && base < nlarge; i++) { \
+        uint##bits target = small[i]; \
+        int step = 1; \
+        int lo, hi; \
+        /* Exponential search for the first window containing target */ \
+        while (base + step < nlarge && large[base + step] < target) \
+            step <<= 1; \
+        lo = base + (step >> 1); \
+        hi = Min(base + step, nlarge - 1); \
+        /* Binary search for the lower bound of target in [lo, hi] */ \
+        while (lo < hi) { \
+            int mid = lo + ((hi - lo) >> 1); \
+            if (large[mid] < target) \
+                lo = mid + 1; \
+            else \
+                hi = mid; \
+        } \
+        if (large[lo] == target) { \
+            count++; \
+            base = lo + 1; \
+        } else { \
+            base = (large[lo] < target) ? lo + 1 : lo; \
+        } \
+    } \
+    return count; \
+}
+
+KMERSEARCH_DEFINE_GALLOP_INTERSECT(16)
+KMERSEARCH_DEFINE_GALLOP_INTERSECT(32)
+KMERSEARCH_DEFINE_GALLOP_INTERSECT(64)
+
+#ifdef __x86_64__
+/*
+ * AVX2 block intersection: compare an 8x8 (uint16/uint32) or 4x4 (uint64)
+ * block of keys all-against-all by rotating one vector, then advance the
+ * block whose maximum is smaller.  Remaining keys use the scalar merge.
+ */
+__attribute__((target("avx2")))
+static int
+kmersearch_intersect_sorted16_avx2(const uint16 *a, int na, const uint16 *b, int nb)
+{
+    int i = 0, j = 0, count = 0;
+
+    while (i + 8 <= na && j + 8 <= nb) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + j));
+        __m128i m = _mm_cmpeq_epi16(va, vb);
+        uint16 amax = a[i + 7];
+        uint16 bmax = b[j + 7];
+        int r;
+
+        for (r = 1; r < 8; r++) {
+            vb = _mm_alignr_epi8(vb, vb, 2);
+            m = _mm_or_si128(m, _mm_cmpeq_epi16(va, vb));
+        }
+        /* Two mask bits per 16-bit lane */
+        count += __builtin_popcount(_mm_movemask_epi8(m)) >> 1;
+        i += (amax <= bmax) ? 8 : 0;
+        j += (bmax <= amax) ? 8 : 0;
+    }
+
+    return count + kmersearch_intersect_sorted16_scalar(a + i, na - i, b + j, nb - j);
+}
+
+__attribute__((target("avx2")))
+static int
+kmersearch_intersect_sorted32_avx2(const uint32 *a, int na, const uint32 *b, int nb)
+{
+    int i = 0, j = 0, count = 0;
+    const __m256i rotate = _mm256_set_epi32(0, 7, 6, 5, 4, 3, 2, 1);
+
+    while (i + 8 <= na && j + 8 <= nb) {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + j));
+        __m256i m = _mm256_cmpeq_epi32(va, vb);
+        uint32 amax = a[i + 7];
+        uint32 bmax = b[j + 7];
+        int r;
+
+        for (r = 1; r < 8; r++) {
+            vb = _mm256_permutevar8x32_epi32(vb, rotate);
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, vb));
+        }
+        count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+        i += (amax <= bmax) ? 8 : 0;
+        j += (bmax <= amax) ? 8 : 0;
+    }
+
+    return count + kmersearch_intersect_sorted32_scalar(a + i, na - i, b + j, nb - j);
+}
+
+__attribute__((target("avx2")))
+static int
+kmersearch_intersect_sorted64_avx2(const uint64 *a, int na, const uint64 *b, int nb)
+{
+    int i = 0, j = 0, count = 0;
+
+    while (i + 4 <= na && j + 4 <= nb) {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + j));
+        __m256i m = _mm256_cmpeq_epi64(va, vb);
+        uint64 amax = a[i + 3];
+        uint64 bmax = b[j + 3];
+        int r;
+
+        for (r = 1; r < 4; r++) {
+            vb = _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1));
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi64(va, vb));
+        }
+        count += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(m)));
+        i += (amax <= bmax) ? 4 : 0;
+        j += (bmax <= amax) ? 4 : 0;
+    }
+
+    return count + kmersearch_intersect_sorted64_scalar(a + i, na - i, b + j, nb - j);
+}
+
+/*
+ * AVX512 block intersection: 16x16 (uint32) or 8x8 (uint64) blocks
+ */
+__attribute__((target("avx512f")))
+static int
+kmersearch_intersect_sorted32_avx512(const uint32 *a, int na, const uint32 *b, int nb)
+{
+    int i = 0, j = 0, count = 0;
+
+    while (i + 16 <= na && j + 16 <= nb) {
+        __m512i va = _mm512_loadu_si512((const void *)(a + i));
+        __m512i vb = _mm512_loadu_si512((const void *)(b + j));
+        __mmask16 m = _mm512_cmpeq_epi32_mask(va, vb);
+        uint32 amax = a[i + 15];
+        uint32 bmax = b[j + 15];
+        int r;
+
+        for (r = 1; r < 16; r++) {
+            vb = _mm512_alignr_epi32(vb, vb, 1);
+            m |= _mm512_cmpeq_epi32_mask(va, vb);
+        }
+        count += __builtin_popcount((unsigned int) m);
+        i += (amax <= bmax) ? 16 : 0;
+        j += (bmax <= amax) ? 16 : 0;
+    }
+
+    return count + kmersearch_intersect_sorted32_scalar(a + i, na - i, b + j, nb - j);
+}
+
+__attribute__((target("avx512f")))
+static int
+kmersearch_intersect_sorted64_avx512(const uint64 *a, int na, const uint64 *b, int nb)
+{
+    int i = 0, j = 0, count = 0;
+
+    while (i + 8 <= na && j + 8 <= nb) {
+        __m512i va = _mm512_loadu_si512((const void *)(a + i));
+        __m512i vb = _mm512_loadu_si512((const void *)(b + j));
+        __mmask8 m = _mm512_cmpeq_epi64_mask(va, vb);
+        uint64 amax = a[i + 7];
+        uint64 bmax = b[j + 7];
+        int r;
+
+        for (r = 1; r < 8; r++) {
+            vb = _mm512_alignr_epi64(vb, vb, 1);
+            m |= _mm512_cmpeq_epi64_mask(va, vb);
+        }
+        count += __builtin_popcount((unsigned int) m);
+        i += (amax <= bmax) ? 8 : 0;
+        j += (bmax <= amax) ? 8 : 0;
     }
-    
-    *output = result;
-    *nkeys = result_count;
+
+    return count + kmersearch_intersect_sorted64_scalar(a + i, na - i, b + j, nb - j);
 }
+#endif
 
 /*
- * Extract uint keys with occurrence counting from DNA2 sequence (dispatch function)
+ * Build presence bitmap of 16-bit uintkeys
+ * bitmap must hold KMERSEARCH_UINTKEY16_BITMAP_WORDS words.
  */
 void
-kmersearch_extract_uintkey_from_dna2(VarBit *seq, void **output, int *nkeys)
+kmersearch_build_uintkey16_bitmap(const uint16 *keys, int nkeys, uint64 *bitmap)
 {
-    int seq_bits = VARBITLEN(seq);
-    
-    /* SIMD capability check */
-    
-    /* SIMD implementations can be added later based on capability and threshold */
-#ifdef __x86_64__
-    /* Future: Add AVX2/AVX512 dispatch based on simd_capability */
-    if (simd_capability >= SIMD_AVX2) {
-        /* AVX2 available but not yet implemented for DNA2 extraction, using scalar */
-    }
-#elif defined(__aarch64__)
-    /* Future: Add NEON/SVE dispatch based on simd_capability */
-    if (simd_capability >= SIMD_NEON) {
-        /* NEON available but not yet implemented for DNA2 extraction, using scalar */
-    }
-#endif
-    
-    kmersearch_extract_uintkey_from_dna2_scalar(seq, output, nkeys);
+    int i;
+
+    memset(bitmap, 0, KMERSEARCH_UINTKEY16_BITMAP_WORDS * sizeof(uint64));
+    for (i = 0; i < nkeys; i++)
+        bitmap[keys[i] >> 6] |= UINT64CONST(1) << (keys[i] & 63);
 }
 
 /*
- * Extract uint keys with occurrence counting from DNA4 sequence (scalar implementation)
+ * Count 16-bit sequence uintkeys present in a query presence bitmap
+ * Short sequences use one bit test per key; sequences with at least as many
+ * keys as bitmap words are turned into a bitmap themselves and counted with
+ * AND + popcount over the 8KB universe.
  */
-static void
-kmersearch_extract_uintkey_from_dna4_scalar(VarBit *seq, void **output, int *nkeys)
+static int
+kmersearch_count_matching_bitmap16(const uint64 *query_bitmap, const uint16 *seq_keys, int seq_nkeys)
 {
-    int k = kmersearch_kmer_size;
-    int occur_bitlen = kmersearch_occur_bitlen;
-    int seq_bits = VARBITLEN(seq);
-    int seq_len = seq_bits / 4;  /* DNA4 uses 4 bits per character */
-    int max_kmers = seq_len - k + 1;
-    int kmer_bits = k * 2;  /* Output is DNA2 format */
-    int total_bits = kmer_bits + occur_bitlen;
-    size_t elem_size;
-    void *result;
-    int result_count = 0;
-    int result_capacity;
+    int shared_count = 0;
     int i;
-    void *occurrences = NULL;
-    int occurrence_count = 0;
-    
-    /* Validate parameters */
-    if (k < 4 || k > 32) {
-        ereport(ERROR,
-                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                 errmsg("Invalid k-mer size: %d", k),
-                 errdetail("k-mer size must be between 4 and 32")));
-    }
-    
-    if (occur_bitlen < 0 || occur_bitlen > 16) {
-        ereport(ERROR,
-                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                 errmsg("Invalid occurrence bit length: %d", occur_bitlen),
-                 errdetail("Occurrence bit length must be between 0 and 16")));
-    }
-    
-    if (total_bits > 64) {
-        ereport(ERROR,
-                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                 errmsg("Total bit length exceeds 64 bits"),
-                 errdetail("k-mer bits: %d, occurrence bits: %d, total: %d", 
-                          kmer_bits, occur_bitlen, total_bits)));
-    }
-    
-    if (max_kmers <= 0) {
-        ereport(ERROR,
-                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                 errmsg("Query sequence must be at least %d bases long", k)));
-        return;
-    }
-    
-    /* Determine element size based on total bits */
-    if (total_bits <= 16) {
-        elem_size = sizeof(uint16);
-    } else if (total_bits <= 32) {
-        elem_size = sizeof(uint32);
-    } else {
-        elem_size = sizeof(uint64);
-    }
-    
-    /* Allocate result array with extra space for degenerate expansions */
-    result_capacity = max_kmers * 16;  /* Conservative estimate for degenerate bases */
-    result = palloc(result_capacity * elem_size);
-    
-    if (elem_size == sizeof(uint16)) {
-        occurrences = palloc0(result_capacity * sizeof(KmerOccurrence16));
-    } else if (elem_size == sizeof(uint32)) {
-        occurrences = palloc0(result_capacity * sizeof(KmerOccurrence32));
+
+    if (seq_nkeys < KMERSEARCH_UINTKEY16_BITMAP_WORDS) {
+        for (i = 0; i < seq_nkeys; i++)
+            shared_count += (int) ((query_bitmap[seq_keys[i] >> 6] >> (seq_keys[i] & 63)) & 1);
     } else {
-        occurrences = palloc0(result_capacity * sizeof(KmerOccurrence64));
-    }
-    
-    /* Process each k-mer position */
-    for (i = 0; i <= seq_len - k; i++) {
-        void *expanded_uintkeys;
-        int expansion_count;
-        int j;
-        
-        /* Expand DNA4 k-mer directly to uintkey format */
-        kmersearch_expand_dna4_to_uintkey(seq, i, k, &expanded_uintkeys, &expansion_count, elem_size);
-        
-        if (!expanded_uintkeys || expansion_count == 0) {
-            continue;
-        }
-        
-        /* Process each expanded k-mer */
-        for (j = 0; j < expansion_count; j++) {
-            int current_count;
-            
-            /* Process directly as appropriate uint type */
-            if (elem_size == sizeof(uint16)) {
-                uint16 kmer_value = ((uint16 *)expanded_uintkeys)[j];
-                uint16 final_value;
-                
-                current_count = kmersearch_find_or_add_kmer_occurrence16(
-                    (KmerOccurrence16 *)occurrences, &occurrence_count,
-                    kmer_value, result_capacity);
-                if (current_count < 0) {
-                    continue;
-                }
-                
-                if (occur_bitlen > 0 && current_count > (1 << occur_bitlen)) {
-                    continue;
-                }
-                
-                if (occur_bitlen == 0) {
-                    /* For occur_bitlen=0, only output unique k-mers (first occurrence) */
-                    if (current_count == 1) {
-                        final_value = kmer_value;
-                        ((uint16 *)result)[result_count++] = final_value;
-                    }
-                } else {
-                    /* Include occurrence count in the uintkey */
-                    final_value = (kmer_value << occur_bitlen) | ((current_count - 1) & ((1 << occur_bitlen) - 1));
-                    ((uint16 *)result)[result_count++] = final_value;
-                }
-                
-            } else if (elem_size == sizeof(uint32)) {
-                uint32 kmer_value = ((uint32 *)expanded_uintkeys)[j];
-                uint32 final_value;
-                
-                current_count = kmersearch_find_or_add_kmer_occurrence32(
-                    (KmerOccurrence32 *)occurrences, &occurrence_count,
-                    kmer_value, result_capacity);
-                if (current_count < 0) {
-                    continue;
-                }
-                
-                if (occur_bitlen > 0 && current_count > (1 << occur_bitlen)) {
-                    continue;
-                }
-                
-                if (occur_bitlen == 0) {
-                    /* For occur_bitlen=0, only output unique k-mers (first occurrence) */
-                    if (current_count == 1) {
-                        final_value = kmer_value;
-                        ((uint32 *)result)[result_count++] = final_value;
-                    }
-                } else {
-                    /* Include occurrence count in the uintkey */
-                    final_value = (kmer_value << occur_bitlen) | ((current_count - 1) & ((1 << occur_bitlen) - 1));
-                    ((uint32 *)result)[result_count++] = final_value;
-                }
-                
-            } else {
-                uint64 kmer_value = ((uint64 *)expanded_uintkeys)[j];
-                uint64 final_value;
-                
-                current_count = kmersearch_find_or_add_kmer_occurrence64(
-                    (KmerOccurrence64 *)occurrences, &occurrence_count,
-                    kmer_value, result_capacity);
-                if (current_count < 0) {
-                    continue;
-                }
-                
-                if (occur_bitlen > 0 && current_count > (1 << occur_bitlen)) {
-                    continue;
-                }
-                
-                if (occur_bitlen == 0) {
-                    /* For occur_bitlen=0, only output unique k-mers (first occurrence) */
-                    if (current_count == 1) {
-                        final_value = kmer_value;
-                        ((uint64 *)result)[result_count++] = final_value;
-                    }
-                } else {
-                    /* Include occurrence count in the uintkey */
-                    final_value = (kmer_value << occur_bitlen) | ((current_count - 1) & ((1 << occur_bitlen) - 1));
-                    ((uint64 *)result)[result_count++] = final_value;
-                }
-            }
-        }
-        
-        /* Free the expansion array */
-        if (expanded_uintkeys) {
-            pfree(expanded_uintkeys);
-        }
-    }
-    
-    /* Free occurrence tracking array */
-    pfree(occurrences);
-    
-    /* Reallocate to actual size if needed */
-    if (result_count < result_capacity) {
-        void *new_result = palloc(result_count * elem_size);
-        memcpy(new_result, result, result_count * elem_size);
-        pfree(result);
-        result = new_result;
+        uint64 seq_bitmap[KMERSEARCH_UINTKEY16_BITMAP_WORDS];
+
+        kmersearch_build_uintkey16_bitmap(seq_keys, seq_nkeys, seq_bitmap);
+        for (i = 0; i < KMERSEARCH_UINTKEY16_BITMAP_WORDS; i++)
+            shared_count += __builtin_popcountll(query_bitmap[i] & seq_bitmap[i]);
     }
-    
-    *output = result;
-    *nkeys = result_count;
+
+    return shared_count;
 }
 
 /*
- * Extract uint keys with occurrence counting from DNA4 sequence (dispatch function)
+ * Count shared keys between two sorted, duplicate-free uintkey arrays
+ * (dispatch function)
  */
-void
-kmersearch_extract_uintkey_from_dna4(VarBit *seq, void **output, int *nkeys)
+int
+kmersearch_count_matching_sorted_uintkey(const void *a, int na, const void *b, int nb, size_t elem_size)
 {
-    int seq_bits = VARBITLEN(seq);
-    
-    /* SIMD capability check */
-    
-    /* SIMD implementations can be added later based on capability and threshold */
-#ifdef __x86_64__
-    /* Future: Add AVX2/AVX512 dispatch based on simd_capability */
-    if (simd_capability >= SIMD_AVX2) {
-        /* AVX2 available but not yet implemented for DNA4 extraction, using scalar */
+    int nsmall = Min(na, nb);
+    int nlarge = Max(na, nb);
+
+    if (nsmall == 0)
+        return 0;
+
+    /* Highly skewed sizes: galloping beats any linear merge */
+    if (nlarge / nsmall >= KMERSEARCH_INTERSECT_GALLOP_RATIO) {
+        const void *small = (na <= nb) ? a : b;
+        const void *large = (na <= nb) ? b : a;
+
+        if (elem_size == sizeof(uint16))
+            return kmersearch_intersect_gallop16((const uint16 *)small, nsmall, (const uint16 *)large, nlarge);
+        else if (elem_size == sizeof(uint32))
+            return kmersearch_intersect_gallop32((const uint32 *)small, nsmall, (const uint32 *)large, nlarge);
+        else
+            return kmersearch_intersect_gallop64((const uint64 *)small, nsmall, (const uint64 *)large, nlarge);
     }
-#elif defined(__aarch64__)
-    /* Future: Add NEON/SVE dispatch based on simd_capability */
-    if (simd_capability >= SIMD_NEON) {
-        /* NEON available but not yet implemented for DNA4 extraction, using scalar */
+
+#ifdef __x86_64__
+    if (elem_size == sizeof(uint16)) {
+        if (simd_capability >= SIMD_AVX2 && nsmall >= SIMD_INTERSECT_AVX2_THRESHOLD)
+            return kmersearch_intersect_sorted16_avx2((const uint16 *)a, na, (const uint16 *)b, nb);
+    } else if (elem_size == sizeof(uint32)) {
+        if (simd_capability >= SIMD_AVX512F && nsmall >= SIMD_INTERSECT_AVX512_THRESHOLD)
+            return kmersearch_intersect_sorted32_avx512((const uint32 *)a, na, (const uint32 *)b, nb);
+        if (simd_capability >= SIMD_AVX2 && nsmall >= SIMD_INTERSECT_AVX2_THRESHOLD)
+            return kmersearch_intersect_sorted32_avx2((const uint32 *)a, na, (const uint32 *)b, nb);
+    } else {
+        if (simd_capability >= SIMD_AVX512F && nsmall >= SIMD_INTERSECT_AVX512_THRESHOLD)
+            return kmersearch_intersect_sorted64_avx512((const uint64 *)a, na, (const uint64 *)b, nb);
+        if (simd_capability >= SIMD_AVX2 && nsmall >= SIMD_INTERSECT_AVX2_THRESHOLD)
+            return kmersearch_intersect_sorted64_avx2((const uint64 *)a, na, (const uint64 *)b, nb);
     }
 #endif
-    
-    kmersearch_extract_uintkey_from_dna4_scalar(seq, output, nkeys);
+
+    if (elem_size == sizeof(uint16))
+        return kmersearch_intersect_sorted16_scalar((const uint16 *)a, na, (const uint16 *)b, nb);
+    else if (elem_size == sizeof(uint32))
+        return kmersearch_intersect_sorted32_scalar((const uint32 *)a, na, (const uint32 *)b, nb);
+    else
+        return kmersearch_intersect_sorted64_scalar((const uint64 *)a, na, (const uint64 *)b, nb);
 }
 
 /*
- * Count matching uintkeys - scalar implementation with hash table
+ * Count matching uintkeys - dispatch function
+ * 16-bit keys use a presence bitmap; wider keys are sorted and run through
+ * the sorted intersection engine
  */
-static int
-kmersearch_count_matching_uintkey_scalar(void *seq_keys, int seq_nkeys, void *query_keys, int query_nkeys, int k_size)
+int
+kmersearch_count_matching_uintkey(void *seq_keys, int seq_nkeys, void *query_keys, int query_nkeys, int k_size)
 {
-    int shared_count = 0;
-    int i;
-    HTAB *query_hash;
-    HASHCTL hash_ctl;
-    bool found;
     int total_bits;
-    
+    size_t elem_size;
+    void *seq_sorted;
+    void *query_sorted;
+    int shared_count;
+
     if (seq_nkeys == 0 || query_nkeys == 0)
         return 0;
-    
+
     total_bits = k_size * 2 + kmersearch_occur_bitlen;
-    
-    /* Use hash table for O(n+m) performance */
-    memset(&hash_ctl, 0, sizeof(hash_ctl));
-    
-    if (total_bits <= 16) {
-        hash_ctl.keysize = sizeof(uint16);
-        hash_ctl.entrysize = sizeof(uint16);
-    }
-    else if (total_bits <= 32) {
-        hash_ctl.keysize = sizeof(uint32);
-        hash_ctl.entrysize = sizeof(uint32);
-    }
-    else {
-        hash_ctl.keysize = sizeof(uint64);
-        hash_ctl.entrysize = sizeof(uint64);
-    }
-    
-    hash_ctl.hash = tag_hash;
-    query_hash = hash_create("QueryUintkeyHash", query_nkeys * 2, &hash_ctl,
-                            HASH_ELEM | HASH_FUNCTION | HASH_BLOBS);
-    
-    /* Insert all query uintkeys into hash table */
     if (total_bits <= 16) {
-        uint16 *query = (uint16 *)query_keys;
-        uint16 *seq;
-        
-        for (i = 0; i < query_nkeys; i++) {
-            hash_search(query_hash, &query[i], HASH_ENTER, &found);
-        }
-        
-        /* Check each sequence uintkey against hash table */
-        seq = (uint16 *)seq_keys;
-        for (i = 0; i < seq_nkeys; i++) {
-            if (hash_search(query_hash, &seq[i], HASH_FIND, NULL)) {
-                shared_count++;
-            }
-        }
-    }
-    else if (total_bits <= 32) {
-        uint32 *query = (uint32 *)query_keys;
-        uint32 *seq;
-        
-        for (i = 0; i < query_nkeys; i++) {
-            hash_search(query_hash, &query[i], HASH_ENTER, &found);
-        }
-        
-        seq = (uint32 *)seq_keys;
-        for (i = 0; i < seq_nkeys; i++) {
-            if (hash_search(query_hash, &seq[i], HASH_FIND, NULL)) {
-                shared_count++;
-            }
-        }
-    }
-    else {
-        uint64 *query = (uint64 *)query_keys;
-        uint64 *seq;
-        
-        for (i = 0; i < query_nkeys; i++) {
-            hash_search(query_hash, &query[i], HASH_ENTER, &found);
-        }
-        
-        seq = (uint64 *)seq_keys;
-        for (i = 0; i < seq_nkeys; i++) {
-            if (hash_search(query_hash, &seq[i], HASH_FIND, NULL)) {
-                shared_count++;
-            }
-        }
+        /* Whole key universe fits in an 8KB bitmap: no sorting needed */
+        uint64 query_bitmap[KMERSEARCH_UINTKEY16_BITMAP_WORDS];
+
+        kmersearch_build_uintkey16_bitmap((const uint16 *)query_keys, query_nkeys, query_bitmap);
+        return kmersearch_count_matching_bitmap16(query_bitmap, (const uint16 *)seq_keys, seq_nkeys);
     }
-    
-    /* Clean up hash table */
-    hash_destroy(query_hash);
-    
+    else if (total_bits <= 32)
+        elem_size = sizeof(uint32);
+    else
+        elem_size = sizeof(uint64);
+
+    seq_sorted = palloc(seq_nkeys * elem_size);
+    memcpy(seq_sorted, seq_keys, seq_nkeys * elem_size);
+    kmersearch_sort_uintkey(seq_sorted, seq_nkeys, elem_size);
+
+    query_sorted = palloc(query_nkeys * elem_size);
+    memcpy(query_sorted, query_keys, query_nkeys * elem_size);
+    kmersearch_sort_uintkey(query_sorted, query_nkeys, elem_size);
+
+    shared_count = kmersearch_count_matching_sorted_uintkey(seq_sorted, seq_nkeys,
+                                                            query_sorted, query_nkeys,
+                                                            elem_size);
+
+    pfree(seq_sorted);
+    pfree(query_sorted);
+
     return shared_count;
 }
 
 /*
- * Count matching uintkeys - dispatch function
- * This will dispatch to SIMD implementations in the future
+ * Count sequence uintkeys present in a compiled query
+ * One probe per sequence key into the query's presence bitmap (16-bit keys)
+ * or open-addressing set; no allocation and no sorting of the sequence keys.
  */
 int
-kmersearch_count_matching_uintkey(void *seq_keys, int seq_nkeys, void *query_keys, int query_nkeys, int k_size)
+kmersearch_count_matching_compiled_query(QueryKmerCacheEntry *query, void *seq_keys, int seq_nkeys)
 {
-    /* Future: Add SIMD dispatch based on simd_capability */
-    return kmersearch_count_matching_uintkey_scalar(seq_keys, seq_nkeys, query_keys, query_nkeys, k_size);
+    int shared_count = 0;
+    int i;
+
+    if (query == NULL || seq_nkeys == 0 || query->kmer_count == 0)
+        return 0;
+
+    if (query->presence_bitmap != NULL)
+        return kmersearch_count_matching_bitmap16(query->presence_bitmap,
+                                                  (const uint16 *) seq_keys, seq_nkeys);
+
+#define KMERSEARCH_PROBE_LOOP(type) \
+    do { \
+        const type *keys = (const type *) seq_keys; \
+        for (i = 0; i < seq_nkeys; i++) \
+            shared_count += kmersearch_compiled_query_contains(query, keys[i]) ? 1 : 0; \
+    } while (0)
+
+    if (query->elem_size == sizeof(uint16))
+        KMERSEARCH_PROBE_LOOP(uint16);
+    else if (query->elem_size == sizeof(uint32))
+        KMERSEARCH_PROBE_LOOP(uint32);
+    else
+        KMERSEARCH_PROBE_LOOP(uint64);
+
+#undef KMERSEARCH_PROBE_LOOP
+
+    return shared_count;
 }
 
 /*
@@ -1125,7 +2045,7 @@ kmersearch_expand_text_to_uintkey(const char *text, int start_pos, int k,
  * Directly processes text without DNA4 intermediate representation
  */
 void
-kmersearch_extract_uintkey_from_text(const char *text, void **output, int *nkeys)
+kmersearch_extract_uintkey_from_text(const char *text, void **output, int *nkeys, bool canonical)
 {
     int text_len = strlen(text);
     int k = kmersearch_kmer_size;
@@ -1138,8 +2058,7 @@ kmersearch_extract_uintkey_from_text(const char *text, void **output, int *nkeys
     int result_count = 0;
     int result_capacity;
     int i;
-    void *occurrences = NULL;
-    int occurrence_count = 0;
+    KmerOccurrenceTable *occurrences;
     
     /* Validate parameters */
     if (k < 4 || k > 32) {
@@ -1197,13 +2116,7 @@ kmersearch_extract_uintkey_from_text(const char *text, void **output, int *nkeys
     result_capacity = max_kmers * 16;  /* Conservative estimate for degenerate bases */
     result = palloc(result_capacity * elem_size);
     
-    if (elem_size == sizeof(uint16)) {
-        occurrences = palloc0(result_capacity * sizeof(KmerOccurrence16));
-    } else if (elem_size == sizeof(uint32)) {
-        occurrences = palloc0(result_capacity * sizeof(KmerOccurrence32));
-    } else {
-        occurrences = palloc0(result_capacity * sizeof(KmerOccurrence64));
-    }
+    occurrences = kmersearch_occurrence_table_begin(max_kmers, canonical);
     
     /* Process each k-mer position */
     for (i = 0; i <= text_len - k; i++) {
@@ -1220,90 +2133,18 @@ kmersearch_extract_uintkey_from_text(const char *text, void **output, int *nkeys
         
         /* Process each expanded k-mer */
         for (j = 0; j < expansion_count; j++) {
-            int current_count;
+            uint64 kmer_value;
+            uint64 uintkey;
             
-            /* Process directly as appropriate uint type */
-            if (elem_size == sizeof(uint16)) {
-                uint16 kmer_value = ((uint16 *)expanded_uintkeys)[j];
-                uint16 final_value;
-                
-                current_count = kmersearch_find_or_add_kmer_occurrence16(
-                    (KmerOccurrence16 *)occurrences, &occurrence_count,
-                    kmer_value, result_capacity);
-                if (current_count < 0) {
-                    continue;
-                }
-                
-                if (occur_bitlen > 0 && current_count > (1 << occur_bitlen)) {
-                    continue;
-                }
-                
-                if (occur_bitlen == 0) {
-                    /* For occur_bitlen=0, only output unique k-mers (first occurrence) */
-                    if (current_count == 1) {
-                        final_value = kmer_value;
-                        ((uint16 *)result)[result_count++] = final_value;
-                    }
-                } else {
-                    /* Include occurrence count in the uintkey */
-                    final_value = (kmer_value << occur_bitlen) | ((current_count - 1) & ((1 << occur_bitlen) - 1));
-                    ((uint16 *)result)[result_count++] = final_value;
-                }
-                
-            } else if (elem_size == sizeof(uint32)) {
-                uint32 kmer_value = ((uint32 *)expanded_uintkeys)[j];
-                uint32 final_value;
-                
-                current_count = kmersearch_find_or_add_kmer_occurrence32(
-                    (KmerOccurrence32 *)occurrences, &occurrence_count,
-                    kmer_value, result_capacity);
-                if (current_count < 0) {
-                    continue;
-                }
-                
-                if (occur_bitlen > 0 && current_count > (1 << occur_bitlen)) {
-                    continue;
-                }
-                
-                if (occur_bitlen == 0) {
-                    /* For occur_bitlen=0, only output unique k-mers (first occurrence) */
-                    if (current_count == 1) {
-                        final_value = kmer_value;
-                        ((uint32 *)result)[result_count++] = final_value;
-                    }
-                } else {
-                    /* Include occurrence count in the uintkey */
-                    final_value = (kmer_value << occur_bitlen) | ((current_count - 1) & ((1 << occur_bitlen) - 1));
-                    ((uint32 *)result)[result_count++] = final_value;
-                }
-                
-            } else {
-                uint64 kmer_value = ((uint64 *)expanded_uintkeys)[j];
-                uint64 final_value;
-                
-                current_count = kmersearch_find_or_add_kmer_occurrence64(
-                    (KmerOccurrence64 *)occurrences, &occurrence_count,
-                    kmer_value, result_capacity);
-                if (current_count < 0) {
-                    continue;
-                }
-                
-                if (occur_bitlen > 0 && current_count > (1 << occur_bitlen)) {
-                    continue;
-                }
-                
-                if (occur_bitlen == 0) {
-                    /* For occur_bitlen=0, only output unique k-mers (first occurrence) */
-                    if (current_count == 1) {
-                        final_value = kmer_value;
-                        ((uint64 *)result)[result_count++] = final_value;
-                    }
-                } else {
-                    /* Include occurrence count in the uintkey */
-                    final_value = (kmer_value << occur_bitlen) | ((current_count - 1) & ((1 << occur_bitlen) - 1));
-                    ((uint64 *)result)[result_count++] = final_value;
-                }
-            }
+            if (elem_size == sizeof(uint16))
+                kmer_value = ((uint16 *)expanded_uintkeys)[j];
+            else if (elem_size == sizeof(uint32))
+                kmer_value = ((uint32 *)expanded_uintkeys)[j];
+            else
+                kmer_value = ((uint64 *)expanded_uintkeys)[j];
+            
+            if (kmersearch_occurrence_uintkey(occurrences, kmer_value, occur_bitlen, &uintkey))
+                kmersearch_store_uintkey(result, result_count++, elem_size, uintkey);
         }
         
         /* Free the expansion array */
@@ -1312,8 +2153,8 @@ kmersearch_extract_uintkey_from_text(const char *text, void **output, int *nkeys
         }
     }
     
-    /* Free occurrence tracking array */
-    pfree(occurrences);
+    /* Finish occurrence tracking (table is reused by the next call) */
+    kmersearch_occurrence_table_end(occurrences);
     
     /* Reallocate to actual size if needed */
     if (result_count < result_capacity) {
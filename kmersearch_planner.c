@@ -46,6 +46,7 @@ typedef struct KmersearchIndexSettings
 	float		max_appearance_rate;
 	int			max_appearance_nrow;
 	bool		preclude_highfreq_kmer;
+	int			syncmer_size;	/* 0 unless built with a syncmer opclass */
 } KmersearchIndexSettings;
 
 /* Forward declarations */
@@ -213,6 +214,9 @@ kmersearch_get_index_settings_direct(Oid index_oid, KmersearchIndexSettings *set
 		datum = heap_getattr(tuple, 10, tupdesc, &isnull);
 		settings->preclude_highfreq_kmer = isnull ? false : DatumGetBool(datum);
 
+		datum = heap_getattr(tuple, 11, tupdesc, &isnull);
+		settings->syncmer_size = isnull ? 0 : DatumGetInt32(datum);
+
 		settings->settings_found = true;
 		found = true;
 		break;
@@ -248,6 +252,10 @@ kmersearch_check_settings_match(KmersearchIndexSettings *settings)
 	if (settings->preclude_highfreq_kmer != kmersearch_preclude_highfreq_kmer)
 		return false;
 
+	/* Syncmer indexes sample k-mers with the s-mer length they were built with */
+	if (settings->syncmer_size != 0 && settings->syncmer_size != kmersearch_syncmer_size)
+		return false;
+
 	return true;
 }
 
@@ -309,13 +317,14 @@ kmersearch_add_matching_index_path(PlannerInfo *root, RelOptInfo *rel,
 				 errmsg("no GIN index found matching current GUC settings"),
 				 errdetail("Current settings: kmersearch.kmer_size=%d, kmersearch.occur_bitlen=%d, "
 						   "kmersearch.max_appearance_rate=%.4f, kmersearch.max_appearance_nrow=%d, "
-						   "kmersearch.preclude_highfreq_kmer=%s",
+						   "kmersearch.preclude_highfreq_kmer=%s, kmersearch.syncmer_size=%d",
 						   kmersearch_kmer_size, kmersearch_occur_bitlen,
 						   kmersearch_max_appearance_rate, kmersearch_max_appearance_nrow,
-						   kmersearch_preclude_highfreq_kmer ? "true" : "false"),
+						   kmersearch_preclude_highfreq_kmer ? "true" : "false",
+						   kmersearch_syncmer_size),
 				 errhint("Create a GIN index with matching settings, or adjust GUC variables to match an existing index. "
 						 "Check available indexes with: SELECT index_oid::regclass, kmer_size, occur_bitlen, "
-						 "max_appearance_rate, max_appearance_nrow, preclude_highfreq_kmer FROM kmersearch_index_info")));
+						 "max_appearance_rate, max_appearance_nrow, preclude_highfreq_kmer, syncmer_size FROM kmersearch_index_info")));
 	}
 
 	new_indexclauses = NIL;
@@ -7,36 +7,36 @@ CREATE TYPE DNA4;
 -- DNA2 input/output functions
 CREATE FUNCTION kmersearch_dna2_in(cstring) RETURNS DNA2
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_in'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna2_out(DNA2) RETURNS cstring
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_out'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna2_recv(internal) RETURNS DNA2
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_recv'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna2_send(DNA2) RETURNS bytea
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_send'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- DNA4 input/output functions
 CREATE FUNCTION kmersearch_dna4_in(cstring) RETURNS DNA4
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_in'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna4_out(DNA4) RETURNS cstring
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_out'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna4_recv(internal) RETURNS DNA4
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_recv'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna4_send(DNA4) RETURNS bytea
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_send'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- Complete DNA2 type definition
 CREATE TYPE DNA2 (
@@ -61,7 +61,7 @@ CREATE TYPE DNA4 (
 -- Equality operators
 CREATE FUNCTION kmersearch_dna2_eq(DNA2, DNA2) RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_eq'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE OPERATOR = (
     LEFTARG = DNA2,
@@ -73,7 +73,7 @@ CREATE OPERATOR = (
 
 CREATE FUNCTION kmersearch_dna4_eq(DNA4, DNA4) RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_eq'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE OPERATOR = (
     LEFTARG = DNA4,
@@ -86,32 +86,32 @@ CREATE OPERATOR = (
 -- BTree comparison functions
 CREATE FUNCTION kmersearch_dna2_cmp(DNA2, DNA2) RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_cmp'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna4_cmp(DNA4, DNA4) RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_cmp'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- DNA2 comparison operators
 CREATE FUNCTION kmersearch_dna2_lt(DNA2, DNA2) RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_lt'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna2_le(DNA2, DNA2) RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_le'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna2_gt(DNA2, DNA2) RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_gt'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna2_ge(DNA2, DNA2) RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_ge'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna2_ne(DNA2, DNA2) RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_ne'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE OPERATOR < (
     LEFTARG = DNA2,
@@ -156,23 +156,23 @@ CREATE OPERATOR <> (
 -- DNA4 comparison operators
 CREATE FUNCTION kmersearch_dna4_lt(DNA4, DNA4) RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_lt'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna4_le(DNA4, DNA4) RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_le'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna4_gt(DNA4, DNA4) RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_gt'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna4_ge(DNA4, DNA4) RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_ge'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna4_ne(DNA4, DNA4) RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_ne'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE OPERATOR < (
     LEFTARG = DNA4,
@@ -217,7 +217,7 @@ CREATE OPERATOR <> (
 -- =% operators for k-mer search
 CREATE FUNCTION kmersearch_dna2_match(DNA2, text) RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_match'
-    LANGUAGE C IMMUTABLE STRICT
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
     COST 1000;
 
 CREATE OPERATOR =% (
@@ -228,7 +228,7 @@ CREATE OPERATOR =% (
 
 CREATE FUNCTION kmersearch_dna4_match(DNA4, text) RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_match'
-    LANGUAGE C IMMUTABLE STRICT
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
     COST 1000;
 
 CREATE OPERATOR =% (
@@ -237,70 +237,201 @@ CREATE OPERATOR =% (
     FUNCTION = kmersearch_dna4_match
 );
 
+-- =%% operators for strand-independent (canonical k-mer) search
+CREATE FUNCTION kmersearch_dna2_match_canonical(DNA2, text) RETURNS boolean
+    AS 'MODULE_PATHNAME', 'kmersearch_dna2_match_canonical'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 1000;
+
+CREATE OPERATOR =%% (
+    LEFTARG = DNA2,
+    RIGHTARG = text,
+    FUNCTION = kmersearch_dna2_match_canonical
+);
+
+CREATE FUNCTION kmersearch_dna4_match_canonical(DNA4, text) RETURNS boolean
+    AS 'MODULE_PATHNAME', 'kmersearch_dna4_match_canonical'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 1000;
+
+CREATE OPERATOR =%% (
+    LEFTARG = DNA4,
+    RIGHTARG = text,
+    FUNCTION = kmersearch_dna4_match_canonical
+);
+
 
 -- New uintkey-based GIN functions for DNA2
 CREATE FUNCTION kmersearch_extract_value_dna2_int2(DNA2, internal)
     RETURNS internal
     AS 'MODULE_PATHNAME', 'kmersearch_extract_value_dna2_int2'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_extract_value_dna2_int4(DNA2, internal)
     RETURNS internal
     AS 'MODULE_PATHNAME', 'kmersearch_extract_value_dna2_int4'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_extract_value_dna2_int8(DNA2, internal)
     RETURNS internal
     AS 'MODULE_PATHNAME', 'kmersearch_extract_value_dna2_int8'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- New uintkey-based GIN functions for DNA4
 CREATE FUNCTION kmersearch_extract_value_dna4_int2(DNA4, internal)
     RETURNS internal
     AS 'MODULE_PATHNAME', 'kmersearch_extract_value_dna4_int2'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_extract_value_dna4_int4(DNA4, internal)
     RETURNS internal
     AS 'MODULE_PATHNAME', 'kmersearch_extract_value_dna4_int4'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_extract_value_dna4_int8(DNA4, internal)
     RETURNS internal
     AS 'MODULE_PATHNAME', 'kmersearch_extract_value_dna4_int8'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- New uintkey-based extract_query functions
 CREATE FUNCTION kmersearch_extract_query_int2(text, internal, int2, internal, internal)
     RETURNS internal
     AS 'MODULE_PATHNAME', 'kmersearch_extract_query_int2'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_extract_query_int4(text, internal, int2, internal, internal)
     RETURNS internal
     AS 'MODULE_PATHNAME', 'kmersearch_extract_query_int4'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_extract_query_int8(text, internal, int2, internal, internal)
     RETURNS internal
     AS 'MODULE_PATHNAME', 'kmersearch_extract_query_int8'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- New uintkey-based consistent functions
 CREATE FUNCTION kmersearch_consistent_int2(internal, int2, text, int4, internal, internal)
     RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_consistent_int2'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_consistent_int4(internal, int2, text, int4, internal, internal)
     RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_consistent_int4'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_consistent_int8(internal, int2, text, int4, internal, internal)
     RETURNS boolean
     AS 'MODULE_PATHNAME', 'kmersearch_consistent_int8'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- GIN triConsistent functions (three-valued consistent for fast scan)
+CREATE FUNCTION kmersearch_triconsistent_int2(internal, int2, text, int4, internal, internal, internal)
+    RETURNS "char"
+    AS 'MODULE_PATHNAME', 'kmersearch_triconsistent_int2'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_triconsistent_int4(internal, int2, text, int4, internal, internal, internal)
+    RETURNS "char"
+    AS 'MODULE_PATHNAME', 'kmersearch_triconsistent_int4'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_triconsistent_int8(internal, int2, text, int4, internal, internal, internal)
+    RETURNS "char"
+    AS 'MODULE_PATHNAME', 'kmersearch_triconsistent_int8'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- Syncmer-sampling GIN functions (index only open syncmers)
+CREATE FUNCTION kmersearch_extract_value_syncmer_dna2_int2(DNA2, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_value_syncmer_dna2_int2'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_value_syncmer_dna2_int4(DNA2, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_value_syncmer_dna2_int4'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_value_syncmer_dna2_int8(DNA2, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_value_syncmer_dna2_int8'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_value_syncmer_dna4_int2(DNA4, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_value_syncmer_dna4_int2'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_value_syncmer_dna4_int4(DNA4, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_value_syncmer_dna4_int4'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_value_syncmer_dna4_int8(DNA4, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_value_syncmer_dna4_int8'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_query_syncmer_int2(text, internal, int2, internal, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_query_syncmer_int2'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_query_syncmer_int4(text, internal, int2, internal, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_query_syncmer_int4'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_query_syncmer_int8(text, internal, int2, internal, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_query_syncmer_int8'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- Canonical (strand-independent) GIN functions
+CREATE FUNCTION kmersearch_extract_value_canonical_dna2_int2(DNA2, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_value_canonical_dna2_int2'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_value_canonical_dna2_int4(DNA2, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_value_canonical_dna2_int4'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_value_canonical_dna2_int8(DNA2, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_value_canonical_dna2_int8'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_value_canonical_dna4_int2(DNA4, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_value_canonical_dna4_int2'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_value_canonical_dna4_int4(DNA4, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_value_canonical_dna4_int4'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_value_canonical_dna4_int8(DNA4, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_value_canonical_dna4_int8'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_query_canonical_int2(text, internal, int2, internal, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_query_canonical_int2'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_query_canonical_int4(text, internal, int2, internal, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_query_canonical_int4'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_extract_query_canonical_int8(text, internal, int2, internal, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'kmersearch_extract_query_canonical_int8'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- New uintkey-based GIN operator classes for DNA2
 CREATE OPERATOR CLASS kmersearch_dna2_gin_ops_int2
@@ -310,6 +441,7 @@ CREATE OPERATOR CLASS kmersearch_dna2_gin_ops_int2
         FUNCTION 2 kmersearch_extract_value_dna2_int2(DNA2, internal),
         FUNCTION 3 kmersearch_extract_query_int2(text, internal, int2, internal, internal),
         FUNCTION 4 kmersearch_consistent_int2(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int2(internal, int2, text, int4, internal, internal, internal),
         STORAGE int2;
 
 CREATE OPERATOR CLASS kmersearch_dna2_gin_ops_int4
@@ -319,6 +451,7 @@ CREATE OPERATOR CLASS kmersearch_dna2_gin_ops_int4
         FUNCTION 2 kmersearch_extract_value_dna2_int4(DNA2, internal),
         FUNCTION 3 kmersearch_extract_query_int4(text, internal, int2, internal, internal),
         FUNCTION 4 kmersearch_consistent_int4(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int4(internal, int2, text, int4, internal, internal, internal),
         STORAGE int4;
 
 CREATE OPERATOR CLASS kmersearch_dna2_gin_ops_int8
@@ -328,6 +461,7 @@ CREATE OPERATOR CLASS kmersearch_dna2_gin_ops_int8
         FUNCTION 2 kmersearch_extract_value_dna2_int8(DNA2, internal),
         FUNCTION 3 kmersearch_extract_query_int8(text, internal, int2, internal, internal),
         FUNCTION 4 kmersearch_consistent_int8(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int8(internal, int2, text, int4, internal, internal, internal),
         STORAGE int8;
 
 -- New uintkey-based GIN operator classes for DNA4
@@ -338,6 +472,7 @@ CREATE OPERATOR CLASS kmersearch_dna4_gin_ops_int2
         FUNCTION 2 kmersearch_extract_value_dna4_int2(DNA4, internal),
         FUNCTION 3 kmersearch_extract_query_int2(text, internal, int2, internal, internal),
         FUNCTION 4 kmersearch_consistent_int2(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int2(internal, int2, text, int4, internal, internal, internal),
         STORAGE int2;
 
 CREATE OPERATOR CLASS kmersearch_dna4_gin_ops_int4
@@ -347,6 +482,7 @@ CREATE OPERATOR CLASS kmersearch_dna4_gin_ops_int4
         FUNCTION 2 kmersearch_extract_value_dna4_int4(DNA4, internal),
         FUNCTION 3 kmersearch_extract_query_int4(text, internal, int2, internal, internal),
         FUNCTION 4 kmersearch_consistent_int4(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int4(internal, int2, text, int4, internal, internal, internal),
         STORAGE int4;
 
 CREATE OPERATOR CLASS kmersearch_dna4_gin_ops_int8
@@ -356,6 +492,129 @@ CREATE OPERATOR CLASS kmersearch_dna4_gin_ops_int8
         FUNCTION 2 kmersearch_extract_value_dna4_int8(DNA4, internal),
         FUNCTION 3 kmersearch_extract_query_int8(text, internal, int2, internal, internal),
         FUNCTION 4 kmersearch_consistent_int8(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int8(internal, int2, text, int4, internal, internal, internal),
+        STORAGE int8;
+
+-- Syncmer-sampling GIN operator classes (smaller index, rechecked matches)
+CREATE OPERATOR CLASS kmersearch_dna2_gin_ops_syncmer_int2
+    FOR TYPE DNA2 USING gin AS
+        OPERATOR 1 =% (DNA2, text),
+        FUNCTION 1 btint2cmp(int2, int2),
+        FUNCTION 2 kmersearch_extract_value_syncmer_dna2_int2(DNA2, internal),
+        FUNCTION 3 kmersearch_extract_query_syncmer_int2(text, internal, int2, internal, internal),
+        FUNCTION 4 kmersearch_consistent_int2(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int2(internal, int2, text, int4, internal, internal, internal),
+        STORAGE int2;
+
+CREATE OPERATOR CLASS kmersearch_dna2_gin_ops_syncmer_int4
+    FOR TYPE DNA2 USING gin AS
+        OPERATOR 1 =% (DNA2, text),
+        FUNCTION 1 btint4cmp(int4, int4),
+        FUNCTION 2 kmersearch_extract_value_syncmer_dna2_int4(DNA2, internal),
+        FUNCTION 3 kmersearch_extract_query_syncmer_int4(text, internal, int2, internal, internal),
+        FUNCTION 4 kmersearch_consistent_int4(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int4(internal, int2, text, int4, internal, internal, internal),
+        STORAGE int4;
+
+CREATE OPERATOR CLASS kmersearch_dna2_gin_ops_syncmer_int8
+    FOR TYPE DNA2 USING gin AS
+        OPERATOR 1 =% (DNA2, text),
+        FUNCTION 1 btint8cmp(int8, int8),
+        FUNCTION 2 kmersearch_extract_value_syncmer_dna2_int8(DNA2, internal),
+        FUNCTION 3 kmersearch_extract_query_syncmer_int8(text, internal, int2, internal, internal),
+        FUNCTION 4 kmersearch_consistent_int8(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int8(internal, int2, text, int4, internal, internal, internal),
+        STORAGE int8;
+
+CREATE OPERATOR CLASS kmersearch_dna4_gin_ops_syncmer_int2
+    FOR TYPE DNA4 USING gin AS
+        OPERATOR 1 =% (DNA4, text),
+        FUNCTION 1 btint2cmp(int2, int2),
+        FUNCTION 2 kmersearch_extract_value_syncmer_dna4_int2(DNA4, internal),
+        FUNCTION 3 kmersearch_extract_query_syncmer_int2(text, internal, int2, internal, internal),
+        FUNCTION 4 kmersearch_consistent_int2(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int2(internal, int2, text, int4, internal, internal, internal),
+        STORAGE int2;
+
+CREATE OPERATOR CLASS kmersearch_dna4_gin_ops_syncmer_int4
+    FOR TYPE DNA4 USING gin AS
+        OPERATOR 1 =% (DNA4, text),
+        FUNCTION 1 btint4cmp(int4, int4),
+        FUNCTION 2 kmersearch_extract_value_syncmer_dna4_int4(DNA4, internal),
+        FUNCTION 3 kmersearch_extract_query_syncmer_int4(text, internal, int2, internal, internal),
+        FUNCTION 4 kmersearch_consistent_int4(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int4(internal, int2, text, int4, internal, internal, internal),
+        STORAGE int4;
+
+CREATE OPERATOR CLASS kmersearch_dna4_gin_ops_syncmer_int8
+    FOR TYPE DNA4 USING gin AS
+        OPERATOR 1 =% (DNA4, text),
+        FUNCTION 1 btint8cmp(int8, int8),
+        FUNCTION 2 kmersearch_extract_value_syncmer_dna4_int8(DNA4, internal),
+        FUNCTION 3 kmersearch_extract_query_syncmer_int8(text, internal, int2, internal, internal),
+        FUNCTION 4 kmersearch_consistent_int8(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int8(internal, int2, text, int4, internal, internal, internal),
+        STORAGE int8;
+
+-- Canonical GIN operator classes (=%% matches either strand)
+CREATE OPERATOR CLASS kmersearch_dna2_gin_ops_canonical_int2
+    FOR TYPE DNA2 USING gin AS
+        OPERATOR 1 =%% (DNA2, text),
+        FUNCTION 1 btint2cmp(int2, int2),
+        FUNCTION 2 kmersearch_extract_value_canonical_dna2_int2(DNA2, internal),
+        FUNCTION 3 kmersearch_extract_query_canonical_int2(text, internal, int2, internal, internal),
+        FUNCTION 4 kmersearch_consistent_int2(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int2(internal, int2, text, int4, internal, internal, internal),
+        STORAGE int2;
+
+CREATE OPERATOR CLASS kmersearch_dna2_gin_ops_canonical_int4
+    FOR TYPE DNA2 USING gin AS
+        OPERATOR 1 =%% (DNA2, text),
+        FUNCTION 1 btint4cmp(int4, int4),
+        FUNCTION 2 kmersearch_extract_value_canonical_dna2_int4(DNA2, internal),
+        FUNCTION 3 kmersearch_extract_query_canonical_int4(text, internal, int2, internal, internal),
+        FUNCTION 4 kmersearch_consistent_int4(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int4(internal, int2, text, int4, internal, internal, internal),
+        STORAGE int4;
+
+CREATE OPERATOR CLASS kmersearch_dna2_gin_ops_canonical_int8
+    FOR TYPE DNA2 USING gin AS
+        OPERATOR 1 =%% (DNA2, text),
+        FUNCTION 1 btint8cmp(int8, int8),
+        FUNCTION 2 kmersearch_extract_value_canonical_dna2_int8(DNA2, internal),
+        FUNCTION 3 kmersearch_extract_query_canonical_int8(text, internal, int2, internal, internal),
+        FUNCTION 4 kmersearch_consistent_int8(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int8(internal, int2, text, int4, internal, internal, internal),
+        STORAGE int8;
+
+CREATE OPERATOR CLASS kmersearch_dna4_gin_ops_canonical_int2
+    FOR TYPE DNA4 USING gin AS
+        OPERATOR 1 =%% (DNA4, text),
+        FUNCTION 1 btint2cmp(int2, int2),
+        FUNCTION 2 kmersearch_extract_value_canonical_dna4_int2(DNA4, internal),
+        FUNCTION 3 kmersearch_extract_query_canonical_int2(text, internal, int2, internal, internal),
+        FUNCTION 4 kmersearch_consistent_int2(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int2(internal, int2, text, int4, internal, internal, internal),
+        STORAGE int2;
+
+CREATE OPERATOR CLASS kmersearch_dna4_gin_ops_canonical_int4
+    FOR TYPE DNA4 USING gin AS
+        OPERATOR 1 =%% (DNA4, text),
+        FUNCTION 1 btint4cmp(int4, int4),
+        FUNCTION 2 kmersearch_extract_value_canonical_dna4_int4(DNA4, internal),
+        FUNCTION 3 kmersearch_extract_query_canonical_int4(text, internal, int2, internal, internal),
+        FUNCTION 4 kmersearch_consistent_int4(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int4(internal, int2, text, int4, internal, internal, internal),
+        STORAGE int4;
+
+CREATE OPERATOR CLASS kmersearch_dna4_gin_ops_canonical_int8
+    FOR TYPE DNA4 USING gin AS
+        OPERATOR 1 =%% (DNA4, text),
+        FUNCTION 1 btint8cmp(int8, int8),
+        FUNCTION 2 kmersearch_extract_value_canonical_dna4_int8(DNA4, internal),
+        FUNCTION 3 kmersearch_extract_query_canonical_int8(text, internal, int2, internal, internal),
+        FUNCTION 4 kmersearch_consistent_int8(internal, int2, text, int4, internal, internal),
+        FUNCTION 6 kmersearch_triconsistent_int8(internal, int2, text, int4, internal, internal, internal),
         STORAGE int8;
 
 -- BTree operator classes for DNA2 and DNA4
@@ -380,20 +639,20 @@ CREATE OPERATOR CLASS kmersearch_dna4_btree_ops
 -- Hash functions for GROUP BY and hash-based operations
 CREATE FUNCTION kmersearch_dna2_hash(DNA2) RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_hash'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna4_hash(DNA4) RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_hash'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- Extended hash functions for improved collision resistance
 CREATE FUNCTION kmersearch_dna2_hash_extended(DNA2, bigint) RETURNS bigint
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_hash_extended'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna4_hash_extended(DNA4, bigint) RETURNS bigint
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_hash_extended'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- Hash operator classes for DNA2 and DNA4
 CREATE OPERATOR CLASS kmersearch_dna2_hash_ops
@@ -459,6 +718,7 @@ CREATE TABLE kmersearch_index_info (
     max_appearance_rate real NOT NULL,
     max_appearance_nrow integer NOT NULL,
     preclude_highfreq_kmer boolean NOT NULL DEFAULT false,
+    syncmer_size integer,  -- NULL unless built with a syncmer operator class
     created_at timestamp with time zone DEFAULT now()
 );
 
@@ -468,23 +728,64 @@ CREATE TABLE kmersearch_index_info (
 CREATE FUNCTION kmersearch_matchscore_dna2(DNA2, text) 
     RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_matchscore_dna2'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_matchscore_dna4(DNA4, text) 
     RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_matchscore_dna4'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- Overloaded matchscore functions for convenience
 CREATE FUNCTION kmersearch_matchscore(DNA2, text) 
     RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_matchscore_dna2'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_matchscore(DNA4, text) 
     RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_matchscore_dna4'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- Strand-independent matchscore (shared canonical k-mer count)
+CREATE FUNCTION kmersearch_matchscore_canonical(DNA2, text) 
+    RETURNS integer
+    AS 'MODULE_PATHNAME', 'kmersearch_matchscore_canonical_dna2'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION kmersearch_matchscore_canonical(DNA4, text) 
+    RETURNS integer
+    AS 'MODULE_PATHNAME', 'kmersearch_matchscore_canonical_dna4'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- <-> distance operators (query k-mers not shared) for ORDER BY ... LIMIT
+-- No operator class supports <->, so ordering evaluates it for every row
+CREATE FUNCTION kmersearch_distance(DNA2, text)
+    RETURNS integer
+    AS 'MODULE_PATHNAME', 'kmersearch_dna2_distance'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OPERATOR <-> (
+    LEFTARG = DNA2,
+    RIGHTARG = text,
+    FUNCTION = kmersearch_distance
+);
+
+CREATE FUNCTION kmersearch_distance(DNA4, text)
+    RETURNS integer
+    AS 'MODULE_PATHNAME', 'kmersearch_dna4_distance'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OPERATOR <-> (
+    LEFTARG = DNA4,
+    RIGHTARG = text,
+    FUNCTION = kmersearch_distance
+);
+
+-- Search many queries with a single pass over the table
+CREATE FUNCTION kmersearch_search_batch(table_oid regclass, column_name text, queries text[])
+    RETURNS TABLE(query_idx integer, row_ctid tid, shared_count integer)
+    AS 'MODULE_PATHNAME', 'kmersearch_search_batch'
+    LANGUAGE C STABLE STRICT;
 
 -- Length functions for DNA2 and DNA4 types
 
@@ -492,60 +793,60 @@ CREATE FUNCTION kmersearch_matchscore(DNA4, text)
 CREATE FUNCTION bit_length(DNA2) 
     RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_bit_length'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION bit_length(DNA4) 
     RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_bit_length'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- nuc_length functions
 CREATE FUNCTION nuc_length(DNA2) 
     RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_nuc_length'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION nuc_length(DNA4) 
     RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_nuc_length'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- char_length functions (same as nuc_length)
 CREATE FUNCTION char_length(DNA2) 
     RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_char_length'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION char_length(DNA4) 
     RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_char_length'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- length functions (same as nuc_length)
 CREATE FUNCTION length(DNA2) 
     RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_nuc_length'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION length(DNA4) 
     RETURNS integer
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_nuc_length'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- SIMD capability detection function
 CREATE FUNCTION kmersearch_simd_capability() 
     RETURNS text
     AS 'MODULE_PATHNAME', 'kmersearch_simd_capability'
-    LANGUAGE C IMMUTABLE;
+    LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- BYTEA conversion functions for hash compatibility
 CREATE FUNCTION kmersearch_dna2_to_bytea(DNA2) RETURNS bytea
     AS 'MODULE_PATHNAME', 'kmersearch_dna2_to_bytea'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION kmersearch_dna4_to_bytea(DNA4) RETURNS bytea
     AS 'MODULE_PATHNAME', 'kmersearch_dna4_to_bytea'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- Complex types for function return values
 CREATE TYPE kmersearch_analysis_result AS (
@@ -566,10 +867,13 @@ CREATE TYPE kmersearch_drop_result AS (
 CREATE FUNCTION kmersearch_show_buildno() 
     RETURNS text
     AS 'MODULE_PATHNAME', 'kmersearch_show_buildno'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- Parallel k-mer analysis functions
-CREATE FUNCTION kmersearch_perform_highfreq_analysis(table_name text, column_name text) 
+CREATE FUNCTION kmersearch_perform_highfreq_analysis(table_name text, column_name text,
+                                                     incremental boolean DEFAULT false,
+                                                     sample_fraction double precision DEFAULT 1.0,
+                                                     sample_rows bigint DEFAULT 0)
     RETURNS kmersearch_analysis_result
     AS 'MODULE_PATHNAME', 'kmersearch_perform_highfreq_analysis'
     LANGUAGE C VOLATILE STRICT;
@@ -597,6 +901,19 @@ CREATE FUNCTION kmersearch_query_kmer_cache_free()
     AS 'MODULE_PATHNAME', 'kmersearch_query_kmer_cache_free'
     LANGUAGE C VOLATILE;
 
+-- Shared query-kmer cache statistics function
+CREATE FUNCTION kmersearch_shared_query_kmer_cache_stats()
+    RETURNS TABLE (
+        hits bigint,
+        misses bigint,
+        evictions bigint,
+        current_entries bigint,
+        used_bytes bigint,
+        max_bytes bigint
+    )
+    AS 'MODULE_PATHNAME', 'kmersearch_shared_query_kmer_cache_stats'
+    LANGUAGE C STABLE;
+
 -- Actual min score cache statistics function
 CREATE FUNCTION kmersearch_actual_min_score_cache_stats()
     RETURNS TABLE (
@@ -636,6 +953,17 @@ CREATE FUNCTION kmersearch_parallel_highfreq_kmer_cache_free(table_name text, co
     AS 'MODULE_PATHNAME', 'kmersearch_parallel_highfreq_kmer_cache_free'
     LANGUAGE C VOLATILE STRICT;
 
+-- Shared high-frequency k-mer cache management functions (shared_preload_libraries)
+CREATE FUNCTION kmersearch_shared_highfreq_kmer_cache_load(table_name text, column_name text)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'kmersearch_shared_highfreq_kmer_cache_load'
+    LANGUAGE C VOLATILE STRICT;
+
+CREATE FUNCTION kmersearch_shared_highfreq_kmer_cache_free()
+    RETURNS integer
+    AS 'MODULE_PATHNAME', 'kmersearch_shared_highfreq_kmer_cache_free'
+    LANGUAGE C VOLATILE;
+
 -- Cache free functions without parameters (for backwards compatibility)
 CREATE FUNCTION kmersearch_highfreq_kmer_cache_free_all()
     RETURNS integer
@@ -762,7 +1090,7 @@ BEGIN
                 index_oid, table_oid, column_name,
                 kmer_size, occur_bitlen,
                 max_appearance_rate, max_appearance_nrow,
-                preclude_highfreq_kmer,
+                preclude_highfreq_kmer, syncmer_size,
                 total_nrow, highfreq_kmer_count
             ) VALUES (
                 idx_oid, tbl_oid, col_name,
@@ -771,6 +1099,8 @@ BEGIN
                 current_setting('kmersearch.max_appearance_rate')::real,
                 current_setting('kmersearch.max_appearance_nrow')::integer,
                 current_setting('kmersearch.preclude_highfreq_kmer')::boolean,
+                CASE WHEN opclass_name LIKE 'kmersearch_%_gin_ops_syncmer_%'
+                     THEN current_setting('kmersearch.syncmer_size')::integer END,
                 0, 0
             )
             ON CONFLICT (index_oid) DO UPDATE SET
@@ -779,6 +1109,7 @@ BEGIN
                 max_appearance_rate = EXCLUDED.max_appearance_rate,
                 max_appearance_nrow = EXCLUDED.max_appearance_nrow,
                 preclude_highfreq_kmer = EXCLUDED.preclude_highfreq_kmer,
+                syncmer_size = EXCLUDED.syncmer_size,
                 created_at = now();
         END IF;
     END LOOP;
@@ -125,5 +125,13 @@ DROP TABLE IF EXISTS test_index_select CASCADE;
 SELECT COUNT(*) as remaining_after_drop FROM kmersearch_index_info
 WHERE index_oid NOT IN (SELECT oid FROM pg_class WHERE relkind = 'i');
 
+-- Verify every GIN operator class provides triConsistent (support function 6)
+SELECT opc.opcname, p.amproc
+FROM pg_opclass opc
+JOIN pg_am am ON am.oid = opc.opcmethod AND am.amname = 'gin'
+JOIN pg_amproc p ON p.amprocfamily = opc.opcfamily AND p.amprocnum = 6
+WHERE opc.opcname LIKE 'kmersearch_%'
+ORDER BY opc.opcname;
+
 DROP EXTENSION pg_kmersearch CASCADE;
 SET client_min_messages = NOTICE;
\ No newline at end of file
@@ -90,6 +90,11 @@ SELECT id, name FROM test_dna4_sequences WHERE sequence =% 'ATCGNN' ORDER BY id;
 SELECT id, name, kmersearch_matchscore(sequence, 'ATCGATCG') as score 
 FROM test_dna2_sequences ORDER BY score DESC, id;
 
+-- Test strand-independent search (query is the reverse complement)
+SELECT kmersearch_matchscore('AAAACCCCAG'::DNA2, 'CTGGGGTTTT') AS forward_score,
+       kmersearch_matchscore_canonical('AAAACCCCAG'::DNA2, 'CTGGGGTTTT') AS canonical_score;
+SELECT 'AAAACCCCAG'::DNA2 =%% 'CTGGGGTTTT' AS both_strands;
+
 -- Clean up test tables
 DROP TABLE IF EXISTS test_dna2_sequences CASCADE;
 DROP TABLE IF EXISTS test_dna4_sequences CASCADE;
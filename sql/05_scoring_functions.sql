@@ -87,6 +87,36 @@ SELECT id, name,
        kmersearch_matchscore(sequence, 'ATCGATCGNNATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATC') AS score_with_nn
 FROM test_dna4_sequences WHERE id = 3;
 
+-- Test <-> distance ordering (query k-mers not shared)
+SELECT id, name, sequence <-> 'ATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGA' AS distance
+FROM test_dna2_sequences ORDER BY sequence <-> 'ATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGA', id;
+
+-- Test top-K search among =% candidates (bounded sort of the index matches)
+SELECT kmersearch_matchscore(sequence, 'ATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGA') AS score, name
+FROM test_dna2_sequences
+WHERE sequence =% 'ATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGA'
+ORDER BY score DESC, name
+LIMIT 2;
+
+-- Test batch search (one table pass for several queries)
+SELECT b.query_idx, s.name, b.shared_count
+FROM kmersearch_search_batch('test_dna2_sequences', 'sequence',
+                             ARRAY['ATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGA', 'GCTAGCTAGCTA', NULL]) b
+JOIN test_dna2_sequences s ON s.ctid = b.row_ctid
+ORDER BY b.query_idx, s.name;
+
+-- With a GIN index, batch candidates come from one =% ANY bitmap scan
+CREATE INDEX test_dna2_sequences_batch_idx ON test_dna2_sequences USING gin (sequence kmersearch_dna2_gin_ops_int2);
+SET enable_seqscan = off;
+EXPLAIN (COSTS OFF)
+SELECT ctid, sequence FROM test_dna2_sequences WHERE sequence =% ANY (ARRAY['GCTAGCTAGCTA', NULL]);
+SELECT b.query_idx, s.name, b.shared_count
+FROM kmersearch_search_batch('test_dna2_sequences', 'sequence',
+                             ARRAY['ATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGATCGA', 'GCTAGCTAGCTA', NULL]) b
+JOIN test_dna2_sequences s ON s.ctid = b.row_ctid
+ORDER BY b.query_idx, s.name;
+RESET enable_seqscan;
+
 -- Clean up test tables
 DROP TABLE IF EXISTS test_dna2_sequences CASCADE;
 DROP TABLE IF EXISTS test_dna4_sequences CASCADE;
@@ -0,0 +1,49 @@
+SET client_min_messages = WARNING;
+CREATE EXTENSION IF NOT EXISTS pg_kmersearch;
+
+-- Syncmer indexes must only serve queries using the s-mer length they were built with
+SET kmersearch.kmer_size = 4;
+SET kmersearch.occur_bitlen = 4;
+SET kmersearch.syncmer_size = 2;
+SET kmersearch.max_appearance_rate = 0.5;
+SET kmersearch.max_appearance_nrow = 0;
+SET kmersearch.preclude_highfreq_kmer = false;
+SET kmersearch.min_score = 1;
+SET kmersearch.min_shared_kmer_rate = 0.5;
+SET enable_seqscan = off;
+
+CREATE TABLE test_syncmer_index (
+    id SERIAL PRIMARY KEY,
+    seq DNA2
+);
+INSERT INTO test_syncmer_index (seq) VALUES ('ACCAACCCAAACACCA'::DNA2);
+INSERT INTO test_syncmer_index (seq)
+SELECT 'GTTGGTGTTTGGGTGT'::DNA2 FROM generate_series(1, 100);
+
+CREATE INDEX idx_syncmer ON test_syncmer_index USING gin (seq kmersearch_dna2_gin_ops_syncmer_int2);
+ANALYZE test_syncmer_index;
+
+-- The s-mer length is recorded alongside the other index settings
+SELECT kmer_size, occur_bitlen, syncmer_size
+FROM kmersearch_index_info
+WHERE index_oid = 'idx_syncmer'::regclass;
+
+-- Matching syncmer_size: the index is used and candidates are rechecked
+EXPLAIN (COSTS OFF)
+SELECT id FROM test_syncmer_index WHERE seq =% 'ACCAACCCAAACACCA';
+SELECT id FROM test_syncmer_index WHERE seq =% 'ACCAACCCAAACACCA' ORDER BY id;
+
+-- A different syncmer_size would sample different k-mers, so the index is rejected
+SET kmersearch.syncmer_size = 3;
+\set ON_ERROR_STOP off
+SELECT id FROM test_syncmer_index WHERE seq =% 'ACCAACCCAAACACCA' ORDER BY id;
+\set ON_ERROR_STOP on
+
+-- Restoring the build-time value makes the index usable again
+SET kmersearch.syncmer_size = 2;
+SELECT id FROM test_syncmer_index WHERE seq =% 'ACCAACCCAAACACCA' ORDER BY id;
+
+DROP TABLE test_syncmer_index;
+RESET enable_seqscan;
+DROP EXTENSION pg_kmersearch CASCADE;
+SET client_min_messages = NOTICE;
\ No newline at end of file
@@ -0,0 +1,62 @@
+SET client_min_messages = WARNING;
+
+-- Limit parallel workers to 2 for consistent test results
+SET max_parallel_maintenance_workers = 2;
+
+CREATE EXTENSION IF NOT EXISTS pg_kmersearch;
+
+-- Same fixture as 09_highfreq_filter: k=4 yields 6 high-frequency k-mers
+SET kmersearch.kmer_size = 4;
+SET kmersearch.occur_bitlen = 4;
+SET kmersearch.max_appearance_rate = 0.25;
+SET kmersearch.max_appearance_nrow = 0;
+SET kmersearch.min_score = 1;
+SET kmersearch.min_shared_kmer_rate = 0.9;
+SET kmersearch.preclude_highfreq_kmer = true;
+SET kmersearch.force_use_parallel_highfreq_kmer_cache = false;
+
+CREATE TABLE test_dna_highfreq (
+    id SERIAL PRIMARY KEY,
+    seq DNA2
+);
+INSERT INTO test_dna_highfreq (seq) VALUES
+    ('AAAACTGTACGT'::DNA2),
+    ('AAAAGCATGCAT'::DNA2),
+    ('AAAATCGATCGA'::DNA2),
+    ('AAAACCCCGGGG'::DNA2),
+    ('AAAATTTTAAAA'::DNA2),
+    ('TCGTAAAACGTA'::DNA2),
+    ('GCATAAAATCGA'::DNA2),
+    ('ATCGAAAACCCC'::DNA2),
+    ('CCCCAAAATTTT'::DNA2),
+    ('TTTTAAAACCCC'::DNA2),
+    ('CCCCCCCCCCCC'::DNA2),
+    ('TTTTTTTTTTTT'::DNA2),
+    ('ACGTACGTACGT'::DNA2),
+    ('TGCATGCATGCA'::DNA2);
+
+SELECT kmersearch_perform_highfreq_analysis('test_dna_highfreq', 'seq');
+SELECT kmersearch_highfreq_kmer_cache_load('test_dna_highfreq', 'seq');
+
+-- Undoing the analysis makes the loaded cache stale once it commits
+SELECT dropped_analyses, dropped_highfreq_kmers
+FROM kmersearch_undo_highfreq_analysis('test_dna_highfreq', 'seq');
+
+-- The next search notices the new generation and drops the cache it cannot reload,
+-- so no k-mer is excluded any more (the refresh warning names the table OID)
+SET client_min_messages = ERROR;
+SELECT id FROM test_dna_highfreq WHERE seq =% 'AAAACTGT' ORDER BY id;
+SET client_min_messages = WARNING;
+SELECT kmersearch_highfreq_kmer_cache_free('test_dna_highfreq', 'seq');
+
+-- Generations are only bumped at COMMIT, so such transactions cannot be prepared
+BEGIN;
+SELECT dropped_analyses FROM kmersearch_undo_highfreq_analysis('test_dna_highfreq', 'seq');
+\set ON_ERROR_STOP off
+PREPARE TRANSACTION 'kmersearch_undo';
+\set ON_ERROR_STOP on
+
+DROP TABLE test_dna_highfreq CASCADE;
+
+DROP EXTENSION pg_kmersearch CASCADE;
+SET client_min_messages = NOTICE;
\ No newline at end of file
@@ -0,0 +1,80 @@
+SET client_min_messages = WARNING;
+
+-- Limit parallel workers to 2 for consistent test results
+SET max_parallel_maintenance_workers = 2;
+
+CREATE EXTENSION IF NOT EXISTS pg_kmersearch;
+
+-- Same fixture as 09_highfreq_filter: k=4 yields 6 high-frequency k-mers
+SET kmersearch.kmer_size = 4;
+SET kmersearch.occur_bitlen = 4;
+SET kmersearch.max_appearance_rate = 0.25;
+SET kmersearch.max_appearance_nrow = 0;
+SET kmersearch.min_score = 1;
+SET kmersearch.min_shared_kmer_rate = 0.9;
+SET kmersearch.preclude_highfreq_kmer = true;
+SET kmersearch.force_use_parallel_highfreq_kmer_cache = false;
+
+CREATE TABLE test_dna_incremental (
+    id SERIAL PRIMARY KEY,
+    seq DNA2
+);
+INSERT INTO test_dna_incremental (seq) VALUES
+    ('AAAACTGTACGT'::DNA2),
+    ('AAAAGCATGCAT'::DNA2),
+    ('AAAATCGATCGA'::DNA2),
+    ('AAAACCCCGGGG'::DNA2),
+    ('AAAATTTTAAAA'::DNA2),
+    ('TCGTAAAACGTA'::DNA2),
+    ('GCATAAAATCGA'::DNA2),
+    ('ATCGAAAACCCC'::DNA2),
+    ('CCCCAAAATTTT'::DNA2),
+    ('TTTTAAAACCCC'::DNA2),
+    ('CCCCCCCCCCCC'::DNA2),
+    ('TTTTTTTTTTTT'::DNA2),
+    ('ACGTACGTACGT'::DNA2),
+    ('TGCATGCATGCA'::DNA2);
+
+-- The first incremental analysis counts every row
+SELECT kmersearch_perform_highfreq_analysis('test_dna_incremental', 'seq', incremental => true);
+
+-- New rows land in the partly filled last block that was already counted
+INSERT INTO test_dna_incremental (seq) VALUES
+    ('GGGGACTGCATG'::DNA2),
+    ('CAGTGGGGTCAT'::DNA2),
+    ('GGGGTCAGTCAG'::DNA2),
+    ('TGACGGGGACTG'::DNA2),
+    ('GGGGCATGGGGT'::DNA2),
+    ('ACGTGGGGCATG'::DNA2);
+
+-- The second run resumes in that block after the rows it counted
+SELECT kmersearch_perform_highfreq_analysis('test_dna_incremental', 'seq', incremental => true);
+
+-- A full analysis of the same rows must find the same k-mers with the same counts
+CREATE TABLE test_dna_full AS SELECT * FROM test_dna_incremental;
+SELECT kmersearch_perform_highfreq_analysis('test_dna_full', 'seq');
+
+SELECT count(*) AS only_incremental FROM (
+    SELECT uintkey, appearance_nrow FROM kmersearch_highfreq_kmer
+    WHERE table_oid = 'test_dna_incremental'::regclass
+    EXCEPT
+    SELECT uintkey, appearance_nrow FROM kmersearch_highfreq_kmer
+    WHERE table_oid = 'test_dna_full'::regclass
+) d;
+SELECT count(*) AS only_full FROM (
+    SELECT uintkey, appearance_nrow FROM kmersearch_highfreq_kmer
+    WHERE table_oid = 'test_dna_full'::regclass
+    EXCEPT
+    SELECT uintkey, appearance_nrow FROM kmersearch_highfreq_kmer
+    WHERE table_oid = 'test_dna_incremental'::regclass
+) d;
+
+-- Remove the kept counts along with the analyses
+SELECT dropped_analyses FROM kmersearch_undo_highfreq_analysis('test_dna_incremental', 'seq');
+SELECT dropped_analyses FROM kmersearch_undo_highfreq_analysis('test_dna_full', 'seq');
+
+DROP TABLE test_dna_full;
+DROP TABLE test_dna_incremental CASCADE;
+
+DROP EXTENSION pg_kmersearch CASCADE;
+SET client_min_messages = NOTICE;
\ No newline at end of file
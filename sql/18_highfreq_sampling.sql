@@ -0,0 +1,76 @@
+SET client_min_messages = WARNING;
+
+-- Limit parallel workers to 2 for consistent test results
+SET max_parallel_maintenance_workers = 2;
+
+CREATE EXTENSION IF NOT EXISTS pg_kmersearch;
+
+-- Same fixture as 09_highfreq_filter: k=4 yields 6 high-frequency k-mers
+SET kmersearch.kmer_size = 4;
+SET kmersearch.occur_bitlen = 4;
+SET kmersearch.max_appearance_rate = 0.25;
+SET kmersearch.max_appearance_nrow = 0;
+SET kmersearch.min_score = 1;
+SET kmersearch.min_shared_kmer_rate = 0.9;
+SET kmersearch.preclude_highfreq_kmer = true;
+SET kmersearch.force_use_parallel_highfreq_kmer_cache = false;
+
+CREATE TABLE test_dna_highfreq (
+    id SERIAL PRIMARY KEY,
+    seq DNA2
+);
+INSERT INTO test_dna_highfreq (seq) VALUES
+    ('AAAACTGTACGT'::DNA2),
+    ('AAAAGCATGCAT'::DNA2),
+    ('AAAATCGATCGA'::DNA2),
+    ('AAAACCCCGGGG'::DNA2),
+    ('AAAATTTTAAAA'::DNA2),
+    ('TCGTAAAACGTA'::DNA2),
+    ('GCATAAAATCGA'::DNA2),
+    ('ATCGAAAACCCC'::DNA2),
+    ('CCCCAAAATTTT'::DNA2),
+    ('TTTTAAAACCCC'::DNA2),
+    ('CCCCCCCCCCCC'::DNA2),
+    ('TTTTTTTTTTTT'::DNA2),
+    ('ACGTACGTACGT'::DNA2),
+    ('TGCATGCATGCA'::DNA2);
+
+-- Invalid sampling arguments
+\set ON_ERROR_STOP off
+SELECT kmersearch_perform_highfreq_analysis('test_dna_highfreq', 'seq', sample_fraction => 0);
+SELECT kmersearch_perform_highfreq_analysis('test_dna_highfreq', 'seq', sample_fraction => 1.5);
+SELECT kmersearch_perform_highfreq_analysis('test_dna_highfreq', 'seq', sample_rows => -1);
+SELECT kmersearch_perform_highfreq_analysis('test_dna_highfreq', 'seq', sample_fraction => 0.5, sample_rows => 10);
+SELECT kmersearch_perform_highfreq_analysis('test_dna_highfreq', 'seq', incremental => true, sample_fraction => 0.5);
+\set ON_ERROR_STOP on
+
+-- Exact counts as the reference
+SELECT kmersearch_perform_highfreq_analysis('test_dna_highfreq', 'seq');
+CREATE TEMP TABLE exact_kmers AS
+SELECT uintkey, appearance_nrow FROM kmersearch_highfreq_kmer
+WHERE table_oid = 'test_dna_highfreq'::regclass;
+SELECT dropped_analyses FROM kmersearch_undo_highfreq_analysis('test_dna_highfreq', 'seq');
+
+-- A sample covering every block is a full scan with exact counts
+SELECT kmersearch_perform_highfreq_analysis('test_dna_highfreq', 'seq', sample_fraction => 1.0);
+SELECT detection_reason, count(*) FROM kmersearch_highfreq_kmer
+WHERE table_oid = 'test_dna_highfreq'::regclass
+GROUP BY detection_reason;
+SELECT count(*) AS only_sampled FROM (
+    SELECT uintkey, appearance_nrow FROM kmersearch_highfreq_kmer
+    WHERE table_oid = 'test_dna_highfreq'::regclass
+    EXCEPT
+    SELECT uintkey, appearance_nrow FROM exact_kmers
+) d;
+SELECT count(*) AS only_exact FROM (
+    SELECT uintkey, appearance_nrow FROM exact_kmers
+    EXCEPT
+    SELECT uintkey, appearance_nrow FROM kmersearch_highfreq_kmer
+    WHERE table_oid = 'test_dna_highfreq'::regclass
+) d;
+
+DROP TABLE exact_kmers;
+DROP TABLE test_dna_highfreq CASCADE;
+
+DROP EXTENSION pg_kmersearch CASCADE;
+SET client_min_messages = NOTICE;
\ No newline at end of file
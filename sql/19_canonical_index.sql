@@ -0,0 +1,55 @@
+SET client_min_messages = WARNING;
+CREATE EXTENSION IF NOT EXISTS pg_kmersearch;
+
+-- Canonical indexes must find a row from either strand of the query
+SET kmersearch.kmer_size = 4;
+SET kmersearch.occur_bitlen = 4;
+SET kmersearch.max_appearance_rate = 0.5;
+SET kmersearch.max_appearance_nrow = 0;
+SET kmersearch.preclude_highfreq_kmer = false;
+SET kmersearch.min_score = 1;
+SET kmersearch.min_shared_kmer_rate = 0.5;
+SET enable_seqscan = off;
+
+CREATE TABLE test_canonical_dna2 (
+    id SERIAL PRIMARY KEY,
+    seq DNA2
+);
+INSERT INTO test_canonical_dna2 (seq) VALUES ('AAAACCCCAGTTAGCA'::DNA2);
+INSERT INTO test_canonical_dna2 (seq)
+SELECT 'GTTGGTGTTTGGGTGT'::DNA2 FROM generate_series(1, 100);
+
+CREATE INDEX idx_canonical_dna2 ON test_canonical_dna2 USING gin (seq kmersearch_dna2_gin_ops_canonical_int2);
+ANALYZE test_canonical_dna2;
+
+-- The query is the reverse complement of row 1
+EXPLAIN (COSTS OFF)
+SELECT id FROM test_canonical_dna2 WHERE seq =%% 'TGCTAACTGGGGTTTT';
+SELECT id FROM test_canonical_dna2 WHERE seq =%% 'TGCTAACTGGGGTTTT' ORDER BY id;
+SELECT id FROM test_canonical_dna2 WHERE seq =%% 'AAAACCCCAGTTAGCA' ORDER BY id;
+
+-- =% compares k-mers of one strand only
+SELECT id FROM test_canonical_dna2 WHERE seq =% 'TGCTAACTGGGGTTTT' ORDER BY id;
+
+CREATE TABLE test_canonical_dna4 (
+    id SERIAL PRIMARY KEY,
+    seq DNA4
+);
+INSERT INTO test_canonical_dna4 (seq) VALUES ('AAAACCCCAGTTAGCA'::DNA4);
+INSERT INTO test_canonical_dna4 (seq)
+SELECT 'GTTGGTGTTTGGGTGT'::DNA4 FROM generate_series(1, 100);
+
+CREATE INDEX idx_canonical_dna4 ON test_canonical_dna4 USING gin (seq kmersearch_dna4_gin_ops_canonical_int2);
+ANALYZE test_canonical_dna4;
+
+-- The query is the reverse complement of row 1
+EXPLAIN (COSTS OFF)
+SELECT id FROM test_canonical_dna4 WHERE seq =%% 'TGCTAACTGGGGTTTT';
+SELECT id FROM test_canonical_dna4 WHERE seq =%% 'TGCTAACTGGGGTTTT' ORDER BY id;
+SELECT id FROM test_canonical_dna4 WHERE seq =%% 'AAAACCCCAGTTAGCA' ORDER BY id;
+
+DROP TABLE test_canonical_dna2;
+DROP TABLE test_canonical_dna4;
+RESET enable_seqscan;
+DROP EXTENSION pg_kmersearch CASCADE;
+SET client_min_messages = NOTICE;
\ No newline at end of file
@@ -0,0 +1,71 @@
+SET client_min_messages = WARNING;
+
+-- Limit parallel workers to 2 for consistent test results
+SET max_parallel_maintenance_workers = 2;
+
+CREATE EXTENSION IF NOT EXISTS pg_kmersearch;
+
+-- Same fixture as 09_highfreq_filter: k=4 yields 6 high-frequency k-mers
+SET kmersearch.kmer_size = 4;
+SET kmersearch.occur_bitlen = 4;
+SET kmersearch.max_appearance_rate = 0.25;
+SET kmersearch.max_appearance_nrow = 0;
+SET kmersearch.min_score = 1;
+SET kmersearch.min_shared_kmer_rate = 0.9;
+SET kmersearch.preclude_highfreq_kmer = true;
+SET kmersearch.force_use_parallel_highfreq_kmer_cache = false;
+
+CREATE TABLE test_dna_highfreq (
+    id SERIAL PRIMARY KEY,
+    seq DNA2
+);
+INSERT INTO test_dna_highfreq (seq) VALUES
+    ('AAAACTGTACGT'::DNA2),
+    ('AAAAGCATGCAT'::DNA2),
+    ('AAAATCGATCGA'::DNA2),
+    ('AAAACCCCGGGG'::DNA2),
+    ('AAAATTTTAAAA'::DNA2),
+    ('TCGTAAAACGTA'::DNA2),
+    ('GCATAAAATCGA'::DNA2),
+    ('ATCGAAAACCCC'::DNA2),
+    ('CCCCAAAATTTT'::DNA2),
+    ('TTTTAAAACCCC'::DNA2),
+    ('CCCCCCCCCCCC'::DNA2),
+    ('TTTTTTTTTTTT'::DNA2),
+    ('ACGTACGTACGT'::DNA2),
+    ('TGCATGCATGCA'::DNA2);
+
+SELECT kmersearch_perform_highfreq_analysis('test_dna_highfreq', 'seq');
+
+-- No cache is loaded: the index build reads kmersearch_highfreq_kmer once
+SET enable_seqscan = off;
+CREATE INDEX idx_highfreq ON test_dna_highfreq USING gin (seq kmersearch_dna2_gin_ops_int2);
+
+-- Hide the analysis so queries keep every key; row 1 holds AAAA and AAAC,
+-- which the index left out, so it can no longer reach all 9 of its keys.
+-- A filter kept past the CREATE INDEX commit would still drop those keys
+-- from the query and find row 1.
+CREATE TEMP TABLE saved_highfreq AS SELECT * FROM kmersearch_highfreq_kmer;
+DELETE FROM kmersearch_highfreq_kmer;
+SELECT id FROM test_dna_highfreq WHERE seq =% 'AAAACTGTACGT' ORDER BY id;
+
+-- Built without high-frequency k-mers, the index holds every key again
+DROP INDEX idx_highfreq;
+CREATE INDEX idx_highfreq ON test_dna_highfreq USING gin (seq kmersearch_dna2_gin_ops_int2);
+SELECT id FROM test_dna_highfreq WHERE seq =% 'AAAACTGTACGT' ORDER BY id;
+
+-- The index built from the global cache leaves out the same keys
+INSERT INTO kmersearch_highfreq_kmer SELECT * FROM saved_highfreq;
+DROP INDEX idx_highfreq;
+SELECT kmersearch_highfreq_kmer_cache_load('test_dna_highfreq', 'seq');
+CREATE INDEX idx_highfreq ON test_dna_highfreq USING gin (seq kmersearch_dna2_gin_ops_int2);
+SELECT kmersearch_highfreq_kmer_cache_free('test_dna_highfreq', 'seq');
+DELETE FROM kmersearch_highfreq_kmer;
+SELECT id FROM test_dna_highfreq WHERE seq =% 'AAAACTGTACGT' ORDER BY id;
+
+RESET enable_seqscan;
+DROP TABLE saved_highfreq;
+DROP TABLE test_dna_highfreq CASCADE;
+
+DROP EXTENSION pg_kmersearch CASCADE;
+SET client_min_messages = NOTICE;
\ No newline at end of file
@@ -0,0 +1,91 @@
+SET client_min_messages = WARNING;
+
+-- Limit parallel workers to 2 for consistent test results
+SET max_parallel_maintenance_workers = 2;
+
+CREATE EXTENSION IF NOT EXISTS pg_kmersearch;
+
+-- Same fixture as 09_highfreq_filter: k=4 yields 6 high-frequency k-mers
+SET kmersearch.kmer_size = 4;
+SET kmersearch.occur_bitlen = 4;
+SET kmersearch.max_appearance_rate = 0.25;
+SET kmersearch.max_appearance_nrow = 0;
+SET kmersearch.min_score = 1;
+SET kmersearch.min_shared_kmer_rate = 0.9;
+SET kmersearch.preclude_highfreq_kmer = true;
+SET kmersearch.force_use_parallel_highfreq_kmer_cache = false;
+
+CREATE TABLE test_dna_highfreq (
+    id SERIAL PRIMARY KEY,
+    seq DNA2
+);
+INSERT INTO test_dna_highfreq (seq) VALUES
+    ('AAAACTGTACGT'::DNA2),
+    ('AAAAGCATGCAT'::DNA2),
+    ('AAAATCGATCGA'::DNA2),
+    ('AAAACCCCGGGG'::DNA2),
+    ('AAAATTTTAAAA'::DNA2),
+    ('TCGTAAAACGTA'::DNA2),
+    ('GCATAAAATCGA'::DNA2),
+    ('ATCGAAAACCCC'::DNA2),
+    ('CCCCAAAATTTT'::DNA2),
+    ('TTTTAAAACCCC'::DNA2),
+    ('CCCCCCCCCCCC'::DNA2),
+    ('TTTTTTTTTTTT'::DNA2),
+    ('ACGTACGTACGT'::DNA2),
+    ('TGCATGCATGCA'::DNA2);
+
+SELECT kmersearch_perform_highfreq_analysis('test_dna_highfreq', 'seq');
+
+SET enable_seqscan = off;
+SELECT kmersearch_highfreq_kmer_cache_load('test_dna_highfreq', 'seq');
+CREATE INDEX idx_highfreq ON test_dna_highfreq USING gin (seq kmersearch_dna2_gin_ops_int2);
+
+-- Hide the analysis: only the loaded cache still leaves out AAAA and AAAC,
+-- which row 1 needs dropped from the query to reach its indexed keys
+CREATE TEMP TABLE saved_highfreq AS SELECT * FROM kmersearch_highfreq_kmer;
+DELETE FROM kmersearch_highfreq_kmer;
+SELECT id FROM test_dna_highfreq WHERE seq =% 'AAAACTGTACGT' ORDER BY id;
+
+-- A parallel worker maps the leader's cache instead of reloading the
+-- (now empty) k-mer set, so it finds row 1 too
+SET debug_parallel_query = on;
+EXPLAIN (COSTS OFF) SELECT id FROM test_dna_highfreq WHERE seq =% 'AAAACTGTACGT' ORDER BY id;
+SELECT id FROM test_dna_highfreq WHERE seq =% 'AAAACTGTACGT' ORDER BY id;
+
+-- Freeing the cache in a rolled-back transaction still frees it; the
+-- restored setting names a filter that is gone, so workers agree
+BEGIN;
+SELECT kmersearch_highfreq_kmer_cache_free('test_dna_highfreq', 'seq');
+ROLLBACK;
+SELECT id FROM test_dna_highfreq WHERE seq =% 'AAAACTGTACGT' ORDER BY id;
+SET debug_parallel_query = off;
+SELECT id FROM test_dna_highfreq WHERE seq =% 'AAAACTGTACGT' ORDER BY id;
+
+-- A cache loaded in a rolled-back transaction or savepoint is dropped with it
+INSERT INTO kmersearch_highfreq_kmer SELECT * FROM saved_highfreq;
+BEGIN;
+SELECT kmersearch_highfreq_kmer_cache_load('test_dna_highfreq', 'seq');
+ROLLBACK;
+SELECT kmersearch_highfreq_kmer_cache_free_all();
+BEGIN;
+SAVEPOINT before_load;
+SELECT kmersearch_highfreq_kmer_cache_load('test_dna_highfreq', 'seq');
+ROLLBACK TO SAVEPOINT before_load;
+SELECT kmersearch_highfreq_kmer_cache_free_all();
+COMMIT;
+
+-- A released savepoint hands the cache to its committing parent
+BEGIN;
+SAVEPOINT before_load;
+SELECT kmersearch_highfreq_kmer_cache_load('test_dna_highfreq', 'seq');
+RELEASE SAVEPOINT before_load;
+COMMIT;
+SELECT kmersearch_highfreq_kmer_cache_free_all();
+
+RESET enable_seqscan;
+DROP TABLE saved_highfreq;
+DROP TABLE test_dna_highfreq CASCADE;
+
+DROP EXTENSION pg_kmersearch CASCADE;
+SET client_min_messages = NOTICE;
\ No newline at end of file